@@ -0,0 +1,358 @@
+//--------------------------------------------------------------------------------------
+// File: DXUTAdjacency.cpp
+//
+// Spatial hash vertex welding and edge hash adjacency.  See DXUTAdjacency.h.
+//--------------------------------------------------------------------------------------
+#include "DXUTAdjacency.h"
+#include "DXUTJobSystem.h"
+#include "DXUTProfiler.h"
+
+#include <math.h>
+#include <string.h>
+#include <new>
+#include <vector>
+
+// Items per ParallelFor chunk; small enough to balance, large enough to amortize
+#define DXUT_ADJACENCY_GRAIN    4096
+
+
+//--------------------------------------------------------------------------------------
+// Bucketed hash table built with a counting sort.  Items land in their bucket in
+// increasing index order, which keeps the results independent of thread timing.
+//--------------------------------------------------------------------------------------
+struct DXUTHashBuckets
+{
+    unsigned int nMask;
+    std::vector<unsigned int> Start;    // Bucket b holds Items[Start[b]] .. Items[Start[b + 1] - 1]
+    std::vector<unsigned int> Items;
+};
+
+static void DXUTBuildHashBuckets( const std::vector<unsigned int>& Hashes, DXUTHashBuckets* pBuckets )
+{
+    unsigned int nItems = ( unsigned int )Hashes.size();
+    unsigned int nBuckets = 1;
+    while( nBuckets < nItems )
+        nBuckets <<= 1;
+
+    pBuckets->nMask = nBuckets - 1;
+    pBuckets->Start.assign( nBuckets + 1, 0 );
+    pBuckets->Items.resize( nItems );
+
+    for( unsigned int i = 0; i < nItems; i++ )
+        pBuckets->Start[( Hashes[i] & pBuckets->nMask ) + 1]++;
+    for( unsigned int b = 0; b < nBuckets; b++ )
+        pBuckets->Start[b + 1] += pBuckets->Start[b];
+
+    std::vector<unsigned int> Cursor( pBuckets->Start.begin(), pBuckets->Start.end() - 1 );
+    for( unsigned int i = 0; i < nItems; i++ )
+        pBuckets->Items[Cursor[Hashes[i] & pBuckets->nMask]++] = i;
+}
+
+static inline unsigned int DXUTHashCell( int x, int y, int z )
+{
+    return ( ( unsigned int )x * 73856093u ) ^ ( ( unsigned int )y * 19349663u ) ^ ( ( unsigned int )z * 83492791u );
+}
+
+static inline unsigned int DXUTHashFloatBits( float f )
+{
+    // Adding zero turns -0 into +0 so they hash alike
+    f += 0.0f;
+    unsigned int n;
+    memcpy( &n, &f, sizeof( n ) );
+    return n;
+}
+
+static inline int DXUTCellCoord( float f, float fInvCellSize )
+{
+    float c = floorf( f * fInvCellSize );
+    if( c < -1073741824.0f )
+        return -1073741824;
+    if( c > 1073741824.0f )
+        return 1073741824;
+    return ( int )c;
+}
+
+
+//--------------------------------------------------------------------------------------
+// Point reps
+//--------------------------------------------------------------------------------------
+struct DXUTPointRepContext
+{
+    const unsigned char* pVertices;
+    unsigned int nStride;
+    float fEpsilon;
+    float fInvCellSize;
+    std::vector<unsigned int>* pHashes;
+    DXUTHashBuckets* pBuckets;
+    unsigned int* pPointReps;
+
+    const float* GetPosition( unsigned int i ) const
+    {
+        return ( const float* )( pVertices + ( size_t )i * nStride );
+    }
+};
+
+static void DXUTHashVertices( unsigned int iBegin, unsigned int iEnd, void* pUserContext )
+{
+    DXUTPointRepContext* pContext = ( DXUTPointRepContext* )pUserContext;
+    std::vector<unsigned int>& Hashes = *pContext->pHashes;
+
+    for( unsigned int i = iBegin; i < iEnd; i++ )
+    {
+        const float* p = pContext->GetPosition( i );
+        if( pContext->fEpsilon > 0.0f )
+        {
+            Hashes[i] = DXUTHashCell( DXUTCellCoord( p[0], pContext->fInvCellSize ),
+                                      DXUTCellCoord( p[1], pContext->fInvCellSize ),
+                                      DXUTCellCoord( p[2], pContext->fInvCellSize ) );
+        }
+        else
+        {
+            Hashes[i] = DXUTHashCell( ( int )DXUTHashFloatBits( p[0] ), ( int )DXUTHashFloatBits( p[1] ),
+                                      ( int )DXUTHashFloatBits( p[2] ) );
+        }
+    }
+}
+
+// Lowest index in bucket b that is coincident with p, or nBest if none is lower
+static unsigned int DXUTFindCoincident( const DXUTPointRepContext* pContext, unsigned int b, const float* p,
+                                        unsigned int nBest )
+{
+    const DXUTHashBuckets* pBuckets = pContext->pBuckets;
+    float fEpsilon = pContext->fEpsilon;
+
+    for( unsigned int k = pBuckets->Start[b]; k < pBuckets->Start[b + 1]; k++ )
+    {
+        // Items are sorted, so nothing later in the bucket can beat nBest
+        unsigned int j = pBuckets->Items[k];
+        if( j >= nBest )
+            break;
+
+        const float* q = pContext->GetPosition( j );
+        if( fabsf( p[0] - q[0] ) <= fEpsilon &&
+            fabsf( p[1] - q[1] ) <= fEpsilon &&
+            fabsf( p[2] - q[2] ) <= fEpsilon )
+            return j;
+    }
+    return nBest;
+}
+
+static void DXUTFindPointReps( unsigned int iBegin, unsigned int iEnd, void* pUserContext )
+{
+    DXUTPointRepContext* pContext = ( DXUTPointRepContext* )pUserContext;
+    unsigned int nMask = pContext->pBuckets->nMask;
+
+    for( unsigned int i = iBegin; i < iEnd; i++ )
+    {
+        const float* p = pContext->GetPosition( i );
+
+        // The vertex itself is always a match, so the answer is at most i
+        unsigned int nBest = i;
+        if( pContext->fEpsilon > 0.0f )
+        {
+            // Cells are epsilon wide, so every coincident vertex is in a neighbouring cell
+            int x = DXUTCellCoord( p[0], pContext->fInvCellSize );
+            int y = DXUTCellCoord( p[1], pContext->fInvCellSize );
+            int z = DXUTCellCoord( p[2], pContext->fInvCellSize );
+            for( int dz = -1; dz <= 1; dz++ )
+                for( int dy = -1; dy <= 1; dy++ )
+                    for( int dx = -1; dx <= 1; dx++ )
+                        nBest = DXUTFindCoincident( pContext, DXUTHashCell( x + dx, y + dy, z + dz ) & nMask, p, nBest );
+        }
+        else
+        {
+            nBest = DXUTFindCoincident( pContext, ( *pContext->pHashes )[i] & nMask, p, nBest );
+        }
+
+        pContext->pPointReps[i] = nBest;
+    }
+}
+
+
+//--------------------------------------------------------------------------------------
+bool DXUTGeneratePointReps( const void* pVertices, unsigned int nStride, unsigned int nVertices,
+                            float fEpsilon, unsigned int* pPointReps )
+{
+    DXUT_PROFILE_ZONE( "DXUTGeneratePointReps" );
+
+    try
+    {
+        std::vector<unsigned int> Hashes( nVertices );
+        DXUTHashBuckets Buckets;
+
+        DXUTPointRepContext Context;
+        Context.pVertices = ( const unsigned char* )pVertices;
+        Context.nStride = nStride;
+        Context.fEpsilon = ( fEpsilon > 0.0f ) ? fEpsilon : 0.0f;
+        Context.fInvCellSize = ( fEpsilon > 0.0f ) ? 1.0f / fEpsilon : 0.0f;
+        Context.pHashes = &Hashes;
+        Context.pBuckets = &Buckets;
+        Context.pPointReps = pPointReps;
+
+        CDXUTJobSystem* pJobs = DXUTGetJobSystem();
+        pJobs->ParallelFor( 0, nVertices, DXUT_ADJACENCY_GRAIN, DXUTHashVertices, &Context );
+        DXUTBuildHashBuckets( Hashes, &Buckets );
+        pJobs->ParallelFor( 0, nVertices, DXUT_ADJACENCY_GRAIN, DXUTFindPointReps, &Context );
+    }
+    catch( std::bad_alloc& )
+    {
+        return false;
+    }
+
+    // Coincidence within epsilon isn't transitive, so a vertex's match may itself have
+    // matched something lower.  Matches always have lower indices, so one ascending
+    // pass makes every rep point at the root of its chain.
+    for( unsigned int i = 0; i < nVertices; i++ )
+        pPointReps[i] = pPointReps[pPointReps[i]];
+
+    return true;
+}
+
+
+//--------------------------------------------------------------------------------------
+// GS adjacency
+//--------------------------------------------------------------------------------------
+struct DXUTAdjacencyContext
+{
+    const void* pIndices;
+    bool b32BitIndices;
+    const unsigned int* pPointReps;
+    unsigned int nVertices;
+    std::vector<unsigned int>* pHashes;
+    DXUTHashBuckets* pBuckets;
+    void* pAdjacencyIndices;
+
+    unsigned int GetIndex( unsigned int i ) const
+    {
+        return b32BitIndices ? ( ( const unsigned int* )pIndices )[i] : ( ( const unsigned short* )pIndices )[i];
+    }
+    unsigned int GetRep( unsigned int i ) const
+    {
+        unsigned int nIndex = GetIndex( i );
+        return ( nIndex < nVertices ) ? pPointReps[nIndex] : nIndex;
+    }
+    // Point reps of the edge that starts at corner i
+    void GetEdge( unsigned int i, unsigned int* pA, unsigned int* pB ) const
+    {
+        unsigned int iTri = i / 3;
+        *pA = GetRep( i );
+        *pB = GetRep( iTri * 3 + ( i % 3 + 1 ) % 3 );
+    }
+};
+
+static inline unsigned int DXUTHashEdge( unsigned int a, unsigned int b )
+{
+    // Order independent so both windings of an edge share a bucket
+    unsigned int nLow = ( a < b ) ? a : b;
+    unsigned int nHigh = ( a < b ) ? b : a;
+    return ( nLow * 73856093u ) ^ ( nHigh * 19349663u );
+}
+
+static void DXUTHashEdges( unsigned int iBegin, unsigned int iEnd, void* pUserContext )
+{
+    DXUTAdjacencyContext* pContext = ( DXUTAdjacencyContext* )pUserContext;
+    std::vector<unsigned int>& Hashes = *pContext->pHashes;
+
+    for( unsigned int i = iBegin; i < iEnd; i++ )
+    {
+        unsigned int a, b;
+        pContext->GetEdge( i, &a, &b );
+        Hashes[i] = DXUTHashEdge( a, b );
+    }
+}
+
+static void DXUTMatchEdges( unsigned int iBegin, unsigned int iEnd, void* pUserContext )
+{
+    DXUTAdjacencyContext* pContext = ( DXUTAdjacencyContext* )pUserContext;
+    const DXUTHashBuckets* pBuckets = pContext->pBuckets;
+
+    for( unsigned int iTri = iBegin; iTri < iEnd; iTri++ )
+    {
+        for( unsigned int iCorner = 0; iCorner < 3; iCorner++ )
+        {
+            unsigned int iEdge = iTri * 3 + iCorner;
+            unsigned int a, b;
+            pContext->GetEdge( iEdge, &a, &b );
+
+            unsigned int nAdjacent = pContext->GetIndex( iTri * 3 + ( iCorner + 2 ) % 3 );
+            if( a != b )
+            {
+                unsigned int iOpposite = ( unsigned int )-1;
+                unsigned int iSameWinding = ( unsigned int )-1;
+
+                unsigned int nBucket = ( *pContext->pHashes )[iEdge] & pBuckets->nMask;
+                for( unsigned int k = pBuckets->Start[nBucket]; k < pBuckets->Start[nBucket + 1]; k++ )
+                {
+                    unsigned int iOther = pBuckets->Items[k];
+                    if( iOther / 3 == iTri )
+                        continue;
+
+                    unsigned int c, d;
+                    pContext->GetEdge( iOther, &c, &d );
+                    if( c == b && d == a )
+                    {
+                        iOpposite = iOther;
+                        break;
+                    }
+                    if( c == a && d == b && iSameWinding == ( unsigned int )-1 )
+                        iSameWinding = iOther;
+                }
+
+                unsigned int iMatch = ( iOpposite != ( unsigned int )-1 ) ? iOpposite : iSameWinding;
+                if( iMatch != ( unsigned int )-1 )
+                    nAdjacent = pContext->GetIndex( ( iMatch / 3 ) * 3 + ( iMatch % 3 + 2 ) % 3 );
+            }
+
+            unsigned int iOut = iTri * 6 + iCorner * 2;
+            unsigned int nCorner = pContext->GetIndex( iEdge );
+            if( pContext->b32BitIndices )
+            {
+                ( ( unsigned int* )pContext->pAdjacencyIndices )[iOut] = nCorner;
+                ( ( unsigned int* )pContext->pAdjacencyIndices )[iOut + 1] = nAdjacent;
+            }
+            else
+            {
+                ( ( unsigned short* )pContext->pAdjacencyIndices )[iOut] = ( unsigned short )nCorner;
+                ( ( unsigned short* )pContext->pAdjacencyIndices )[iOut + 1] = ( unsigned short )nAdjacent;
+            }
+        }
+    }
+}
+
+
+//--------------------------------------------------------------------------------------
+bool DXUTGenerateGSAdjacency( const void* pIndices, bool b32BitIndices, unsigned int nIndices,
+                              const unsigned int* pPointReps, unsigned int nVertices,
+                              void* pAdjacencyIndices )
+{
+    DXUT_PROFILE_ZONE( "DXUTGenerateGSAdjacency" );
+
+    unsigned int nTriangles = nIndices / 3;
+    unsigned int nEdges = nTriangles * 3;
+
+    try
+    {
+        std::vector<unsigned int> Hashes( nEdges );
+        DXUTHashBuckets Buckets;
+
+        DXUTAdjacencyContext Context;
+        Context.pIndices = pIndices;
+        Context.b32BitIndices = b32BitIndices;
+        Context.pPointReps = pPointReps;
+        Context.nVertices = nVertices;
+        Context.pHashes = &Hashes;
+        Context.pBuckets = &Buckets;
+        Context.pAdjacencyIndices = pAdjacencyIndices;
+
+        CDXUTJobSystem* pJobs = DXUTGetJobSystem();
+        pJobs->ParallelFor( 0, nEdges, DXUT_ADJACENCY_GRAIN, DXUTHashEdges, &Context );
+        DXUTBuildHashBuckets( Hashes, &Buckets );
+        pJobs->ParallelFor( 0, nTriangles, DXUT_ADJACENCY_GRAIN / 3, DXUTMatchEdges, &Context );
+    }
+    catch( std::bad_alloc& )
+    {
+        return false;
+    }
+
+    return true;
+}
@@ -0,0 +1,34 @@
+//--------------------------------------------------------------------------------------
+// File: DXUTAdjacency.h
+//
+// Portable replacement for ID3DX10Mesh::GenerateAdjacencyAndPointReps and
+// ID3DX10Mesh::GenerateGSAdjacency.
+//
+// Vertices whose positions are within epsilon of each other are welded with a spatial
+// hash; each vertex's point rep is the lowest index it is welded to.  Triangle edges
+// are then matched through a hash of their point rep pairs to find, for every edge,
+// the vertex opposite it in the neighbouring triangle.  Both passes run in parallel
+// on DXUTGetJobSystem().
+//--------------------------------------------------------------------------------------
+#pragma once
+#ifndef DXUT_ADJACENCY_H
+#define DXUT_ADJACENCY_H
+
+// pVertices points at nVertices vertices nStride bytes apart, each starting with a
+// float3 position.  Two vertices are coincident when every component of their
+// positions differs by at most fEpsilon (fEpsilon == 0 welds exact matches only).
+// pPointReps receives nVertices entries.  Returns false if out of memory.
+bool    DXUTGeneratePointReps( const void* pVertices, unsigned int nStride, unsigned int nVertices,
+                               float fEpsilon, unsigned int* pPointReps );
+
+// Builds a triangle-list-with-adjacency index buffer from a triangle list: six indices
+// per triangle, v0 adj01 v1 adj12 v2 adj20, in the same 16 or 32-bit format as the
+// input.  An edge with no neighbour gets the triangle's own opposite vertex, so the
+// geometry shader sees the triangle as its own neighbour.  Neighbours with the
+// opposite winding are preferred.
+// pAdjacencyIndices receives nIndices * 2 entries.  Returns false if out of memory.
+bool    DXUTGenerateGSAdjacency( const void* pIndices, bool b32BitIndices, unsigned int nIndices,
+                                 const unsigned int* pPointReps, unsigned int nVertices,
+                                 void* pAdjacencyIndices );
+
+#endif
@@ -0,0 +1,158 @@
+//--------------------------------------------------------------------------------------
+// File: DXUTArena.cpp
+//
+// Block management for CDXUTArena and the per-thread arenas.  See DXUTArena.h for
+// usage.
+//--------------------------------------------------------------------------------------
+#include "DXUTArena.h"
+
+#include <stdlib.h>
+
+// Blocks are chained newest first.  The data starts after the header, which is padded
+// so the first allocation in a block is aligned like DXUT_ARENA_DEFAULT_ALIGN.
+struct DXUTArenaBlock
+{
+    DXUTArenaBlock* pPrev;
+    size_t nSize;               // Bytes of data after the header
+};
+
+#define DXUT_ARENA_HEADER_SIZE  ( ( sizeof( DXUTArenaBlock ) + DXUT_ARENA_DEFAULT_ALIGN - 1 ) & \
+                                  ~( size_t )( DXUT_ARENA_DEFAULT_ALIGN - 1 ) )
+
+static inline char* DXUTArenaBlockData( DXUTArenaBlock* pBlock )
+{
+    return ( char* )pBlock + DXUT_ARENA_HEADER_SIZE;
+}
+
+
+//--------------------------------------------------------------------------------------
+// Global/Static Members
+//--------------------------------------------------------------------------------------
+#ifdef _MSC_VER
+static __declspec( thread ) CDXUTArena* s_pThreadArena = NULL;
+#else
+static __thread CDXUTArena* s_pThreadArena = NULL;
+#endif
+
+
+//--------------------------------------------------------------------------------------
+CDXUTArena::CDXUTArena( DXUT_MEM_TAG Tag, size_t nMinBlockSize ) :
+    m_pBlock( NULL ),
+    m_pSpare( NULL ),
+    m_pCur( NULL ),
+    m_pEnd( NULL ),
+    m_nMinBlockSize( nMinBlockSize ),
+    m_nNextBlockSize( nMinBlockSize ),
+    m_nReservedBytes( 0 ),
+    m_Tag( Tag )
+{
+}
+
+
+//--------------------------------------------------------------------------------------
+CDXUTArena::~CDXUTArena()
+{
+    Release();
+}
+
+
+//--------------------------------------------------------------------------------------
+// Slow path of Alloc: moves on to a spare block if the request fits in it, otherwise
+// allocates a new one.  Whatever was left in the previous block is wasted.
+//--------------------------------------------------------------------------------------
+void* CDXUTArena::AllocFromNewBlock( size_t nBytes, size_t nAlign )
+{
+    // Block data is aligned to DXUT_ARENA_DEFAULT_ALIGN; anything stricter may need padding
+    size_t nNeeded = nBytes + ( nAlign > DXUT_ARENA_DEFAULT_ALIGN ? nAlign : 0 );
+    if( nNeeded < nBytes )
+        return NULL;
+
+    DXUTArenaBlock* pBlock = NULL;
+    if( m_pSpare && m_pSpare->nSize >= nNeeded )
+    {
+        pBlock = m_pSpare;
+        m_pSpare = pBlock->pPrev;
+    }
+    else
+    {
+        size_t nSize = m_nNextBlockSize > nNeeded ? m_nNextBlockSize : nNeeded;
+        if( nSize > ( size_t )-1 - DXUT_ARENA_HEADER_SIZE )
+            return NULL;
+
+        pBlock = ( DXUTArenaBlock* )malloc( DXUT_ARENA_HEADER_SIZE + nSize );
+        if( pBlock == NULL )
+            return NULL;
+        pBlock->nSize = nSize;
+        m_nReservedBytes += nSize;
+        DXUT_MEM_ALLOC( m_Tag, DXUT_ARENA_HEADER_SIZE + nSize );
+
+        if( m_nNextBlockSize < DXUT_ARENA_MAX_BLOCK_SIZE )
+            m_nNextBlockSize *= 2;
+    }
+
+    pBlock->pPrev = m_pBlock;
+    m_pBlock = pBlock;
+    m_pCur = DXUTArenaBlockData( pBlock );
+    m_pEnd = m_pCur + pBlock->nSize;
+
+    return Alloc( nBytes, nAlign );
+}
+
+
+//--------------------------------------------------------------------------------------
+void CDXUTArena::Rewind( const Marker& Mark )
+{
+    while( m_pBlock != Mark.pBlock )
+    {
+        DXUTArenaBlock* pBlock = m_pBlock;
+        m_pBlock = pBlock->pPrev;
+        pBlock->pPrev = m_pSpare;
+        m_pSpare = pBlock;
+    }
+
+    m_pCur = Mark.pCur;
+    m_pEnd = m_pBlock ? DXUTArenaBlockData( m_pBlock ) + m_pBlock->nSize : NULL;
+}
+
+
+//--------------------------------------------------------------------------------------
+void CDXUTArena::Reset()
+{
+    Marker Empty = { NULL, NULL };
+    Rewind( Empty );
+}
+
+
+//--------------------------------------------------------------------------------------
+void CDXUTArena::Release()
+{
+    Reset();
+
+    while( m_pSpare )
+    {
+        DXUTArenaBlock* pBlock = m_pSpare;
+        m_pSpare = pBlock->pPrev;
+        DXUT_MEM_FREE( m_Tag, DXUT_ARENA_HEADER_SIZE + pBlock->nSize );
+        free( pBlock );
+    }
+
+    m_nReservedBytes = 0;
+    m_nNextBlockSize = m_nMinBlockSize;
+}
+
+
+//--------------------------------------------------------------------------------------
+CDXUTArena* DXUTGetThreadArena()
+{
+    if( s_pThreadArena == NULL )
+        s_pThreadArena = new CDXUTArena( DXUT_MEM_PARSER );
+    return s_pThreadArena;
+}
+
+
+//--------------------------------------------------------------------------------------
+void DXUTReleaseThreadArena()
+{
+    delete s_pThreadArena;
+    s_pThreadArena = NULL;
+}
@@ -0,0 +1,139 @@
+//--------------------------------------------------------------------------------------
+// File: DXUTArena.h
+//
+// Monotonic allocator for short-lived load-time objects.  Allocations bump a pointer
+// through large blocks and are never freed one at a time; the whole arena is rewound
+// or released at once when the work that needed it is done:
+//
+//      CDXUTArena Arena( DXUT_MEM_VERTEX_CACHE );
+//      CacheEntry* pEntry = Arena.New<CacheEntry>();
+//      ...
+//      Arena.Release();            // Every entry at once, one free per block
+//
+// Destructors are never run, so only use it for types that don't need them.
+//
+// Each thread can take scratch memory from DXUTGetThreadArena() without locking.  A
+// CDXUTArenaScope rewinds it when the work is done, in one step, and the blocks are
+// reused by the next work on that thread; the .obj parser keeps its line buffers there.
+// A thread that used it calls DXUTReleaseThreadArena before it exits.
+//
+// Blocks are reported to DXUTMemTrack under the tag given to the constructor.
+//--------------------------------------------------------------------------------------
+#pragma once
+#ifndef DXUT_ARENA_H
+#define DXUT_ARENA_H
+
+#include <stddef.h>
+#include <new>
+#include "DXUTMemTrack.h"
+
+// The first block is this big; each new block doubles up to the maximum.  Requests
+// bigger than the current block size get a block of their own.
+#define DXUT_ARENA_MIN_BLOCK_SIZE   ( 64 * 1024 )
+#define DXUT_ARENA_MAX_BLOCK_SIZE   ( 4 * 1024 * 1024 )
+#define DXUT_ARENA_DEFAULT_ALIGN    16
+
+struct DXUTArenaBlock;
+
+class CDXUTArena
+{
+public:
+    // Position to rewind to; only valid until the arena is rewound past it
+    struct Marker
+    {
+        DXUTArenaBlock* pBlock;
+        char* pCur;
+    };
+
+            CDXUTArena( DXUT_MEM_TAG Tag, size_t nMinBlockSize = DXUT_ARENA_MIN_BLOCK_SIZE );
+            ~CDXUTArena();
+
+    // Returns NULL when out of memory.  nAlign must be a power of two.
+    void*   Alloc( size_t nBytes, size_t nAlign = DXUT_ARENA_DEFAULT_ALIGN )
+    {
+        char* p = ( char* )( ( ( size_t )m_pCur + nAlign - 1 ) & ~( nAlign - 1 ) );
+        if( m_pCur && p <= m_pEnd && nBytes <= ( size_t )( m_pEnd - p ) )
+        {
+            m_pCur = p + nBytes;
+            return p;
+        }
+        return AllocFromNewBlock( nBytes, nAlign );
+    }
+
+    // Value-initialized, like new TYPE()
+    template<typename TYPE> TYPE* New()
+    {
+        void* p = Alloc( sizeof( TYPE ), __alignof( TYPE ) );
+        return p ? new( p ) TYPE() : NULL;
+    }
+
+    Marker  GetMarker() const
+    {
+        Marker Mark = { m_pBlock, m_pCur };
+        return Mark;
+    }
+    // Blocks filled after the marker are kept for reuse rather than freed
+    void    Rewind( const Marker& Mark );
+
+    // Forgets every allocation but keeps the blocks for the next use
+    void    Reset();
+
+    // Forgets every allocation and frees the blocks
+    void    Release();
+
+    // Bytes of block memory currently held, used or not
+    size_t  GetReservedBytes() const
+    {
+        return m_nReservedBytes;
+    }
+
+private:
+    CDXUTArena( const CDXUTArena& );
+    CDXUTArena& operator=( const CDXUTArena& );
+
+    void*   AllocFromNewBlock( size_t nBytes, size_t nAlign );
+
+    DXUTArenaBlock* m_pBlock;       // Block being filled; earlier blocks hang off it
+    DXUTArenaBlock* m_pSpare;       // Rewound blocks waiting to be reused
+    char*   m_pCur;
+    char*   m_pEnd;
+    size_t  m_nMinBlockSize;
+    size_t  m_nNextBlockSize;
+    size_t  m_nReservedBytes;
+    DXUT_MEM_TAG m_Tag;
+};
+
+
+//--------------------------------------------------------------------------------------
+// Rewinds an arena to where it was when the scope was entered
+//--------------------------------------------------------------------------------------
+class CDXUTArenaScope
+{
+public:
+    CDXUTArenaScope( CDXUTArena* pArena ) : m_pArena( pArena ), m_Mark( pArena->GetMarker() )
+    {
+    }
+    ~CDXUTArenaScope()
+    {
+        m_pArena->Rewind( m_Mark );
+    }
+
+private:
+    CDXUTArenaScope( const CDXUTArenaScope& );
+    CDXUTArenaScope& operator=( const CDXUTArenaScope& );
+
+    CDXUTArena* m_pArena;
+    CDXUTArena::Marker m_Mark;
+};
+
+
+//--------------------------------------------------------------------------------------
+// Per-thread arenas.  Each thread gets its own on first use, tagged DXUT_MEM_PARSER.
+//--------------------------------------------------------------------------------------
+CDXUTArena*         DXUTGetThreadArena();
+
+// Frees the calling thread's arena and its blocks; the next DXUTGetThreadArena on the
+// thread makes a new one
+void                DXUTReleaseThreadArena();
+
+#endif
@@ -0,0 +1,360 @@
+//--------------------------------------------------------------------------------------
+// File: DXUTDepthReproject.cpp
+//
+// Forward warping of linear depth images.  See DXUTDepthReproject.h.
+//--------------------------------------------------------------------------------------
+#include "DXUTDepthReproject.h"
+
+#include <float.h>
+#include <math.h>
+
+// Values in m_Warped besides real depths.  Anything real is nearer than the
+// background, which is nearer than nothing at all, so one min does the depth test.
+static const float s_fBackground = 1e30f;
+static const float s_fHole = FLT_MAX;
+
+
+//--------------------------------------------------------------------------------------
+CDXUTDepthReprojector::CDXUTDepthReprojector() : m_nWidth( 0 ),
+                                                 m_nHeight( 0 ),
+                                                 m_nTileSize( 0 ),
+                                                 m_nTilesX( 0 ),
+                                                 m_nTilesY( 0 ),
+                                                 m_fTolerance( 0.0f )
+{
+}
+
+
+//--------------------------------------------------------------------------------------
+bool CDXUTDepthReprojector::Create( unsigned int nWidth, unsigned int nHeight, unsigned int nTileSize,
+                                    float fTolerance )
+{
+    if( nWidth == 0 || nHeight == 0 || nTileSize == 0 || !( fTolerance >= 0.0f ) )
+        return false;
+
+    m_nWidth = nWidth;
+    m_nHeight = nHeight;
+    m_nTileSize = nTileSize;
+    m_nTilesX = ( nWidth + nTileSize - 1 ) / nTileSize;
+    m_nTilesY = ( nHeight + nTileSize - 1 ) / nTileSize;
+    m_fTolerance = fTolerance;
+    m_Warped.assign( ( size_t )nWidth * nHeight, s_fHole );
+    m_Depth.assign( ( size_t )nWidth * nHeight, 0.0f );
+    m_TileDirty.assign( ( size_t )m_nTilesX * m_nTilesY, 1 );
+    return true;
+}
+
+
+//--------------------------------------------------------------------------------------
+void CDXUTDepthReprojector::Begin( const DXUTMATRIX4* pViewProj )
+{
+    m_mViewProj = *pViewProj;
+    m_Warped.assign( m_Warped.size(), s_fHole );
+}
+
+
+//--------------------------------------------------------------------------------------
+bool CDXUTDepthReprojector::AddSource( const float* pSrcDepth, unsigned int nSrcPitch,
+                                       const DXUT_REPROJECT_RECT* pRect, const DXUTMATRIX4* pSrcViewProj )
+{
+    DXUTMATRIX4 mInvSrc;
+    if( !DXUTMatrixInverse( &mInvSrc, pSrcViewProj ) )
+        return false;
+
+    DXUT_REPROJECT_RECT Whole = { 0, 0, m_nWidth, m_nHeight };
+    Splat( pSrcDepth, nSrcPitch, pRect ? pRect : &Whole, &mInvSrc );
+    return true;
+}
+
+
+//--------------------------------------------------------------------------------------
+unsigned int CDXUTDepthReprojector::End()
+{
+    FillCracks();
+
+    unsigned int nDirty = 0;
+    for( size_t i = 0; i < m_TileDirty.size(); i++ )
+        nDirty += m_TileDirty[i];
+    return nDirty;
+}
+
+
+//--------------------------------------------------------------------------------------
+unsigned int CDXUTDepthReprojector::Reproject( const float* pSrcDepth, const DXUTMATRIX4* pSrcViewProj,
+                                               const DXUTMATRIX4* pViewProj )
+{
+    Begin( pViewProj );
+    AddSource( pSrcDepth, m_nWidth, NULL, pSrcViewProj );
+    return End();
+}
+
+
+//--------------------------------------------------------------------------------------
+// A source pixel at NDC ( x, y ) and depth d was clip space d * ( x, y, a, 1 ) +
+// ( 0, 0, b, 0 ), with a and b read off the source projection.  Through the inverse
+// source and the new view-projection that is d * ( x M0 + y M1 + a M2 + M3 ) + b M2
+// in the new clip space, where Mi are the rows of the combined matrix.  An empty pixel
+// is the direction x M0 + y M1 + a M2 + M3, at infinity.
+//--------------------------------------------------------------------------------------
+void CDXUTDepthReprojector::Splat( const float* pSrcDepth, unsigned int nSrcPitch, const DXUT_REPROJECT_RECT* pRect,
+                                   const DXUTMATRIX4* pInvSrcViewProj )
+{
+    DXUTMATRIX4 M;
+    DXUTMatrixMultiply( &M, pInvSrcViewProj, &m_mViewProj );
+
+    // Two points on the source view axis give clip z as a function of clip w
+    float w[2], z[2];
+    for( int i = 0; i < 2; i++ )
+    {
+        float fNdcZ = 0.5f * i;
+        w[i] = 1.0f / ( fNdcZ * pInvSrcViewProj->m[2][3] + pInvSrcViewProj->m[3][3] );
+        z[i] = fNdcZ * w[i];
+    }
+    float a = ( z[1] - z[0] ) / ( w[1] - w[0] );
+    float b = z[0] - a * w[0];
+
+    // Only x, y and w are needed; the columns used are 0, 1 and 3
+    static const int s_Columns[3] = { 0, 1, 3 };
+    float fBias[3], fStepX[3], fRow0[3];
+    float fWidth = ( float )m_nWidth, fHeight = ( float )m_nHeight;
+    for( int j = 0; j < 3; j++ )
+    {
+        int k = s_Columns[j];
+        fBias[j] = b * M.m[2][k];
+        fStepX[j] = 2.0f / fWidth * M.m[0][k];
+        fRow0[j] = ( 1.0f / fWidth - 1.0f ) * M.m[0][k] + a * M.m[2][k] + M.m[3][k];
+    }
+
+    unsigned int xEnd = pRect->x + pRect->Width, yEnd = pRect->y + pRect->Height;
+    for( unsigned int y = pRect->y; y < yEnd; y++ )
+    {
+        // Left pixel centre of the row; x steps are added to that, not accumulated
+        float fNdcY = 2.0f * ( y + 0.5f ) / fHeight - 1.0f;
+        float fRow[3];
+        for( int j = 0; j < 3; j++ )
+            fRow[j] = fNdcY * M.m[1][s_Columns[j]] + fRow0[j];
+
+        const float* pSrc = pSrcDepth + ( size_t )( y - pRect->y ) * nSrcPitch;
+        unsigned int x = pRect->x;
+#if defined( DXUT_MATH_SSE )
+        // Four pixels at a time up to the depth test, which stays scalar
+        __m128 vStepX[3], vRow[3], vBias[3];
+        for( int j = 0; j < 3; j++ )
+        {
+            vStepX[j] = _mm_set1_ps( fStepX[j] );
+            vRow[j] = _mm_set1_ps( fRow[j] );
+            vBias[j] = _mm_set1_ps( fBias[j] );
+        }
+        const __m128 vZero = _mm_setzero_ps(), vHalf = _mm_set1_ps( 0.5f );
+        const __m128 vWidth = _mm_set1_ps( fWidth ), vHeight = _mm_set1_ps( fHeight );
+        const __m128 vBackground = _mm_set1_ps( s_fBackground );
+        for( ; x + 4 <= xEnd; x += 4 )
+        {
+            __m128 vX = _mm_add_ps( _mm_set1_ps( ( float )x ), _mm_set_ps( 3.0f, 2.0f, 1.0f, 0.0f ) );
+            __m128 d = _mm_loadu_ps( pSrc + x - pRect->x );
+            __m128 vFinite = _mm_cmpgt_ps( d, vZero );
+            __m128 c[3];
+            for( int j = 0; j < 3; j++ )
+            {
+                __m128 vRay = _mm_add_ps( _mm_mul_ps( vX, vStepX[j] ), vRow[j] );
+                __m128 vPoint = _mm_add_ps( _mm_mul_ps( d, vRay ), vBias[j] );
+                c[j] = _mm_or_ps( _mm_and_ps( vFinite, vPoint ), _mm_andnot_ps( vFinite, vRay ) );
+            }
+            __m128 vInvW = _mm_div_ps( vHalf, c[2] );
+            __m128 vPx = _mm_mul_ps( _mm_add_ps( _mm_mul_ps( c[0], vInvW ), vHalf ), vWidth );
+            __m128 vPy = _mm_mul_ps( _mm_add_ps( _mm_mul_ps( c[1], vInvW ), vHalf ), vHeight );
+            __m128 vValid = _mm_and_ps( _mm_cmpgt_ps( c[2], vZero ),
+                                        _mm_and_ps( _mm_and_ps( _mm_cmpge_ps( vPx, vZero ), _mm_cmplt_ps( vPx, vWidth ) ),
+                                                    _mm_and_ps( _mm_cmpge_ps( vPy, vZero ), _mm_cmplt_ps( vPy, vHeight ) ) ) );
+            int nValid = _mm_movemask_ps( vValid );
+            if( nValid == 0 )
+                continue;
+
+            float fPx[4], fPy[4], fDepth[4];
+            _mm_storeu_ps( fPx, vPx );
+            _mm_storeu_ps( fPy, vPy );
+            _mm_storeu_ps( fDepth, _mm_or_ps( _mm_and_ps( vFinite, c[2] ), _mm_andnot_ps( vFinite, vBackground ) ) );
+            for( int k = 0; k < 4; k++ )
+            {
+                if( !( nValid & ( 1 << k ) ) )
+                    continue;
+                float* pDest = &m_Warped[( size_t )( int )fPy[k] * m_nWidth + ( int )fPx[k]];
+                if( fDepth[k] < *pDest )
+                    *pDest = fDepth[k];
+            }
+        }
+#endif
+        for( ; x < xEnd; x++ )
+        {
+            float fx = x * fStepX[0] + fRow[0];
+            float fy = x * fStepX[1] + fRow[1];
+            float fw = x * fStepX[2] + fRow[2];
+
+            float d = pSrc[x - pRect->x], fDepth = s_fBackground;
+            if( d > 0.0f )
+            {
+                fx = d * fx + fBias[0];
+                fy = d * fy + fBias[1];
+                fw = d * fw + fBias[2];
+                fDepth = fw;
+            }
+            if( !( fw > 0.0f ) )
+                continue;
+
+            // Written as a range test on the floats so huge values can't wrap
+            float fInvW = 0.5f / fw;
+            fx = ( fx * fInvW + 0.5f ) * fWidth;
+            fy = ( fy * fInvW + 0.5f ) * fHeight;
+            if( !( fx >= 0.0f && fx < fWidth && fy >= 0.0f && fy < fHeight ) )
+                continue;
+
+            float* pDest = &m_Warped[( size_t )( int )fy * m_nWidth + ( int )fx];
+            if( fDepth < *pDest )
+                *pDest = fDepth;
+        }
+    }
+}
+
+
+//--------------------------------------------------------------------------------------
+// Copies m_Warped to m_Depth, filling the pixels nothing landed on from their
+// neighbours where that is safe, and flags the tiles of the ones that aren't
+//--------------------------------------------------------------------------------------
+void CDXUTDepthReprojector::FillCracks()
+{
+    m_TileDirty.assign( m_TileDirty.size(), 0 );
+
+    for( unsigned int y = 0; y < m_nHeight; y++ )
+    {
+        for( unsigned int x = 0; x < m_nWidth; x++ )
+        {
+            size_t i = ( size_t )y * m_nWidth + x;
+            float fDepth = m_Warped[i];
+            if( fDepth != s_fHole )
+            {
+                m_Depth[i] = fDepth == s_fBackground ? 0.0f : fDepth;
+                continue;
+            }
+
+            unsigned int nNeighbours = 0, nSamples = 0, nBackground = 0, nDepths = 0;
+            float fDepths[8], fMax = 0.0f;
+            for( int dy = -1; dy <= 1; dy++ )
+            {
+                int ny = ( int )y + dy;
+                if( ny < 0 || ny >= ( int )m_nHeight )
+                    continue;
+                for( int dx = -1; dx <= 1; dx++ )
+                {
+                    int nx = ( int )x + dx;
+                    if( ( dx == 0 && dy == 0 ) || nx < 0 || nx >= ( int )m_nWidth )
+                        continue;
+                    nNeighbours++;
+                    float fNeighbour = m_Warped[( size_t )ny * m_nWidth + nx];
+                    if( fNeighbour == s_fHole )
+                        continue;
+                    nSamples++;
+                    if( fNeighbour == s_fBackground )
+                    {
+                        nBackground++;
+                        continue;
+                    }
+                    fDepths[nDepths++] = fNeighbour;
+                    fMax = fmaxf( fMax, fNeighbour );
+                }
+            }
+
+            // A pixel between samples is a crack in a surface, or a sliver a nearer
+            // surface uncovered as it moved.  Either way it belongs to the farthest
+            // surface around it, if at least two of its samples agree on that one.
+            unsigned int nFar = nBackground;
+            float fFar = 0.0f;
+            if( nBackground == 0 )
+            {
+                for( unsigned int k = 0; k < nDepths; k++ )
+                {
+                    if( fDepths[k] * ( 1.0f + m_fTolerance ) >= fMax )
+                    {
+                        nFar++;
+                        fFar += fDepths[k];
+                    }
+                }
+            }
+
+            if( 2 * nSamples >= nNeighbours && nFar >= 2 )
+                m_Depth[i] = nBackground ? 0.0f : fFar / nFar;
+            else
+            {
+                m_Depth[i] = 0.0f;
+                m_TileDirty[( y / m_nTileSize ) * m_nTilesX + x / m_nTileSize] = 1;
+            }
+        }
+    }
+}
+
+
+//--------------------------------------------------------------------------------------
+void CDXUTDepthReprojector::GetDirtyRects( std::vector<DXUT_REPROJECT_RECT>& Rects ) const
+{
+    Rects.clear();
+
+    // Rectangles, in tiles, that reached the row below the current one
+    std::vector<size_t> Open, NextOpen;
+    for( unsigned int ty = 0; ty < m_nTilesY; ty++ )
+    {
+        NextOpen.clear();
+        for( unsigned int tx = 0; tx < m_nTilesX; )
+        {
+            if( !IsTileDirty( tx, ty ) )
+            {
+                tx++;
+                continue;
+            }
+            unsigned int tx0 = tx;
+            while( tx < m_nTilesX && IsTileDirty( tx, ty ) )
+                tx++;
+
+            size_t iRect = Rects.size();
+            for( size_t k = 0; k < Open.size(); k++ )
+            {
+                if( Rects[Open[k]].x == tx0 && Rects[Open[k]].Width == tx - tx0 )
+                {
+                    iRect = Open[k];
+                    break;
+                }
+            }
+            if( iRect == Rects.size() )
+            {
+                DXUT_REPROJECT_RECT Rect = { tx0, ty, tx - tx0, 0 };
+                Rects.push_back( Rect );
+            }
+            Rects[iRect].Height++;
+            NextOpen.push_back( iRect );
+        }
+        Open.swap( NextOpen );
+    }
+
+    for( size_t k = 0; k < Rects.size(); k++ )
+    {
+        DXUT_REPROJECT_RECT& Rect = Rects[k];
+        Rect.x *= m_nTileSize;
+        Rect.y *= m_nTileSize;
+        Rect.Width = ( Rect.x + Rect.Width * m_nTileSize > m_nWidth ? m_nWidth - Rect.x : Rect.Width * m_nTileSize );
+        Rect.Height = ( Rect.y + Rect.Height * m_nTileSize > m_nHeight ? m_nHeight - Rect.y :
+                        Rect.Height * m_nTileSize );
+    }
+}
+
+
+//--------------------------------------------------------------------------------------
+void DXUTGetRectViewProj( DXUTMATRIX4* pOut, const DXUTMATRIX4* pViewProj, const DXUT_REPROJECT_RECT* pRect,
+                          unsigned int nWidth, unsigned int nHeight )
+{
+    float fLeft = 2.0f * pRect->x / nWidth - 1.0f;
+    float fRight = 2.0f * ( pRect->x + pRect->Width ) / nWidth - 1.0f;
+    float fBottom = 2.0f * pRect->y / nHeight - 1.0f;
+    float fTop = 2.0f * ( pRect->y + pRect->Height ) / nHeight - 1.0f;
+
+    DXUTMATRIX4 mCrop;
+    DXUTMatrixProjectionCrop( &mCrop, fLeft, fBottom, fRight, fTop );
+    DXUTMatrixMultiply( pOut, pViewProj, &mCrop );
+}
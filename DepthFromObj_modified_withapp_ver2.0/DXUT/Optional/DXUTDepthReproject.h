@@ -0,0 +1,128 @@
+//--------------------------------------------------------------------------------------
+// File: DXUTDepthReproject.h
+//
+// Forward warping of linear depth images to a nearby camera, so a dense camera path
+// only has to re-rasterize the parts of each frame the earlier ones can't supply.
+//
+// Every pixel of the source images is moved to where its surface point lands in the
+// new view and the nearest point wins.  A pixel nothing landed on is filled with the
+// farthest surface around it when at least half of its eight neighbours have a sample
+// and two of those agree on that surface to within the tolerance: the cracks a slightly
+// magnified surface leaves, and the slivers a moving edge uncovers.  Anything else is
+// a hole, a disocclusion or a strip coming into view at the edges.  The image is split
+// into square tiles and every tile holding a hole is flagged; the caller renders those
+// tiles (GetDirtyRects merges them into rectangles) over the warped image.
+//
+// Depth is the distance along the view axis, which for a perspective projection is
+// clip space w, with 0 where nothing was drawn; empty pixels move as points at
+// infinity.  Row 0 is the bottom of the image (NDC y = -1), as glReadPixels returns
+// it.  The view-projection matrices are in the DXUTMath layout and can be either
+// handedness or depth range, but must be perspective projections with the eye at the
+// origin of view space, i.e. clip z an affine function of clip w.
+//
+// A warp can move a depth edge by up to half a pixel.  Warping a warped image adds
+// that up from frame to frame, so the sources should be rendered images: a full frame
+// rendered every so often, say, plus the tiles rendered since.
+//--------------------------------------------------------------------------------------
+#pragma once
+#ifndef DXUT_DEPTH_REPROJECT_H
+#define DXUT_DEPTH_REPROJECT_H
+
+#include <vector>
+#include "DXUTMath.h"
+
+struct DXUT_REPROJECT_RECT
+{
+    unsigned int x, y;          // Bottom left, in pixels
+    unsigned int Width, Height;
+};
+
+
+//--------------------------------------------------------------------------------------
+class CDXUTDepthReprojector
+{
+public:
+            CDXUTDepthReprojector();
+
+    // fTolerance is the relative depth spread up to which neighbours are taken to be
+    // one surface when filling a pixel, e.g. 0.01 for 1%
+    bool    Create( unsigned int nWidth, unsigned int nHeight, unsigned int nTileSize, float fTolerance );
+
+    // Warps to pViewProj from any number of sources.  A source is the pixels of pRect,
+    // or of the whole image if pRect is NULL, rendered with pSrcViewProj; pSrcDepth is
+    // its bottom left pixel and rows are nSrcPitch floats apart.  AddSource returns
+    // false, and adds nothing, if pSrcViewProj can't be inverted.  End returns the
+    // number of tiles to re-render.
+    void    Begin( const DXUTMATRIX4* pViewProj );
+    bool    AddSource( const float* pSrcDepth, unsigned int nSrcPitch, const DXUT_REPROJECT_RECT* pRect,
+                       const DXUTMATRIX4* pSrcViewProj );
+    unsigned int End();
+
+    // The above for a single whole image
+    unsigned int Reproject( const float* pSrcDepth, const DXUTMATRIX4* pSrcViewProj,
+                            const DXUTMATRIX4* pViewProj );
+
+    // The warped image; holes are 0
+    const float* GetDepth() const
+    {
+        return &m_Depth[0];
+    }
+
+    unsigned int GetWidth() const
+    {
+        return m_nWidth;
+    }
+    unsigned int GetHeight() const
+    {
+        return m_nHeight;
+    }
+    unsigned int GetTileSize() const
+    {
+        return m_nTileSize;
+    }
+    unsigned int GetNumTilesX() const
+    {
+        return m_nTilesX;
+    }
+    unsigned int GetNumTilesY() const
+    {
+        return m_nTilesY;
+    }
+    unsigned int GetNumTiles() const
+    {
+        return m_nTilesX * m_nTilesY;
+    }
+    bool    IsTileDirty( unsigned int iTileX, unsigned int iTileY ) const
+    {
+        return m_TileDirty[iTileY * m_nTilesX + iTileX] != 0;
+    }
+
+    // The dirty tiles of the last End as few rectangles: runs of tiles along
+    // each row, joined with the runs above that span the same columns.  Rectangles are
+    // clipped to the image.
+    void    GetDirtyRects( std::vector<DXUT_REPROJECT_RECT>& Rects ) const;
+
+private:
+    void    Splat( const float* pSrcDepth, unsigned int nSrcPitch, const DXUT_REPROJECT_RECT* pRect,
+                   const DXUTMATRIX4* pInvSrcViewProj );
+    void    FillCracks();
+
+    DXUTMATRIX4 m_mViewProj;
+    unsigned int m_nWidth, m_nHeight;
+    unsigned int m_nTileSize, m_nTilesX, m_nTilesY;
+    float   m_fTolerance;
+    std::vector<float> m_Warped;        // Nearest sample per pixel, before filling
+    std::vector<float> m_Depth;
+    std::vector<unsigned char> m_TileDirty;
+};
+
+
+//--------------------------------------------------------------------------------------
+// The part of pViewProj's image inside Rect as a whole image: pViewProj followed by the
+// scale and offset that stretch Rect to the [-1, 1] square.  Culling against it finds
+// what can touch the rectangle.
+//--------------------------------------------------------------------------------------
+void    DXUTGetRectViewProj( DXUTMATRIX4* pOut, const DXUTMATRIX4* pViewProj, const DXUT_REPROJECT_RECT* pRect,
+                             unsigned int nWidth, unsigned int nHeight );
+
+#endif
@@ -0,0 +1,606 @@
+//--------------------------------------------------------------------------------------
+// File: DXUTDepthSequence.cpp
+//
+// Depth image sequence files.  See DXUTDepthSequence.h.
+//--------------------------------------------------------------------------------------
+#include "DXUTDepthSequence.h"
+
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifndef _WIN32
+#include <sys/types.h>
+#endif
+
+#define DXUT_DSEQ_INDEX_ENTRIES     256
+#define DXUT_DSEQ_MAX_VARINT        10
+
+// Tile encodings, the first byte of each tile
+#define DXUT_DSEQ_TILE_RAW          0
+#define DXUT_DSEQ_TILE_PREDICTED    1
+
+struct DXUT_DSEQ_INDEX_BLOCK
+{
+    char    Magic[4];                   // "DIDX"
+    unsigned int NumEntries;
+    unsigned long long NextBlock;       // 0 until the block after it is written
+    unsigned long long Frames[DXUT_DSEQ_INDEX_ENTRIES];
+};
+
+struct DXUT_DSEQ_FRAME
+{
+    char    Magic[4];                   // "DFRM"
+    unsigned int NumTiles;
+    unsigned long long cbSize;          // Of the whole record
+    DXUT_CAMERA_KEY Camera;
+};
+
+struct DXUT_DSEQ_TILE
+{
+    unsigned int Offset;                // From the start of the record
+    unsigned int cbSize;
+};
+
+static_assert( sizeof( DXUT_DEPTH_SEQUENCE_HEADER ) == 64, "DXUT_DEPTH_SEQUENCE_HEADER is part of the file format" );
+static_assert( sizeof( DXUT_DSEQ_FRAME ) == 104, "DXUT_DSEQ_FRAME is part of the file format" );
+
+
+//--------------------------------------------------------------------------------------
+// Helpers
+//--------------------------------------------------------------------------------------
+// fseek and ftell stop at 2 GB where long is 32 bits
+static bool SeekFile( FILE* fp, unsigned long long nOffset, int nOrigin )
+{
+#ifdef _WIN32
+    return 0 == _fseeki64( fp, ( __int64 )nOffset, nOrigin );
+#else
+    return 0 == fseeko( fp, ( off_t )nOffset, nOrigin );
+#endif
+}
+
+static unsigned long long TellFile( FILE* fp )
+{
+#ifdef _WIN32
+    return ( unsigned long long )_ftelli64( fp );
+#else
+    return ( unsigned long long )ftello( fp );
+#endif
+}
+
+static unsigned int FloatBits( float f )
+{
+    unsigned int n;
+    memcpy( &n, &f, sizeof( n ) );
+    return n;
+}
+
+static float BitsFloat( unsigned int n )
+{
+    float f;
+    memcpy( &f, &n, sizeof( f ) );
+    return f;
+}
+
+// LOCO-I median predictor from the pixel to the left (a), below (b) and below left (c);
+// the first row and column only have one neighbour
+static unsigned int Predict( unsigned int x, unsigned int y, unsigned int a, unsigned int b, unsigned int c )
+{
+    if( y == 0 )
+        return x ? a : 0;
+    if( x == 0 )
+        return b;
+    unsigned int nMin = a < b ? a : b;
+    unsigned int nMax = a < b ? b : a;
+    if( c >= nMax )
+        return nMin;
+    if( c <= nMin )
+        return nMax;
+    return a + b - c;
+}
+
+static void PutVarint( std::vector<unsigned char>& Out, unsigned long long n )
+{
+    while( n >= 0x80 )
+    {
+        Out.push_back( ( unsigned char )( n | 0x80 ) );
+        n >>= 7;
+    }
+    Out.push_back( ( unsigned char )n );
+}
+
+static bool GetVarint( const unsigned char*& p, const unsigned char* pEnd, unsigned long long* pn )
+{
+    unsigned long long n = 0;
+    for( int i = 0; i < DXUT_DSEQ_MAX_VARINT && p < pEnd; i++ )
+    {
+        unsigned char b = *p++;
+        n |= ( unsigned long long )( b & 0x7F ) << ( 7 * i );
+        if( !( b & 0x80 ) )
+        {
+            *pn = n;
+            return true;
+        }
+    }
+    return false;
+}
+
+//--------------------------------------------------------------------------------------
+// A tile is a stream of tokens, each a variable length integer: a run of n exact
+// predictions is ( n - 1 ) * 2 + 1, and any other difference is its zigzag code (0,
+// -1, 1, -2... to 0, 1, 2, 3...) times 2.
+//--------------------------------------------------------------------------------------
+static void EncodeTile( std::vector<unsigned char>& Out, const float* pSrc, ptrdiff_t nPitch, unsigned int nWidth,
+                        unsigned int nHeight )
+{
+    size_t nStart = Out.size();
+    Out.push_back( DXUT_DSEQ_TILE_PREDICTED );
+
+    unsigned long long nRun = 0;
+    for( unsigned int y = 0; y < nHeight; y++ )
+    {
+        const float* pRow = pSrc + nPitch * ( ptrdiff_t )y;
+        const float* pBelow = y ? pRow - nPitch : pRow;
+        for( unsigned int x = 0; x < nWidth; x++ )
+        {
+            unsigned int nPredicted = Predict( x, y, x ? FloatBits( pRow[x - 1] ) : 0, FloatBits( pBelow[x] ),
+                                               x ? FloatBits( pBelow[x - 1] ) : 0 );
+            long long nDiff = ( long long )FloatBits( pRow[x] ) - ( long long )nPredicted;
+            if( nDiff == 0 )
+            {
+                nRun++;
+                continue;
+            }
+            if( nRun )
+                PutVarint( Out, ( ( nRun - 1 ) << 1 ) | 1 );
+            nRun = 0;
+            unsigned long long nZigzag = nDiff < 0 ? ( ( unsigned long long )-nDiff << 1 ) - 1 :
+                                                     ( unsigned long long )nDiff << 1;
+            PutVarint( Out, nZigzag << 1 );
+        }
+    }
+    if( nRun )
+        PutVarint( Out, ( ( nRun - 1 ) << 1 ) | 1 );
+
+    size_t cbRaw = ( size_t )nWidth * nHeight * sizeof( float );
+    if( Out.size() - nStart <= 1 + cbRaw )
+        return;
+
+    Out.resize( nStart + 1 + cbRaw );
+    Out[nStart] = DXUT_DSEQ_TILE_RAW;
+    for( unsigned int y = 0; y < nHeight; y++ )
+        memcpy( &Out[nStart + 1 + ( size_t )y * nWidth * sizeof( float )], pSrc + nPitch * ( ptrdiff_t )y,
+                nWidth * sizeof( float ) );
+}
+
+static bool DecodeTile( const unsigned char* p, size_t cbSize, float* pDst, ptrdiff_t nPitch, unsigned int nWidth,
+                        unsigned int nHeight )
+{
+    const unsigned char* pEnd = p + cbSize;
+    if( cbSize < 1 )
+        return false;
+
+    if( *p == DXUT_DSEQ_TILE_RAW )
+    {
+        if( cbSize != 1 + ( size_t )nWidth * nHeight * sizeof( float ) )
+            return false;
+        for( unsigned int y = 0; y < nHeight; y++ )
+            memcpy( pDst + nPitch * ( ptrdiff_t )y, p + 1 + ( size_t )y * nWidth * sizeof( float ),
+                    nWidth * sizeof( float ) );
+        return true;
+    }
+    if( *p++ != DXUT_DSEQ_TILE_PREDICTED )
+        return false;
+
+    unsigned long long nRun = 0;
+    for( unsigned int y = 0; y < nHeight; y++ )
+    {
+        float* pRow = pDst + nPitch * ( ptrdiff_t )y;
+        const float* pBelow = y ? pRow - nPitch : pRow;
+        for( unsigned int x = 0; x < nWidth; x++ )
+        {
+            unsigned int nPredicted = Predict( x, y, x ? FloatBits( pRow[x - 1] ) : 0, FloatBits( pBelow[x] ),
+                                               x ? FloatBits( pBelow[x - 1] ) : 0 );
+            long long nValue = nPredicted;
+            if( nRun )
+            {
+                nRun--;
+            }
+            else
+            {
+                unsigned long long nToken;
+                if( !GetVarint( p, pEnd, &nToken ) )
+                    return false;
+                if( nToken & 1 )
+                {
+                    nRun = nToken >> 1;
+                }
+                else
+                {
+                    unsigned long long nZigzag = nToken >> 1;
+                    if( nZigzag & 1 )
+                        nValue -= ( long long )( ( nZigzag + 1 ) >> 1 );
+                    else
+                        nValue += ( long long )( nZigzag >> 1 );
+                    if( nValue < 0 || nValue > 0xFFFFFFFFLL )
+                        return false;
+                }
+            }
+            pRow[x] = BitsFloat( ( unsigned int )nValue );
+        }
+    }
+    return nRun == 0 && p == pEnd;
+}
+
+static bool ValidHeader( const DXUT_DEPTH_SEQUENCE_HEADER* pHeader )
+{
+    return 0 == memcmp( pHeader->Magic, "DSEQ", 4 ) && pHeader->Version == DXUT_DEPTH_SEQUENCE_VERSION &&
+           pHeader->Width > 0 && pHeader->Height > 0 && pHeader->TileSize > 0;
+}
+
+
+//--------------------------------------------------------------------------------------
+CDXUTDepthSequenceWriter::CDXUTDepthSequenceWriter() : m_fp( NULL ),
+                                                       m_nEnd( 0 ),
+                                                       m_nIndexBlock( 0 ),
+                                                       m_cbCompressed( 0 ),
+                                                       m_cbRaw( 0 ),
+                                                       m_bError( false )
+{
+    memset( &m_Header, 0, sizeof( m_Header ) );
+}
+
+
+//--------------------------------------------------------------------------------------
+CDXUTDepthSequenceWriter::~CDXUTDepthSequenceWriter()
+{
+    Close();
+}
+
+
+//--------------------------------------------------------------------------------------
+bool CDXUTDepthSequenceWriter::Create( const char* szFileName, unsigned int nWidth, unsigned int nHeight,
+                                       unsigned int nTileSize )
+{
+    Close();
+    if( nWidth == 0 || nHeight == 0 || nTileSize == 0 )
+        return false;
+
+    m_fp = DXUTOpenFile( szFileName, "wb" );
+    if( m_fp == NULL )
+        return false;
+
+    memset( &m_Header, 0, sizeof( m_Header ) );
+    memcpy( m_Header.Magic, "DSEQ", 4 );
+    m_Header.Version = DXUT_DEPTH_SEQUENCE_VERSION;
+    m_Header.Width = nWidth;
+    m_Header.Height = nHeight;
+    m_Header.TileSize = nTileSize;
+    m_nEnd = sizeof( m_Header );
+    m_nIndexBlock = 0;
+    m_cbCompressed = m_cbRaw = 0;
+    m_bError = false;
+
+    if( !WriteAt( 0, &m_Header, sizeof( m_Header ) ) || fflush( m_fp ) != 0 )
+    {
+        Close();
+        return false;
+    }
+    return true;
+}
+
+
+//--------------------------------------------------------------------------------------
+bool CDXUTDepthSequenceWriter::Append( const char* szFileName )
+{
+    Close();
+    m_fp = DXUTOpenFile( szFileName, "r+b" );
+    if( m_fp == NULL )
+        return false;
+
+    m_nIndexBlock = 0;
+    m_cbCompressed = m_cbRaw = 0;
+    m_bError = false;
+    bool bOK = fread( &m_Header, sizeof( m_Header ), 1, m_fp ) == 1 && ValidHeader( &m_Header );
+
+    // Follow the index to the block holding the last frame.  Anything after the last
+    // committed frame is left over from a capture that stopped part way, and stays
+    // unreferenced.
+    unsigned long long nBlock = m_Header.FirstIndexBlock;
+    for( unsigned int i = 0; bOK && i < m_Header.NumFrames; i += DXUT_DSEQ_INDEX_ENTRIES )
+    {
+        DXUT_DSEQ_INDEX_BLOCK Block;
+        bOK = nBlock != 0 && SeekFile( m_fp, nBlock, SEEK_SET ) && fread( &Block, sizeof( Block ), 1, m_fp ) == 1 &&
+              0 == memcmp( Block.Magic, "DIDX", 4 );
+        m_nIndexBlock = nBlock;
+        nBlock = Block.NextBlock;
+    }
+
+    bOK = bOK && SeekFile( m_fp, 0, SEEK_END );
+    m_nEnd = TellFile( m_fp );
+    if( !bOK )
+    {
+        fclose( m_fp );
+        m_fp = NULL;
+    }
+    return bOK;
+}
+
+
+//--------------------------------------------------------------------------------------
+void CDXUTDepthSequenceWriter::Close()
+{
+    if( m_fp )
+        fclose( m_fp );
+    m_fp = NULL;
+}
+
+
+//--------------------------------------------------------------------------------------
+bool CDXUTDepthSequenceWriter::WriteAt( unsigned long long nOffset, const void* pData, size_t cbSize )
+{
+    if( m_bError || !SeekFile( m_fp, nOffset, SEEK_SET ) || fwrite( pData, 1, cbSize, m_fp ) != cbSize )
+        m_bError = true;
+    return !m_bError;
+}
+
+
+//--------------------------------------------------------------------------------------
+bool CDXUTDepthSequenceWriter::AddFrame( const float* pDepth, ptrdiff_t nPitch, const DXUT_CAMERA_KEY* pCamera )
+{
+    if( m_fp == NULL || m_bError )
+        return false;
+
+    unsigned int nTileSize = m_Header.TileSize;
+    unsigned int nTilesX = ( m_Header.Width + nTileSize - 1 ) / nTileSize;
+    unsigned int nTilesY = ( m_Header.Height + nTileSize - 1 ) / nTileSize;
+    unsigned int nTiles = nTilesX * nTilesY;
+
+    // The record is put together in memory and written in one go
+    size_t cbTable = sizeof( DXUT_DSEQ_FRAME ) + nTiles * sizeof( DXUT_DSEQ_TILE );
+    m_Record.resize( cbTable );
+    for( unsigned int iTileY = 0; iTileY < nTilesY; iTileY++ )
+    {
+        for( unsigned int iTileX = 0; iTileX < nTilesX; iTileX++ )
+        {
+            unsigned int x = iTileX * nTileSize, y = iTileY * nTileSize;
+            unsigned int nWidth = m_Header.Width - x < nTileSize ? m_Header.Width - x : nTileSize;
+            unsigned int nHeight = m_Header.Height - y < nTileSize ? m_Header.Height - y : nTileSize;
+
+            DXUT_DSEQ_TILE Tile;
+            Tile.Offset = ( unsigned int )m_Record.size();
+            EncodeTile( m_Record, pDepth + nPitch * ( ptrdiff_t )y + x, nPitch, nWidth, nHeight );
+            Tile.cbSize = ( unsigned int )( m_Record.size() - Tile.Offset );
+            memcpy( &m_Record[sizeof( DXUT_DSEQ_FRAME ) + ( iTileY * nTilesX + iTileX ) * sizeof( Tile )], &Tile,
+                    sizeof( Tile ) );
+        }
+    }
+    if( m_Record.size() > 0xFFFFFFFFULL )
+        return false;
+
+    DXUT_DSEQ_FRAME Frame;
+    memcpy( Frame.Magic, "DFRM", 4 );
+    Frame.NumTiles = nTiles;
+    Frame.cbSize = m_Record.size();
+    Frame.Camera = *pCamera;
+    memcpy( &m_Record[0], &Frame, sizeof( Frame ) );
+
+    // Every 256 frames a new index block, linked from the one before or the header
+    unsigned int iFrame = m_Header.NumFrames;
+    if( iFrame % DXUT_DSEQ_INDEX_ENTRIES == 0 )
+    {
+        DXUT_DSEQ_INDEX_BLOCK Block;
+        memset( &Block, 0, sizeof( Block ) );
+        memcpy( Block.Magic, "DIDX", 4 );
+        Block.NumEntries = DXUT_DSEQ_INDEX_ENTRIES;
+        WriteAt( m_nEnd, &Block, sizeof( Block ) );
+        if( m_nIndexBlock )
+        {
+            WriteAt( m_nIndexBlock + offsetof( DXUT_DSEQ_INDEX_BLOCK, NextBlock ), &m_nEnd, sizeof( m_nEnd ) );
+        }
+        else
+        {
+            WriteAt( offsetof( DXUT_DEPTH_SEQUENCE_HEADER, FirstIndexBlock ), &m_nEnd, sizeof( m_nEnd ) );
+            m_Header.FirstIndexBlock = m_nEnd;
+        }
+        m_nIndexBlock = m_nEnd;
+        m_nEnd += sizeof( Block );
+    }
+
+    // Record, index entry, count; a reader that sees the count sees the rest
+    unsigned long long nRecord = m_nEnd;
+    WriteAt( nRecord, &m_Record[0], m_Record.size() );
+    m_nEnd += m_Record.size();
+    WriteAt( m_nIndexBlock + offsetof( DXUT_DSEQ_INDEX_BLOCK, Frames ) +
+             ( iFrame % DXUT_DSEQ_INDEX_ENTRIES ) * sizeof( nRecord ), &nRecord, sizeof( nRecord ) );
+    unsigned int nFrames = iFrame + 1;
+    WriteAt( offsetof( DXUT_DEPTH_SEQUENCE_HEADER, NumFrames ), &nFrames, sizeof( nFrames ) );
+    if( m_bError || fflush( m_fp ) != 0 )
+    {
+        m_bError = true;
+        return false;
+    }
+
+    m_Header.NumFrames = nFrames;
+    m_cbCompressed += m_Record.size();
+    m_cbRaw += ( unsigned long long )m_Header.Width * m_Header.Height * sizeof( float );
+    return true;
+}
+
+
+//--------------------------------------------------------------------------------------
+CDXUTDepthSequenceReader::CDXUTDepthSequenceReader() : m_nTilesX( 0 ),
+                                                       m_nTilesY( 0 ),
+                                                       m_nIndexBlock( 0 )
+{
+    m_strFileName[0] = 0;
+    memset( &m_Header, 0, sizeof( m_Header ) );
+}
+
+
+//--------------------------------------------------------------------------------------
+bool CDXUTDepthSequenceReader::Open( const char* szFileName )
+{
+    Close();
+    if( strlen( szFileName ) >= sizeof( m_strFileName ) )
+        return false;
+    strcpy( m_strFileName, szFileName );
+
+#ifdef _WIN32
+    wchar_t wstrFileName[DXUT_FILE_MAX_PATH];
+    if( !DXUTFileNameToWide( szFileName, wstrFileName ) ||
+        !m_File.Open( wstrFileName, DXUT_MAPPED_FILE_SHARE_WRITE | DXUT_MAPPED_FILE_RANDOM ) )
+        return false;
+#else
+    if( !m_File.Open( szFileName, DXUT_MAPPED_FILE_SHARE_WRITE | DXUT_MAPPED_FILE_RANDOM ) )
+        return false;
+#endif
+
+    if( m_File.GetSize() < sizeof( m_Header ) )
+    {
+        Close();
+        return false;
+    }
+    memcpy( &m_Header, m_File.GetData(), sizeof( m_Header ) );
+    if( !ValidHeader( &m_Header ) )
+    {
+        Close();
+        return false;
+    }
+    m_nTilesX = ( m_Header.Width + m_Header.TileSize - 1 ) / m_Header.TileSize;
+    m_nTilesY = ( m_Header.Height + m_Header.TileSize - 1 ) / m_Header.TileSize;
+    return Refresh();
+}
+
+
+//--------------------------------------------------------------------------------------
+bool CDXUTDepthSequenceReader::Refresh()
+{
+    if( !m_File.IsOpen() )
+        return false;
+
+    // Everything the count covers was written before it
+    unsigned int nFrames;
+    memcpy( &nFrames, m_File.GetData() + offsetof( DXUT_DEPTH_SEQUENCE_HEADER, NumFrames ), sizeof( nFrames ) );
+    if( nFrames <= m_FrameOffsets.size() )
+        return true;
+
+    // The grown file is mapped before the old mapping goes, so the frames found so far
+    // stay readable if it can't be.  A file that shrank isn't the one they were in.
+    CDXUTMappedFile File;
+#ifdef _WIN32
+    wchar_t wstrFileName[DXUT_FILE_MAX_PATH];
+    if( !DXUTFileNameToWide( m_strFileName, wstrFileName ) ||
+        !File.Open( wstrFileName, DXUT_MAPPED_FILE_SHARE_WRITE | DXUT_MAPPED_FILE_RANDOM ) )
+        return false;
+#else
+    if( !File.Open( m_strFileName, DXUT_MAPPED_FILE_SHARE_WRITE | DXUT_MAPPED_FILE_RANDOM ) )
+        return false;
+#endif
+    if( File.GetSize() < m_File.GetSize() )
+        return false;
+    m_File.Swap( File );
+
+    const unsigned char* pData = m_File.GetData();
+    size_t cbFile = m_File.GetSize();
+    unsigned int nTiles = m_nTilesX * m_nTilesY;
+    for( unsigned int iFrame = ( unsigned int )m_FrameOffsets.size(); iFrame < nFrames; iFrame++ )
+    {
+        // Move on to the frame's index block
+        if( iFrame % DXUT_DSEQ_INDEX_ENTRIES == 0 )
+        {
+            size_t nLink = iFrame ? ( size_t )m_nIndexBlock + offsetof( DXUT_DSEQ_INDEX_BLOCK, NextBlock ) :
+                                    offsetof( DXUT_DEPTH_SEQUENCE_HEADER, FirstIndexBlock );
+            memcpy( &m_nIndexBlock, pData + nLink, sizeof( m_nIndexBlock ) );
+            if( m_nIndexBlock == 0 || m_nIndexBlock > cbFile || cbFile - m_nIndexBlock < sizeof( DXUT_DSEQ_INDEX_BLOCK ) ||
+                0 != memcmp( pData + m_nIndexBlock, "DIDX", 4 ) )
+                return false;
+        }
+
+        unsigned long long nRecord;
+        memcpy( &nRecord, pData + m_nIndexBlock + offsetof( DXUT_DSEQ_INDEX_BLOCK, Frames ) +
+                          ( iFrame % DXUT_DSEQ_INDEX_ENTRIES ) * sizeof( nRecord ), sizeof( nRecord ) );
+        DXUT_DSEQ_FRAME Frame;
+        if( nRecord > cbFile || cbFile - nRecord < sizeof( Frame ) )
+            return false;
+        memcpy( &Frame, pData + nRecord, sizeof( Frame ) );
+        if( 0 != memcmp( Frame.Magic, "DFRM", 4 ) || Frame.NumTiles != nTiles || Frame.cbSize > cbFile - nRecord ||
+            Frame.cbSize < sizeof( Frame ) + nTiles * sizeof( DXUT_DSEQ_TILE ) )
+            return false;
+        m_FrameOffsets.push_back( nRecord );
+    }
+    return true;
+}
+
+
+//--------------------------------------------------------------------------------------
+void CDXUTDepthSequenceReader::Close()
+{
+    m_File.Close();
+    m_FrameOffsets.clear();
+    m_nIndexBlock = 0;
+    m_nTilesX = m_nTilesY = 0;
+    memset( &m_Header, 0, sizeof( m_Header ) );
+}
+
+
+//--------------------------------------------------------------------------------------
+const unsigned char* CDXUTDepthSequenceReader::GetRecord( unsigned int iFrame ) const
+{
+    if( iFrame >= m_FrameOffsets.size() )
+        return NULL;
+    return m_File.GetData() + m_FrameOffsets[iFrame];
+}
+
+
+//--------------------------------------------------------------------------------------
+bool CDXUTDepthSequenceReader::GetCamera( unsigned int iFrame, DXUT_CAMERA_KEY* pCamera ) const
+{
+    const unsigned char* pRecord = GetRecord( iFrame );
+    if( pRecord == NULL )
+        return false;
+    memcpy( pCamera, pRecord + offsetof( DXUT_DSEQ_FRAME, Camera ), sizeof( *pCamera ) );
+    return true;
+}
+
+
+//--------------------------------------------------------------------------------------
+bool CDXUTDepthSequenceReader::ReadTile( unsigned int iFrame, unsigned int iTileX, unsigned int iTileY, float* pDst,
+                                         ptrdiff_t nPitch ) const
+{
+    const unsigned char* pRecord = GetRecord( iFrame );
+    if( pRecord == NULL || iTileX >= m_nTilesX || iTileY >= m_nTilesY )
+        return false;
+
+    unsigned long long cbRecord;
+    DXUT_DSEQ_TILE Tile;
+    memcpy( &cbRecord, pRecord + offsetof( DXUT_DSEQ_FRAME, cbSize ), sizeof( cbRecord ) );
+    memcpy( &Tile, pRecord + sizeof( DXUT_DSEQ_FRAME ) + ( iTileY * m_nTilesX + iTileX ) * sizeof( Tile ),
+            sizeof( Tile ) );
+    if( Tile.Offset > cbRecord || Tile.cbSize > cbRecord - Tile.Offset )
+        return false;
+
+    unsigned int nTileSize = m_Header.TileSize;
+    unsigned int x = iTileX * nTileSize, y = iTileY * nTileSize;
+    unsigned int nWidth = m_Header.Width - x < nTileSize ? m_Header.Width - x : nTileSize;
+    unsigned int nHeight = m_Header.Height - y < nTileSize ? m_Header.Height - y : nTileSize;
+    return DecodeTile( pRecord + Tile.Offset, Tile.cbSize, pDst, nPitch, nWidth, nHeight );
+}
+
+
+//--------------------------------------------------------------------------------------
+bool CDXUTDepthSequenceReader::ReadFrame( unsigned int iFrame, float* pDst, ptrdiff_t nPitch ) const
+{
+    unsigned int nTileSize = m_Header.TileSize;
+    for( unsigned int iTileY = 0; iTileY < m_nTilesY; iTileY++ )
+    {
+        for( unsigned int iTileX = 0; iTileX < m_nTilesX; iTileX++ )
+        {
+            if( !ReadTile( iFrame, iTileX, iTileY, pDst + nPitch * ( ptrdiff_t )( iTileY * nTileSize ) +
+                           iTileX * nTileSize, nPitch ) )
+                return false;
+        }
+    }
+    return true;
+}
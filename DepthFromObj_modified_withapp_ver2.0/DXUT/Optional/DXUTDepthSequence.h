@@ -0,0 +1,175 @@
+//--------------------------------------------------------------------------------------
+// File: DXUTDepthSequence.h
+//
+// Single file container for sequences of linear depth images, in place of a directory
+// of one image file per frame.  Each frame keeps the camera it was rendered with (pose,
+// intrinsics and near/far, as a DXUT_CAMERA_KEY) and its image as square tiles, each
+// compressed on its own so any tile of any frame can be read without the rest.
+//
+// The file is a header, frame records and index blocks, all appended:
+//
+//      header          "DSEQ", version, image and tile size, frames committed, first
+//                      index block
+//      index block     "DIDX", the next index block, the offsets of 256 frames
+//      frame record    "DFRM", tile count, record size, camera, then a table of each
+//                      tile's offset and size in the record, then the tiles
+//
+// A frame is committed by writing its record, then its index entry, then the frame
+// count in the header, so a reader that goes by the count only ever sees whole frames.
+// Readers can open the file while it is being captured, and Refresh picks up the frames
+// committed since; on one machine they see the writes through the page cache as soon
+// as AddFrame returns.  A capture that dies leaves the frames it committed readable,
+// and Append carries on after them.
+//
+// Tiles are lossless.  Each float is predicted from the pixels to its left, below and
+// below left (the LOCO-I median predictor, on the float bits, which order like the
+// values for the non-negative depths here); the differences are stored as variable
+// length integers, with runs of exact predictions, such as background, as one count.
+// A tile that would come out bigger is stored raw.
+//
+// Depth is 0 where nothing was drawn.  Row 0 is the bottom of the image, as in PFM
+// files and glReadPixels; pass the last row and a negative pitch for top down images.
+// The tiles along the right and top edges are clipped to the image.  Files are little
+// endian.  Paths are UTF-8.
+//--------------------------------------------------------------------------------------
+#pragma once
+#ifndef DXUT_DEPTH_SEQUENCE_H
+#define DXUT_DEPTH_SEQUENCE_H
+
+#include <stddef.h>
+#include <stdio.h>
+#include <vector>
+#include "DXUTTrajectory.h"
+#include "DXUTMappedFile.h"
+
+#define DXUT_DEPTH_SEQUENCE_VERSION     1
+#define DXUT_DEPTH_SEQUENCE_MAX_PATH    260
+
+// On-disk layout
+struct DXUT_DEPTH_SEQUENCE_HEADER
+{
+    char    Magic[4];                   // "DSEQ"
+    unsigned int Version;
+    unsigned int Width, Height;
+    unsigned int TileSize;
+    unsigned int NumFrames;             // Committed
+    unsigned long long FirstIndexBlock; // 0 until the first frame
+    unsigned char Reserved[32];
+};
+
+
+//--------------------------------------------------------------------------------------
+class CDXUTDepthSequenceWriter
+{
+public:
+            CDXUTDepthSequenceWriter();
+            ~CDXUTDepthSequenceWriter();
+
+    // Create starts a new file, replacing any old one.  Append opens a file to add
+    // frames after the ones already in it.
+    bool    Create( const char* szFileName, unsigned int nWidth, unsigned int nHeight, unsigned int nTileSize );
+    bool    Append( const char* szFileName );
+    void    Close();
+
+    // Compresses the image and commits it with its camera.  pDepth is the bottom left
+    // pixel and rows are nPitch floats apart.
+    bool    AddFrame( const float* pDepth, ptrdiff_t nPitch, const DXUT_CAMERA_KEY* pCamera );
+
+    bool    IsOpen() const
+    {
+        return m_fp != NULL;
+    }
+    unsigned int GetWidth() const
+    {
+        return m_Header.Width;
+    }
+    unsigned int GetHeight() const
+    {
+        return m_Header.Height;
+    }
+    unsigned int GetNumFrames() const
+    {
+        return m_Header.NumFrames;
+    }
+
+    // Bytes written for frames, against the raw floats they hold
+    unsigned long long GetCompressedSize() const
+    {
+        return m_cbCompressed;
+    }
+    unsigned long long GetRawSize() const
+    {
+        return m_cbRaw;
+    }
+
+private:
+    bool    WriteAt( unsigned long long nOffset, const void* pData, size_t cbSize );
+
+    FILE*   m_fp;
+    DXUT_DEPTH_SEQUENCE_HEADER m_Header;
+    unsigned long long m_nEnd;              // Where the next record goes
+    unsigned long long m_nIndexBlock;       // The last index block
+    std::vector<unsigned char> m_Record;
+    unsigned long long m_cbCompressed, m_cbRaw;
+    bool    m_bError;
+};
+
+
+//--------------------------------------------------------------------------------------
+class CDXUTDepthSequenceReader
+{
+public:
+            CDXUTDepthSequenceReader();
+
+    // Maps the file.  Frames the writer commits later show up after Refresh, which
+    // maps the file again if it has grown; it returns false if the file can't be read,
+    // and the frames found before stay readable.
+    bool    Open( const char* szFileName );
+    bool    Refresh();
+    void    Close();
+
+    unsigned int GetWidth() const
+    {
+        return m_Header.Width;
+    }
+    unsigned int GetHeight() const
+    {
+        return m_Header.Height;
+    }
+    unsigned int GetTileSize() const
+    {
+        return m_Header.TileSize;
+    }
+    unsigned int GetNumTilesX() const
+    {
+        return m_nTilesX;
+    }
+    unsigned int GetNumTilesY() const
+    {
+        return m_nTilesY;
+    }
+    unsigned int GetNumFrames() const
+    {
+        return ( unsigned int )m_FrameOffsets.size();
+    }
+
+    bool    GetCamera( unsigned int iFrame, DXUT_CAMERA_KEY* pCamera ) const;
+
+    // Decompress one tile, its bottom left pixel to pDst, or the whole frame.  They
+    // return false if the frame is out of range or its data is damaged.
+    bool    ReadTile( unsigned int iFrame, unsigned int iTileX, unsigned int iTileY, float* pDst,
+                      ptrdiff_t nPitch ) const;
+    bool    ReadFrame( unsigned int iFrame, float* pDst, ptrdiff_t nPitch ) const;
+
+private:
+    const unsigned char* GetRecord( unsigned int iFrame ) const;
+
+    CDXUTMappedFile m_File;
+    char    m_strFileName[DXUT_DEPTH_SEQUENCE_MAX_PATH];
+    DXUT_DEPTH_SEQUENCE_HEADER m_Header;
+    unsigned int m_nTilesX, m_nTilesY;
+    unsigned long long m_nIndexBlock;       // Holding the next frame's entry
+    std::vector<unsigned long long> m_FrameOffsets;
+};
+
+#endif
@@ -0,0 +1,555 @@
+//--------------------------------------------------------------------------------------
+// File: DXUTJobSystem.cpp
+//
+// Work-stealing scheduler behind CDXUTJobSystem.  See DXUTJobSystem.h for usage.
+//--------------------------------------------------------------------------------------
+#include "DXUTJobSystem.h"
+#include "DXUTProfiler.h"
+
+#include <string.h>
+
+#ifdef _WIN32
+#pragma pack(push)
+#pragma pack(8)
+#include <windows.h>
+#pragma pack(pop)
+#elif defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+// Capacity of the queue that takes jobs submitted from non-worker threads.  When it is
+// full the submitting thread runs the job itself.
+#define DXUT_JOB_INJECTION_QUEUE_SIZE   4096
+
+// Chunks per worker ParallelFor aims for when no grain size is given
+#define DXUT_JOB_CHUNKS_PER_WORKER      4
+
+
+//--------------------------------------------------------------------------------------
+// Global/Static Members
+//--------------------------------------------------------------------------------------
+#ifdef _MSC_VER
+static __declspec( thread ) CDXUTJobSystem* s_pWorkerSystem = NULL;
+static __declspec( thread ) int s_iWorkerIndex = -1;
+#else
+static __thread CDXUTJobSystem* s_pWorkerSystem = NULL;
+static __thread int s_iWorkerIndex = -1;
+#endif
+
+static CDXUTJobSystem g_DXUTJobSystem;
+
+CDXUTJobSystem* DXUTGetJobSystem()
+{
+    return &g_DXUTJobSystem;
+}
+
+
+//--------------------------------------------------------------------------------------
+// Binds a thread to one logical processor
+//--------------------------------------------------------------------------------------
+static void DXUTPinThread( std::thread& thread, unsigned int iCore )
+{
+#ifdef _WIN32
+    if( iCore < sizeof( DWORD_PTR ) * 8 )
+        SetThreadAffinityMask( ( HANDLE )thread.native_handle(), ( DWORD_PTR )1 << iCore );
+#elif defined(__linux__)
+    cpu_set_t CpuSet;
+    CPU_ZERO( &CpuSet );
+    CPU_SET( iCore, &CpuSet );
+    pthread_setaffinity_np( thread.native_handle(), sizeof( CpuSet ), &CpuSet );
+#else
+    // No portable affinity API; leave scheduling to the OS
+    ( void )thread;
+    ( void )iCore;
+#endif
+}
+
+
+//--------------------------------------------------------------------------------------
+CDXUTJobSystem::CDXUTJobSystem() : m_Injected( DXUT_JOB_INJECTION_QUEUE_SIZE )
+{
+    m_nWorkSignal.store( 0 );
+    m_nSleeping.store( 0 );
+    m_bQuit.store( false );
+    m_tStatsStartNs = 0;
+}
+
+
+//--------------------------------------------------------------------------------------
+CDXUTJobSystem::~CDXUTJobSystem()
+{
+    Shutdown();
+}
+
+
+//--------------------------------------------------------------------------------------
+bool CDXUTJobSystem::Init( int nWorkers, bool bPinThreads )
+{
+    Shutdown();
+
+    unsigned int nHardwareThreads = std::thread::hardware_concurrency();
+    if( nWorkers < 0 )
+        nWorkers = ( nHardwareThreads > 1 ) ? ( int )nHardwareThreads - 1 : 0;
+
+    m_bQuit.store( false );
+
+    // Every worker has to exist before any thread starts so stealing can walk the
+    // whole array without a lock
+    for( int i = 0; i < nWorkers; i++ )
+    {
+        Worker* pWorker = new Worker;
+        pWorker->pSystem = this;
+        pWorker->iIndex = ( unsigned int )i;
+        pWorker->nJobsExecuted.store( 0 );
+        pWorker->nJobsStolen.store( 0 );
+        pWorker->nBusyNs.store( 0 );
+        pWorker->nRandom = 0x9E3779B9u * ( i + 1 );
+        m_Workers.push_back( pWorker );
+    }
+    ResetStats();
+
+    for( size_t i = 0; i < m_Workers.size(); i++ )
+    {
+        m_Workers[i]->Thread = std::thread( WorkerThreadProc, m_Workers[i] );
+
+        // Core 0 is left to the thread that called Init
+        if( bPinThreads && nHardwareThreads > 0 )
+            DXUTPinThread( m_Workers[i]->Thread, ( unsigned int )( i + 1 ) % nHardwareThreads );
+    }
+
+    return true;
+}
+
+
+//--------------------------------------------------------------------------------------
+void CDXUTJobSystem::Shutdown()
+{
+    if( m_Workers.empty() )
+        return;
+
+    {
+        std::lock_guard<std::mutex> lock( m_SleepLock );
+        m_bQuit.store( true );
+    }
+    m_WakeCondition.notify_all();
+
+    for( size_t i = 0; i < m_Workers.size(); i++ )
+        m_Workers[i]->Thread.join();
+
+    // Whatever the workers left behind runs here so no job is lost or leaked
+    while( RunPendingJob() )
+    {
+    }
+
+    for( size_t i = 0; i < m_Workers.size(); i++ )
+        delete m_Workers[i];
+    m_Workers.clear();
+}
+
+
+//--------------------------------------------------------------------------------------
+int CDXUTJobSystem::GetCurrentWorkerIndex() const
+{
+    return ( s_pWorkerSystem == this ) ? s_iWorkerIndex : -1;
+}
+
+
+//--------------------------------------------------------------------------------------
+DXUTJob* CDXUTJobSystem::CreateJob( LPDXUTJOBCALLBACK pCallback, void* pUserContext, DXUTJob* pParent )
+{
+    DXUTJob* pJob = new DXUTJob;
+    pJob->pCallback = pCallback;
+    pJob->pUserContext = pUserContext;
+    pJob->pParent = pParent;
+    pJob->nUnfinished.store( 1 );
+    pJob->nPendingDeps.store( 1 );
+    pJob->nRefs.store( 1 );
+    pJob->bComplete = false;
+
+    if( pParent )
+    {
+        // The child keeps its parent alive until it has reported completion
+        pParent->nUnfinished.fetch_add( 1 );
+        pParent->nRefs.fetch_add( 1 );
+    }
+
+    return pJob;
+}
+
+
+//--------------------------------------------------------------------------------------
+void CDXUTJobSystem::AddDependency( DXUTJob* pJob, DXUTJob* pPrerequisite )
+{
+    std::lock_guard<std::mutex> lock( pPrerequisite->DependentsLock );
+    if( pPrerequisite->bComplete )
+        return;
+
+    pPrerequisite->Dependents.push_back( pJob );
+    pJob->nPendingDeps.fetch_add( 1 );
+    pJob->nRefs.fetch_add( 1 );
+}
+
+
+//--------------------------------------------------------------------------------------
+void CDXUTJobSystem::Submit( DXUTJob* pJob )
+{
+    // The scheduler's reference, dropped once the job has executed
+    pJob->nRefs.fetch_add( 1 );
+
+    if( pJob->nPendingDeps.fetch_sub( 1 ) == 1 )
+        Enqueue( pJob );
+}
+
+
+//--------------------------------------------------------------------------------------
+void CDXUTJobSystem::Wait( DXUTJob* pJob )
+{
+    while( pJob->nUnfinished.load( std::memory_order_acquire ) > 0 )
+    {
+        if( !RunPendingJob() )
+            std::this_thread::yield();
+    }
+}
+
+
+//--------------------------------------------------------------------------------------
+bool CDXUTJobSystem::IsComplete( DXUTJob* pJob ) const
+{
+    return pJob->nUnfinished.load( std::memory_order_acquire ) == 0;
+}
+
+
+//--------------------------------------------------------------------------------------
+void CDXUTJobSystem::ReleaseJob( DXUTJob* pJob )
+{
+    if( pJob->nRefs.fetch_sub( 1 ) == 1 )
+        delete pJob;
+}
+
+
+//--------------------------------------------------------------------------------------
+// ParallelFor splits the range into chunk jobs parented to a job with no work of its
+// own, then waits on that job
+//--------------------------------------------------------------------------------------
+struct DXUTParallelForChunk
+{
+    LPDXUTPARALLELFORCALLBACK pCallback;
+    void* pUserContext;
+    unsigned int iBegin;
+    unsigned int iEnd;
+};
+
+static void DXUTRunParallelForChunk( void* pUserContext )
+{
+    DXUTParallelForChunk* pChunk = ( DXUTParallelForChunk* )pUserContext;
+    pChunk->pCallback( pChunk->iBegin, pChunk->iEnd, pChunk->pUserContext );
+}
+
+void CDXUTJobSystem::ParallelFor( unsigned int nBegin, unsigned int nEnd, unsigned int nGrainSize,
+                                  LPDXUTPARALLELFORCALLBACK pCallback, void* pUserContext )
+{
+    if( nEnd <= nBegin )
+        return;
+
+    unsigned int nCount = nEnd - nBegin;
+    if( nGrainSize == 0 )
+    {
+        unsigned int nTargetChunks = ( ( unsigned int )m_Workers.size() + 1 ) * DXUT_JOB_CHUNKS_PER_WORKER;
+        nGrainSize = ( nCount + nTargetChunks - 1 ) / nTargetChunks;
+        if( nGrainSize == 0 )
+            nGrainSize = 1;
+    }
+
+    if( m_Workers.empty() || nCount <= nGrainSize )
+    {
+        pCallback( nBegin, nEnd, pUserContext );
+        return;
+    }
+
+    // Reserve up front; the jobs point into this array
+    std::vector<DXUTParallelForChunk> Chunks;
+    Chunks.reserve( ( nCount + nGrainSize - 1 ) / nGrainSize );
+    for( unsigned int i = nBegin; i < nEnd; )
+    {
+        DXUTParallelForChunk Chunk;
+        Chunk.pCallback = pCallback;
+        Chunk.pUserContext = pUserContext;
+        Chunk.iBegin = i;
+        Chunk.iEnd = ( nEnd - i > nGrainSize ) ? i + nGrainSize : nEnd;
+        Chunks.push_back( Chunk );
+        i = Chunk.iEnd;
+    }
+
+    DXUTJob* pRoot = CreateJob( NULL, NULL );
+    for( size_t i = 0; i < Chunks.size(); i++ )
+    {
+        DXUTJob* pChunkJob = CreateJob( DXUTRunParallelForChunk, &Chunks[i], pRoot );
+        Submit( pChunkJob );
+        ReleaseJob( pChunkJob );
+    }
+
+    // The root has no work of its own, so it's done as soon as its children are
+    FinishJob( pRoot );
+    Wait( pRoot );
+    ReleaseJob( pRoot );
+}
+
+
+//--------------------------------------------------------------------------------------
+void CDXUTJobSystem::GetWorkerStats( unsigned int iWorker, DXUTJobWorkerStats* pStats ) const
+{
+    if( pStats == NULL )
+        return;
+
+    memset( pStats, 0, sizeof( DXUTJobWorkerStats ) );
+    if( iWorker >= m_Workers.size() )
+        return;
+
+    const Worker* pWorker = m_Workers[iWorker];
+    unsigned long long nElapsedNs = DXUTProfilerGetTimeNs() - m_tStatsStartNs;
+
+    pStats->nJobsExecuted = pWorker->nJobsExecuted.load( std::memory_order_relaxed );
+    pStats->nJobsStolen = pWorker->nJobsStolen.load( std::memory_order_relaxed );
+    pStats->fBusySeconds = pWorker->nBusyNs.load( std::memory_order_relaxed ) * 1e-9;
+    pStats->fElapsedSeconds = nElapsedNs * 1e-9;
+    if( nElapsedNs > 0 )
+        pStats->fUtilization = ( float )( pStats->fBusySeconds / pStats->fElapsedSeconds );
+}
+
+
+//--------------------------------------------------------------------------------------
+void CDXUTJobSystem::ResetStats()
+{
+    for( size_t i = 0; i < m_Workers.size(); i++ )
+    {
+        m_Workers[i]->nJobsExecuted.store( 0, std::memory_order_relaxed );
+        m_Workers[i]->nJobsStolen.store( 0, std::memory_order_relaxed );
+        m_Workers[i]->nBusyNs.store( 0, std::memory_order_relaxed );
+    }
+    m_tStatsStartNs = DXUTProfilerGetTimeNs();
+}
+
+
+//--------------------------------------------------------------------------------------
+void CDXUTJobSystem::WorkerThreadProc( Worker* pWorker )
+{
+    CDXUTJobSystem* pSystem = pWorker->pSystem;
+    s_pWorkerSystem = pSystem;
+    s_iWorkerIndex = ( int )pWorker->iIndex;
+
+    // "Job worker N"; formatted by hand since sprintf_s isn't portable
+    char szName[32] = "Job worker ";
+    char szDigits[12];
+    int nDigits = 0;
+    unsigned int nIndex = pWorker->iIndex;
+    do
+    {
+        szDigits[nDigits++] = ( char )( '0' + nIndex % 10 );
+        nIndex /= 10;
+    } while( nIndex );
+    size_t cch = strlen( szName );
+    while( nDigits )
+        szName[cch++] = szDigits[--nDigits];
+    szName[cch] = 0;
+    DXUTProfilerSetThreadName( szName );
+
+    while( !pSystem->m_bQuit.load() )
+    {
+        // Read the signal before looking for work: anything queued after this point
+        // changes it, so we can't go to sleep and miss that job
+        unsigned int nSignal = pSystem->m_nWorkSignal.load();
+
+        bool bStolen;
+        DXUTJob* pJob = pSystem->FindJob( pWorker, &bStolen );
+        if( pJob )
+        {
+            pSystem->Execute( pJob, pWorker, bStolen );
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock( pSystem->m_SleepLock );
+        pSystem->m_nSleeping.fetch_add( 1 );
+        while( pSystem->m_nWorkSignal.load() == nSignal && !pSystem->m_bQuit.load() )
+            pSystem->m_WakeCondition.wait( lock );
+        pSystem->m_nSleeping.fetch_sub( 1 );
+    }
+
+    s_pWorkerSystem = NULL;
+    s_iWorkerIndex = -1;
+}
+
+
+//--------------------------------------------------------------------------------------
+// Makes a job whose prerequisites are all complete runnable
+//--------------------------------------------------------------------------------------
+void CDXUTJobSystem::Enqueue( DXUTJob* pJob )
+{
+    if( m_Workers.empty() )
+    {
+        Execute( pJob, NULL, false );
+        return;
+    }
+
+    if( s_pWorkerSystem == this )
+    {
+        Worker* pWorker = m_Workers[s_iWorkerIndex];
+        std::lock_guard<std::mutex> lock( pWorker->Lock );
+        pWorker->Jobs.push_back( pJob );
+    }
+    else if( !m_Injected.TryPush( pJob ) )
+    {
+        // Workers are saturated; doing the work here beats blocking on the queue
+        Execute( pJob, NULL, false );
+        return;
+    }
+
+    m_nWorkSignal.fetch_add( 1 );
+    WakeWorkers( 1 );
+}
+
+
+//--------------------------------------------------------------------------------------
+// Looks in the worker's own deque, then the injection queue, then steals from the
+// other workers starting at a random victim
+//--------------------------------------------------------------------------------------
+DXUTJob* CDXUTJobSystem::FindJob( Worker* pWorker, bool* pbStolen )
+{
+    DXUTJob* pJob = NULL;
+    *pbStolen = false;
+
+    if( pWorker )
+    {
+        std::lock_guard<std::mutex> lock( pWorker->Lock );
+        if( !pWorker->Jobs.empty() )
+        {
+            pJob = pWorker->Jobs.back();
+            pWorker->Jobs.pop_back();
+            return pJob;
+        }
+    }
+
+    if( m_Injected.TryPop( pJob ) )
+        return pJob;
+
+    unsigned int nWorkers = ( unsigned int )m_Workers.size();
+    if( nWorkers == 0 )
+        return NULL;
+
+    unsigned int iStart = 0;
+    if( pWorker )
+    {
+        // xorshift32
+        pWorker->nRandom ^= pWorker->nRandom << 13;
+        pWorker->nRandom ^= pWorker->nRandom >> 17;
+        pWorker->nRandom ^= pWorker->nRandom << 5;
+        iStart = pWorker->nRandom % nWorkers;
+    }
+
+    for( unsigned int i = 0; i < nWorkers; i++ )
+    {
+        Worker* pVictim = m_Workers[( iStart + i ) % nWorkers];
+        if( pVictim == pWorker )
+            continue;
+
+        std::lock_guard<std::mutex> lock( pVictim->Lock );
+        if( !pVictim->Jobs.empty() )
+        {
+            pJob = pVictim->Jobs.front();
+            pVictim->Jobs.pop_front();
+            *pbStolen = true;
+            return pJob;
+        }
+    }
+
+    return NULL;
+}
+
+
+//--------------------------------------------------------------------------------------
+void CDXUTJobSystem::Execute( DXUTJob* pJob, Worker* pWorker, bool bStolen )
+{
+    DXUT_PROFILE_TIME tStart = pWorker ? DXUTProfilerGetTimeNs() : 0;
+
+    if( pJob->pCallback )
+        pJob->pCallback( pJob->pUserContext );
+    FinishJob( pJob );
+
+    if( pWorker )
+    {
+        pWorker->nBusyNs.fetch_add( DXUTProfilerGetTimeNs() - tStart, std::memory_order_relaxed );
+        pWorker->nJobsExecuted.fetch_add( 1, std::memory_order_relaxed );
+        if( bStolen )
+            pWorker->nJobsStolen.fetch_add( 1, std::memory_order_relaxed );
+    }
+
+    ReleaseJob( pJob );
+}
+
+
+//--------------------------------------------------------------------------------------
+// Drops one unfinished count.  When it reaches zero the job is complete: its
+// dependents are released and its parent is told.
+//--------------------------------------------------------------------------------------
+void CDXUTJobSystem::FinishJob( DXUTJob* pJob )
+{
+    if( pJob->nUnfinished.fetch_sub( 1, std::memory_order_acq_rel ) != 1 )
+        return;
+
+    std::vector<DXUTJob*> Dependents;
+    {
+        std::lock_guard<std::mutex> lock( pJob->DependentsLock );
+        pJob->bComplete = true;
+        Dependents.swap( pJob->Dependents );
+    }
+
+    for( size_t i = 0; i < Dependents.size(); i++ )
+    {
+        if( Dependents[i]->nPendingDeps.fetch_sub( 1 ) == 1 )
+            Enqueue( Dependents[i] );
+        ReleaseJob( Dependents[i] );
+    }
+
+    DXUTJob* pParent = pJob->pParent;
+    if( pParent )
+    {
+        FinishJob( pParent );
+        ReleaseJob( pParent );
+    }
+}
+
+
+//--------------------------------------------------------------------------------------
+// Runs one queued job on the calling thread.  Returns false if nothing was queued.
+//--------------------------------------------------------------------------------------
+bool CDXUTJobSystem::RunPendingJob()
+{
+    Worker* pWorker = ( s_pWorkerSystem == this ) ? m_Workers[s_iWorkerIndex] : NULL;
+
+    bool bStolen;
+    DXUTJob* pJob = FindJob( pWorker, &bStolen );
+    if( pJob == NULL )
+        return false;
+
+    Execute( pJob, pWorker, bStolen );
+    return true;
+}
+
+
+//--------------------------------------------------------------------------------------
+void CDXUTJobSystem::WakeWorkers( unsigned int nCount )
+{
+    if( m_nSleeping.load() == 0 )
+        return;
+
+    // Taking the lock orders this with a worker that has checked the signal but not
+    // yet started waiting
+    {
+        std::lock_guard<std::mutex> lock( m_SleepLock );
+    }
+
+    if( nCount == 1 )
+        m_WakeCondition.notify_one();
+    else
+        m_WakeCondition.notify_all();
+}
@@ -0,0 +1,191 @@
+//--------------------------------------------------------------------------------------
+// File: DXUTJobSystem.h
+//
+// Work-stealing job scheduler shared by the loader, renderer and encoders so they can
+// split work across cores without each spinning up their own threads.
+//
+// Each worker thread owns a deque of ready jobs.  A worker pushes and pops at the back
+// of its own deque (LIFO, so recently spawned work stays in cache) and, when it runs
+// dry, steals from the front of another worker's deque.  Jobs submitted from threads
+// that are not workers go through a shared DXUTLockFreeQueue.  Idle workers sleep on a
+// condition variable instead of spinning.
+//
+// Jobs form a graph in two ways:
+//  - a job created with a parent keeps the parent from completing until it completes
+//  - AddDependency( pJob, pPrerequisite ) holds pJob back until pPrerequisite completes
+//
+//      DXUTJob* pParse = pJobs->CreateJob( ParseChunk, pChunk );
+//      DXUTJob* pBuild = pJobs->CreateJob( BuildMesh, pMesh );
+//      pJobs->AddDependency( pBuild, pParse );
+//      pJobs->Submit( pBuild );
+//      pJobs->Submit( pParse );
+//      pJobs->Wait( pBuild );
+//      pJobs->ReleaseJob( pParse );
+//      pJobs->ReleaseJob( pBuild );
+//
+// Wait() runs other jobs while it waits, so it may be called from inside a job.  If
+// the job system was initialized with zero workers everything runs on the calling
+// thread.
+//--------------------------------------------------------------------------------------
+#pragma once
+#ifndef DXUT_JOBSYSTEM_H
+#define DXUT_JOBSYSTEM_H
+
+#include <stddef.h>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "DXUTLockFreeQueue.h"
+
+typedef void ( *LPDXUTJOBCALLBACK )( void* pUserContext );
+typedef void ( *LPDXUTPARALLELFORCALLBACK )( unsigned int iBegin, unsigned int iEnd, void* pUserContext );
+
+//--------------------------------------------------------------------------------------
+// A unit of work.  Opaque to callers; create with CDXUTJobSystem::CreateJob and give
+// it back with CDXUTJobSystem::ReleaseJob.
+//--------------------------------------------------------------------------------------
+struct DXUTJob
+{
+    LPDXUTJOBCALLBACK pCallback;
+    void* pUserContext;
+    DXUTJob* pParent;
+
+    std::atomic<int> nUnfinished;       // 1 for the job itself + 1 per unfinished child
+    std::atomic<int> nPendingDeps;      // Unfinished prerequisites + 1 until submitted
+    std::atomic<int> nRefs;
+
+    std::mutex DependentsLock;          // Guards bComplete and Dependents
+    bool bComplete;
+    std::vector<DXUTJob*> Dependents;
+};
+
+
+//--------------------------------------------------------------------------------------
+// Per-worker counters returned by CDXUTJobSystem::GetWorkerStats.  Times are measured
+// since Init() or the last ResetStats().
+//--------------------------------------------------------------------------------------
+struct DXUTJobWorkerStats
+{
+    unsigned int nJobsExecuted;
+    unsigned int nJobsStolen;           // Executed jobs that came from another worker
+    double fBusySeconds;
+    double fElapsedSeconds;
+    float fUtilization;                 // fBusySeconds / fElapsedSeconds
+};
+
+
+//--------------------------------------------------------------------------------------
+class CDXUTJobSystem
+{
+public:
+                            CDXUTJobSystem();
+                            ~CDXUTJobSystem();
+
+    // nWorkers == -1 uses one worker per hardware thread minus one for the caller.
+    // With bPinThreads each worker is bound to its own core.
+    bool                    Init( int nWorkers = -1, bool bPinThreads = false );
+
+    // Runs anything still queued, then stops and joins the workers
+    void                    Shutdown();
+
+    unsigned int            GetWorkerCount() const
+    {
+        return ( unsigned int )m_Workers.size();
+    }
+
+    // Index of the calling worker, or -1 if called from a thread this system doesn't own
+    int                     GetCurrentWorkerIndex() const;
+
+    // The returned job holds one reference for the caller.  Jobs are not run until
+    // they are submitted.
+    DXUTJob*                CreateJob( LPDXUTJOBCALLBACK pCallback, void* pUserContext,
+                                       DXUTJob* pParent = NULL );
+
+    // pJob won't start until pPrerequisite has completed.  Must be called before pJob
+    // is submitted; has no effect if pPrerequisite has already completed.
+    void                    AddDependency( DXUTJob* pJob, DXUTJob* pPrerequisite );
+
+    void                    Submit( DXUTJob* pJob );
+
+    // Executes queued jobs on the calling thread until pJob and all its children have
+    // completed
+    void                    Wait( DXUTJob* pJob );
+    bool                    IsComplete( DXUTJob* pJob ) const;
+
+    void                    ReleaseJob( DXUTJob* pJob );
+
+    // Calls pCallback over [nBegin, nEnd) split into chunks of at most nGrainSize
+    // items and returns once every chunk has run.  nGrainSize == 0 picks a size that
+    // gives each worker a few chunks to balance load with.
+    void                    ParallelFor( unsigned int nBegin, unsigned int nEnd, unsigned int nGrainSize,
+                                         LPDXUTPARALLELFORCALLBACK pCallback, void* pUserContext );
+
+    // Same as above with any callable taking ( unsigned int iBegin, unsigned int iEnd )
+    template <typename FUNC> void ParallelFor( unsigned int nBegin, unsigned int nEnd,
+                                               unsigned int nGrainSize, const FUNC& func )
+    {
+        ParallelFor( nBegin, nEnd, nGrainSize, &ParallelForFunctor<FUNC>, ( void* )&func );
+    }
+
+    void                    GetWorkerStats( unsigned int iWorker, DXUTJobWorkerStats* pStats ) const;
+    void                    ResetStats();
+
+private:
+    struct Worker
+    {
+        CDXUTJobSystem* pSystem;
+        unsigned int iIndex;
+        std::thread Thread;
+
+        std::mutex Lock;                // Guards Jobs
+        std::deque<DXUTJob*> Jobs;
+
+        std::atomic<unsigned int> nJobsExecuted;
+        std::atomic<unsigned int> nJobsStolen;
+        std::atomic<unsigned long long> nBusyNs;
+        unsigned int nRandom;           // Victim selection; only touched by the owner
+    };
+
+    template <typename FUNC> static void ParallelForFunctor( unsigned int iBegin, unsigned int iEnd,
+                                                             void* pUserContext )
+    {
+        ( *( const FUNC* )pUserContext )( iBegin, iEnd );
+    }
+
+    static void             WorkerThreadProc( Worker* pWorker );
+
+    void                    Enqueue( DXUTJob* pJob );
+    DXUTJob*                FindJob( Worker* pWorker, bool* pbStolen );
+    void                    Execute( DXUTJob* pJob, Worker* pWorker, bool bStolen );
+    void                    FinishJob( DXUTJob* pJob );
+    bool                    RunPendingJob();
+    void                    WakeWorkers( unsigned int nCount );
+
+    // Leave these private and undefined to prevent their use
+                            CDXUTJobSystem( const CDXUTJobSystem& );
+    CDXUTJobSystem&         operator =( const CDXUTJobSystem& );
+
+    std::vector<Worker*>    m_Workers;
+    DXUTLockFreeQueue<DXUTJob*> m_Injected;     // Jobs submitted from outside the workers
+
+    std::mutex              m_SleepLock;
+    std::condition_variable m_WakeCondition;
+    std::atomic<unsigned int> m_nWorkSignal;    // Bumped every time a job is queued
+    std::atomic<unsigned int> m_nSleeping;
+    std::atomic<bool>       m_bQuit;
+
+    unsigned long long      m_tStatsStartNs;
+};
+
+
+//--------------------------------------------------------------------------------------
+// Process-wide job system.  The application calls Init() on it at startup and
+// Shutdown() before exit; until then it has no workers and runs jobs inline.
+//--------------------------------------------------------------------------------------
+CDXUTJobSystem*             DXUTGetJobSystem();
+
+#endif
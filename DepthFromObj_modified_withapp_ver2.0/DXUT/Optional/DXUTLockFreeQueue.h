@@ -0,0 +1,178 @@
+//--------------------------------------------------------------------------------------
+// DXUTLockFreeQueue.h
+//
+// Bounded multi-producer/multi-consumer lock-free queue of typed elements.  This is the
+// general form of DXUTLockFreePipe: any number of threads may push and pop at once, and
+// ordering is expressed with std::atomic acquire/release operations instead of compiler
+// barriers, so it is also correct on weakly ordered CPUs such as ARM.
+//
+// Each slot carries a sequence number that says whether it is ready to be written
+// (sequence == position) or read (sequence == position + 1).  A producer claims a
+// position with a CAS on the enqueue index, fills the slot and publishes it with a
+// release store of the sequence; a consumer does the mirror image.  Producers and
+// consumers therefore only contend on their own index, and the two indices live on
+// separate cache lines.
+//--------------------------------------------------------------------------------------
+#pragma once
+#ifndef DXUT_LOCKFREEQUEUE_H
+#define DXUT_LOCKFREEQUEUE_H
+
+#include <stddef.h>
+#include <atomic>
+#include <thread>
+
+#define DXUT_CACHE_LINE_SIZE 64
+
+//
+// TYPE must be default constructible and copy assignable.  The capacity is rounded up
+// to a power of two (minimum 2) so positions can be mapped to slots with a mask.
+//
+template <typename TYPE> class DXUTLockFreeQueue
+{
+public:
+    explicit DXUTLockFreeQueue( size_t nCapacity )
+    {
+        size_t nSize = 2;
+        while( nSize < nCapacity )
+            nSize <<= 1;
+
+        m_nMask = nSize - 1;
+        m_pCells = new Cell[nSize];
+        for( size_t i = 0; i < nSize; i++ )
+            m_pCells[i].nSequence.store( i, std::memory_order_relaxed );
+
+        m_nEnqueuePos.store( 0, std::memory_order_relaxed );
+        m_nDequeuePos.store( 0, std::memory_order_relaxed );
+    }
+
+    ~DXUTLockFreeQueue()
+    {
+        delete[] m_pCells;
+    }
+
+    size_t GetCapacity() const
+    {
+        return m_nMask + 1;
+    }
+
+    // Approximate number of queued elements; exact only when no thread is pushing or
+    // popping
+    size_t GetSizeApprox() const
+    {
+        size_t nEnqueue = m_nEnqueuePos.load( std::memory_order_relaxed );
+        size_t nDequeue = m_nDequeuePos.load( std::memory_order_relaxed );
+        return nEnqueue > nDequeue ? nEnqueue - nDequeue : 0;
+    }
+
+    // Returns false without blocking if the queue is full
+    bool TryPush( const TYPE& value )
+    {
+        Cell* pCell;
+        size_t nPos = m_nEnqueuePos.load( std::memory_order_relaxed );
+        for(; ; )
+        {
+            pCell = &m_pCells[nPos & m_nMask];
+
+            // Acquire pairs with the consumer's release so we don't overwrite the slot
+            // before it has been read
+            size_t nSequence = pCell->nSequence.load( std::memory_order_acquire );
+            ptrdiff_t nDiff = ( ptrdiff_t )nSequence - ( ptrdiff_t )nPos;
+            if( nDiff == 0 )
+            {
+                // The slot is free; try to claim this position
+                if( m_nEnqueuePos.compare_exchange_weak( nPos, nPos + 1, std::memory_order_relaxed ) )
+                    break;
+            }
+            else if( nDiff < 0 )
+            {
+                // The slot still holds the element from one lap ago
+                return false;
+            }
+            else
+            {
+                // Another producer claimed this position first
+                nPos = m_nEnqueuePos.load( std::memory_order_relaxed );
+            }
+        }
+
+        pCell->Data = value;
+
+        // Publish the element to consumers
+        pCell->nSequence.store( nPos + 1, std::memory_order_release );
+        return true;
+    }
+
+    // Returns false without blocking if the queue is empty
+    bool TryPop( TYPE& value )
+    {
+        Cell* pCell;
+        size_t nPos = m_nDequeuePos.load( std::memory_order_relaxed );
+        for(; ; )
+        {
+            pCell = &m_pCells[nPos & m_nMask];
+
+            // Acquire pairs with the producer's release so the element is visible
+            size_t nSequence = pCell->nSequence.load( std::memory_order_acquire );
+            ptrdiff_t nDiff = ( ptrdiff_t )nSequence - ( ptrdiff_t )( nPos + 1 );
+            if( nDiff == 0 )
+            {
+                if( m_nDequeuePos.compare_exchange_weak( nPos, nPos + 1, std::memory_order_relaxed ) )
+                    break;
+            }
+            else if( nDiff < 0 )
+            {
+                // Nothing has been published at this position yet
+                return false;
+            }
+            else
+            {
+                nPos = m_nDequeuePos.load( std::memory_order_relaxed );
+            }
+        }
+
+        value = pCell->Data;
+
+        // Hand the slot back to producers for the next lap
+        pCell->nSequence.store( nPos + m_nMask + 1, std::memory_order_release );
+        return true;
+    }
+
+    // Spins (yielding the time slice) until there is room
+    void Push( const TYPE& value )
+    {
+        while( !TryPush( value ) )
+            std::this_thread::yield();
+    }
+
+    // Spins (yielding the time slice) until an element is available
+    void Pop( TYPE& value )
+    {
+        while( !TryPop( value ) )
+            std::this_thread::yield();
+    }
+
+private:
+    struct Cell
+    {
+        std::atomic<size_t> nSequence;
+        TYPE Data;
+    };
+
+    // Leave these private and undefined to prevent their use
+    DXUTLockFreeQueue( const DXUTLockFreeQueue& );
+    DXUTLockFreeQueue& operator =( const DXUTLockFreeQueue& );
+
+    // Member data.  The padding keeps the read-mostly fields, the producer index and the
+    // consumer index on separate cache lines.
+    //
+    char                    m_Pad0[DXUT_CACHE_LINE_SIZE];
+    Cell*                   m_pCells;
+    size_t                  m_nMask;
+    char                    m_Pad1[DXUT_CACHE_LINE_SIZE - sizeof( Cell* ) - sizeof( size_t )];
+    std::atomic<size_t>     m_nEnqueuePos;
+    char                    m_Pad2[DXUT_CACHE_LINE_SIZE - sizeof( std::atomic<size_t> )];
+    std::atomic<size_t>     m_nDequeuePos;
+    char                    m_Pad3[DXUT_CACHE_LINE_SIZE - sizeof( std::atomic<size_t> )];
+};
+
+#endif
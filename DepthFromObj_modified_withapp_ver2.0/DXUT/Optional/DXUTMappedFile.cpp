@@ -0,0 +1,302 @@
+//--------------------------------------------------------------------------------------
+// File: DXUTMappedFile.cpp
+//
+// Win32 and POSIX implementations of CDXUTMappedFile.  See DXUTMappedFile.h.
+//--------------------------------------------------------------------------------------
+#include "DXUTMappedFile.h"
+
+#ifdef _WIN32
+#pragma pack(push)
+#pragma pack(8)
+#include <windows.h>
+#pragma pack(pop)
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+
+//--------------------------------------------------------------------------------------
+CDXUTMappedFile::CDXUTMappedFile() : m_pData( NULL ),
+                                     m_cbSize( 0 )
+{
+}
+
+
+//--------------------------------------------------------------------------------------
+CDXUTMappedFile::~CDXUTMappedFile()
+{
+    Close();
+}
+
+
+#ifdef _WIN32
+//--------------------------------------------------------------------------------------
+// PrefetchVirtualMemory only exists on Windows 8 and later, so it is looked up at run
+// time.  The range struct is declared here because older SDKs don't have it.
+//--------------------------------------------------------------------------------------
+struct DXUT_MEMORY_RANGE_ENTRY
+{
+    PVOID VirtualAddress;
+    SIZE_T NumberOfBytes;
+};
+typedef BOOL ( WINAPI*LPPREFETCHVIRTUALMEMORY )( HANDLE hProcess, ULONG_PTR NumberOfEntries,
+                                                 DXUT_MEMORY_RANGE_ENTRY* VirtualAddresses, ULONG Flags );
+
+static DWORD DXUTMappedFileCreateFlags( unsigned int dwFlags )
+{
+    if( dwFlags & DXUT_MAPPED_FILE_SEQUENTIAL )
+        return FILE_FLAG_SEQUENTIAL_SCAN;
+    if( dwFlags & DXUT_MAPPED_FILE_RANDOM )
+        return FILE_FLAG_RANDOM_ACCESS;
+    return FILE_ATTRIBUTE_NORMAL;
+}
+
+static DWORD DXUTMappedFileShareMode( unsigned int dwFlags )
+{
+    if( dwFlags & DXUT_MAPPED_FILE_SHARE_WRITE )
+        return FILE_SHARE_READ | FILE_SHARE_WRITE;
+    return FILE_SHARE_READ;
+}
+
+
+//--------------------------------------------------------------------------------------
+bool CDXUTMappedFile::Open( const wchar_t* szFileName, unsigned int dwFlags )
+{
+    Close();
+
+    HANDLE hFile = CreateFileW( szFileName, GENERIC_READ, DXUTMappedFileShareMode( dwFlags ), NULL, OPEN_EXISTING,
+                                DXUTMappedFileCreateFlags( dwFlags ), NULL );
+    if( INVALID_HANDLE_VALUE == hFile )
+        return false;
+
+    // The view keeps the file open, so the handle isn't needed past this point
+    bool bResult = MapHandle( hFile, dwFlags );
+    CloseHandle( hFile );
+    return bResult;
+}
+
+
+//--------------------------------------------------------------------------------------
+bool CDXUTMappedFile::Open( const char* szFileName, unsigned int dwFlags )
+{
+    Close();
+
+    HANDLE hFile = CreateFileA( szFileName, GENERIC_READ, DXUTMappedFileShareMode( dwFlags ), NULL, OPEN_EXISTING,
+                                DXUTMappedFileCreateFlags( dwFlags ), NULL );
+    if( INVALID_HANDLE_VALUE == hFile )
+        return false;
+
+    bool bResult = MapHandle( hFile, dwFlags );
+    CloseHandle( hFile );
+    return bResult;
+}
+
+
+//--------------------------------------------------------------------------------------
+bool CDXUTMappedFile::MapHandle( void* hFile, unsigned int dwFlags )
+{
+    LARGE_INTEGER FileSize;
+    if( !GetFileSizeEx( ( HANDLE )hFile, &FileSize ) || FileSize.QuadPart == 0 )
+        return false;
+    if( ( ULONGLONG )FileSize.QuadPart > ( ULONGLONG )( ( SIZE_T )-1 ) )
+        return false;
+
+    bool bCopyOnWrite = ( dwFlags & DXUT_MAPPED_FILE_COPY_ON_WRITE ) != 0;
+    HANDLE hMapping = CreateFileMappingW( ( HANDLE )hFile, NULL, bCopyOnWrite ? PAGE_WRITECOPY : PAGE_READONLY,
+                                          0, 0, NULL );
+    if( hMapping == NULL )
+        return false;
+
+    m_pData = ( unsigned char* )MapViewOfFile( hMapping, bCopyOnWrite ? FILE_MAP_COPY : FILE_MAP_READ, 0, 0, 0 );
+    CloseHandle( hMapping );
+    if( m_pData == NULL )
+        return false;
+
+    m_cbSize = ( size_t )FileSize.QuadPart;
+
+    if( dwFlags & DXUT_MAPPED_FILE_WILLNEED )
+        Advise( 0, m_cbSize, DXUT_MAPPED_FILE_WILLNEED );
+
+    return true;
+}
+
+
+//--------------------------------------------------------------------------------------
+void CDXUTMappedFile::Close()
+{
+    if( m_pData )
+        UnmapViewOfFile( m_pData );
+    m_pData = NULL;
+    m_cbSize = 0;
+}
+
+
+//--------------------------------------------------------------------------------------
+void CDXUTMappedFile::Advise( size_t cbOffset, size_t cbSize, unsigned int dwHints )
+{
+    if( m_pData == NULL || cbOffset >= m_cbSize )
+        return;
+    if( cbSize > m_cbSize - cbOffset )
+        cbSize = m_cbSize - cbOffset;
+
+    // Read-ahead for the rest is chosen when the file is opened
+    if( !( dwHints & DXUT_MAPPED_FILE_WILLNEED ) )
+        return;
+
+    static LPPREFETCHVIRTUALMEMORY s_pPrefetchVirtualMemory = NULL;
+    static bool s_bLookedUp = false;
+    if( !s_bLookedUp )
+    {
+        HMODULE hKernel = GetModuleHandleW( L"kernel32.dll" );
+        if( hKernel )
+            s_pPrefetchVirtualMemory = ( LPPREFETCHVIRTUALMEMORY )GetProcAddress( hKernel, "PrefetchVirtualMemory" );
+        s_bLookedUp = true;
+    }
+
+    if( s_pPrefetchVirtualMemory )
+    {
+        DXUT_MEMORY_RANGE_ENTRY Range;
+        Range.VirtualAddress = m_pData + cbOffset;
+        Range.NumberOfBytes = cbSize;
+        s_pPrefetchVirtualMemory( GetCurrentProcess(), 1, &Range, 0 );
+    }
+}
+
+#else
+
+//--------------------------------------------------------------------------------------
+bool CDXUTMappedFile::Open( const char* szFileName, unsigned int dwFlags )
+{
+    Close();
+
+    int fd = open( szFileName, O_RDONLY );
+    if( fd < 0 )
+        return false;
+
+    struct stat FileInfo;
+    if( fstat( fd, &FileInfo ) != 0 || FileInfo.st_size <= 0 )
+    {
+        close( fd );
+        return false;
+    }
+
+    // A private mapping with PROT_WRITE is copy-on-write; writes never reach the file
+    int nProtection = PROT_READ;
+    if( dwFlags & DXUT_MAPPED_FILE_COPY_ON_WRITE )
+        nProtection |= PROT_WRITE;
+
+    // Private pages a writer changes may or may not be seen, depending on the system;
+    // shared ones always are
+    int nMapping = MAP_PRIVATE;
+    if( ( dwFlags & DXUT_MAPPED_FILE_SHARE_WRITE ) && !( dwFlags & DXUT_MAPPED_FILE_COPY_ON_WRITE ) )
+        nMapping = MAP_SHARED;
+
+    void* pData = mmap( NULL, ( size_t )FileInfo.st_size, nProtection, nMapping, fd, 0 );
+
+    // The mapping holds its own reference to the file
+    close( fd );
+    if( pData == MAP_FAILED )
+        return false;
+
+    m_pData = ( unsigned char* )pData;
+    m_cbSize = ( size_t )FileInfo.st_size;
+
+    unsigned int dwHints = dwFlags & ( DXUT_MAPPED_FILE_SEQUENTIAL | DXUT_MAPPED_FILE_RANDOM |
+                                       DXUT_MAPPED_FILE_WILLNEED );
+    if( dwHints )
+        Advise( 0, m_cbSize, dwHints );
+
+    return true;
+}
+
+
+//--------------------------------------------------------------------------------------
+void CDXUTMappedFile::Close()
+{
+    if( m_pData )
+        munmap( m_pData, m_cbSize );
+    m_pData = NULL;
+    m_cbSize = 0;
+}
+
+
+//--------------------------------------------------------------------------------------
+void CDXUTMappedFile::Advise( size_t cbOffset, size_t cbSize, unsigned int dwHints )
+{
+    if( m_pData == NULL || cbOffset >= m_cbSize )
+        return;
+    if( cbSize > m_cbSize - cbOffset )
+        cbSize = m_cbSize - cbOffset;
+
+    // madvise wants a page aligned start
+    size_t cbPage = ( size_t )sysconf( _SC_PAGESIZE );
+    size_t cbAlignedOffset = cbOffset & ~( cbPage - 1 );
+    unsigned char* pStart = m_pData + cbAlignedOffset;
+    size_t cbLength = cbSize + ( cbOffset - cbAlignedOffset );
+
+    if( dwHints & DXUT_MAPPED_FILE_SEQUENTIAL )
+        madvise( pStart, cbLength, MADV_SEQUENTIAL );
+    else if( dwHints & DXUT_MAPPED_FILE_RANDOM )
+        madvise( pStart, cbLength, MADV_RANDOM );
+
+    if( dwHints & DXUT_MAPPED_FILE_WILLNEED )
+        madvise( pStart, cbLength, MADV_WILLNEED );
+}
+
+#endif
+
+
+//--------------------------------------------------------------------------------------
+// UTF-8 file names
+//--------------------------------------------------------------------------------------
+#ifdef _WIN32
+bool DXUTFileNameToWide( const char* szFileName, wchar_t* wstr )
+{
+    return 0 != MultiByteToWideChar( CP_UTF8, MB_ERR_INVALID_CHARS, szFileName, -1, wstr, DXUT_FILE_MAX_PATH );
+}
+#endif
+
+
+//--------------------------------------------------------------------------------------
+FILE* DXUTOpenFile( const char* szFileName, const char* szMode )
+{
+#ifdef _WIN32
+    wchar_t wstrFileName[DXUT_FILE_MAX_PATH], wstrMode[8];
+    if( !DXUTFileNameToWide( szFileName, wstrFileName ) ||
+        0 == MultiByteToWideChar( CP_UTF8, MB_ERR_INVALID_CHARS, szMode, -1, wstrMode, 8 ) )
+        return NULL;
+    return _wfopen( wstrFileName, wstrMode );
+#else
+    return fopen( szFileName, szMode );
+#endif
+}
+
+
+//--------------------------------------------------------------------------------------
+bool DXUTReplaceFile( const char* szFrom, const char* szTo )
+{
+#ifdef _WIN32
+    wchar_t wstrFrom[DXUT_FILE_MAX_PATH], wstrTo[DXUT_FILE_MAX_PATH];
+    if( !DXUTFileNameToWide( szFrom, wstrFrom ) || !DXUTFileNameToWide( szTo, wstrTo ) )
+        return false;
+    return 0 != MoveFileExW( wstrFrom, wstrTo, MOVEFILE_REPLACE_EXISTING );
+#else
+    return 0 == rename( szFrom, szTo );
+#endif
+}
+
+
+//--------------------------------------------------------------------------------------
+void DXUTDeleteFile( const char* szFileName )
+{
+#ifdef _WIN32
+    wchar_t wstrFileName[DXUT_FILE_MAX_PATH];
+    if( DXUTFileNameToWide( szFileName, wstrFileName ) )
+        _wremove( wstrFileName );
+#else
+    remove( szFileName );
+#endif
+}
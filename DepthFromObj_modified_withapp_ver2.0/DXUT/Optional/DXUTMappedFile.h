@@ -0,0 +1,118 @@
+//--------------------------------------------------------------------------------------
+// File: DXUTMappedFile.h
+//
+// Read-only or copy-on-write memory mapping of a whole file, on Win32 file mappings or
+// POSIX mmap.  Pointers into the mapping are backed by the OS page cache, so loaders
+// can use the file's contents in place instead of reading them into a heap copy, and
+// several processes mapping the same asset share the physical pages.
+//
+// Also has the helpers the portable loaders and writers use to open, replace and delete
+// files named in UTF-8, which Windows would otherwise take in the ANSI code page.
+//--------------------------------------------------------------------------------------
+#pragma once
+#ifndef DXUT_MAPPEDFILE_H
+#define DXUT_MAPPEDFILE_H
+
+#include <stddef.h>
+#include <stdio.h>
+
+// Longest UTF-8 path the file helpers convert for Windows, in wide characters
+#define DXUT_FILE_MAX_PATH  260
+
+//--------------------------------------------------------------------------------------
+// Flags for CDXUTMappedFile::Open and access hints for CDXUTMappedFile::Advise
+//--------------------------------------------------------------------------------------
+enum DXUT_MAPPED_FILE_FLAGS
+{
+    // Pages are private to this mapping and may be written; only the pages that are
+    // actually written get copied, the rest stay shared with the page cache.  Without
+    // this flag the mapping is read-only.
+    DXUT_MAPPED_FILE_COPY_ON_WRITE = 0x1,
+
+    // Access pattern hints.  They only steer OS read-ahead and are ignored where the
+    // platform has no equivalent.
+    DXUT_MAPPED_FILE_SEQUENTIAL = 0x2,     // Aggressive read-ahead
+    DXUT_MAPPED_FILE_RANDOM = 0x4,         // Little or no read-ahead
+    DXUT_MAPPED_FILE_WILLNEED = 0x8,       // Start paging the range in now
+
+    // Lets another process go on writing to the file while it is mapped, and have
+    // what it writes within the mapped size show up in the mapping.  Reading a file
+    // that is still being appended to means opening it again once it has grown.
+    DXUT_MAPPED_FILE_SHARE_WRITE = 0x10,
+};
+
+
+//--------------------------------------------------------------------------------------
+class CDXUTMappedFile
+{
+public:
+                    CDXUTMappedFile();
+                    ~CDXUTMappedFile();
+
+    // Maps the whole file.  Fails on empty files, which can't be mapped.
+    bool            Open( const char* szFileName, unsigned int dwFlags = 0 );
+#ifdef _WIN32
+    bool            Open( const wchar_t* szFileName, unsigned int dwFlags = 0 );
+#endif
+    void            Close();
+
+    bool            IsOpen() const
+    {
+        return m_pData != NULL;
+    }
+    unsigned char*  GetData() const
+    {
+        return m_pData;
+    }
+    size_t          GetSize() const
+    {
+        return m_cbSize;
+    }
+
+    // Exchanges the mappings, e.g. to map a file again without losing the old mapping
+    // if that fails
+    void            Swap( CDXUTMappedFile& Other )
+    {
+        unsigned char* pData = m_pData;
+        size_t cbSize = m_cbSize;
+        m_pData = Other.m_pData;
+        m_cbSize = Other.m_cbSize;
+        Other.m_pData = pData;
+        Other.m_cbSize = cbSize;
+    }
+
+    // Applies DXUT_MAPPED_FILE_SEQUENTIAL/RANDOM/WILLNEED to part of the mapping, e.g.
+    // to prefetch vertex data once the header has said where it is
+    void            Advise( size_t cbOffset, size_t cbSize, unsigned int dwHints );
+
+private:
+#ifdef _WIN32
+    bool            MapHandle( void* hFile, unsigned int dwFlags );
+#endif
+
+    // Leave these private and undefined to prevent their use
+                    CDXUTMappedFile( const CDXUTMappedFile& );
+    CDXUTMappedFile& operator =( const CDXUTMappedFile& );
+
+    unsigned char*  m_pData;
+    size_t          m_cbSize;
+};
+
+
+//--------------------------------------------------------------------------------------
+// UTF-8 file names.  Elsewhere they are passed to the CRT as they are.
+//--------------------------------------------------------------------------------------
+#ifdef _WIN32
+// wstr holds DXUT_FILE_MAX_PATH characters.  Fails on invalid UTF-8 or a longer path.
+bool    DXUTFileNameToWide( const char* szFileName, wchar_t* wstr );
+#endif
+
+// fopen
+FILE*   DXUTOpenFile( const char* szFileName, const char* szMode );
+
+// Moves szFrom over szTo, replacing it if it exists
+bool    DXUTReplaceFile( const char* szFrom, const char* szTo );
+
+void    DXUTDeleteFile( const char* szFileName );
+
+#endif
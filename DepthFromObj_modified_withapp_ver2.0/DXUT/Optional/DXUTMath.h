@@ -0,0 +1,401 @@
+//--------------------------------------------------------------------------------------
+// File: DXUTMath.h
+//
+// Small 4x4 matrix and vector library for code that can't use D3DX: the OpenGL tools,
+// the command line tools on Linux and the CPU side of the loaders.  Everything is
+// inline, with SSE and NEON paths for the matrix multiply and the batch transforms and
+// plain C++ elsewhere.
+//
+// Matrices use the D3DX layout: row-major, applied to row vectors (v * M), translation
+// in m[3].  That is the same sixteen floats in the same order as an OpenGL column-major
+// matrix applied to column vectors, so a DXUTMATRIX4 can be passed straight to
+// glUniformMatrix4fv without transposing.  The one thing to keep in mind is the order
+// of products: OpenGL's P * V * M is DXUTMatrixMultiply( M, V ) then ( ..., P ).
+//--------------------------------------------------------------------------------------
+#pragma once
+#ifndef DXUT_MATH_H
+#define DXUT_MATH_H
+
+#include <math.h>
+#include <stddef.h>
+#include <string.h>
+
+#if defined( _M_IX86 ) || defined( _M_X64 ) || defined( __SSE__ )
+#include <xmmintrin.h>
+#define DXUT_MATH_SSE
+#elif defined( __ARM_NEON ) || defined( _M_ARM ) || defined( _M_ARM64 )
+#include <arm_neon.h>
+#define DXUT_MATH_NEON
+#endif
+
+struct DXUTMATRIX4
+{
+    float m[4][4];
+};
+
+// Range of clip space z after the divide
+enum DXUT_CLIP_DEPTH
+{
+    DXUT_CLIP_DEPTH_ZERO_TO_ONE,            // Direct3D
+    DXUT_CLIP_DEPTH_MINUS_ONE_TO_ONE,       // OpenGL
+};
+
+
+//--------------------------------------------------------------------------------------
+// Vectors, as float[3]
+//--------------------------------------------------------------------------------------
+inline float DXUTVec3Dot( const float* a, const float* b )
+{
+    return a[0] * b[0] + a[1] * b[1] + a[2] * b[2];
+}
+
+// pOut may alias either input
+inline void DXUTVec3Cross( float* pOut, const float* a, const float* b )
+{
+    float x = a[1] * b[2] - a[2] * b[1];
+    float y = a[2] * b[0] - a[0] * b[2];
+    float z = a[0] * b[1] - a[1] * b[0];
+    pOut[0] = x;
+    pOut[1] = y;
+    pOut[2] = z;
+}
+
+// Zero length vectors are left as they are
+inline void DXUTVec3Normalize( float* pOut, const float* a )
+{
+    float fLength = sqrtf( DXUTVec3Dot( a, a ) );
+    float fScale = fLength > 0.0f ? 1.0f / fLength : 1.0f;
+    pOut[0] = a[0] * fScale;
+    pOut[1] = a[1] * fScale;
+    pOut[2] = a[2] * fScale;
+}
+
+
+//--------------------------------------------------------------------------------------
+// Matrices
+//--------------------------------------------------------------------------------------
+inline void DXUTMatrixIdentity( DXUTMATRIX4* pOut )
+{
+    memset( pOut, 0, sizeof( DXUTMATRIX4 ) );
+    pOut->m[0][0] = pOut->m[1][1] = pOut->m[2][2] = pOut->m[3][3] = 1.0f;
+}
+
+inline void DXUTMatrixTranslation( DXUTMATRIX4* pOut, float x, float y, float z )
+{
+    DXUTMatrixIdentity( pOut );
+    pOut->m[3][0] = x;
+    pOut->m[3][1] = y;
+    pOut->m[3][2] = z;
+}
+
+inline void DXUTMatrixTranspose( DXUTMATRIX4* pOut, const DXUTMATRIX4* pM )
+{
+    DXUTMATRIX4 t;
+    for( int i = 0; i < 4; i++ )
+    {
+        for( int j = 0; j < 4; j++ )
+            t.m[i][j] = pM->m[j][i];
+    }
+    *pOut = t;
+}
+
+// Rotation by the unit quaternion q = ( x, y, z, w ), as D3DXMatrixRotationQuaternion
+inline void DXUTMatrixRotationQuaternion( DXUTMATRIX4* pOut, const float* q )
+{
+    float x = q[0], y = q[1], z = q[2], w = q[3];
+    DXUTMatrixIdentity( pOut );
+    pOut->m[0][0] = 1.0f - 2.0f * ( y * y + z * z );
+    pOut->m[0][1] = 2.0f * ( x * y + z * w );
+    pOut->m[0][2] = 2.0f * ( x * z - y * w );
+    pOut->m[1][0] = 2.0f * ( x * y - z * w );
+    pOut->m[1][1] = 1.0f - 2.0f * ( x * x + z * z );
+    pOut->m[1][2] = 2.0f * ( y * z + x * w );
+    pOut->m[2][0] = 2.0f * ( x * z + y * w );
+    pOut->m[2][1] = 2.0f * ( y * z - x * w );
+    pOut->m[2][2] = 1.0f - 2.0f * ( x * x + y * y );
+}
+
+// pOut = pA * pB: pA is applied first.  Each output row is the rows of pB scaled by one
+// row of pA, which maps onto four-wide lanes.  pOut may alias either input.
+inline void DXUTMatrixMultiply( DXUTMATRIX4* pOut, const DXUTMATRIX4* pA, const DXUTMATRIX4* pB )
+{
+#if defined( DXUT_MATH_SSE )
+    __m128 b0 = _mm_loadu_ps( pB->m[0] );
+    __m128 b1 = _mm_loadu_ps( pB->m[1] );
+    __m128 b2 = _mm_loadu_ps( pB->m[2] );
+    __m128 b3 = _mm_loadu_ps( pB->m[3] );
+
+    __m128 r[4];
+    for( int i = 0; i < 4; i++ )
+    {
+        const float* a = pA->m[i];
+        r[i] = _mm_add_ps( _mm_add_ps( _mm_mul_ps( _mm_set1_ps( a[0] ), b0 ), _mm_mul_ps( _mm_set1_ps( a[1] ), b1 ) ),
+                           _mm_add_ps( _mm_mul_ps( _mm_set1_ps( a[2] ), b2 ), _mm_mul_ps( _mm_set1_ps( a[3] ), b3 ) ) );
+    }
+
+    for( int i = 0; i < 4; i++ )
+        _mm_storeu_ps( pOut->m[i], r[i] );
+#elif defined( DXUT_MATH_NEON )
+    float32x4_t b0 = vld1q_f32( pB->m[0] );
+    float32x4_t b1 = vld1q_f32( pB->m[1] );
+    float32x4_t b2 = vld1q_f32( pB->m[2] );
+    float32x4_t b3 = vld1q_f32( pB->m[3] );
+
+    float32x4_t r[4];
+    for( int i = 0; i < 4; i++ )
+    {
+        const float* a = pA->m[i];
+        r[i] = vmlaq_n_f32( vmlaq_n_f32( vmlaq_n_f32( vmulq_n_f32( b0, a[0] ), b1, a[1] ), b2, a[2] ), b3, a[3] );
+    }
+
+    for( int i = 0; i < 4; i++ )
+        vst1q_f32( pOut->m[i], r[i] );
+#else
+    DXUTMATRIX4 t;
+    for( int i = 0; i < 4; i++ )
+    {
+        for( int j = 0; j < 4; j++ )
+            t.m[i][j] = pA->m[i][0] * pB->m[0][j] + pA->m[i][1] * pB->m[1][j] +
+                        pA->m[i][2] * pB->m[2][j] + pA->m[i][3] * pB->m[3][j];
+    }
+    *pOut = t;
+#endif
+}
+
+// General inverse by cofactors.  Returns false and leaves pOut alone if pM is singular.
+// It isn't on any per-vertex path, so it stays scalar.
+inline bool DXUTMatrixInverse( DXUTMATRIX4* pOut, const DXUTMATRIX4* pM )
+{
+    const float* m = &pM->m[0][0];
+
+    // 2x2 determinants of the top two and bottom two rows
+    float s0 = m[0] * m[5] - m[4] * m[1];
+    float s1 = m[0] * m[6] - m[4] * m[2];
+    float s2 = m[0] * m[7] - m[4] * m[3];
+    float s3 = m[1] * m[6] - m[5] * m[2];
+    float s4 = m[1] * m[7] - m[5] * m[3];
+    float s5 = m[2] * m[7] - m[6] * m[3];
+
+    float c5 = m[10] * m[15] - m[14] * m[11];
+    float c4 = m[9] * m[15] - m[13] * m[11];
+    float c3 = m[9] * m[14] - m[13] * m[10];
+    float c2 = m[8] * m[15] - m[12] * m[11];
+    float c1 = m[8] * m[14] - m[12] * m[10];
+    float c0 = m[8] * m[13] - m[12] * m[9];
+
+    float fDet = s0 * c5 - s1 * c4 + s2 * c3 + s3 * c2 - s4 * c1 + s5 * c0;
+    if( fDet == 0.0f || fDet != fDet )
+        return false;
+    float f = 1.0f / fDet;
+
+    DXUTMATRIX4 t;
+    float* r = &t.m[0][0];
+    r[0] = ( m[5] * c5 - m[6] * c4 + m[7] * c3 ) * f;
+    r[1] = ( -m[1] * c5 + m[2] * c4 - m[3] * c3 ) * f;
+    r[2] = ( m[13] * s5 - m[14] * s4 + m[15] * s3 ) * f;
+    r[3] = ( -m[9] * s5 + m[10] * s4 - m[11] * s3 ) * f;
+
+    r[4] = ( -m[4] * c5 + m[6] * c2 - m[7] * c1 ) * f;
+    r[5] = ( m[0] * c5 - m[2] * c2 + m[3] * c1 ) * f;
+    r[6] = ( -m[12] * s5 + m[14] * s2 - m[15] * s1 ) * f;
+    r[7] = ( m[8] * s5 - m[10] * s2 + m[11] * s1 ) * f;
+
+    r[8] = ( m[4] * c4 - m[5] * c2 + m[7] * c0 ) * f;
+    r[9] = ( -m[0] * c4 + m[1] * c2 - m[3] * c0 ) * f;
+    r[10] = ( m[12] * s4 - m[13] * s2 + m[15] * s0 ) * f;
+    r[11] = ( -m[8] * s4 + m[9] * s2 - m[11] * s0 ) * f;
+
+    r[12] = ( -m[4] * c3 + m[5] * c1 - m[6] * c0 ) * f;
+    r[13] = ( m[0] * c3 - m[1] * c1 + m[2] * c0 ) * f;
+    r[14] = ( -m[12] * s3 + m[13] * s1 - m[14] * s0 ) * f;
+    r[15] = ( m[8] * s3 - m[9] * s1 + m[10] * s0 ) * f;
+
+    *pOut = t;
+    return true;
+}
+
+
+//--------------------------------------------------------------------------------------
+// Cameras.  LH looks down +z (the Direct3D sample), RH looks down -z (OpenGL).  Both
+// match the D3DX functions of the same name when Depth is DXUT_CLIP_DEPTH_ZERO_TO_ONE.
+//--------------------------------------------------------------------------------------
+inline void DXUTMatrixLookAt( DXUTMATRIX4* pOut, const float* pEye, const float* pAt, const float* pUp,
+                              bool bRightHanded )
+{
+    float x[3], y[3], z[3];
+    if( bRightHanded )
+        z[0] = pEye[0] - pAt[0], z[1] = pEye[1] - pAt[1], z[2] = pEye[2] - pAt[2];
+    else
+        z[0] = pAt[0] - pEye[0], z[1] = pAt[1] - pEye[1], z[2] = pAt[2] - pEye[2];
+    DXUTVec3Normalize( z, z );
+    DXUTVec3Cross( x, pUp, z );
+    DXUTVec3Normalize( x, x );
+    DXUTVec3Cross( y, z, x );
+
+    for( int i = 0; i < 3; i++ )
+    {
+        pOut->m[i][0] = x[i];
+        pOut->m[i][1] = y[i];
+        pOut->m[i][2] = z[i];
+        pOut->m[i][3] = 0.0f;
+    }
+    pOut->m[3][0] = -DXUTVec3Dot( x, pEye );
+    pOut->m[3][1] = -DXUTVec3Dot( y, pEye );
+    pOut->m[3][2] = -DXUTVec3Dot( z, pEye );
+    pOut->m[3][3] = 1.0f;
+}
+
+inline void DXUTMatrixLookAtLH( DXUTMATRIX4* pOut, const float* pEye, const float* pAt, const float* pUp )
+{
+    DXUTMatrixLookAt( pOut, pEye, pAt, pUp, false );
+}
+
+inline void DXUTMatrixLookAtRH( DXUTMATRIX4* pOut, const float* pEye, const float* pAt, const float* pUp )
+{
+    DXUTMatrixLookAt( pOut, pEye, pAt, pUp, true );
+}
+
+// fFovY is the full vertical field of view in radians
+inline void DXUTMatrixPerspectiveFov( DXUTMATRIX4* pOut, float fFovY, float fAspect, float fNear, float fFar,
+                                      DXUT_CLIP_DEPTH Depth, bool bRightHanded )
+{
+    float fYScale = 1.0f / tanf( 0.5f * fFovY );
+    float fSign = bRightHanded ? -1.0f : 1.0f;
+
+    memset( pOut, 0, sizeof( DXUTMATRIX4 ) );
+    pOut->m[0][0] = fYScale / fAspect;
+    pOut->m[1][1] = fYScale;
+    pOut->m[2][3] = fSign;
+    if( Depth == DXUT_CLIP_DEPTH_ZERO_TO_ONE )
+    {
+        pOut->m[2][2] = fSign * fFar / ( fFar - fNear );
+        pOut->m[3][2] = -fNear * fFar / ( fFar - fNear );
+    }
+    else
+    {
+        pOut->m[2][2] = fSign * ( fFar + fNear ) / ( fFar - fNear );
+        pOut->m[3][2] = -2.0f * fNear * fFar / ( fFar - fNear );
+    }
+}
+
+inline void DXUTMatrixPerspectiveFovLH( DXUTMATRIX4* pOut, float fFovY, float fAspect, float fNear, float fFar,
+                                        DXUT_CLIP_DEPTH Depth = DXUT_CLIP_DEPTH_ZERO_TO_ONE )
+{
+    DXUTMatrixPerspectiveFov( pOut, fFovY, fAspect, fNear, fFar, Depth, false );
+}
+
+inline void DXUTMatrixPerspectiveFovRH( DXUTMATRIX4* pOut, float fFovY, float fAspect, float fNear, float fFar,
+                                        DXUT_CLIP_DEPTH Depth = DXUT_CLIP_DEPTH_MINUS_ONE_TO_ONE )
+{
+    DXUTMatrixPerspectiveFov( pOut, fFovY, fAspect, fNear, fFar, Depth, true );
+}
+
+// Applied after a projection, stretches the NDC rectangle [fLeft, fRight] x [fBottom,
+// fTop] to the whole of clip space.  Projection * crop is the projection of that part
+// of the view on its own, for rendering an image in tiles or culling to part of it.
+inline void DXUTMatrixProjectionCrop( DXUTMATRIX4* pOut, float fLeft, float fBottom, float fRight, float fTop )
+{
+    DXUTMatrixIdentity( pOut );
+    pOut->m[0][0] = 2.0f / ( fRight - fLeft );
+    pOut->m[3][0] = -( fRight + fLeft ) / ( fRight - fLeft );
+    pOut->m[1][1] = 2.0f / ( fTop - fBottom );
+    pOut->m[3][1] = -( fTop + fBottom ) / ( fTop - fBottom );
+}
+
+
+//--------------------------------------------------------------------------------------
+// Batch transforms.  Inputs are three floats at the start of each cbInStride bytes, so
+// positions can be read straight out of an interleaved vertex buffer.  Each vertex is
+// loaded before anything is stored, so the output may be the input (in place).  The
+// loops do a handful of multiply-adds per 12 bytes read and run at memory speed.
+//--------------------------------------------------------------------------------------
+
+// Helper for the batch loops: x * r0 + y * r1 + z * r2 + r3
+#if defined( DXUT_MATH_SSE )
+#define DXUT_MATH_TRANSFORM_ROWS( p, r0, r1, r2, r3 ) \
+    _mm_add_ps( _mm_add_ps( _mm_mul_ps( _mm_set1_ps( ( p )[0] ), r0 ), _mm_mul_ps( _mm_set1_ps( ( p )[1] ), r1 ) ), \
+                _mm_add_ps( _mm_mul_ps( _mm_set1_ps( ( p )[2] ), r2 ), r3 ) )
+#elif defined( DXUT_MATH_NEON )
+#define DXUT_MATH_TRANSFORM_ROWS( p, r0, r1, r2, r3 ) \
+    vmlaq_n_f32( vmlaq_n_f32( vmlaq_n_f32( r3, r0, ( p )[0] ), r1, ( p )[1] ), r2, ( p )[2] )
+#endif
+
+// Full projective transform of positions (w = 1) to four floats each, e.g. to clip
+// space.  pOut is packed.
+inline void DXUTTransformPointsToVec4( float* pOut, const void* pIn, size_t cbInStride, size_t nCount,
+                                       const DXUTMATRIX4* pM )
+{
+    const char* pSrc = ( const char* )pIn;
+#if defined( DXUT_MATH_SSE )
+    __m128 r0 = _mm_loadu_ps( pM->m[0] ), r1 = _mm_loadu_ps( pM->m[1] );
+    __m128 r2 = _mm_loadu_ps( pM->m[2] ), r3 = _mm_loadu_ps( pM->m[3] );
+    for( size_t i = 0; i < nCount; i++, pSrc += cbInStride )
+        _mm_storeu_ps( pOut + 4 * i, DXUT_MATH_TRANSFORM_ROWS( ( const float* )pSrc, r0, r1, r2, r3 ) );
+#elif defined( DXUT_MATH_NEON )
+    float32x4_t r0 = vld1q_f32( pM->m[0] ), r1 = vld1q_f32( pM->m[1] );
+    float32x4_t r2 = vld1q_f32( pM->m[2] ), r3 = vld1q_f32( pM->m[3] );
+    for( size_t i = 0; i < nCount; i++, pSrc += cbInStride )
+        vst1q_f32( pOut + 4 * i, DXUT_MATH_TRANSFORM_ROWS( ( const float* )pSrc, r0, r1, r2, r3 ) );
+#else
+    for( size_t i = 0; i < nCount; i++, pSrc += cbInStride )
+    {
+        const float* p = ( const float* )pSrc;
+        for( int j = 0; j < 4; j++ )
+            pOut[4 * i + j] = p[0] * pM->m[0][j] + p[1] * pM->m[1][j] + p[2] * pM->m[2][j] + pM->m[3][j];
+    }
+#endif
+}
+
+// Shared by DXUTTransformPoints and DXUTTransformVectors; the last column of pM is
+// ignored, and fW scales the translation row
+inline void DXUTTransformAffine( void* pOut, size_t cbOutStride, const void* pIn, size_t cbInStride, size_t nCount,
+                                 const DXUTMATRIX4* pM, float fW )
+{
+    const char* pSrc = ( const char* )pIn;
+    char* pDest = ( char* )pOut;
+#if defined( DXUT_MATH_SSE )
+    __m128 r0 = _mm_loadu_ps( pM->m[0] ), r1 = _mm_loadu_ps( pM->m[1] );
+    __m128 r2 = _mm_loadu_ps( pM->m[2] ), r3 = _mm_mul_ps( _mm_loadu_ps( pM->m[3] ), _mm_set1_ps( fW ) );
+    for( size_t i = 0; i < nCount; i++, pSrc += cbInStride, pDest += cbOutStride )
+    {
+        __m128 v = DXUT_MATH_TRANSFORM_ROWS( ( const float* )pSrc, r0, r1, r2, r3 );
+        _mm_storel_pi( ( __m64* )pDest, v );
+        _mm_store_ss( ( float* )pDest + 2, _mm_movehl_ps( v, v ) );
+    }
+#elif defined( DXUT_MATH_NEON )
+    float32x4_t r0 = vld1q_f32( pM->m[0] ), r1 = vld1q_f32( pM->m[1] );
+    float32x4_t r2 = vld1q_f32( pM->m[2] ), r3 = vmulq_n_f32( vld1q_f32( pM->m[3] ), fW );
+    for( size_t i = 0; i < nCount; i++, pSrc += cbInStride, pDest += cbOutStride )
+    {
+        float32x4_t v = DXUT_MATH_TRANSFORM_ROWS( ( const float* )pSrc, r0, r1, r2, r3 );
+        vst1_f32( ( float* )pDest, vget_low_f32( v ) );
+        vst1q_lane_f32( ( float* )pDest + 2, v, 2 );
+    }
+#else
+    for( size_t i = 0; i < nCount; i++, pSrc += cbInStride, pDest += cbOutStride )
+    {
+        const float* p = ( const float* )pSrc;
+        float v[3];
+        for( int j = 0; j < 3; j++ )
+            v[j] = p[0] * pM->m[0][j] + p[1] * pM->m[1][j] + p[2] * pM->m[2][j] + fW * pM->m[3][j];
+        memcpy( pDest, v, sizeof( v ) );
+    }
+#endif
+}
+
+// Positions (w = 1) through the affine part of pM, three floats out per vertex
+inline void DXUTTransformPoints( void* pOut, size_t cbOutStride, const void* pIn, size_t cbInStride, size_t nCount,
+                                 const DXUTMATRIX4* pM )
+{
+    DXUTTransformAffine( pOut, cbOutStride, pIn, cbInStride, nCount, pM, 1.0f );
+}
+
+// Directions (w = 0): the translation is ignored.  For normals pass the inverse
+// transpose of the world matrix and renormalize.
+inline void DXUTTransformVectors( void* pOut, size_t cbOutStride, const void* pIn, size_t cbInStride, size_t nCount,
+                                  const DXUTMATRIX4* pM )
+{
+    DXUTTransformAffine( pOut, cbOutStride, pIn, cbInStride, nCount, pM, 0.0f );
+}
+
+#endif
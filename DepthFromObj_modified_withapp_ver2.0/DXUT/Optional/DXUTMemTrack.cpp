@@ -0,0 +1,314 @@
+//--------------------------------------------------------------------------------------
+// File: DXUTMemTrack.cpp
+//
+// Counters and phase timeline for DXUT_MEM_ALLOC and friends.  See DXUTMemTrack.h for
+// usage.
+//--------------------------------------------------------------------------------------
+#include "DXUTMemTrack.h"
+#include "DXUTProfiler.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <mutex>
+#include <vector>
+
+#ifdef _WIN32
+#pragma pack(push)
+#pragma pack(8)
+#include <windows.h>
+#include <psapi.h>
+#pragma pack(pop)
+#pragma comment( lib, "psapi.lib" )
+#endif
+
+#ifdef _MSC_VER
+#define DXUT_MEMTRACK_FORMAT( szLine, ... )     sprintf_s( szLine, sizeof( szLine ), __VA_ARGS__ )
+#else
+#define DXUT_MEMTRACK_FORMAT( szLine, ... )     sprintf( szLine, __VA_ARGS__ )
+#endif
+
+//--------------------------------------------------------------------------------------
+// Every tag is updated with relaxed atomics from whichever thread allocates.  Peaks
+// are raised with a compare-exchange loop, so they are exact even under contention.
+//--------------------------------------------------------------------------------------
+struct DXUTMemTagCounters
+{
+    std::atomic<unsigned long long> nAllocs;
+    std::atomic<unsigned long long> nFrees;
+    std::atomic<unsigned long long> nTotalBytes;
+    std::atomic<long long> nBytes;
+    std::atomic<long long> nPeakBytes;
+    std::atomic<long long> nPhasePeakBytes;
+};
+
+
+//--------------------------------------------------------------------------------------
+// Global/Static Members
+//--------------------------------------------------------------------------------------
+std::atomic<bool> g_bDXUTMemTrackEnabled( false );
+
+static DXUTMemTagCounters s_Tags[DXUT_MEM_TAG_COUNT];
+static std::atomic<long long> s_nBytes( 0 );
+static std::atomic<long long> s_nPhasePeakBytes( 0 );
+
+static const char* s_pszTagNames[DXUT_MEM_TAG_COUNT] =
+{
+    "parser",
+    "vertex cache",
+    "mesh",
+    "materials",
+    "textures",
+};
+
+// The timeline is only touched at phase boundaries
+static std::mutex& DXUTMemTrackTimelineLock()
+{
+    static std::mutex s_Lock;
+    return s_Lock;
+}
+static DXUTMemPhase s_Phases[DXUT_MEMTRACK_MAX_PHASES];
+static unsigned int s_nPhases = 0;
+static DXUT_PROFILE_TIME s_tTimelineStart = 0;
+
+
+//--------------------------------------------------------------------------------------
+static void DXUTMemTrackRaise( std::atomic<long long>& nPeak, long long nValue )
+{
+    long long nOld = nPeak.load( std::memory_order_relaxed );
+    while( nValue > nOld && !nPeak.compare_exchange_weak( nOld, nValue, std::memory_order_relaxed ) )
+        ;
+}
+
+
+//--------------------------------------------------------------------------------------
+void DXUTMemTrackEnable( bool bEnable )
+{
+    g_bDXUTMemTrackEnabled.store( bEnable, std::memory_order_relaxed );
+}
+
+
+//--------------------------------------------------------------------------------------
+void DXUTMemTrackInitFromEnvironment()
+{
+    const char* pszValue = getenv( "DXUT_MEMTRACK" );
+    if( pszValue && pszValue[0] && strcmp( pszValue, "0" ) )
+        DXUTMemTrackEnable( true );
+}
+
+
+//--------------------------------------------------------------------------------------
+void DXUTMemTrackAlloc( DXUT_MEM_TAG Tag, size_t nBytes )
+{
+    DXUTMemTagCounters& Counters = s_Tags[Tag];
+    Counters.nAllocs.fetch_add( 1, std::memory_order_relaxed );
+    Counters.nTotalBytes.fetch_add( nBytes, std::memory_order_relaxed );
+
+    long long nTagBytes = Counters.nBytes.fetch_add( ( long long )nBytes, std::memory_order_relaxed ) + nBytes;
+    DXUTMemTrackRaise( Counters.nPeakBytes, nTagBytes );
+    DXUTMemTrackRaise( Counters.nPhasePeakBytes, nTagBytes );
+
+    long long nAllBytes = s_nBytes.fetch_add( ( long long )nBytes, std::memory_order_relaxed ) + nBytes;
+    DXUTMemTrackRaise( s_nPhasePeakBytes, nAllBytes );
+}
+
+
+//--------------------------------------------------------------------------------------
+void DXUTMemTrackFree( DXUT_MEM_TAG Tag, size_t nBytes )
+{
+    DXUTMemTagCounters& Counters = s_Tags[Tag];
+    Counters.nFrees.fetch_add( 1, std::memory_order_relaxed );
+    Counters.nBytes.fetch_sub( ( long long )nBytes, std::memory_order_relaxed );
+    s_nBytes.fetch_sub( ( long long )nBytes, std::memory_order_relaxed );
+}
+
+
+//--------------------------------------------------------------------------------------
+// Starts the next phase at the current totals
+//--------------------------------------------------------------------------------------
+static void DXUTMemTrackResetPhasePeaks()
+{
+    for( unsigned int i = 0; i < DXUT_MEM_TAG_COUNT; i++ )
+        s_Tags[i].nPhasePeakBytes.store( s_Tags[i].nBytes.load( std::memory_order_relaxed ), std::memory_order_relaxed );
+    s_nPhasePeakBytes.store( s_nBytes.load( std::memory_order_relaxed ), std::memory_order_relaxed );
+}
+
+
+//--------------------------------------------------------------------------------------
+void DXUTMemTrackBeginTimeline()
+{
+    std::lock_guard<std::mutex> lock( DXUTMemTrackTimelineLock() );
+    s_nPhases = 0;
+    s_tTimelineStart = DXUTProfilerGetTimeNs();
+    DXUTMemTrackResetPhasePeaks();
+}
+
+
+//--------------------------------------------------------------------------------------
+void DXUTMemTrackMarkPhase( const char* pszName )
+{
+    std::lock_guard<std::mutex> lock( DXUTMemTrackTimelineLock() );
+
+    // A full timeline keeps its last entry up to date rather than dropping the end
+    DXUTMemPhase& Phase = s_Phases[s_nPhases < DXUT_MEMTRACK_MAX_PHASES ? s_nPhases++ : s_nPhases - 1];
+    Phase.pszName = pszName;
+    Phase.tEndNs = DXUTProfilerGetTimeNs() - s_tTimelineStart;
+    Phase.nPeakBytes = s_nPhasePeakBytes.load( std::memory_order_relaxed );
+    Phase.nBytes = s_nBytes.load( std::memory_order_relaxed );
+    for( unsigned int i = 0; i < DXUT_MEM_TAG_COUNT; i++ )
+        Phase.nTagPeakBytes[i] = s_Tags[i].nPhasePeakBytes.load( std::memory_order_relaxed );
+    DXUTMemTrackGetProcessMemory( &Phase.nProcessBytes, &Phase.nProcessPeakBytes );
+
+    DXUTMemTrackResetPhasePeaks();
+}
+
+
+//--------------------------------------------------------------------------------------
+void DXUTMemTrackGetTagStats( DXUT_MEM_TAG Tag, DXUTMemTagStats* pStats )
+{
+    const DXUTMemTagCounters& Counters = s_Tags[Tag];
+    pStats->nAllocs = Counters.nAllocs.load( std::memory_order_relaxed );
+    pStats->nFrees = Counters.nFrees.load( std::memory_order_relaxed );
+    pStats->nTotalBytes = Counters.nTotalBytes.load( std::memory_order_relaxed );
+    pStats->nBytes = Counters.nBytes.load( std::memory_order_relaxed );
+    pStats->nPeakBytes = Counters.nPeakBytes.load( std::memory_order_relaxed );
+}
+
+
+//--------------------------------------------------------------------------------------
+const char* DXUTMemTrackGetTagName( DXUT_MEM_TAG Tag )
+{
+    return s_pszTagNames[Tag];
+}
+
+
+//--------------------------------------------------------------------------------------
+unsigned int DXUTMemTrackGetPhaseCount()
+{
+    std::lock_guard<std::mutex> lock( DXUTMemTrackTimelineLock() );
+    return s_nPhases;
+}
+
+
+//--------------------------------------------------------------------------------------
+void DXUTMemTrackGetPhase( unsigned int iPhase, DXUTMemPhase* pPhase )
+{
+    std::lock_guard<std::mutex> lock( DXUTMemTrackTimelineLock() );
+    if( iPhase < s_nPhases )
+        *pPhase = s_Phases[iPhase];
+    else
+        memset( pPhase, 0, sizeof( DXUTMemPhase ) );
+}
+
+
+//--------------------------------------------------------------------------------------
+void DXUTMemTrackGetProcessMemory( unsigned long long* pnBytes, unsigned long long* pnPeakBytes )
+{
+    *pnBytes = *pnPeakBytes = 0;
+#ifdef _WIN32
+    PROCESS_MEMORY_COUNTERS Counters;
+    if( GetProcessMemoryInfo( GetCurrentProcess(), &Counters, sizeof( Counters ) ) )
+    {
+        *pnBytes = Counters.WorkingSetSize;
+        *pnPeakBytes = Counters.PeakWorkingSetSize;
+    }
+#else
+    // VmRSS and VmHWM are in kB
+    FILE* pFile = fopen( "/proc/self/status", "r" );
+    if( pFile )
+    {
+        char szLine[256];
+        unsigned long long nKB;
+        while( fgets( szLine, sizeof( szLine ), pFile ) )
+        {
+            if( 1 == sscanf( szLine, "VmRSS: %llu", &nKB ) )
+                *pnBytes = nKB * 1024;
+            else if( 1 == sscanf( szLine, "VmHWM: %llu", &nKB ) )
+                *pnPeakBytes = nKB * 1024;
+        }
+        fclose( pFile );
+    }
+#endif
+}
+
+
+//--------------------------------------------------------------------------------------
+// Report text is built line by line; each line fits easily in the scratch buffer
+//--------------------------------------------------------------------------------------
+static void DXUTMemTrackAppend( std::vector<char>& Text, const char* pszLine )
+{
+    Text.insert( Text.end(), pszLine, pszLine + strlen( pszLine ) );
+}
+
+
+//--------------------------------------------------------------------------------------
+size_t DXUTMemTrackFormatReport( const char* pszTitle, char* pszBuffer, size_t cchBuffer )
+{
+    const double fMB = 1.0 / ( 1024.0 * 1024.0 );
+    std::vector<char> Text;
+    char szLine[512];
+
+    DXUT_MEMTRACK_FORMAT( szLine, "%s memory\n", pszTitle ? pszTitle : "DXUTMemTrack" );
+    DXUTMemTrackAppend( Text, szLine );
+    DXUT_MEMTRACK_FORMAT( szLine, "  %-14s %12s %12s %10s %10s %10s\n", "tag", "allocs", "frees", "live MB", "peak MB",
+             "total MB" );
+    DXUTMemTrackAppend( Text, szLine );
+    for( unsigned int i = 0; i < DXUT_MEM_TAG_COUNT; i++ )
+    {
+        DXUTMemTagStats Stats;
+        DXUTMemTrackGetTagStats( ( DXUT_MEM_TAG )i, &Stats );
+        DXUT_MEMTRACK_FORMAT( szLine, "  %-14s %12llu %12llu %10.2f %10.2f %10.2f\n", s_pszTagNames[i], Stats.nAllocs, Stats.nFrees,
+                 Stats.nBytes * fMB, Stats.nPeakBytes * fMB, Stats.nTotalBytes * fMB );
+        DXUTMemTrackAppend( Text, szLine );
+    }
+
+    unsigned int nPhases = DXUTMemTrackGetPhaseCount();
+    if( nPhases )
+    {
+        DXUT_MEMTRACK_FORMAT( szLine, "  %-24s %9s %10s %10s", "phase (peak MB)", "end ms", "tracked", "process" );
+        DXUTMemTrackAppend( Text, szLine );
+        for( unsigned int i = 0; i < DXUT_MEM_TAG_COUNT; i++ )
+        {
+            DXUT_MEMTRACK_FORMAT( szLine, " %13s", s_pszTagNames[i] );
+            DXUTMemTrackAppend( Text, szLine );
+        }
+        DXUTMemTrackAppend( Text, "\n" );
+
+        for( unsigned int iPhase = 0; iPhase < nPhases; iPhase++ )
+        {
+            DXUTMemPhase Phase;
+            DXUTMemTrackGetPhase( iPhase, &Phase );
+            DXUT_MEMTRACK_FORMAT( szLine, "  %-24.24s %9.1f %10.2f %10.2f", Phase.pszName, Phase.tEndNs * 1e-6,
+                     Phase.nPeakBytes * fMB, Phase.nProcessPeakBytes * fMB );
+            DXUTMemTrackAppend( Text, szLine );
+            for( unsigned int i = 0; i < DXUT_MEM_TAG_COUNT; i++ )
+            {
+                DXUT_MEMTRACK_FORMAT( szLine, " %13.2f", Phase.nTagPeakBytes[i] * fMB );
+                DXUTMemTrackAppend( Text, szLine );
+            }
+            DXUTMemTrackAppend( Text, "\n" );
+        }
+    }
+
+    if( cchBuffer )
+    {
+        size_t cchCopy = Text.size() < cchBuffer - 1 ? Text.size() : cchBuffer - 1;
+        if( cchCopy )
+            memcpy( pszBuffer, &Text[0], cchCopy );
+        pszBuffer[cchCopy] = 0;
+    }
+    return Text.size();
+}
+
+
+//--------------------------------------------------------------------------------------
+void DXUTMemTrackPrintReport( const char* pszTitle )
+{
+    std::vector<char> Report( DXUTMemTrackFormatReport( pszTitle, NULL, 0 ) + 1 );
+    DXUTMemTrackFormatReport( pszTitle, &Report[0], Report.size() );
+#ifdef _WIN32
+    OutputDebugStringA( &Report[0] );
+#else
+    fputs( &Report[0], stderr );
+#endif
+}
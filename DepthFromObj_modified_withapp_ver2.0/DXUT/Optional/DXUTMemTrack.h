@@ -0,0 +1,187 @@
+//--------------------------------------------------------------------------------------
+// File: DXUTMemTrack.h
+//
+// Opt-in allocation accounting for the mesh load path.  Allocation sites report what
+// they allocate and free under a tag naming the subsystem:
+//
+//      CacheEntry* pEntry = new CacheEntry;
+//      DXUT_MEM_ALLOC( DXUT_MEM_VERTEX_CACHE, sizeof( CacheEntry ) );
+//      ...
+//      DXUT_MEM_FREE( DXUT_MEM_VERTEX_CACHE, sizeof( CacheEntry ) );
+//      delete pEntry;
+//
+// Each tag keeps allocation and free counts, live bytes and the high-water mark.  A
+// load brackets its stages with DXUT_MEM_BEGIN_TIMELINE() and DXUT_MEM_PHASE( "name" );
+// every phase records the peak of each tag while it ran and the process working set,
+// and DXUT_MEM_REPORT() prints the lot.
+//
+// Like DXUT_PROFILE_ZONE the macros only generate code when PROFILE (or
+// DXUT_ENABLE_MEMTRACK) is defined, and even then nothing is counted until
+// DXUTMemTrackEnable( true ).  Enable it before the first load so that every free has
+// a matching allocation.
+//--------------------------------------------------------------------------------------
+#pragma once
+#ifndef DXUT_MEMTRACK_H
+#define DXUT_MEMTRACK_H
+
+#include <stddef.h>
+#include <atomic>
+#include <memory>
+#include <new>
+#include <utility>
+
+enum DXUT_MEM_TAG
+{
+    DXUT_MEM_PARSER,            // Parsed and welded geometry before it goes into the mesh
+    DXUT_MEM_VERTEX_CACHE,      // Vertex welding hash table
+    DXUT_MEM_MESH,              // The finished ID3DX10Mesh and its attribute table
+    DXUT_MEM_MATERIALS,
+    DXUT_MEM_TEXTURES,          // Estimated from the texture descriptions
+    DXUT_MEM_TAG_COUNT
+};
+
+#define DXUT_MEMTRACK_MAX_PHASES    32
+
+struct DXUTMemTagStats
+{
+    unsigned long long nAllocs;
+    unsigned long long nFrees;
+    unsigned long long nTotalBytes;     // Everything ever allocated
+    long long nBytes;                   // Live now
+    long long nPeakBytes;               // Since the program started
+};
+
+struct DXUTMemPhase
+{
+    const char* pszName;
+    unsigned long long tEndNs;          // Since DXUTMemTrackBeginTimeline
+    long long nPeakBytes;               // All tags together, while the phase ran
+    long long nBytes;                   // All tags together, at the end of the phase
+    long long nTagPeakBytes[DXUT_MEM_TAG_COUNT];
+    unsigned long long nProcessBytes;   // Working set at the end of the phase
+    unsigned long long nProcessPeakBytes;
+};
+
+// Global on/off switch; use DXUTMemTrackEnable() rather than touching this directly
+extern std::atomic<bool> g_bDXUTMemTrackEnabled;
+
+//--------------------------------------------------------------------------------------
+// Tracking control
+//--------------------------------------------------------------------------------------
+void                DXUTMemTrackEnable( bool bEnable );
+inline bool         DXUTMemTrackIsEnabled()
+{
+    return g_bDXUTMemTrackEnabled.load( std::memory_order_relaxed );
+}
+
+// Enables tracking if DXUT_MEMTRACK is set to anything but 0 in the environment
+void                DXUTMemTrackInitFromEnvironment();
+
+void                DXUTMemTrackAlloc( DXUT_MEM_TAG Tag, size_t nBytes );
+void                DXUTMemTrackFree( DXUT_MEM_TAG Tag, size_t nBytes );
+
+// Starts a new timeline: clears the recorded phases and starts the first one
+void                DXUTMemTrackBeginTimeline();
+
+// Ends the current phase, names it and starts the next.  pszName must outlive the
+// timeline (string literals are the intended use).
+void                DXUTMemTrackMarkPhase( const char* pszName );
+
+void                DXUTMemTrackGetTagStats( DXUT_MEM_TAG Tag, DXUTMemTagStats* pStats );
+const char*         DXUTMemTrackGetTagName( DXUT_MEM_TAG Tag );
+unsigned int        DXUTMemTrackGetPhaseCount();
+void                DXUTMemTrackGetPhase( unsigned int iPhase, DXUTMemPhase* pPhase );
+
+// Working set of the process as the OS sees it, including everything not tracked here
+void                DXUTMemTrackGetProcessMemory( unsigned long long* pnBytes, unsigned long long* pnPeakBytes );
+
+// Writes the per-tag totals and the timeline as text.  Returns the length of the full
+// report; the output is truncated to cchBuffer - 1 characters.
+size_t              DXUTMemTrackFormatReport( const char* pszTitle, char* pszBuffer, size_t cchBuffer );
+
+// Formats the report and sends it to the debugger output (stderr off Windows)
+void                DXUTMemTrackPrintReport( const char* pszTitle );
+
+
+#if defined(PROFILE) || defined(DXUT_ENABLE_MEMTRACK)
+#define DXUT_MEMTRACK_ENABLED
+#define DXUT_MEM_ALLOC( Tag, nBytes )   ( DXUTMemTrackIsEnabled() ? DXUTMemTrackAlloc( Tag, nBytes ) : (void)0 )
+#define DXUT_MEM_FREE( Tag, nBytes )    ( DXUTMemTrackIsEnabled() ? DXUTMemTrackFree( Tag, nBytes ) : (void)0 )
+#define DXUT_MEM_BEGIN_TIMELINE()       ( DXUTMemTrackIsEnabled() ? DXUTMemTrackBeginTimeline() : (void)0 )
+#define DXUT_MEM_PHASE( pszName )       ( DXUTMemTrackIsEnabled() ? DXUTMemTrackMarkPhase( pszName ) : (void)0 )
+#define DXUT_MEM_REPORT( pszTitle )     ( DXUTMemTrackIsEnabled() ? DXUTMemTrackPrintReport( pszTitle ) : (void)0 )
+#else
+#define DXUT_MEM_ALLOC( Tag, nBytes )   ((void)0)
+#define DXUT_MEM_FREE( Tag, nBytes )    ((void)0)
+#define DXUT_MEM_BEGIN_TIMELINE()       ((void)0)
+#define DXUT_MEM_PHASE( pszName )       ((void)0)
+#define DXUT_MEM_REPORT( pszTitle )     ((void)0)
+#endif
+
+//--------------------------------------------------------------------------------------
+// Standard allocator that reports to DXUTMemTrack under Tag, for the containers in the
+// modules that can't use CGrowableArray:
+//
+//      std::vector<float, CDXUTMemTrackAllocator<float, DXUT_MEM_PARSER> > Positions;
+//--------------------------------------------------------------------------------------
+template<typename TYPE, DXUT_MEM_TAG Tag> class CDXUTMemTrackAllocator
+{
+public:
+    typedef TYPE value_type;
+    typedef TYPE* pointer;
+    typedef const TYPE* const_pointer;
+    typedef TYPE& reference;
+    typedef const TYPE& const_reference;
+    typedef size_t size_type;
+    typedef ptrdiff_t difference_type;
+
+    template<typename OTHER> struct rebind
+    {
+        typedef CDXUTMemTrackAllocator<OTHER, Tag> other;
+    };
+
+    CDXUTMemTrackAllocator()
+    {
+    }
+    template<typename OTHER> CDXUTMemTrackAllocator( const CDXUTMemTrackAllocator<OTHER, Tag>& )
+    {
+    }
+
+    TYPE*   allocate( size_t n )
+    {
+        TYPE* p = std::allocator<TYPE>().allocate( n );
+        DXUT_MEM_ALLOC( Tag, n * sizeof( TYPE ) );
+        return p;
+    }
+    void    deallocate( TYPE* p, size_t n )
+    {
+        DXUT_MEM_FREE( Tag, n * sizeof( TYPE ) );
+        std::allocator<TYPE>().deallocate( p, n );
+    }
+    size_t  max_size() const
+    {
+        return std::allocator<TYPE>().max_size();
+    }
+
+    template<typename OTHER, typename... ARGS> void construct( OTHER* p, ARGS&&... Args )
+    {
+        ::new( ( void* )p ) OTHER( std::forward<ARGS>( Args )... );
+    }
+    template<typename OTHER> void destroy( OTHER* p )
+    {
+        p->~OTHER();
+    }
+};
+
+template<typename TYPE, typename OTHER, DXUT_MEM_TAG Tag>
+inline bool operator==( const CDXUTMemTrackAllocator<TYPE, Tag>&, const CDXUTMemTrackAllocator<OTHER, Tag>& )
+{
+    return true;
+}
+template<typename TYPE, typename OTHER, DXUT_MEM_TAG Tag>
+inline bool operator!=( const CDXUTMemTrackAllocator<TYPE, Tag>&, const CDXUTMemTrackAllocator<OTHER, Tag>& )
+{
+    return false;
+}
+
+#endif
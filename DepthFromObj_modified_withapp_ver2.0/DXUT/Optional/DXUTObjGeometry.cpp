@@ -0,0 +1,643 @@
+//--------------------------------------------------------------------------------------
+// File: DXUTObjGeometry.cpp
+//
+// .obj and .mtl parsing and vertex welding for CDXUTObjGeometry.  See DXUTObjGeometry.h.
+//--------------------------------------------------------------------------------------
+#include "DXUTObjGeometry.h"
+#include "DXUTMappedFile.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <new>
+
+// Faces are parsed where they are in the file.  Other lines are copied out so they can
+// be NUL terminated for strtof, to a buffer in the thread's arena that starts at this
+// size and grows.
+#define DXUT_OBJ_MAX_LINE   4096
+
+
+//--------------------------------------------------------------------------------------
+// Helpers
+//--------------------------------------------------------------------------------------
+template<typename VECTOR> static void FreeVector( VECTOR& Vector )
+{
+    VECTOR().swap( Vector );
+}
+
+static bool OpenMappedFile( CDXUTMappedFile& File, const char* szFileName )
+{
+#ifdef _WIN32
+    // CreateFileA would take the path in the ANSI code page
+    wchar_t wstrFileName[DXUT_FILE_MAX_PATH];
+    if( !DXUTFileNameToWide( szFileName, wstrFileName ) )
+        return false;
+    return File.Open( wstrFileName, DXUT_MAPPED_FILE_SEQUENTIAL );
+#else
+    return File.Open( szFileName, DXUT_MAPPED_FILE_SEQUENTIAL );
+#endif
+}
+
+// Sets *ppLineEnd to the end of the line starting at pCur, before its line break, and
+// returns where the line after it starts
+static const char* FindLineEnd( const char* pCur, const char* pEnd, const char** ppLineEnd )
+{
+    const char* pBreak = ( const char* )memchr( pCur, '\n', pEnd - pCur );
+    const char* pLineEnd = pBreak ? pBreak : pEnd;
+    if( pLineEnd > pCur && pLineEnd[-1] == '\r' )
+        pLineEnd--;
+
+    *ppLineEnd = pLineEnd;
+    return pBreak ? pBreak + 1 : pEnd;
+}
+
+// Copy of the line being parsed.  Growing it leaves the old buffer to the arena, which
+// the parse rewinds when it is done.
+struct LineBuffer
+{
+    char* pData;
+    size_t cbSize;
+};
+
+// Copies [pBegin, pEnd) into pLine, NUL terminated, and returns the copy
+static const char* CopyLine( const char* pBegin, const char* pEnd, LineBuffer* pLine )
+{
+    size_t cch = pEnd - pBegin;
+    if( pLine->cbSize < cch + 1 )
+    {
+        size_t cbSize = pLine->cbSize * 2 > cch + 1 ? pLine->cbSize * 2 : cch + 1;
+        if( cbSize < DXUT_OBJ_MAX_LINE )
+            cbSize = DXUT_OBJ_MAX_LINE;
+        pLine->pData = ( char* )DXUTGetThreadArena()->Alloc( cbSize, 1 );
+        if( pLine->pData == NULL )
+            throw std::bad_alloc();
+        pLine->cbSize = cbSize;
+    }
+    memcpy( pLine->pData, pBegin, cch );
+    pLine->pData[cch] = '\0';
+    return pLine->pData;
+}
+
+static const char* SkipSpace( const char* p )
+{
+    while( *p == ' ' || *p == '\t' )
+        p++;
+    return p;
+}
+
+static const char* SkipSpace( const char* p, const char* pEnd )
+{
+    while( p < pEnd && ( *p == ' ' || *p == '\t' ) )
+        p++;
+    return p;
+}
+
+// Matches the keyword at the start of the line and returns what follows it, or NULL
+static const char* MatchCommand( const char* strLine, const char* strCommand )
+{
+    size_t cch = strlen( strCommand );
+    if( strncmp( strLine, strCommand, cch ) != 0 )
+        return NULL;
+    if( strLine[cch] != ' ' && strLine[cch] != '\t' && strLine[cch] != '\0' )
+        return NULL;
+    return SkipSpace( strLine + cch );
+}
+
+// The same for a line in the file, which isn't NUL terminated
+static const char* MatchCommand( const char* pLine, const char* pLineEnd, const char* strCommand )
+{
+    size_t cch = strlen( strCommand );
+    if( ( size_t )( pLineEnd - pLine ) < cch || memcmp( pLine, strCommand, cch ) != 0 )
+        return NULL;
+    if( pLine + cch < pLineEnd && pLine[cch] != ' ' && pLine[cch] != '\t' )
+        return NULL;
+    return SkipSpace( pLine + cch, pLineEnd );
+}
+
+// A face index, like strtol but stopping at pEnd.  Returns false if there are no
+// digits; values too big for an index are clamped so they fail to resolve.
+static bool ReadIndex( const char** pp, const char* pEnd, long* pnIndex )
+{
+    const char* p = *pp;
+    bool bNegative = p < pEnd && *p == '-';
+    if( bNegative || ( p < pEnd && *p == '+' ) )
+        p++;
+    if( p == pEnd || *p < '0' || *p > '9' )
+        return false;
+
+    long n = 0;
+    for( ; p < pEnd && *p >= '0' && *p <= '9'; p++ )
+        n = n < 100000000L ? n * 10 + ( *p - '0' ) : 1000000000L;
+
+    *pnIndex = bNegative ? -n : n;
+    *pp = p;
+    return true;
+}
+
+// Up to nCount floats; missing ones are left as they are
+static void ReadFloats( const char* p, float* pValues, int nCount )
+{
+    for( int i = 0; i < nCount; i++ )
+    {
+        char* pNext;
+        float f = strtof( p, &pNext );
+        if( pNext == p )
+            break;
+        pValues[i] = f;
+        p = pNext;
+    }
+}
+
+// The rest of the line with surrounding spaces removed, so names may contain spaces
+static void ReadName( const char* p, char* strName, size_t cchName )
+{
+    p = SkipSpace( p );
+    size_t cch = strlen( p );
+    while( cch && ( p[cch - 1] == ' ' || p[cch - 1] == '\t' ) )
+        cch--;
+    if( cch > cchName - 1 )
+        cch = cchName - 1;
+    memcpy( strName, p, cch );
+    strName[cch] = '\0';
+}
+
+// Turns a 1-based or negative .obj index into a 0-based one
+static bool ResolveIndex( long nIndex, size_t nCount, unsigned int* piIndex )
+{
+    if( nIndex > 0 && ( size_t )nIndex <= nCount )
+        *piIndex = ( unsigned int )( nIndex - 1 );
+    else if( nIndex < 0 && ( size_t )-nIndex <= nCount )
+        *piIndex = ( unsigned int )( nCount + nIndex );
+    else
+        return false;
+    return true;
+}
+
+static void InitMaterial( DXUTOBJ_MATERIAL* pMaterial, const char* strName )
+{
+    memset( pMaterial, 0, sizeof( DXUTOBJ_MATERIAL ) );
+    ReadName( strName, pMaterial->strName, DXUT_OBJ_MAX_PATH );
+
+    for( int i = 0; i < 3; i++ )
+    {
+        pMaterial->vAmbient[i] = 0.2f;
+        pMaterial->vDiffuse[i] = 0.8f;
+        pMaterial->vSpecular[i] = 1.0f;
+    }
+    pMaterial->nShininess = 0;
+    pMaterial->fAlpha = 1.0f;
+    pMaterial->bSpecular = false;
+}
+
+
+//--------------------------------------------------------------------------------------
+CDXUTObjGeometry::CDXUTObjGeometry() : m_CacheArena( DXUT_MEM_VERTEX_CACHE ),
+                                       m_FileBytes( 0 ),
+                                       m_NumFaceVertices( 0 )
+{
+    m_strDirectory[0] = '\0';
+    m_strMaterialLibrary[0] = '\0';
+}
+
+
+//--------------------------------------------------------------------------------------
+CDXUTObjGeometry::~CDXUTObjGeometry()
+{
+    Release();
+}
+
+
+//--------------------------------------------------------------------------------------
+void CDXUTObjGeometry::Release()
+{
+    ReleaseWeldCache();
+    FreeVector( m_Vertices );
+    FreeVector( m_Indices );
+    FreeVector( m_Attributes );
+    FreeVector( m_Materials );
+
+    m_strDirectory[0] = '\0';
+    m_strMaterialLibrary[0] = '\0';
+    m_FileBytes = 0;
+    m_NumFaceVertices = 0;
+}
+
+
+//--------------------------------------------------------------------------------------
+void CDXUTObjGeometry::ReleaseWeldCache()
+{
+    // Every entry came from the arena, so there is nothing to walk
+    FreeVector( m_VertexCache );
+    m_CacheArena.Release();
+}
+
+
+//--------------------------------------------------------------------------------------
+bool CDXUTObjGeometry::Load( const char* szFileName )
+{
+    Release();
+
+    CDXUTMappedFile File;
+    if( !OpenMappedFile( File, szFileName ) )
+        return false;
+
+    // Keep the directory so the material library can be found next to the .obj
+    const char* pSlash = strrchr( szFileName, '/' );
+    const char* pBackslash = strrchr( szFileName, '\\' );
+    if( pBackslash > pSlash )
+        pSlash = pBackslash;
+    if( pSlash )
+    {
+        size_t cch = pSlash + 1 - szFileName;
+        if( cch < DXUT_OBJ_MAX_PATH )
+        {
+            memcpy( m_strDirectory, szFileName, cch );
+            m_strDirectory[cch] = '\0';
+        }
+    }
+
+    if( !ParseOBJ( ( const char* )File.GetData(), File.GetSize() ) )
+        return false;
+
+    m_FileBytes = File.GetSize();
+    return true;
+}
+
+
+//--------------------------------------------------------------------------------------
+bool CDXUTObjGeometry::LoadFromMemory( const char* pData, size_t cbSize )
+{
+    Release();
+    return ParseOBJ( pData, cbSize );
+}
+
+
+//--------------------------------------------------------------------------------------
+bool CDXUTObjGeometry::LoadMaterials( const char* szFileName )
+{
+    CDXUTMappedFile File;
+    if( !OpenMappedFile( File, szFileName ) )
+        return false;
+    return ParseMTL( ( const char* )File.GetData(), File.GetSize() );
+}
+
+
+//--------------------------------------------------------------------------------------
+bool CDXUTObjGeometry::LoadMaterialsFromMemory( const char* pData, size_t cbSize )
+{
+    return ParseMTL( pData, cbSize );
+}
+
+
+//--------------------------------------------------------------------------------------
+bool CDXUTObjGeometry::GetMaterialLibraryPath( char* szPath, size_t cchPath ) const
+{
+    if( m_strMaterialLibrary[0] == '\0' )
+        return false;
+
+    // Absolute paths are used as they are
+    const char* strLib = m_strMaterialLibrary;
+    bool bAbsolute = strLib[0] == '/' || strLib[0] == '\\' || ( strLib[0] && strLib[1] == ':' );
+    const char* strDir = bAbsolute ? "" : m_strDirectory;
+
+    size_t cchDir = strlen( strDir );
+    size_t cchLib = strlen( strLib );
+    if( cchDir + cchLib + 1 > cchPath )
+        return false;
+
+    memcpy( szPath, strDir, cchDir );
+    memcpy( szPath + cchDir, strLib, cchLib + 1 );
+    return true;
+}
+
+
+//--------------------------------------------------------------------------------------
+unsigned int CDXUTObjGeometry::WeldVertex( unsigned int iKey, const DXUTOBJ_VERTEX* pVertex )
+{
+    // Since it's very slow to check every element in the vertex list, a hashtable stores
+    // vertex indices by key; only the chain of the same key is compared
+    if( iKey < m_VertexCache.size() )
+    {
+        for( CacheEntry* pEntry = m_VertexCache[iKey]; pEntry != NULL; pEntry = pEntry->pNext )
+        {
+            if( 0 == memcmp( pVertex, &m_Vertices[pEntry->index], sizeof( DXUTOBJ_VERTEX ) ) )
+                return pEntry->index;
+        }
+    }
+
+    // Not found: add it to the vertices and to the head of the chain
+    CacheEntry* pNewEntry = m_CacheArena.New<CacheEntry>();
+    if( pNewEntry == NULL || m_Vertices.size() >= DXUT_OBJ_INVALID_INDEX )
+        return DXUT_OBJ_INVALID_INDEX;
+
+    try
+    {
+        if( iKey >= m_VertexCache.size() )
+            m_VertexCache.resize( ( size_t )iKey + 1, NULL );
+        m_Vertices.push_back( *pVertex );
+    }
+    catch( std::bad_alloc& )
+    {
+        return DXUT_OBJ_INVALID_INDEX;
+    }
+
+    pNewEntry->index = ( unsigned int )( m_Vertices.size() - 1 );
+    pNewEntry->pNext = m_VertexCache[iKey];
+    m_VertexCache[iKey] = pNewEntry;
+    return pNewEntry->index;
+}
+
+
+//--------------------------------------------------------------------------------------
+bool CDXUTObjGeometry::SetSize( unsigned int NumVertices, unsigned int NumIndices )
+{
+    Release();
+    try
+    {
+        m_Vertices.resize( NumVertices );
+        m_Indices.resize( NumIndices );
+        m_Attributes.resize( NumIndices / 3 );
+        AddMaterial( "default" );
+    }
+    catch( std::bad_alloc& )
+    {
+        Release();
+        return false;
+    }
+    return true;
+}
+
+
+//--------------------------------------------------------------------------------------
+unsigned int CDXUTObjGeometry::FindMaterial( const char* strName ) const
+{
+    for( size_t i = 0; i < m_Materials.size(); i++ )
+    {
+        if( 0 == strcmp( m_Materials[i].strName, strName ) )
+            return ( unsigned int )i;
+    }
+    return DXUT_OBJ_INVALID_INDEX;
+}
+
+
+//--------------------------------------------------------------------------------------
+unsigned int CDXUTObjGeometry::AddMaterial( const char* strName )
+{
+    DXUTOBJ_MATERIAL Material;
+    InitMaterial( &Material, strName );
+    m_Materials.push_back( Material );
+    return ( unsigned int )( m_Materials.size() - 1 );
+}
+
+
+//--------------------------------------------------------------------------------------
+// Releases everything on failure.  Containers report running out of memory by throwing,
+// which is turned into a failed load here.
+//--------------------------------------------------------------------------------------
+bool CDXUTObjGeometry::ParseOBJ( const char* pData, size_t cbSize )
+{
+    std::vector<float, CDXUTMemTrackAllocator<float, DXUT_MEM_PARSER> > Positions;
+    std::vector<float, CDXUTMemTrackAllocator<float, DXUT_MEM_PARSER> > TexCoords;
+    std::vector<float, CDXUTMemTrackAllocator<float, DXUT_MEM_PARSER> > Normals;
+    bool bSucceeded = true;
+
+    try
+    {
+        CDXUTArenaScope Scope( DXUTGetThreadArena() );
+        LineBuffer Line = { NULL, 0 };
+
+        // The first subset uses the default material
+        AddMaterial( "default" );
+        unsigned int iCurSubset = 0;
+
+        const char* pEnd = pData + cbSize;
+        for( const char* pCur = pData; bSucceeded && pCur < pEnd; )
+        {
+            const char* pLineEnd;
+            const char* pLine = pCur;
+            pCur = FindLineEnd( pCur, pEnd, &pLineEnd );
+            pLine = SkipSpace( pLine, pLineEnd );
+            const char* pArgs;
+
+            if( pLine == pLineEnd || *pLine == '#' )
+            {
+                // Comment or blank line
+            }
+            else if( NULL != ( pArgs = MatchCommand( pLine, pLineEnd, "v" ) ) )
+            {
+                // Vertex Position
+                float v[3] = { 0.0f, 0.0f, 0.0f };
+                ReadFloats( CopyLine( pArgs, pLineEnd, &Line ), v, 3 );
+                Positions.insert( Positions.end(), v, v + 3 );
+            }
+            else if( NULL != ( pArgs = MatchCommand( pLine, pLineEnd, "vt" ) ) )
+            {
+                // Vertex TexCoord
+                float v[2] = { 0.0f, 0.0f };
+                ReadFloats( CopyLine( pArgs, pLineEnd, &Line ), v, 2 );
+                TexCoords.insert( TexCoords.end(), v, v + 2 );
+            }
+            else if( NULL != ( pArgs = MatchCommand( pLine, pLineEnd, "vn" ) ) )
+            {
+                // Vertex Normal
+                float v[3] = { 0.0f, 0.0f, 0.0f };
+                ReadFloats( CopyLine( pArgs, pLineEnd, &Line ), v, 3 );
+                Normals.insert( Normals.end(), v, v + 3 );
+            }
+            else if( NULL != ( pArgs = MatchCommand( pLine, pLineEnd, "f" ) ) )
+            {
+                // Face, as a fan around its first corner, read in place so its length
+                // isn't limited.  A comment may follow the last corner.
+                unsigned int iFirst = 0, iPrevious = 0;
+                unsigned int nCorners = 0;
+
+                for( const char* p = pArgs; p < pLineEnd && *p != '#'; p = SkipSpace( p, pLineEnd ) )
+                {
+                    DXUTOBJ_VERTEX Vertex;
+                    memset( &Vertex, 0, sizeof( Vertex ) );
+
+                    long nIndex;
+                    unsigned int iPosition, iTexCoord, iNormal;
+                    if( !ReadIndex( &p, pLineEnd, &nIndex ) ||
+                        !ResolveIndex( nIndex, Positions.size() / 3, &iPosition ) )
+                    {
+                        bSucceeded = false;
+                        break;
+                    }
+                    memcpy( Vertex.Position, &Positions[iPosition * 3], sizeof( Vertex.Position ) );
+
+                    if( p < pLineEnd && *p == '/' )
+                    {
+                        p++;
+                        if( p == pLineEnd || *p != '/' )
+                        {
+                            // Optional texture coordinate
+                            if( !ReadIndex( &p, pLineEnd, &nIndex ) ||
+                                !ResolveIndex( nIndex, TexCoords.size() / 2, &iTexCoord ) )
+                            {
+                                bSucceeded = false;
+                                break;
+                            }
+                            memcpy( Vertex.TexCoord, &TexCoords[iTexCoord * 2], sizeof( Vertex.TexCoord ) );
+                        }
+
+                        if( p < pLineEnd && *p == '/' )
+                        {
+                            // Optional vertex normal
+                            p++;
+                            if( !ReadIndex( &p, pLineEnd, &nIndex ) ||
+                                !ResolveIndex( nIndex, Normals.size() / 3, &iNormal ) )
+                            {
+                                bSucceeded = false;
+                                break;
+                            }
+                            memcpy( Vertex.Normal, &Normals[iNormal * 3], sizeof( Vertex.Normal ) );
+                        }
+                    }
+
+                    // Anything else glued to the corner is malformed
+                    if( p < pLineEnd && *p != ' ' && *p != '\t' && *p != '#' )
+                    {
+                        bSucceeded = false;
+                        break;
+                    }
+
+                    unsigned int index = WeldVertex( iPosition, &Vertex );
+                    if( index == DXUT_OBJ_INVALID_INDEX )
+                    {
+                        bSucceeded = false;
+                        break;
+                    }
+                    m_NumFaceVertices++;
+
+                    if( nCorners == 0 )
+                        iFirst = index;
+                    if( nCorners >= 2 )
+                    {
+                        m_Indices.push_back( iFirst );
+                        m_Indices.push_back( iPrevious );
+                        m_Indices.push_back( index );
+                        m_Attributes.push_back( iCurSubset );
+                    }
+                    iPrevious = index;
+                    nCorners++;
+                }
+            }
+            else if( NULL != ( pArgs = MatchCommand( pLine, pLineEnd, "mtllib" ) ) )
+            {
+                // Material library
+                ReadName( CopyLine( pArgs, pLineEnd, &Line ), m_strMaterialLibrary, DXUT_OBJ_MAX_PATH );
+            }
+            else if( NULL != ( pArgs = MatchCommand( pLine, pLineEnd, "usemtl" ) ) )
+            {
+                // Material
+                char strName[DXUT_OBJ_MAX_PATH];
+                ReadName( CopyLine( pArgs, pLineEnd, &Line ), strName, DXUT_OBJ_MAX_PATH );
+
+                iCurSubset = FindMaterial( strName );
+                if( iCurSubset == DXUT_OBJ_INVALID_INDEX )
+                    iCurSubset = AddMaterial( strName );
+            }
+            else
+            {
+                // Unimplemented or unrecognized command
+            }
+        }
+    }
+    catch( std::bad_alloc& )
+    {
+        bSucceeded = false;
+    }
+
+    ReleaseWeldCache();
+    if( !bSucceeded )
+        Release();
+    return bSucceeded;
+}
+
+
+//--------------------------------------------------------------------------------------
+bool CDXUTObjGeometry::ParseMTL( const char* pData, size_t cbSize )
+{
+    // Lines are copied to a buffer that grows for long ones
+    try
+    {
+        CDXUTArenaScope Scope( DXUTGetThreadArena() );
+        LineBuffer Line = { NULL, 0 };
+        DXUTOBJ_MATERIAL* pMaterial = NULL;
+
+        const char* pEnd = pData + cbSize;
+        for( const char* pCur = pData; pCur < pEnd; )
+        {
+            const char* pLineEnd;
+            const char* pLine = pCur;
+            pCur = FindLineEnd( pCur, pEnd, &pLineEnd );
+            pLine = SkipSpace( CopyLine( pLine, pLineEnd, &Line ) );
+            const char* pArgs;
+
+            if( NULL != ( pArgs = MatchCommand( pLine, "newmtl" ) ) )
+            {
+                // Switching active materials
+                char strName[DXUT_OBJ_MAX_PATH];
+                ReadName( pArgs, strName, DXUT_OBJ_MAX_PATH );
+
+                unsigned int iMaterial = FindMaterial( strName );
+                pMaterial = iMaterial == DXUT_OBJ_INVALID_INDEX ? NULL : &m_Materials[iMaterial];
+            }
+
+            // The rest of the commands rely on an active material
+            if( pMaterial == NULL )
+                continue;
+
+            if( *pLine == '#' )
+            {
+                // Comment
+            }
+            else if( NULL != ( pArgs = MatchCommand( pLine, "Ka" ) ) )
+            {
+                // Ambient color
+                ReadFloats( pArgs, pMaterial->vAmbient, 3 );
+            }
+            else if( NULL != ( pArgs = MatchCommand( pLine, "Kd" ) ) )
+            {
+                // Diffuse color
+                ReadFloats( pArgs, pMaterial->vDiffuse, 3 );
+            }
+            else if( NULL != ( pArgs = MatchCommand( pLine, "Ks" ) ) )
+            {
+                // Specular color
+                ReadFloats( pArgs, pMaterial->vSpecular, 3 );
+            }
+            else if( NULL != ( pArgs = MatchCommand( pLine, "d" ) ) ||
+                     NULL != ( pArgs = MatchCommand( pLine, "Tr" ) ) )
+            {
+                // Alpha
+                ReadFloats( pArgs, &pMaterial->fAlpha, 1 );
+            }
+            else if( NULL != ( pArgs = MatchCommand( pLine, "Ns" ) ) )
+            {
+                // Shininess
+                pMaterial->nShininess = ( int )strtol( pArgs, NULL, 10 );
+            }
+            else if( NULL != ( pArgs = MatchCommand( pLine, "illum" ) ) )
+            {
+                // Specular on/off
+                pMaterial->bSpecular = ( strtol( pArgs, NULL, 10 ) == 2 );
+            }
+            else if( NULL != ( pArgs = MatchCommand( pLine, "map_Kd" ) ) )
+            {
+                // Texture
+                ReadName( pArgs, pMaterial->strTexture, DXUT_OBJ_MAX_PATH );
+            }
+            else
+            {
+                // Unimplemented or unrecognized command
+            }
+        }
+    }
+    catch( std::bad_alloc& )
+    {
+        return false;
+    }
+
+    return true;
+}
@@ -0,0 +1,182 @@
+//--------------------------------------------------------------------------------------
+// File: DXUTObjGeometry.h
+//
+// Device independent .obj/.mtl reader shared by the Direct3D loader (CMeshLoader10) and
+// the OpenGL tools.  It parses positions, texture coordinates, normals, faces and
+// material references, welds identical face corners into one vertex and leaves plain
+// arrays behind for the caller to upload:
+//
+//      CDXUTObjGeometry Geometry;
+//      if( Geometry.Load( "media/bunny.obj" ) )
+//      {
+//          char strMtl[DXUT_OBJ_MAX_PATH];
+//          if( Geometry.GetMaterialLibraryPath( strMtl, DXUT_OBJ_MAX_PATH ) )
+//              Geometry.LoadMaterials( strMtl );
+//          Upload( Geometry.GetVertices(), Geometry.GetNumVertices(),
+//                  Geometry.GetIndices(), Geometry.GetNumIndices() );
+//      }
+//
+// Paths and names are UTF-8 on every platform.  Files are read through CDXUTMappedFile.
+// Faces with more than three corners are split into fans and negative (relative) indices
+// are resolved; an index outside the data read so far fails the load.  Lines may be any
+// length.  Triangle i uses material GetAttributes()[i]; material 0 is always "default".
+//
+// The arrays are reported to DXUTMemTrack as DXUT_MEM_PARSER, the weld cache as
+// DXUT_MEM_VERTEX_CACHE and the materials as DXUT_MEM_MATERIALS.
+//--------------------------------------------------------------------------------------
+#pragma once
+#ifndef DXUT_OBJGEOMETRY_H
+#define DXUT_OBJGEOMETRY_H
+
+#include <stddef.h>
+#include <vector>
+#include "DXUTMemTrack.h"
+#include "DXUTArena.h"
+
+#define DXUT_OBJ_MAX_PATH       260
+#define DXUT_OBJ_INVALID_INDEX  0xFFFFFFFF
+
+// Same layout as the VERTEX of CMeshLoader10 and DXUTSHAPE_VERTEX
+struct DXUTOBJ_VERTEX
+{
+    float Position[3];
+    float Normal[3];
+    float TexCoord[2];
+};
+
+struct DXUTOBJ_MATERIAL
+{
+    char    strName[DXUT_OBJ_MAX_PATH];
+
+    float   vAmbient[3];
+    float   vDiffuse[3];
+    float   vSpecular[3];
+
+    int     nShininess;
+    float   fAlpha;
+
+    bool    bSpecular;
+
+    char    strTexture[DXUT_OBJ_MAX_PATH];   // As written in the .mtl, usually relative to it
+};
+
+
+//--------------------------------------------------------------------------------------
+class CDXUTObjGeometry
+{
+public:
+            CDXUTObjGeometry();
+            ~CDXUTObjGeometry();
+
+    // Replaces any geometry already held.  The weld cache is released before returning.
+    bool    Load( const char* szFileName );
+    bool    LoadFromMemory( const char* pData, size_t cbSize );
+
+    // Fills in the materials named by usemtl; materials the .obj never used are skipped
+    bool    LoadMaterials( const char* szFileName );
+    bool    LoadMaterialsFromMemory( const char* pData, size_t cbSize );
+
+    // The mtllib of the last Load, relative to the directory of the .obj.  Returns false
+    // if there was none or it doesn't fit.
+    bool    GetMaterialLibraryPath( char* szPath, size_t cchPath ) const;
+    const char* GetMaterialLibrary() const
+    {
+        return m_strMaterialLibrary;
+    }
+
+    // Returns the index of a vertex equal to pVertex, appending it if there is none.
+    // Only vertices added with the same key are compared; the .obj reader uses the
+    // position index.  Returns DXUT_OBJ_INVALID_INDEX when out of memory.
+    unsigned int WeldVertex( unsigned int iKey, const DXUTOBJ_VERTEX* pVertex );
+    void    ReleaseWeldCache();
+
+    // Sizes the arrays for geometry built some other way, e.g. by DXUTGenerateShapeScene,
+    // with NumIndices / 3 attributes and only the default material
+    bool    SetSize( unsigned int NumVertices, unsigned int NumIndices );
+
+    // Frees the arrays and materials
+    void    Release();
+
+    DXUTOBJ_VERTEX* GetVertices()
+    {
+        return m_Vertices.empty() ? NULL : &m_Vertices[0];
+    }
+    const DXUTOBJ_VERTEX* GetVertices() const
+    {
+        return m_Vertices.empty() ? NULL : &m_Vertices[0];
+    }
+    unsigned int GetNumVertices() const
+    {
+        return ( unsigned int )m_Vertices.size();
+    }
+    unsigned int* GetIndices()
+    {
+        return m_Indices.empty() ? NULL : &m_Indices[0];
+    }
+    const unsigned int* GetIndices() const
+    {
+        return m_Indices.empty() ? NULL : &m_Indices[0];
+    }
+    unsigned int GetNumIndices() const
+    {
+        return ( unsigned int )m_Indices.size();
+    }
+    unsigned int* GetAttributes()
+    {
+        return m_Attributes.empty() ? NULL : &m_Attributes[0];
+    }
+    const unsigned int* GetAttributes() const
+    {
+        return m_Attributes.empty() ? NULL : &m_Attributes[0];
+    }
+    unsigned int GetNumMaterials() const
+    {
+        return ( unsigned int )m_Materials.size();
+    }
+    const DXUTOBJ_MATERIAL* GetMaterial( unsigned int iMaterial ) const
+    {
+        return &m_Materials[iMaterial];
+    }
+
+    // Size of the last file given to Load and the face corners it welded
+    unsigned long long GetFileBytes() const
+    {
+        return m_FileBytes;
+    }
+    unsigned int GetNumFaceVertices() const
+    {
+        return m_NumFaceVertices;
+    }
+
+private:
+    // Leave these private and undefined to prevent their use
+            CDXUTObjGeometry( const CDXUTObjGeometry& );
+    CDXUTObjGeometry& operator=( const CDXUTObjGeometry& );
+
+    // Vertices added with the same key, newest first
+    struct CacheEntry
+    {
+        unsigned int index;
+        CacheEntry* pNext;
+    };
+
+    bool    ParseOBJ( const char* pData, size_t cbSize );
+    bool    ParseMTL( const char* pData, size_t cbSize );
+    unsigned int FindMaterial( const char* strName ) const;
+    unsigned int AddMaterial( const char* strName );
+
+    std::vector<DXUTOBJ_VERTEX, CDXUTMemTrackAllocator<DXUTOBJ_VERTEX, DXUT_MEM_PARSER> > m_Vertices;
+    std::vector<unsigned int, CDXUTMemTrackAllocator<unsigned int, DXUT_MEM_PARSER> > m_Indices;
+    std::vector<unsigned int, CDXUTMemTrackAllocator<unsigned int, DXUT_MEM_PARSER> > m_Attributes;
+    std::vector<DXUTOBJ_MATERIAL, CDXUTMemTrackAllocator<DXUTOBJ_MATERIAL, DXUT_MEM_MATERIALS> > m_Materials;
+
+    std::vector<CacheEntry*, CDXUTMemTrackAllocator<CacheEntry*, DXUT_MEM_VERTEX_CACHE> > m_VertexCache;
+    CDXUTArena m_CacheArena;        // Owns the CacheEntry chains
+
+    char    m_strDirectory[DXUT_OBJ_MAX_PATH];      // Of the last Load, with a trailing separator
+    char    m_strMaterialLibrary[DXUT_OBJ_MAX_PATH];
+    unsigned long long m_FileBytes;
+    unsigned int m_NumFaceVertices;
+};
+
+#endif
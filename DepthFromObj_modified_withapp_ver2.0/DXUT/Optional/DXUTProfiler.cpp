@@ -0,0 +1,325 @@
+//--------------------------------------------------------------------------------------
+// File: DXUTProfiler.cpp
+//
+// Per-thread ring buffers and Chrome trace export for DXUT_PROFILE_ZONE.  See
+// DXUTProfiler.h for usage.
+//--------------------------------------------------------------------------------------
+#include "DXUTProfiler.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <mutex>
+#include <vector>
+
+#ifdef _WIN32
+#pragma pack(push)
+#pragma pack(8)
+#include <windows.h>
+#pragma pack(pop)
+#else
+#include <time.h>
+#endif
+
+//--------------------------------------------------------------------------------------
+// Per-thread ring buffer.  Only the owning thread writes zones (advancing m_nHead) and
+// only the exporter reads them (advancing m_nTail), so the ring needs no lock: the
+// release store of each index publishes the slots behind it to the other side.
+//--------------------------------------------------------------------------------------
+#define DXUT_PROFILER_RING_SIZE_LOG2    16
+#define DXUT_PROFILER_RING_SIZE         ( 1u << DXUT_PROFILER_RING_SIZE_LOG2 )
+#define DXUT_PROFILER_RING_MASK         ( DXUT_PROFILER_RING_SIZE - 1 )
+#define DXUT_PROFILER_MAX_THREAD_NAME   64
+
+struct DXUTProfileEvent
+{
+    const char* pszName;
+    DXUT_PROFILE_TIME tStart;
+    DXUT_PROFILE_TIME tEnd;
+    unsigned int nDepth;
+};
+
+struct DXUTProfileThread
+{
+    unsigned int nThreadId;
+    char szName[DXUT_PROFILER_MAX_THREAD_NAME];
+
+    // Head and tail live on separate cache lines so the recording thread and the
+    // exporter don't false-share
+    std::atomic<unsigned int> nHead;
+    char padHead[64 - sizeof( std::atomic<unsigned int> )];
+    std::atomic<unsigned int> nTail;
+    char padTail[64 - sizeof( std::atomic<unsigned int> )];
+
+    std::atomic<unsigned int> nDropped;
+    DXUTProfileEvent Events[DXUT_PROFILER_RING_SIZE];
+};
+
+
+//--------------------------------------------------------------------------------------
+// Global/Static Members
+//--------------------------------------------------------------------------------------
+std::atomic<bool> g_bDXUTProfilerEnabled( false );
+
+#ifdef _MSC_VER
+__declspec( thread ) unsigned int CDXUTProfileZone::s_nDepth = 0;
+static __declspec( thread ) DXUTProfileThread* s_pProfileThread = NULL;
+#else
+__thread unsigned int CDXUTProfileZone::s_nDepth = 0;
+static __thread DXUTProfileThread* s_pProfileThread = NULL;
+#endif
+
+// Registry of every thread that has recorded a zone.  Only touched when a thread
+// records its first zone and when exporting.  Buffers outlive their threads so zones
+// recorded by short-lived workers still make it into the trace.
+static std::mutex& DXUTProfilerRegistryLock()
+{
+    static std::mutex s_Lock;
+    return s_Lock;
+}
+static std::vector<DXUTProfileThread*>& DXUTProfilerThreads()
+{
+    static std::vector<DXUTProfileThread*> s_Threads;
+    return s_Threads;
+}
+static char g_szTraceFileName[260] = {0};
+
+
+//--------------------------------------------------------------------------------------
+void DXUTProfilerEnable( bool bEnable )
+{
+    // Make sure the clock is initialized before any thread can record
+    DXUTProfilerGetTimeNs();
+    g_bDXUTProfilerEnabled.store( bEnable, std::memory_order_relaxed );
+}
+
+
+//--------------------------------------------------------------------------------------
+void DXUTProfilerInitFromEnvironment()
+{
+    const char* pszFile = getenv( "DXUT_TRACE_FILE" );
+    if( pszFile == NULL || pszFile[0] == 0 )
+        return;
+
+    size_t cch = strlen( pszFile );
+    if( cch >= sizeof( g_szTraceFileName ) )
+        return;
+    memcpy( g_szTraceFileName, pszFile, cch + 1 );
+
+    DXUTProfilerEnable( true );
+}
+
+
+//--------------------------------------------------------------------------------------
+void DXUTProfilerShutdown()
+{
+    DXUTProfilerEnable( false );
+
+    if( g_szTraceFileName[0] )
+    {
+        DXUTProfilerWriteChromeTrace( g_szTraceFileName );
+        g_szTraceFileName[0] = 0;
+    }
+}
+
+
+//--------------------------------------------------------------------------------------
+DXUT_PROFILE_TIME DXUTProfilerGetTimeNs()
+{
+#ifdef _WIN32
+    // QueryPerformanceFrequency is fixed at boot, so it only needs to be read once
+    static LONGLONG s_llTicksPerSec = 0;
+    if( s_llTicksPerSec == 0 )
+    {
+        LARGE_INTEGER qwTicksPerSec;
+        QueryPerformanceFrequency( &qwTicksPerSec );
+        s_llTicksPerSec = qwTicksPerSec.QuadPart;
+    }
+
+    LARGE_INTEGER qwTime;
+    QueryPerformanceCounter( &qwTime );
+
+    // Split the conversion so the multiply can't overflow
+    DXUT_PROFILE_TIME tSeconds = qwTime.QuadPart / s_llTicksPerSec;
+    DXUT_PROFILE_TIME tRemainder = qwTime.QuadPart % s_llTicksPerSec;
+    return tSeconds * 1000000000ull + tRemainder * 1000000000ull / s_llTicksPerSec;
+#else
+    timespec ts;
+    clock_gettime( CLOCK_MONOTONIC, &ts );
+    return ( DXUT_PROFILE_TIME )ts.tv_sec * 1000000000ull + ( DXUT_PROFILE_TIME )ts.tv_nsec;
+#endif
+}
+
+
+//--------------------------------------------------------------------------------------
+// Returns the calling thread's ring buffer, creating and registering it on first use
+//--------------------------------------------------------------------------------------
+static DXUTProfileThread* DXUTProfilerGetThread()
+{
+    if( s_pProfileThread )
+        return s_pProfileThread;
+
+    DXUTProfileThread* pThread = new DXUTProfileThread;
+    pThread->szName[0] = 0;
+    pThread->nHead.store( 0, std::memory_order_relaxed );
+    pThread->nTail.store( 0, std::memory_order_relaxed );
+    pThread->nDropped.store( 0, std::memory_order_relaxed );
+
+    std::lock_guard<std::mutex> lock( DXUTProfilerRegistryLock() );
+    pThread->nThreadId = ( unsigned int )DXUTProfilerThreads().size() + 1;
+    DXUTProfilerThreads().push_back( pThread );
+
+    s_pProfileThread = pThread;
+    return pThread;
+}
+
+
+//--------------------------------------------------------------------------------------
+void DXUTProfilerSetThreadName( const char* pszName )
+{
+    DXUTProfileThread* pThread = DXUTProfilerGetThread();
+
+    std::lock_guard<std::mutex> lock( DXUTProfilerRegistryLock() );
+    size_t cch = pszName ? strlen( pszName ) : 0;
+    if( cch >= DXUT_PROFILER_MAX_THREAD_NAME )
+        cch = DXUT_PROFILER_MAX_THREAD_NAME - 1;
+    memcpy( pThread->szName, pszName, cch );
+    pThread->szName[cch] = 0;
+}
+
+
+//--------------------------------------------------------------------------------------
+void DXUTProfilerRecordZone( const char* pszName, DXUT_PROFILE_TIME tStartNs, DXUT_PROFILE_TIME tEndNs,
+                             unsigned int nDepth )
+{
+    DXUTProfileThread* pThread = DXUTProfilerGetThread();
+
+    // Only this thread writes nHead, so a relaxed load is enough.  The acquire on nTail
+    // makes sure the exporter has finished reading a slot before it is reused.
+    unsigned int nHead = pThread->nHead.load( std::memory_order_relaxed );
+    unsigned int nTail = pThread->nTail.load( std::memory_order_acquire );
+    if( nHead - nTail >= DXUT_PROFILER_RING_SIZE )
+    {
+        pThread->nDropped.fetch_add( 1, std::memory_order_relaxed );
+        return;
+    }
+
+    DXUTProfileEvent& Event = pThread->Events[nHead & DXUT_PROFILER_RING_MASK];
+    Event.pszName = pszName;
+    Event.tStart = tStartNs;
+    Event.tEnd = tEndNs;
+    Event.nDepth = nDepth;
+
+    // Publish the slot to the exporter
+    pThread->nHead.store( nHead + 1, std::memory_order_release );
+}
+
+
+//--------------------------------------------------------------------------------------
+unsigned int DXUTProfilerGetDroppedZoneCount()
+{
+    std::lock_guard<std::mutex> lock( DXUTProfilerRegistryLock() );
+
+    unsigned int nDropped = 0;
+    std::vector<DXUTProfileThread*>& Threads = DXUTProfilerThreads();
+    for( size_t i = 0; i < Threads.size(); i++ )
+        nDropped += Threads[i]->nDropped.load( std::memory_order_relaxed );
+    return nDropped;
+}
+
+
+//--------------------------------------------------------------------------------------
+// Writes pszString as a JSON string literal
+//--------------------------------------------------------------------------------------
+static void DXUTProfilerWriteJsonString( FILE* pFile, const char* pszString )
+{
+    fputc( '"', pFile );
+    for( const char* pch = pszString; *pch; pch++ )
+    {
+        unsigned char ch = ( unsigned char )*pch;
+        if( ch == '"' || ch == '\\' )
+            fprintf( pFile, "\\%c", ch );
+        else if( ch < 0x20 )
+            fprintf( pFile, "\\u%04x", ch );
+        else
+            fputc( ch, pFile );
+    }
+    fputc( '"', pFile );
+}
+
+
+//--------------------------------------------------------------------------------------
+bool DXUTProfilerWriteChromeTrace( const char* pszFileName )
+{
+    FILE* pFile = NULL;
+#ifdef _MSC_VER
+    if( fopen_s( &pFile, pszFileName, "w" ) != 0 )
+        pFile = NULL;
+#else
+    pFile = fopen( pszFileName, "w" );
+#endif
+    if( pFile == NULL )
+        return false;
+
+    std::lock_guard<std::mutex> lock( DXUTProfilerRegistryLock() );
+    std::vector<DXUTProfileThread*>& Threads = DXUTProfilerThreads();
+
+    // Chrome's trace viewer wants microseconds; keep the nanoseconds as the fraction and
+    // make the earliest zone time zero so the numbers stay readable
+    DXUT_PROFILE_TIME tOrigin = ~( DXUT_PROFILE_TIME )0;
+    for( size_t i = 0; i < Threads.size(); i++ )
+    {
+        DXUTProfileThread* pThread = Threads[i];
+        unsigned int nHead = pThread->nHead.load( std::memory_order_acquire );
+        unsigned int nTail = pThread->nTail.load( std::memory_order_relaxed );
+        for( unsigned int n = nTail; n != nHead; n++ )
+        {
+            const DXUTProfileEvent& Event = pThread->Events[n & DXUT_PROFILER_RING_MASK];
+            if( Event.tStart < tOrigin )
+                tOrigin = Event.tStart;
+        }
+    }
+
+    fprintf( pFile, "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n" );
+    fprintf( pFile, "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"args\":{\"name\":\"DXUT\"}}" );
+
+    for( size_t i = 0; i < Threads.size(); i++ )
+    {
+        DXUTProfileThread* pThread = Threads[i];
+
+        if( pThread->szName[0] )
+        {
+            fprintf( pFile, ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":",
+                     pThread->nThreadId );
+            DXUTProfilerWriteJsonString( pFile, pThread->szName );
+            fprintf( pFile, "}}" );
+        }
+
+        unsigned int nHead = pThread->nHead.load( std::memory_order_acquire );
+        unsigned int nTail = pThread->nTail.load( std::memory_order_relaxed );
+        for( ; nTail != nHead; nTail++ )
+        {
+            const DXUTProfileEvent& Event = pThread->Events[nTail & DXUT_PROFILER_RING_MASK];
+            DXUT_PROFILE_TIME tStart = Event.tStart - tOrigin;
+            DXUT_PROFILE_TIME tDuration = Event.tEnd - Event.tStart;
+
+            fprintf( pFile, ",\n{\"name\":" );
+            DXUTProfilerWriteJsonString( pFile, Event.pszName );
+            fprintf( pFile, ",\"cat\":\"dxut\",\"ph\":\"X\",\"pid\":1,\"tid\":%u,"
+                     "\"ts\":%llu.%03u,\"dur\":%llu.%03u,\"args\":{\"depth\":%u}}",
+                     pThread->nThreadId,
+                     ( unsigned long long )( tStart / 1000 ), ( unsigned int )( tStart % 1000 ),
+                     ( unsigned long long )( tDuration / 1000 ), ( unsigned int )( tDuration % 1000 ),
+                     Event.nDepth );
+        }
+
+        // Hand the slots back to the recording thread
+        pThread->nTail.store( nTail, std::memory_order_release );
+    }
+
+    fprintf( pFile, "\n]}\n" );
+
+    bool bSuccess = ( ferror( pFile ) == 0 );
+    fclose( pFile );
+    return bSuccess;
+}
@@ -0,0 +1,123 @@
+//--------------------------------------------------------------------------------------
+// File: DXUTProfiler.h
+//
+// Lightweight hierarchical CPU profiler.  Code is instrumented with scoped zones:
+//
+//      void LoadStuff()
+//      {
+//          DXUT_PROFILE_ZONE( "LoadStuff" );
+//          ...
+//      }
+//
+// Each thread records completed zones into its own lock-free ring buffer with
+// nanosecond timestamps taken from the same performance counter CDXUTTimer uses.
+// DXUTProfilerWriteChromeTrace() drains all buffers into a Chrome/Perfetto JSON trace
+// (open it in chrome://tracing or ui.perfetto.dev).
+//
+// Like DXUT_BeginPerfEvent, the zone macros only generate code when PROFILE (or
+// DXUT_ENABLE_PROFILER) is defined.  Even then recording is off until
+// DXUTProfilerEnable( true ) is called, and a disabled zone costs one relaxed load.
+//--------------------------------------------------------------------------------------
+#pragma once
+#ifndef DXUT_PROFILER_H
+#define DXUT_PROFILER_H
+
+#include <stddef.h>
+#include <atomic>
+
+#ifdef _MSC_VER
+typedef unsigned __int64 DXUT_PROFILE_TIME;
+#else
+#include <stdint.h>
+typedef uint64_t DXUT_PROFILE_TIME;
+#endif
+
+// Global on/off switch; use DXUTProfilerEnable() rather than touching this directly
+extern std::atomic<bool> g_bDXUTProfilerEnabled;
+
+//--------------------------------------------------------------------------------------
+// Profiler control
+//--------------------------------------------------------------------------------------
+void                DXUTProfilerEnable( bool bEnable );
+inline bool         DXUTProfilerIsEnabled()
+{
+    return g_bDXUTProfilerEnabled.load( std::memory_order_relaxed );
+}
+
+// Reads DXUT_TRACE_FILE from the environment; if it is set, recording is enabled and
+// DXUTProfilerShutdown() writes the trace there.
+void                DXUTProfilerInitFromEnvironment();
+void                DXUTProfilerShutdown();
+
+// Names the calling thread in exported traces.  pszName is copied.
+void                DXUTProfilerSetThreadName( const char* pszName );
+
+// Current time in nanoseconds on the profiler's clock
+DXUT_PROFILE_TIME   DXUTProfilerGetTimeNs();
+
+// Records a zone that has already finished.  pszName must outlive the profiler
+// (string literals are the intended use).
+void                DXUTProfilerRecordZone( const char* pszName, DXUT_PROFILE_TIME tStartNs,
+                                            DXUT_PROFILE_TIME tEndNs, unsigned int nDepth );
+
+// Writes every zone recorded so far to a Chrome trace event JSON file and removes
+// them from the ring buffers.  Returns false if the file can't be written.
+bool                DXUTProfilerWriteChromeTrace( const char* pszFileName );
+
+// Number of zones that were dropped because a thread's ring buffer was full
+unsigned int        DXUTProfilerGetDroppedZoneCount();
+
+
+//--------------------------------------------------------------------------------------
+// CDXUTProfileZone records the lifetime of a block of code.  Prefer the
+// DXUT_PROFILE_ZONE macro, which compiles away in builds without PROFILE.
+//--------------------------------------------------------------------------------------
+class CDXUTProfileZone
+{
+public:
+    explicit CDXUTProfileZone( const char* pszName )
+    {
+        m_pszName = NULL;
+        if( DXUTProfilerIsEnabled() )
+        {
+            m_pszName = pszName;
+            m_nDepth = s_nDepth++;
+            m_tStart = DXUTProfilerGetTimeNs();
+        }
+    }
+    ~CDXUTProfileZone()
+    {
+        if( m_pszName )
+        {
+            --s_nDepth;
+            DXUTProfilerRecordZone( m_pszName, m_tStart, DXUTProfilerGetTimeNs(), m_nDepth );
+        }
+    }
+
+private:
+    const char* m_pszName;
+    unsigned int m_nDepth;
+    DXUT_PROFILE_TIME m_tStart;
+
+#ifdef _MSC_VER
+    static __declspec( thread ) unsigned int s_nDepth;
+#else
+    static __thread unsigned int s_nDepth;
+#endif
+
+    // Leave these private and undefined to prevent their use
+    CDXUTProfileZone( const CDXUTProfileZone& );
+    CDXUTProfileZone& operator =( const CDXUTProfileZone& );
+};
+
+
+#define DXUT_PROFILE_CONCAT2( a, b )    a##b
+#define DXUT_PROFILE_CONCAT( a, b )     DXUT_PROFILE_CONCAT2( a, b )
+
+#if defined(PROFILE) || defined(DXUT_ENABLE_PROFILER)
+#define DXUT_PROFILE_ZONE( pszName )    CDXUTProfileZone DXUT_PROFILE_CONCAT( dxutProfileZone, __LINE__ )( pszName )
+#else
+#define DXUT_PROFILE_ZONE( pszName )    ((void)0)
+#endif
+
+#endif
@@ -0,0 +1,564 @@
+//--------------------------------------------------------------------------------------
+// File: DXUTShapeGen.cpp
+//
+// Procedural shapes with 32-bit indices.  See DXUTShapeGen.h.
+//
+// Every shape is built from one or more patches, regular grids of quads over a (u, v)
+// parameterization.  Each grid row is generated independently from its position in the
+// output, which is what lets one huge shape be split across workers.
+//--------------------------------------------------------------------------------------
+#include "DXUTShapeGen.h"
+#include "DXUTJobSystem.h"
+#include "DXUTMath.h"
+
+#include <math.h>
+#include <string.h>
+#include <vector>
+
+#define DXUT_SHAPE_PI           3.14159265358979323846f
+#define DXUT_SHAPE_MAX_PATCHES  6
+
+// Vertices per ParallelFor chunk
+#define DXUT_SHAPE_GRAIN        4096
+
+
+//--------------------------------------------------------------------------------------
+// A grid of nU by nV quads.  A collapsed first or last row has every vertex on one
+// point (a pole, or the centre of a cap), so half of its triangles are degenerate and
+// are left out.
+//--------------------------------------------------------------------------------------
+struct DXUTShapePatch
+{
+    int iPatch;                 // Face or cap, passed to the evaluator
+    unsigned int nU;
+    unsigned int nV;
+    bool bCollapseFirst;
+    bool bCollapseLast;
+    bool bFlip;                 // Parameterization faces inwards; swap the winding
+    unsigned long long nVertexStart;
+    unsigned long long nIndexStart;
+};
+
+// Where and how a shape is written; the transform and offsets are only used in scenes
+struct DXUTShapeOutput
+{
+    DXUTSHAPE_VERTEX* pVertices;
+    unsigned int* pIndices;
+    unsigned int* pAttributes;  // One per triangle, may be NULL
+    unsigned int nBaseVertex;   // Added to every index
+    unsigned int Attribute;
+    bool bTransform;
+    DXUTMATRIX4 World;
+    DXUTMATRIX4 NormalMatrix;   // Cofactors of the upper 3x3, the inverse transpose up to scale
+    bool bMirror;               // World flips handedness
+};
+
+// Box faces: corner, the two edges and the normal, in a unit cube.  The edges are
+// ordered so that cross( e2, e1 ) is the outward normal.
+static const float s_BoxFaces[6][4][3] =
+{
+    { { -.5f, -.5f, -.5f }, { 0.0f, 1.0f, 0.0f }, { 0.0f, 0.0f, 1.0f }, { -1.0f, 0.0f, 0.0f } },
+    { {  .5f, -.5f, -.5f }, { 0.0f, 0.0f, 1.0f }, { 0.0f, 1.0f, 0.0f }, {  1.0f, 0.0f, 0.0f } },
+    { { -.5f,  .5f, -.5f }, { 1.0f, 0.0f, 0.0f }, { 0.0f, 0.0f, 1.0f }, { 0.0f,  1.0f, 0.0f } },
+    { { -.5f, -.5f, -.5f }, { 0.0f, 0.0f, 1.0f }, { 1.0f, 0.0f, 0.0f }, { 0.0f, -1.0f, 0.0f } },
+    { { -.5f, -.5f,  .5f }, { 0.0f, 1.0f, 0.0f }, { 1.0f, 0.0f, 0.0f }, { 0.0f, 0.0f,  1.0f } },
+    { { -.5f, -.5f, -.5f }, { 1.0f, 0.0f, 0.0f }, { 0.0f, 1.0f, 0.0f }, { 0.0f, 0.0f, -1.0f } },
+};
+
+
+//--------------------------------------------------------------------------------------
+static inline void DXUTSetShapeVertex( DXUTSHAPE_VERTEX* pVertex, float px, float py, float pz,
+                                       float nx, float ny, float nz, float u, float v )
+{
+    pVertex->Position[0] = px;
+    pVertex->Position[1] = py;
+    pVertex->Position[2] = pz;
+    pVertex->Normal[0] = nx;
+    pVertex->Normal[1] = ny;
+    pVertex->Normal[2] = nz;
+    pVertex->TexCoord[0] = u;
+    pVertex->TexCoord[1] = v;
+}
+
+
+//--------------------------------------------------------------------------------------
+// Position, normal and texture coordinate at (u, v) on one patch of a shape
+//--------------------------------------------------------------------------------------
+static void DXUTEvaluateShape( const DXUT_SHAPE_DESC* pDesc, int iPatch, float u, float v, DXUTSHAPE_VERTEX* pVertex )
+{
+    switch( pDesc->Type )
+    {
+        case DXUT_SHAPE_BOX:
+        {
+            const float( *pFace )[3] = s_BoxFaces[iPatch];
+            float p[3];
+            for( int i = 0; i < 3; i++ )
+                p[i] = ( pFace[0][i] + u * pFace[1][i] + v * pFace[2][i] ) * pDesc->fSize[i];
+            DXUTSetShapeVertex( pVertex, p[0], p[1], p[2], pFace[3][0], pFace[3][1], pFace[3][2], u, 1.0f - v );
+            break;
+        }
+
+        case DXUT_SHAPE_CYLINDER:
+        {
+            float fRadius1 = pDesc->fSize[0];
+            float fRadius2 = pDesc->fSize[1];
+            float fLength = pDesc->fSize[2];
+            float fTheta = u * 2.0f * DXUT_SHAPE_PI;
+            float fSin = sinf( fTheta );
+            float fCos = cosf( fTheta );
+
+            if( 0 == iPatch )
+            {
+                // Side; the normal leans along the axis as much as the radius changes
+                float fRadius = fRadius1 + ( fRadius2 - fRadius1 ) * v;
+                float fSlope = ( fRadius1 - fRadius2 ) / fLength;
+                float fScale = 1.0f / sqrtf( 1.0f + fSlope * fSlope );
+                DXUTSetShapeVertex( pVertex, fRadius * fCos, fRadius * fSin, fLength * ( v - 0.5f ),
+                                    fCos * fScale, fSin * fScale, fSlope * fScale, u, 1.0f - v );
+            }
+            else
+            {
+                // Caps, from the centre (v = 0) out to the rim
+                bool bTop = ( 2 == iPatch );
+                float fRadius = ( bTop ? fRadius2 : fRadius1 ) * v;
+                DXUTSetShapeVertex( pVertex, fRadius * fCos, fRadius * fSin, bTop ? fLength * 0.5f : -fLength * 0.5f,
+                                    0.0f, 0.0f, bTop ? 1.0f : -1.0f,
+                                    0.5f + 0.5f * v * fCos, 0.5f - 0.5f * v * fSin );
+            }
+            break;
+        }
+
+        case DXUT_SHAPE_SPHERE:
+        {
+            // v runs from the -z pole to the +z pole
+            float fRadius = pDesc->fSize[0];
+            float fTheta = u * 2.0f * DXUT_SHAPE_PI;
+            float fPhi = v * DXUT_SHAPE_PI;
+            float fRing = sinf( fPhi );
+            float nx = fRing * cosf( fTheta );
+            float ny = fRing * sinf( fTheta );
+            float nz = -cosf( fPhi );
+            DXUTSetShapeVertex( pVertex, nx * fRadius, ny * fRadius, nz * fRadius, nx, ny, nz, u, 1.0f - v );
+            break;
+        }
+
+        case DXUT_SHAPE_TORUS:
+        {
+            // u runs around the tube, v around the axis
+            float fInner = pDesc->fSize[0];
+            float fOuter = pDesc->fSize[1];
+            float fPhi = u * 2.0f * DXUT_SHAPE_PI;
+            float fTheta = v * 2.0f * DXUT_SHAPE_PI;
+            float fTubeCos = cosf( fPhi );
+            float fTubeSin = sinf( fPhi );
+            float fCos = cosf( fTheta );
+            float fSin = sinf( fTheta );
+            float fRadius = fOuter + fInner * fTubeCos;
+            DXUTSetShapeVertex( pVertex, fRadius * fCos, fRadius * fSin, fInner * fTubeSin,
+                                fTubeCos * fCos, fTubeCos * fSin, fTubeSin, u, v );
+            break;
+        }
+
+        case DXUT_SHAPE_PLANE:
+        default:
+            DXUTSetShapeVertex( pVertex, pDesc->fSize[0] * ( u - 0.5f ), 0.0f, pDesc->fSize[1] * ( v - 0.5f ),
+                                0.0f, 1.0f, 0.0f, u, 1.0f - v );
+            break;
+    }
+}
+
+
+//--------------------------------------------------------------------------------------
+// Split a shape into patches and lay them out in the vertex and index arrays.  Returns
+// false if the description is invalid.
+//--------------------------------------------------------------------------------------
+static void DXUTAddShapePatch( DXUTShapePatch* pPatches, unsigned int* pnPatches, int iPatch, unsigned int nU,
+                               unsigned int nV, bool bCollapseFirst, bool bCollapseLast, bool bFlip )
+{
+    DXUTShapePatch* pPatch = &pPatches[( *pnPatches )++];
+    pPatch->iPatch = iPatch;
+    pPatch->nU = nU;
+    pPatch->nV = nV;
+    pPatch->bCollapseFirst = bCollapseFirst;
+    pPatch->bCollapseLast = bCollapseLast;
+    pPatch->bFlip = bFlip;
+    pPatch->nVertexStart = 0;
+    pPatch->nIndexStart = 0;
+}
+
+static bool DXUTGetShapePatches( const DXUT_SHAPE_DESC* pDesc, DXUTShapePatch* pPatches, unsigned int* pnPatches,
+                                 unsigned long long* pnVertices, unsigned long long* pnIndices )
+{
+    *pnPatches = 0;
+    unsigned int nSlices = pDesc->nSlices;
+    unsigned int nStacks = pDesc->nStacks;
+    const float* pSize = pDesc->fSize;
+
+    switch( pDesc->Type )
+    {
+        case DXUT_SHAPE_BOX:
+            if( nSlices < 1 || !( pSize[0] > 0.0f && pSize[1] > 0.0f && pSize[2] > 0.0f ) )
+                return false;
+            for( int i = 0; i < 6; i++ )
+                DXUTAddShapePatch( pPatches, pnPatches, i, nSlices, nSlices, false, false, false );
+            break;
+
+        case DXUT_SHAPE_CYLINDER:
+            if( nSlices < 3 || nStacks < 1 || !( pSize[0] >= 0.0f && pSize[1] >= 0.0f && pSize[2] > 0.0f ) ||
+                !( pSize[0] > 0.0f || pSize[1] > 0.0f ) )
+                return false;
+            DXUTAddShapePatch( pPatches, pnPatches, 0, nSlices, nStacks, pSize[0] == 0.0f, pSize[1] == 0.0f, true );
+            if( pSize[0] > 0.0f )
+                DXUTAddShapePatch( pPatches, pnPatches, 1, nSlices, 1, true, false, true );
+            if( pSize[1] > 0.0f )
+                DXUTAddShapePatch( pPatches, pnPatches, 2, nSlices, 1, true, false, false );
+            break;
+
+        case DXUT_SHAPE_SPHERE:
+            if( nSlices < 3 || nStacks < 2 || !( pSize[0] > 0.0f ) )
+                return false;
+            DXUTAddShapePatch( pPatches, pnPatches, 0, nSlices, nStacks, true, true, true );
+            break;
+
+        case DXUT_SHAPE_TORUS:
+            if( nSlices < 3 || nStacks < 3 || !( pSize[0] > 0.0f && pSize[1] > 0.0f ) )
+                return false;
+            DXUTAddShapePatch( pPatches, pnPatches, 0, nSlices, nStacks, false, false, false );
+            break;
+
+        case DXUT_SHAPE_PLANE:
+            if( nSlices < 1 || nStacks < 1 || !( pSize[0] > 0.0f && pSize[1] > 0.0f ) )
+                return false;
+            DXUTAddShapePatch( pPatches, pnPatches, 0, nSlices, nStacks, false, false, false );
+            break;
+
+        default:
+            return false;
+    }
+
+    unsigned long long nVertices = 0;
+    unsigned long long nIndices = 0;
+    for( unsigned int i = 0; i < *pnPatches; i++ )
+    {
+        DXUTShapePatch* pPatch = &pPatches[i];
+        unsigned long long nU = pPatch->nU;
+        unsigned long long nV = pPatch->nV;
+        unsigned long long nTriangles = 2 * nU * nV;
+        if( pPatch->bCollapseFirst )
+            nTriangles -= nU;
+        if( pPatch->bCollapseLast )
+            nTriangles -= nU;
+
+        pPatch->nVertexStart = nVertices;
+        pPatch->nIndexStart = nIndices;
+        nVertices += ( nU + 1 ) * ( nV + 1 );
+        nIndices += 3 * nTriangles;
+    }
+
+    *pnVertices = nVertices;
+    *pnIndices = nIndices;
+    return true;
+}
+
+
+//--------------------------------------------------------------------------------------
+// Generate rows [iBegin, iEnd) of a patch.  Vertex row r lies at v = r / nV; index row r
+// is the strip of quads between vertex rows r and r + 1.
+//--------------------------------------------------------------------------------------
+static void DXUTGeneratePatchRows( const DXUT_SHAPE_DESC* pDesc, const DXUTShapePatch* pPatch,
+                                   const DXUTShapeOutput* pOut, unsigned int iBegin, unsigned int iEnd )
+{
+    unsigned int nU = pPatch->nU;
+    unsigned int nV = pPatch->nV;
+    unsigned int nRowVertices = nU + 1;
+    bool bFlip = pPatch->bFlip != pOut->bMirror;
+
+    for( unsigned int r = iBegin; r < iEnd; r++ )
+    {
+        // Vertices
+        DXUTSHAPE_VERTEX* pVertex = pOut->pVertices + pPatch->nVertexStart + ( unsigned long long )r * nRowVertices;
+        float v = ( float )r / ( float )nV;
+        for( unsigned int c = 0; c <= nU; c++, pVertex++ )
+        {
+            // Ends of rows land exactly on 0 and 1 so seams close
+            DXUTEvaluateShape( pDesc, pPatch->iPatch, c == nU ? 1.0f : ( float )c / ( float )nU, v, pVertex );
+        }
+
+        // The whole row is transformed in place while it is still in cache
+        if( pOut->bTransform )
+        {
+            pVertex -= nRowVertices;
+            DXUTTransformPoints( pVertex->Position, sizeof( DXUTSHAPE_VERTEX ), pVertex->Position,
+                                 sizeof( DXUTSHAPE_VERTEX ), nRowVertices, &pOut->World );
+            DXUTTransformVectors( pVertex->Normal, sizeof( DXUTSHAPE_VERTEX ), pVertex->Normal,
+                                  sizeof( DXUTSHAPE_VERTEX ), nRowVertices, &pOut->NormalMatrix );
+            for( unsigned int c = 0; c <= nU; c++ )
+                DXUTVec3Normalize( pVertex[c].Normal, pVertex[c].Normal );
+        }
+
+        if( r >= nV )
+            continue;
+
+        // Indices.  Collapsed rows only have one triangle per quad, so rows after a
+        // collapsed first row start nU triangles earlier.
+        bool bFirstCollapsed = pPatch->bCollapseFirst && 0 == r;
+        bool bLastCollapsed = pPatch->bCollapseLast && nV - 1 == r;
+        unsigned long long nTriangleStart = 2ull * nU * r;
+        if( pPatch->bCollapseFirst && r > 0 )
+            nTriangleStart -= nU;
+
+        unsigned long long iTriangle = pPatch->nIndexStart / 3 + nTriangleStart;
+        unsigned int* pIndex = pOut->pIndices + iTriangle * 3;
+        unsigned int nRow0 = pOut->nBaseVertex + ( unsigned int )pPatch->nVertexStart + r * nRowVertices;
+        unsigned int nRow1 = nRow0 + nRowVertices;
+
+        for( unsigned int c = 0; c < nU; c++ )
+        {
+            unsigned int a = nRow0 + c;
+            unsigned int b = a + 1;
+            unsigned int d = nRow1 + c;
+            unsigned int e = d + 1;
+
+            if( !bFirstCollapsed )
+            {
+                pIndex[0] = a;
+                pIndex[1] = bFlip ? b : d;
+                pIndex[2] = bFlip ? d : b;
+                pIndex += 3;
+            }
+            if( !bLastCollapsed )
+            {
+                pIndex[0] = b;
+                pIndex[1] = bFlip ? e : d;
+                pIndex[2] = bFlip ? d : e;
+                pIndex += 3;
+            }
+        }
+
+        if( pOut->pAttributes )
+        {
+            unsigned long long nRowTriangles = ( unsigned long long )( pIndex - ( pOut->pIndices + iTriangle * 3 ) ) / 3;
+            for( unsigned long long i = 0; i < nRowTriangles; i++ )
+                pOut->pAttributes[iTriangle + i] = pOut->Attribute;
+        }
+    }
+}
+
+
+//--------------------------------------------------------------------------------------
+static void DXUTGenerateShapeInternal( const DXUT_SHAPE_DESC* pDesc, const DXUTShapePatch* pPatches,
+                                       unsigned int nPatches, const DXUTShapeOutput* pOut )
+{
+    for( unsigned int i = 0; i < nPatches; i++ )
+    {
+        const DXUTShapePatch* pPatch = &pPatches[i];
+        unsigned int nGrain = DXUT_SHAPE_GRAIN / ( pPatch->nU + 1 );
+        if( nGrain < 1 )
+            nGrain = 1;
+
+        DXUTGetJobSystem()->ParallelFor( 0, pPatch->nV + 1, nGrain, [&]( unsigned int iBegin, unsigned int iEnd )
+        {
+            DXUTGeneratePatchRows( pDesc, pPatch, pOut, iBegin, iEnd );
+        } );
+    }
+}
+
+
+//--------------------------------------------------------------------------------------
+bool DXUTGetShapeCounts( const DXUT_SHAPE_DESC* pDesc, unsigned int* pnVertices, unsigned int* pnIndices )
+{
+    DXUTShapePatch Patches[DXUT_SHAPE_MAX_PATCHES];
+    unsigned int nPatches;
+    unsigned long long nVertices, nIndices;
+    if( !pDesc || !DXUTGetShapePatches( pDesc, Patches, &nPatches, &nVertices, &nIndices ) )
+        return false;
+    if( nVertices > 0xFFFFFFFFull || nIndices > 0xFFFFFFFFull )
+        return false;
+
+    *pnVertices = ( unsigned int )nVertices;
+    *pnIndices = ( unsigned int )nIndices;
+    return true;
+}
+
+
+//--------------------------------------------------------------------------------------
+bool DXUTGenerateShape( const DXUT_SHAPE_DESC* pDesc, DXUTSHAPE_VERTEX* pVertices, unsigned int* pIndices )
+{
+    DXUTShapePatch Patches[DXUT_SHAPE_MAX_PATCHES];
+    unsigned int nPatches;
+    unsigned long long nVertices, nIndices;
+    if( !pDesc || !DXUTGetShapePatches( pDesc, Patches, &nPatches, &nVertices, &nIndices ) )
+        return false;
+    if( nVertices > 0xFFFFFFFFull || nIndices > 0xFFFFFFFFull )
+        return false;
+
+    DXUTShapeOutput Out;
+    memset( &Out, 0, sizeof( Out ) );
+    Out.pVertices = pVertices;
+    Out.pIndices = pIndices;
+
+    DXUTGenerateShapeInternal( pDesc, Patches, nPatches, &Out );
+    return true;
+}
+
+
+//--------------------------------------------------------------------------------------
+bool DXUTGetShapeSceneCounts( const DXUT_SHAPE_INSTANCE* pInstances, unsigned int nInstances,
+                              unsigned int* pnVertices, unsigned int* pnIndices )
+{
+    unsigned long long nTotalVertices = 0;
+    unsigned long long nTotalIndices = 0;
+    for( unsigned int i = 0; i < nInstances; i++ )
+    {
+        DXUTShapePatch Patches[DXUT_SHAPE_MAX_PATCHES];
+        unsigned int nPatches;
+        unsigned long long nVertices, nIndices;
+        if( !DXUTGetShapePatches( &pInstances[i].Shape, Patches, &nPatches, &nVertices, &nIndices ) )
+            return false;
+
+        nTotalVertices += nVertices;
+        nTotalIndices += nIndices;
+        if( nTotalVertices > 0xFFFFFFFFull || nTotalIndices > 0xFFFFFFFFull )
+            return false;
+    }
+
+    *pnVertices = ( unsigned int )nTotalVertices;
+    *pnIndices = ( unsigned int )nTotalIndices;
+    return true;
+}
+
+
+//--------------------------------------------------------------------------------------
+bool DXUTGenerateShapeScene( const DXUT_SHAPE_INSTANCE* pInstances, unsigned int nInstances,
+                             DXUTSHAPE_VERTEX* pVertices, unsigned int* pIndices, unsigned int* pAttributes )
+{
+    // Each instance's offsets, found once up front; the same pass checks the totals fit
+    std::vector<unsigned int> VertexStarts( nInstances );
+    std::vector<unsigned int> IndexStarts( nInstances );
+    unsigned long long nTotalVertices = 0;
+    unsigned long long nTotalIndices = 0;
+    for( unsigned int i = 0; i < nInstances; i++ )
+    {
+        DXUTShapePatch Patches[DXUT_SHAPE_MAX_PATCHES];
+        unsigned int nPatches;
+        unsigned long long nVertices, nIndices;
+        if( !DXUTGetShapePatches( &pInstances[i].Shape, Patches, &nPatches, &nVertices, &nIndices ) )
+            return false;
+
+        VertexStarts[i] = ( unsigned int )nTotalVertices;
+        IndexStarts[i] = ( unsigned int )nTotalIndices;
+        nTotalVertices += nVertices;
+        nTotalIndices += nIndices;
+        if( nTotalVertices > 0xFFFFFFFFull || nTotalIndices > 0xFFFFFFFFull )
+            return false;
+    }
+
+    // Instances are independent once their offsets are known; each one splits its own
+    // rows further, so a scene of one huge shape is spread over the workers as well
+    DXUTGetJobSystem()->ParallelFor( 0, nInstances, 1, [&]( unsigned int iBegin, unsigned int iEnd )
+    {
+        DXUTShapePatch Patches[DXUT_SHAPE_MAX_PATCHES];
+        unsigned int nPatches;
+        unsigned long long nVertices, nIndices;
+        for( unsigned int i = iBegin; i < iEnd; i++ )
+        {
+            const DXUT_SHAPE_INSTANCE* pInstance = &pInstances[i];
+            DXUTGetShapePatches( &pInstance->Shape, Patches, &nPatches, &nVertices, &nIndices );
+
+            DXUTShapeOutput Out;
+            Out.pVertices = pVertices + VertexStarts[i];
+            Out.pIndices = pIndices + IndexStarts[i];
+            Out.pAttributes = pAttributes ? pAttributes + IndexStarts[i] / 3 : NULL;
+            Out.nBaseVertex = VertexStarts[i];
+            Out.Attribute = pInstance->Attribute;
+            Out.bTransform = true;
+            memcpy( Out.World.m, pInstance->World, sizeof( Out.World.m ) );
+
+            // Normals go through the inverse transpose.  The cofactor matrix is that
+            // scaled by the determinant, which the normalization removes, apart from its
+            // sign: a mirroring transform has to flip the normals back out and reverse
+            // the winding.
+            const float( *M )[4] = pInstance->World;
+            float( *N )[4] = Out.NormalMatrix.m;
+            memset( N, 0, sizeof( Out.NormalMatrix.m ) );
+            N[0][0] = M[1][1] * M[2][2] - M[1][2] * M[2][1];
+            N[0][1] = M[1][2] * M[2][0] - M[1][0] * M[2][2];
+            N[0][2] = M[1][0] * M[2][1] - M[1][1] * M[2][0];
+            N[1][0] = M[0][2] * M[2][1] - M[0][1] * M[2][2];
+            N[1][1] = M[0][0] * M[2][2] - M[0][2] * M[2][0];
+            N[1][2] = M[0][1] * M[2][0] - M[0][0] * M[2][1];
+            N[2][0] = M[0][1] * M[1][2] - M[0][2] * M[1][1];
+            N[2][1] = M[0][2] * M[1][0] - M[0][0] * M[1][2];
+            N[2][2] = M[0][0] * M[1][1] - M[0][1] * M[1][0];
+            float fDet = M[0][0] * N[0][0] + M[0][1] * N[0][1] + M[0][2] * N[0][2];
+            Out.bMirror = fDet < 0.0f;
+            if( Out.bMirror )
+            {
+                for( int r = 0; r < 3; r++ )
+                    for( int c = 0; c < 3; c++ )
+                        N[r][c] = -N[r][c];
+            }
+
+            DXUTGenerateShapeInternal( &pInstance->Shape, Patches, nPatches, &Out );
+        }
+    } );
+
+    return true;
+}
+
+
+//--------------------------------------------------------------------------------------
+// xorshift32, so scenes are identical on every platform and C runtime
+//--------------------------------------------------------------------------------------
+static inline float DXUTShapeRandom( unsigned int* pnState )
+{
+    unsigned int x = *pnState;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    *pnState = x;
+    return ( float )( x >> 8 ) * ( 1.0f / 16777216.0f );
+}
+
+void DXUTScatterShapeInstances( const DXUT_SHAPE_DESC* pShapes, unsigned int nShapes, unsigned int nInstances,
+                                float fExtent, unsigned int nSeed, DXUT_SHAPE_INSTANCE* pInstances )
+{
+    unsigned int nState = nSeed ? nSeed : 0x9E3779B9;
+
+    for( unsigned int i = 0; i < nInstances; i++ )
+    {
+        DXUT_SHAPE_INSTANCE* pInstance = &pInstances[i];
+        pInstance->Shape = pShapes[i % nShapes];
+        pInstance->Attribute = i % nShapes;
+
+        // Uniformly distributed rotation (Shoemake)
+        float r0 = DXUTShapeRandom( &nState );
+        float r1 = DXUTShapeRandom( &nState ) * 2.0f * DXUT_SHAPE_PI;
+        float r2 = DXUTShapeRandom( &nState ) * 2.0f * DXUT_SHAPE_PI;
+        float s0 = sqrtf( 1.0f - r0 );
+        float s1 = sqrtf( r0 );
+        float x = s0 * sinf( r1 );
+        float y = s0 * cosf( r1 );
+        float z = s1 * sinf( r2 );
+        float w = s1 * cosf( r2 );
+
+        float fScale = 0.5f + DXUTShapeRandom( &nState );
+
+        // Same layout as D3DXMatrixRotationQuaternion, then scaled
+        float( *W )[4] = pInstance->World;
+        W[0][0] = ( 1.0f - 2.0f * ( y * y + z * z ) ) * fScale;
+        W[0][1] = ( 2.0f * ( x * y + z * w ) ) * fScale;
+        W[0][2] = ( 2.0f * ( x * z - y * w ) ) * fScale;
+        W[1][0] = ( 2.0f * ( x * y - z * w ) ) * fScale;
+        W[1][1] = ( 1.0f - 2.0f * ( x * x + z * z ) ) * fScale;
+        W[1][2] = ( 2.0f * ( y * z + x * w ) ) * fScale;
+        W[2][0] = ( 2.0f * ( x * z + y * w ) ) * fScale;
+        W[2][1] = ( 2.0f * ( y * z - x * w ) ) * fScale;
+        W[2][2] = ( 1.0f - 2.0f * ( x * x + y * y ) ) * fScale;
+        W[0][3] = W[1][3] = W[2][3] = 0.0f;
+
+        for( int j = 0; j < 3; j++ )
+            W[3][j] = ( DXUTShapeRandom( &nState ) * 2.0f - 1.0f ) * fExtent;
+        W[3][3] = 1.0f;
+    }
+}
@@ -0,0 +1,88 @@
+//--------------------------------------------------------------------------------------
+// File: DXUTShapeGen.h
+//
+// Device independent procedural shapes for synthetic scenes.  Unlike DXUTShapes, which
+// builds small ID3DX10Mesh objects with 16-bit indices, these write plain vertex and
+// 32-bit index arrays supplied by the caller, so the tessellation is only limited by
+// memory.  Many transformed shapes can be packed into one scene for reproducible
+// benchmark inputs.
+//
+// Shapes are centred on the origin and use the DXUTShapes conventions: cylinders run
+// along z, sphere poles are on z and tori lie in the xy plane.  Triangles are wound
+// clockwise seen from outside, as in DXUTShapes.  Large shapes are generated in
+// parallel on DXUTGetJobSystem(); the output does not depend on the worker count.
+//--------------------------------------------------------------------------------------
+#pragma once
+#ifndef DXUT_SHAPEGEN_H
+#define DXUT_SHAPEGEN_H
+
+// Same layout as the VERTEX of CMeshLoader10 so generated data can be copied straight in
+struct DXUTSHAPE_VERTEX
+{
+    float Position[3];
+    float Normal[3];
+    float TexCoord[2];
+};
+
+enum DXUT_SHAPE_TYPE
+{
+    DXUT_SHAPE_BOX,
+    DXUT_SHAPE_CYLINDER,
+    DXUT_SHAPE_SPHERE,
+    DXUT_SHAPE_TORUS,
+    DXUT_SHAPE_PLANE,
+};
+
+struct DXUT_SHAPE_DESC
+{
+    DXUT_SHAPE_TYPE Type;
+
+    // Box: width, height, depth.  Cylinder: radius at -z, radius at +z, length.
+    // Sphere: radius.  Torus: inner (tube) radius, outer radius.  Plane (in xz, facing
+    // +y): width, depth.
+    float fSize[3];
+
+    // Box: divisions along each edge of every face.  Cylinder and sphere: slices around
+    // the axis and stacks along it.  Torus: sides around the tube and rings around the
+    // axis.  Plane: divisions along the width and along the depth.
+    unsigned int nSlices;
+    unsigned int nStacks;
+};
+
+// One shape placed in a scene.  World is row-major and applies to row vectors, the
+// D3DX convention, so the translation is in World[3].  Every triangle of the instance
+// gets Attribute as its subset id.
+struct DXUT_SHAPE_INSTANCE
+{
+    DXUT_SHAPE_DESC Shape;
+    float World[4][4];
+    unsigned int Attribute;
+};
+
+// Vertex and index counts of a shape.  Returns false if the description is invalid or
+// the counts do not fit in 32 bits.
+bool    DXUTGetShapeCounts( const DXUT_SHAPE_DESC* pDesc, unsigned int* pnVertices, unsigned int* pnIndices );
+
+// Fills pVertices and pIndices, sized by DXUTGetShapeCounts.  Returns false if the
+// description is invalid.
+bool    DXUTGenerateShape( const DXUT_SHAPE_DESC* pDesc, DXUTSHAPE_VERTEX* pVertices, unsigned int* pIndices );
+
+// Totals over a set of instances.  Returns false if any shape is invalid or a total does
+// not fit in 32 bits.
+bool    DXUTGetShapeSceneCounts( const DXUT_SHAPE_INSTANCE* pInstances, unsigned int nInstances,
+                                 unsigned int* pnVertices, unsigned int* pnIndices );
+
+// Generates every instance into one vertex and index array, in instance order, with
+// vertices transformed by World and indices offset to address the shared array.
+// pAttributes receives one entry per triangle and may be NULL.
+bool    DXUTGenerateShapeScene( const DXUT_SHAPE_INSTANCE* pInstances, unsigned int nInstances,
+                                DXUTSHAPE_VERTEX* pVertices, unsigned int* pIndices, unsigned int* pAttributes );
+
+// Scatters nInstances copies of the nShapes shapes through a cube of half-size fExtent
+// with random rotations and scales between 0.5 and 1.5.  Instance i uses shape
+// i % nShapes and gets that shape index as its attribute.  The same seed always gives
+// the same scene on every platform.
+void    DXUTScatterShapeInstances( const DXUT_SHAPE_DESC* pShapes, unsigned int nShapes, unsigned int nInstances,
+                                   float fExtent, unsigned int nSeed, DXUT_SHAPE_INSTANCE* pInstances );
+
+#endif
@@ -0,0 +1,233 @@
+//--------------------------------------------------------------------------------------
+// File: DXUTTiledTiff.cpp
+//
+// Tiled BigTIFF writer.  See DXUTTiledTiff.h.
+//--------------------------------------------------------------------------------------
+#include "DXUTTiledTiff.h"
+#include "DXUTMappedFile.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// BigTIFF is the TIFF layout with 64 bit offsets and counts; a 30k x 30k float image
+// is past the 4 GB classic TIFF can address
+#define DXUT_TIFF_HEADER_SIZE       16
+#define DXUT_TIFF_ENTRY_SIZE        20
+
+// Field types
+#define DXUT_TIFF_SHORT             3
+#define DXUT_TIFF_LONG              4
+#define DXUT_TIFF_LONG8             16
+
+// Tags, in the ascending order the directory needs
+#define DXUT_TIFF_IMAGE_WIDTH       256
+#define DXUT_TIFF_IMAGE_LENGTH      257
+#define DXUT_TIFF_BITS_PER_SAMPLE   258
+#define DXUT_TIFF_COMPRESSION       259
+#define DXUT_TIFF_PHOTOMETRIC       262
+#define DXUT_TIFF_SAMPLES_PER_PIXEL 277
+#define DXUT_TIFF_PLANAR_CONFIG     284
+#define DXUT_TIFF_TILE_WIDTH        322
+#define DXUT_TIFF_TILE_LENGTH       323
+#define DXUT_TIFF_TILE_OFFSETS      324
+#define DXUT_TIFF_TILE_BYTE_COUNTS  325
+#define DXUT_TIFF_SAMPLE_FORMAT     339
+
+#define DXUT_TIFF_NUM_ENTRIES       12
+
+
+//--------------------------------------------------------------------------------------
+// Helpers
+//--------------------------------------------------------------------------------------
+// Little endian, as the "II" in the header says
+static unsigned char* PutDirectoryEntry( unsigned char* p, unsigned short Tag, unsigned short Type,
+                                         unsigned long long nCount, unsigned long long nValue )
+{
+    memcpy( p, &Tag, 2 );
+    memcpy( p + 2, &Type, 2 );
+    memcpy( p + 4, &nCount, 8 );
+    memset( p + 12, 0, 8 );
+    if( Type == DXUT_TIFF_SHORT && nCount == 1 )
+    {
+        unsigned short Value = ( unsigned short )nValue;
+        memcpy( p + 12, &Value, 2 );
+    }
+    else if( Type == DXUT_TIFF_LONG && nCount == 1 )
+    {
+        unsigned int Value = ( unsigned int )nValue;
+        memcpy( p + 12, &Value, 4 );
+    }
+    else
+    {
+        memcpy( p + 12, &nValue, 8 );
+    }
+    return p + DXUT_TIFF_ENTRY_SIZE;
+}
+
+
+//--------------------------------------------------------------------------------------
+CDXUTTiledTiffWriter::CDXUTTiledTiffWriter() : m_fp( NULL ),
+                                               m_nWidth( 0 ),
+                                               m_nHeight( 0 ),
+                                               m_nTileWidth( 0 ),
+                                               m_nTileHeight( 0 ),
+                                               m_nTilesX( 0 ),
+                                               m_nTilesY( 0 ),
+                                               m_nOffset( 0 ),
+                                               m_bError( false )
+{
+    m_strFileName[0] = 0;
+    m_strTempName[0] = 0;
+}
+
+
+//--------------------------------------------------------------------------------------
+CDXUTTiledTiffWriter::~CDXUTTiledTiffWriter()
+{
+    Abandon();
+}
+
+
+//--------------------------------------------------------------------------------------
+bool CDXUTTiledTiffWriter::Create( const char* szFileName, unsigned int nWidth, unsigned int nHeight,
+                                   unsigned int nTileWidth, unsigned int nTileHeight )
+{
+    Abandon();
+    if( nWidth == 0 || nHeight == 0 || nTileWidth == 0 || nTileHeight == 0 || nTileWidth % 16 != 0 ||
+        nTileHeight % 16 != 0 || strlen( szFileName ) + 5 > sizeof( m_strTempName ) )
+        return false;
+
+    strcpy( m_strFileName, szFileName );
+    strcpy( m_strTempName, szFileName );
+    strcat( m_strTempName, ".tmp" );
+    m_fp = DXUTOpenFile( m_strTempName, "wb" );
+    if( m_fp == NULL )
+        return false;
+
+    m_nWidth = nWidth;
+    m_nHeight = nHeight;
+    m_nTileWidth = nTileWidth;
+    m_nTileHeight = nTileHeight;
+    m_nTilesX = ( nWidth + nTileWidth - 1 ) / nTileWidth;
+    m_nTilesY = ( nHeight + nTileHeight - 1 ) / nTileHeight;
+    m_TileOffsets.assign( ( size_t )m_nTilesX * m_nTilesY, 0 );
+    m_Tile.resize( ( size_t )nTileWidth * nTileHeight );
+    m_nOffset = 0;
+    m_bError = false;
+
+    // The directory offset is filled in by Close
+    unsigned char Header[DXUT_TIFF_HEADER_SIZE] = { 'I', 'I', 43, 0, 8, 0, 0, 0 };
+    return Write( Header, sizeof( Header ) );
+}
+
+
+//--------------------------------------------------------------------------------------
+bool CDXUTTiledTiffWriter::Write( const void* pData, size_t cbSize )
+{
+    if( m_bError || fwrite( pData, 1, cbSize, m_fp ) != cbSize )
+    {
+        m_bError = true;
+        return false;
+    }
+    m_nOffset += cbSize;
+    return true;
+}
+
+
+//--------------------------------------------------------------------------------------
+bool CDXUTTiledTiffWriter::WriteTile( unsigned int iTileX, unsigned int iTileY, const float* pData, size_t nPitch,
+                                      bool bBottomUp )
+{
+    if( m_fp == NULL || iTileX >= m_nTilesX || iTileY >= m_nTilesY )
+        return false;
+
+    for( unsigned int y = 0; y < m_nTileHeight; y++ )
+    {
+        const float* pRow = pData + nPitch * ( bBottomUp ? m_nTileHeight - 1 - y : y );
+        memcpy( &m_Tile[( size_t )y * m_nTileWidth], pRow, m_nTileWidth * sizeof( float ) );
+    }
+
+    m_TileOffsets[( size_t )iTileY * m_nTilesX + iTileX] = m_nOffset;
+    return Write( &m_Tile[0], m_Tile.size() * sizeof( float ) );
+}
+
+
+//--------------------------------------------------------------------------------------
+bool CDXUTTiledTiffWriter::Close()
+{
+    if( m_fp == NULL )
+        return false;
+
+    // The tiles never written all point at one tile of zeros
+    unsigned long long nZeroTile = 0;
+    for( size_t i = 0; i < m_TileOffsets.size(); i++ )
+    {
+        if( m_TileOffsets[i] != 0 )
+            continue;
+        if( nZeroTile == 0 )
+        {
+            nZeroTile = m_nOffset;
+            memset( &m_Tile[0], 0, m_Tile.size() * sizeof( float ) );
+            Write( &m_Tile[0], m_Tile.size() * sizeof( float ) );
+        }
+        m_TileOffsets[i] = nZeroTile;
+    }
+
+    // The directory, then the tile offsets and byte counts it points to.  One tile's
+    // offset and count fit in the entries themselves.
+    size_t nTiles = m_TileOffsets.size();
+    unsigned long long nTileBytes = ( unsigned long long )m_nTileWidth * m_nTileHeight * sizeof( float );
+    unsigned long long nDirectory = m_nOffset;
+    unsigned long long nDirectorySize = 8 + DXUT_TIFF_NUM_ENTRIES * DXUT_TIFF_ENTRY_SIZE + 8;
+    unsigned long long nOffsetsAt = nTiles == 1 ? m_TileOffsets[0] : nDirectory + nDirectorySize;
+    unsigned long long nCountsAt = nTiles == 1 ? nTileBytes : nOffsetsAt + nTiles * 8;
+
+    unsigned char Directory[8 + DXUT_TIFF_NUM_ENTRIES * DXUT_TIFF_ENTRY_SIZE + 8];
+    unsigned long long nEntries = DXUT_TIFF_NUM_ENTRIES, nNext = 0;
+    memcpy( Directory, &nEntries, 8 );
+    unsigned char* p = Directory + 8;
+    p = PutDirectoryEntry( p, DXUT_TIFF_IMAGE_WIDTH, DXUT_TIFF_LONG, 1, m_nWidth );
+    p = PutDirectoryEntry( p, DXUT_TIFF_IMAGE_LENGTH, DXUT_TIFF_LONG, 1, m_nHeight );
+    p = PutDirectoryEntry( p, DXUT_TIFF_BITS_PER_SAMPLE, DXUT_TIFF_SHORT, 1, 32 );
+    p = PutDirectoryEntry( p, DXUT_TIFF_COMPRESSION, DXUT_TIFF_SHORT, 1, 1 );           // None
+    p = PutDirectoryEntry( p, DXUT_TIFF_PHOTOMETRIC, DXUT_TIFF_SHORT, 1, 1 );           // Black is zero
+    p = PutDirectoryEntry( p, DXUT_TIFF_SAMPLES_PER_PIXEL, DXUT_TIFF_SHORT, 1, 1 );
+    p = PutDirectoryEntry( p, DXUT_TIFF_PLANAR_CONFIG, DXUT_TIFF_SHORT, 1, 1 );
+    p = PutDirectoryEntry( p, DXUT_TIFF_TILE_WIDTH, DXUT_TIFF_LONG, 1, m_nTileWidth );
+    p = PutDirectoryEntry( p, DXUT_TIFF_TILE_LENGTH, DXUT_TIFF_LONG, 1, m_nTileHeight );
+    p = PutDirectoryEntry( p, DXUT_TIFF_TILE_OFFSETS, DXUT_TIFF_LONG8, nTiles, nOffsetsAt );
+    p = PutDirectoryEntry( p, DXUT_TIFF_TILE_BYTE_COUNTS, DXUT_TIFF_LONG8, nTiles, nCountsAt );
+    p = PutDirectoryEntry( p, DXUT_TIFF_SAMPLE_FORMAT, DXUT_TIFF_SHORT, 1, 3 );         // IEEE float
+    memcpy( p, &nNext, 8 );
+    Write( Directory, sizeof( Directory ) );
+
+    if( nTiles > 1 )
+    {
+        std::vector<unsigned long long> Counts( nTiles, nTileBytes );
+        Write( &m_TileOffsets[0], nTiles * 8 );
+        Write( &Counts[0], nTiles * 8 );
+    }
+
+    // Only now is there a directory for the header to point to
+    bool bOK = !m_bError && fseek( m_fp, 8, SEEK_SET ) == 0 && fwrite( &nDirectory, 8, 1, m_fp ) == 1;
+    if( fclose( m_fp ) != 0 )
+        bOK = false;
+    m_fp = NULL;
+    if( bOK )
+        bOK = DXUTReplaceFile( m_strTempName, m_strFileName );
+    if( !bOK )
+        DXUTDeleteFile( m_strTempName );
+    return bOK;
+}
+
+
+//--------------------------------------------------------------------------------------
+void CDXUTTiledTiffWriter::Abandon()
+{
+    if( m_fp == NULL )
+        return;
+    fclose( m_fp );
+    m_fp = NULL;
+    DXUTDeleteFile( m_strTempName );
+}
@@ -0,0 +1,73 @@
+//--------------------------------------------------------------------------------------
+// File: DXUTTiledTiff.h
+//
+// Streaming writer for depth images too big to hold in memory, as 32 bit float tiled
+// BigTIFF files.  Tiles are written to the file as they are finished, in any order;
+// only their offsets are kept, and the directory goes at the end when the file is
+// closed.  libtiff 4, GDAL and the GIS tools built on them read the result, and can
+// read any tile without the rest.
+//
+// Tiles are counted from the top left of the image.  TIFF needs their width and height
+// to be multiples of 16, so the tiles along the right and bottom edges usually reach
+// past the image; what is past the edge is stored but isn't part of the image.
+//
+// The file is written under a temporary name and only replaces szFileName when Close
+// succeeds.  Paths are UTF-8.
+//--------------------------------------------------------------------------------------
+#pragma once
+#ifndef DXUT_TILED_TIFF_H
+#define DXUT_TILED_TIFF_H
+
+#include <stddef.h>
+#include <stdio.h>
+#include <vector>
+
+#define DXUT_TIFF_MAX_PATH  260
+
+
+//--------------------------------------------------------------------------------------
+class CDXUTTiledTiffWriter
+{
+public:
+            CDXUTTiledTiffWriter();
+            ~CDXUTTiledTiffWriter();
+
+    bool    Create( const char* szFileName, unsigned int nWidth, unsigned int nHeight, unsigned int nTileWidth,
+                    unsigned int nTileHeight );
+
+    // pData is the tile's rows, nPitch floats apart, top row first, or bottom row first
+    // if bBottomUp (as glReadPixels returns them).  Writing a tile twice keeps the last.
+    bool    WriteTile( unsigned int iTileX, unsigned int iTileY, const float* pData, size_t nPitch,
+                       bool bBottomUp );
+
+    // Writes the directory and renames the file into place.  Tiles never written are
+    // stored as zeros.  Abandon deletes the file instead, as does the destructor if
+    // Close wasn't called.
+    bool    Close();
+    void    Abandon();
+
+    unsigned int GetNumTilesX() const
+    {
+        return m_nTilesX;
+    }
+    unsigned int GetNumTilesY() const
+    {
+        return m_nTilesY;
+    }
+
+private:
+    bool    Write( const void* pData, size_t cbSize );
+
+    FILE*   m_fp;
+    char    m_strFileName[DXUT_TIFF_MAX_PATH];
+    char    m_strTempName[DXUT_TIFF_MAX_PATH];
+    unsigned int m_nWidth, m_nHeight;
+    unsigned int m_nTileWidth, m_nTileHeight;
+    unsigned int m_nTilesX, m_nTilesY;
+    unsigned long long m_nOffset;           // Where the next write goes
+    std::vector<unsigned long long> m_TileOffsets;
+    std::vector<float> m_Tile;              // A tile in file order
+    bool    m_bError;
+};
+
+#endif
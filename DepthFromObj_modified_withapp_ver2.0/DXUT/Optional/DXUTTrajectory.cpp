@@ -0,0 +1,399 @@
+//--------------------------------------------------------------------------------------
+// File: DXUTTrajectory.cpp
+//
+// Camera trajectory files and their interpolation.  See DXUTTrajectory.h.
+//--------------------------------------------------------------------------------------
+#include "DXUTTrajectory.h"
+#include "DXUTMappedFile.h"
+
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define DXUT_TRAJECTORY_MAX_LINE    1024
+#define DXUT_TRAJECTORY_MAX_PATH    260
+#define DXUT_TRAJECTORY_PI          3.14159265358979323846
+
+// Floats after the time on a key line
+#define DXUT_TRAJECTORY_KEY_FLOATS  20
+
+// The float triples that are splined, as offsets into DXUT_CAMERA_KEY
+static const size_t s_Vectors[] =
+{
+    offsetof( DXUT_CAMERA_KEY, vEye ),
+    offsetof( DXUT_CAMERA_KEY, vAt ),
+    offsetof( DXUT_CAMERA_KEY, vUp ),
+    offsetof( DXUT_CAMERA_KEY, vWorldPosition ),
+};
+
+
+//--------------------------------------------------------------------------------------
+// Helpers
+//--------------------------------------------------------------------------------------
+// Copies the next line into strLine without its line break and returns where the line
+// after it starts.  Overlong lines are cut short.
+static const char* ReadLine( const char* pCur, const char* pEnd, char* strLine )
+{
+    const char* pBreak = ( const char* )memchr( pCur, '\n', pEnd - pCur );
+    const char* pLineEnd = pBreak ? pBreak : pEnd;
+
+    size_t cch = pLineEnd - pCur;
+    if( cch > DXUT_TRAJECTORY_MAX_LINE - 1 )
+        cch = DXUT_TRAJECTORY_MAX_LINE - 1;
+    memcpy( strLine, pCur, cch );
+    if( cch && strLine[cch - 1] == '\r' )
+        cch--;
+    strLine[cch] = '\0';
+
+    return pBreak ? pBreak + 1 : pEnd;
+}
+
+static const char* SkipSpace( const char* p )
+{
+    while( *p == ' ' || *p == '\t' )
+        p++;
+    return p;
+}
+
+// Matches the keyword at the start of the line and returns what follows it, or NULL
+static const char* MatchCommand( const char* strLine, const char* strCommand )
+{
+    size_t cch = strlen( strCommand );
+    if( strncmp( strLine, strCommand, cch ) != 0 )
+        return NULL;
+    if( strLine[cch] != ' ' && strLine[cch] != '\t' && strLine[cch] != '\0' )
+        return NULL;
+    return SkipSpace( strLine + cch );
+}
+
+// Returns how many of the nCount floats were read
+static int ReadFloats( const char* p, float* pValues, int nCount )
+{
+    for( int i = 0; i < nCount; i++ )
+    {
+        char* pNext;
+        float f = strtof( p, &pNext );
+        if( pNext == p )
+            return i;
+        pValues[i] = f;
+        p = pNext;
+    }
+    return nCount;
+}
+
+static float Lerp( float a, float b, float s )
+{
+    return a + ( b - a ) * s;
+}
+
+// Cubic Hermite between p1 and p2, h seconds apart, with tangents m1 and m2 per second
+static float Hermite( float p1, float m1, float p2, float m2, float h, float s )
+{
+    float s2 = s * s, s3 = s2 * s;
+    return ( 2.0f * s3 - 3.0f * s2 + 1.0f ) * p1 + ( s3 - 2.0f * s2 + s ) * h * m1 +
+           ( -2.0f * s3 + 3.0f * s2 ) * p2 + ( s3 - s2 ) * h * m2;
+}
+
+static float* KeyVector( DXUT_CAMERA_KEY* pKey, size_t Offset )
+{
+    return ( float* )( ( char* )pKey + Offset );
+}
+
+static const float* KeyVector( const DXUT_CAMERA_KEY* pKey, size_t Offset )
+{
+    return ( const float* )( ( const char* )pKey + Offset );
+}
+
+// Catmull-Rom tangent of component j at key i from its neighbours, one-sided at the ends
+static float Tangent( const DXUT_CAMERA_KEY* pKeys, unsigned int nKeys, unsigned int i, size_t Offset, int j )
+{
+    unsigned int iPrev = i > 0 ? i - 1 : i;
+    unsigned int iNext = i + 1 < nKeys ? i + 1 : i;
+    double h = pKeys[iNext].fTime - pKeys[iPrev].fTime;
+    if( h <= 0.0 )
+        return 0.0f;
+    return ( float )( ( KeyVector( &pKeys[iNext], Offset )[j] - KeyVector( &pKeys[iPrev], Offset )[j] ) / h );
+}
+
+static void NormalizeQuaternion( float* q )
+{
+    float fLength = sqrtf( q[0] * q[0] + q[1] * q[1] + q[2] * q[2] + q[3] * q[3] );
+    if( fLength > 0.0f )
+    {
+        for( int j = 0; j < 4; j++ )
+            q[j] /= fLength;
+    }
+    else
+    {
+        q[0] = q[1] = q[2] = 0.0f;
+        q[3] = 1.0f;
+    }
+}
+
+
+//--------------------------------------------------------------------------------------
+CDXUTTrajectory::CDXUTTrajectory() : m_Interpolation( DXUT_TRAJECTORY_SPLINE )
+{
+}
+
+
+//--------------------------------------------------------------------------------------
+void CDXUTTrajectory::Clear()
+{
+    m_Keys.clear();
+}
+
+
+//--------------------------------------------------------------------------------------
+bool CDXUTTrajectory::AddKey( const DXUT_CAMERA_KEY* pKey )
+{
+    if( !m_Keys.empty() && pKey->fTime < m_Keys.back().fTime )
+        return false;
+
+    // The rotation is stored unit length so playback can rely on it
+    DXUT_CAMERA_KEY Key = *pKey;
+    NormalizeQuaternion( Key.qWorld );
+    m_Keys.push_back( Key );
+    return true;
+}
+
+
+//--------------------------------------------------------------------------------------
+bool CDXUTTrajectory::Load( const char* szFileName )
+{
+    CDXUTMappedFile File;
+#ifdef _WIN32
+    wchar_t wstrFileName[DXUT_FILE_MAX_PATH];
+    if( !DXUTFileNameToWide( szFileName, wstrFileName ) || !File.Open( wstrFileName, DXUT_MAPPED_FILE_SEQUENTIAL ) )
+        return false;
+#else
+    if( !File.Open( szFileName, DXUT_MAPPED_FILE_SEQUENTIAL ) )
+        return false;
+#endif
+    return LoadFromMemory( ( const char* )File.GetData(), File.GetSize() );
+}
+
+
+//--------------------------------------------------------------------------------------
+bool CDXUTTrajectory::LoadFromMemory( const char* pData, size_t cbSize )
+{
+    Clear();
+    m_Interpolation = DXUT_TRAJECTORY_SPLINE;
+
+    char strLine[DXUT_TRAJECTORY_MAX_LINE];
+    const char* pCur = pData;
+    const char* pEnd = pData + cbSize;
+    while( pCur < pEnd )
+    {
+        pCur = ReadLine( pCur, pEnd, strLine );
+        const char* p = SkipSpace( strLine );
+        const char* pArgs;
+
+        if( *p == '#' || *p == '\0' )
+        {
+            continue;
+        }
+        else if( NULL != ( pArgs = MatchCommand( p, "version" ) ) )
+        {
+            if( atoi( pArgs ) > DXUT_TRAJECTORY_VERSION )
+                return false;
+        }
+        else if( NULL != ( pArgs = MatchCommand( p, "interpolation" ) ) )
+        {
+            if( MatchCommand( pArgs, "spline" ) )
+                m_Interpolation = DXUT_TRAJECTORY_SPLINE;
+            else if( MatchCommand( pArgs, "linear" ) )
+                m_Interpolation = DXUT_TRAJECTORY_LINEAR;
+            else
+                return false;
+        }
+        else if( NULL != ( pArgs = MatchCommand( p, "key" ) ) )
+        {
+            DXUT_CAMERA_KEY Key;
+            float v[DXUT_TRAJECTORY_KEY_FLOATS];
+            char* pNext;
+            Key.fTime = strtod( pArgs, &pNext );
+            if( pNext == pArgs || ReadFloats( pNext, v, DXUT_TRAJECTORY_KEY_FLOATS ) != DXUT_TRAJECTORY_KEY_FLOATS )
+                return false;
+
+            memcpy( Key.vEye, v, sizeof( Key.vEye ) );
+            memcpy( Key.vAt, v + 3, sizeof( Key.vAt ) );
+            memcpy( Key.vUp, v + 6, sizeof( Key.vUp ) );
+            memcpy( Key.qWorld, v + 9, sizeof( Key.qWorld ) );
+            memcpy( Key.vWorldPosition, v + 13, sizeof( Key.vWorldPosition ) );
+            Key.fFovY = ( float )( v[16] * DXUT_TRAJECTORY_PI / 180.0 );
+            Key.fAspect = v[17];
+            Key.fNear = v[18];
+            Key.fFar = v[19];
+            if( !AddKey( &Key ) )
+                return false;
+        }
+    }
+
+    return true;
+}
+
+
+//--------------------------------------------------------------------------------------
+bool CDXUTTrajectory::Save( const char* szFileName ) const
+{
+    char strTemp[DXUT_TRAJECTORY_MAX_PATH];
+    if( strlen( szFileName ) + 5 > sizeof( strTemp ) )
+        return false;
+    strcpy( strTemp, szFileName );
+    strcat( strTemp, ".tmp" );
+
+    FILE* fp = DXUTOpenFile( strTemp, "w" );
+    if( fp == NULL )
+        return false;
+
+    fprintf( fp, "# DXUT camera trajectory\n" );
+    fprintf( fp, "version %d\n", DXUT_TRAJECTORY_VERSION );
+    fprintf( fp, "interpolation %s\n", m_Interpolation == DXUT_TRAJECTORY_LINEAR ? "linear" : "spline" );
+    fprintf( fp, "# key time  eye  at  up  world rotation (x y z w)  world position  fovy aspect near far\n" );
+    for( size_t i = 0; i < m_Keys.size(); i++ )
+    {
+        const DXUT_CAMERA_KEY& Key = m_Keys[i];
+        fprintf( fp, "key %.6f  %.9g %.9g %.9g  %.9g %.9g %.9g  %.9g %.9g %.9g  %.9g %.9g %.9g %.9g  "
+                 "%.9g %.9g %.9g  %.9g %.9g %.9g %.9g\n", Key.fTime,
+                 Key.vEye[0], Key.vEye[1], Key.vEye[2], Key.vAt[0], Key.vAt[1], Key.vAt[2],
+                 Key.vUp[0], Key.vUp[1], Key.vUp[2], Key.qWorld[0], Key.qWorld[1], Key.qWorld[2], Key.qWorld[3],
+                 Key.vWorldPosition[0], Key.vWorldPosition[1], Key.vWorldPosition[2],
+                 ( float )( Key.fFovY * 180.0 / DXUT_TRAJECTORY_PI ), Key.fAspect, Key.fNear, Key.fFar );
+    }
+
+    bool bOK = !ferror( fp );
+    if( fclose( fp ) != 0 )
+        bOK = false;
+    if( bOK )
+        bOK = DXUTReplaceFile( strTemp, szFileName );
+    if( !bOK )
+        DXUTDeleteFile( strTemp );
+    return bOK;
+}
+
+
+//--------------------------------------------------------------------------------------
+bool CDXUTTrajectory::Evaluate( double fTime, DXUT_CAMERA_KEY* pPose ) const
+{
+    unsigned int nKeys = GetNumKeys();
+    if( 0 == nKeys )
+        return false;
+
+    const DXUT_CAMERA_KEY* pKeys = &m_Keys[0];
+    if( fTime <= pKeys[0].fTime || 1 == nKeys )
+    {
+        *pPose = pKeys[0];
+        return true;
+    }
+    if( fTime >= pKeys[nKeys - 1].fTime )
+    {
+        *pPose = pKeys[nKeys - 1];
+        return true;
+    }
+
+    // Segment [i, i + 1] containing fTime: the last key at or before it
+    unsigned int iLow = 0, iHigh = nKeys - 1;
+    while( iHigh - iLow > 1 )
+    {
+        unsigned int iMid = ( iLow + iHigh ) / 2;
+        if( pKeys[iMid].fTime <= fTime )
+            iLow = iMid;
+        else
+            iHigh = iMid;
+    }
+    unsigned int i = iLow;
+    const DXUT_CAMERA_KEY* p1 = &pKeys[i];
+    const DXUT_CAMERA_KEY* p2 = &pKeys[i + 1];
+    float h = ( float )( p2->fTime - p1->fTime );
+    float s = ( float )( ( fTime - p1->fTime ) / ( p2->fTime - p1->fTime ) );
+
+    pPose->fTime = fTime;
+    pPose->fFovY = Lerp( p1->fFovY, p2->fFovY, s );
+    pPose->fAspect = Lerp( p1->fAspect, p2->fAspect, s );
+    pPose->fNear = Lerp( p1->fNear, p2->fNear, s );
+    pPose->fFar = Lerp( p1->fFar, p2->fFar, s );
+
+    // Quaternions q and -q are the same rotation; take the neighbours on the same side
+    // as p1 so the interpolation follows the shorter arc
+    float q[4][4];
+    unsigned int iQuat[4] = { i > 0 ? i - 1 : i, i, i + 1, i + 2 < nKeys ? i + 2 : i + 1 };
+    for( int k = 0; k < 4; k++ )
+    {
+        memcpy( q[k], pKeys[iQuat[k]].qWorld, sizeof( q[k] ) );
+        const float* pRef = k < 2 ? q[1] : q[k - 1];
+        if( k != 1 && q[k][0] * pRef[0] + q[k][1] * pRef[1] + q[k][2] * pRef[2] + q[k][3] * pRef[3] < 0.0f )
+        {
+            for( int j = 0; j < 4; j++ )
+                q[k][j] = -q[k][j];
+        }
+    }
+
+    if( m_Interpolation == DXUT_TRAJECTORY_LINEAR )
+    {
+        for( int v = 0; v < 4; v++ )
+        {
+            for( int j = 0; j < 3; j++ )
+                KeyVector( pPose, s_Vectors[v] )[j] = Lerp( KeyVector( p1, s_Vectors[v] )[j],
+                                                            KeyVector( p2, s_Vectors[v] )[j], s );
+        }
+        for( int j = 0; j < 4; j++ )
+            pPose->qWorld[j] = Lerp( q[1][j], q[2][j], s );
+    }
+    else
+    {
+        for( int v = 0; v < 4; v++ )
+        {
+            for( int j = 0; j < 3; j++ )
+            {
+                float m1 = Tangent( pKeys, nKeys, i, s_Vectors[v], j );
+                float m2 = Tangent( pKeys, nKeys, i + 1, s_Vectors[v], j );
+                KeyVector( pPose, s_Vectors[v] )[j] = Hermite( KeyVector( p1, s_Vectors[v] )[j], m1,
+                                                               KeyVector( p2, s_Vectors[v] )[j], m2, h, s );
+            }
+        }
+
+        // Same tangents for the aligned quaternions
+        double t[4] = { pKeys[iQuat[0]].fTime, p1->fTime, p2->fTime, pKeys[iQuat[3]].fTime };
+        for( int j = 0; j < 4; j++ )
+        {
+            float m1 = t[2] > t[0] ? ( float )( ( q[2][j] - q[0][j] ) / ( t[2] - t[0] ) ) : 0.0f;
+            float m2 = t[3] > t[1] ? ( float )( ( q[3][j] - q[1][j] ) / ( t[3] - t[1] ) ) : 0.0f;
+            pPose->qWorld[j] = Hermite( q[1][j], m1, q[2][j], m2, h, s );
+        }
+    }
+
+    NormalizeQuaternion( pPose->qWorld );
+    DXUTVec3Normalize( pPose->vUp, pPose->vUp );
+    return true;
+}
+
+
+//--------------------------------------------------------------------------------------
+unsigned int CDXUTTrajectory::GetNumFrames( double fFrameRate ) const
+{
+    if( m_Keys.empty() || fFrameRate <= 0.0 )
+        return 0;
+
+    // A little slack so a duration that is a whole number of frames keeps its last one
+    return ( unsigned int )( GetDuration() * fFrameRate + 1e-6 ) + 1;
+}
+
+
+//--------------------------------------------------------------------------------------
+void DXUTGetCameraKeyMatrices( const DXUT_CAMERA_KEY* pPose, DXUTMATRIX4* pWorld, DXUTMATRIX4* pView,
+                               DXUTMATRIX4* pProj )
+{
+    if( pWorld )
+    {
+        DXUTMatrixRotationQuaternion( pWorld, pPose->qWorld );
+        pWorld->m[3][0] = pPose->vWorldPosition[0];
+        pWorld->m[3][1] = pPose->vWorldPosition[1];
+        pWorld->m[3][2] = pPose->vWorldPosition[2];
+    }
+    if( pView )
+        DXUTMatrixLookAtLH( pView, pPose->vEye, pPose->vAt, pPose->vUp );
+    if( pProj )
+        DXUTMatrixPerspectiveFovLH( pProj, pPose->fFovY, pPose->fAspect, pPose->fNear, pPose->fFar );
+}
@@ -0,0 +1,128 @@
+//--------------------------------------------------------------------------------------
+// File: DXUTTrajectory.h
+//
+// Timestamped camera poses with their intrinsics, for recording a CModelViewerCamera
+// session and playing it back deterministically.  A pose holds what the viewer feeds
+// its effect: the eye, look-at point and up vector behind the view matrix, the model
+// (world) rotation and translation, and the projection parameters.
+//
+// Trajectories are text files, one key per line, so sparse keys can be written by hand:
+//
+//      # DXUT camera trajectory
+//      version 1
+//      interpolation spline
+//      # key time  eye  at  up  world rotation (x y z w)  world position  fovy aspect near far
+//      key 0  0 0 -3.5  0 0 0  0 1 0  0 0 0 1  0 0 0  92.794 1 0.1 200
+//      key 4  3.5 0 0  0 0 0  0 1 0  0 0 0 1  0 0 0  92.794 1 0.1 200
+//
+// Times are in seconds and must not decrease; fovy is in degrees in the file and in
+// radians in DXUT_CAMERA_KEY.  Lines starting with '#' and unknown keywords are skipped.
+//
+// Between keys the eye, look-at point, up vector and world position follow a
+// Catmull-Rom spline (tangents from the neighbouring keys, scaled by their spacing in
+// time) and the rotation a normalized spline of the quaternions, so a few keys give a
+// smooth dense sequence.  The intrinsics are interpolated linearly so they can't
+// overshoot.  DXUT_TRAJECTORY_LINEAR interpolates everything linearly instead.
+//
+// Paths are UTF-8.
+//--------------------------------------------------------------------------------------
+#pragma once
+#ifndef DXUT_TRAJECTORY_H
+#define DXUT_TRAJECTORY_H
+
+#include <stddef.h>
+#include <vector>
+#include "DXUTMath.h"
+
+#define DXUT_TRAJECTORY_VERSION     1
+
+enum DXUT_TRAJECTORY_INTERPOLATION
+{
+    DXUT_TRAJECTORY_SPLINE,
+    DXUT_TRAJECTORY_LINEAR,
+};
+
+struct DXUT_CAMERA_KEY
+{
+    double  fTime;              // Seconds
+    float   vEye[3];
+    float   vAt[3];
+    float   vUp[3];
+    float   qWorld[4];          // Model rotation, x y z w
+    float   vWorldPosition[3];  // Model translation
+    float   fFovY;              // Vertical field of view in radians
+    float   fAspect;            // Width / height
+    float   fNear;
+    float   fFar;
+};
+
+
+//--------------------------------------------------------------------------------------
+class CDXUTTrajectory
+{
+public:
+            CDXUTTrajectory();
+
+    // Replace the keys held.  The file is left untouched if Save fails.
+    bool    Load( const char* szFileName );
+    bool    LoadFromMemory( const char* pData, size_t cbSize );
+    bool    Save( const char* szFileName ) const;
+
+    void    Clear();
+
+    // Keys must be added in time order; returns false if pKey is earlier than the last
+    bool    AddKey( const DXUT_CAMERA_KEY* pKey );
+
+    unsigned int GetNumKeys() const
+    {
+        return ( unsigned int )m_Keys.size();
+    }
+    const DXUT_CAMERA_KEY* GetKey( unsigned int iKey ) const
+    {
+        return &m_Keys[iKey];
+    }
+    double  GetStartTime() const
+    {
+        return m_Keys.empty() ? 0.0 : m_Keys.front().fTime;
+    }
+    double  GetDuration() const
+    {
+        return m_Keys.empty() ? 0.0 : m_Keys.back().fTime - m_Keys.front().fTime;
+    }
+
+    void    SetInterpolation( DXUT_TRAJECTORY_INTERPOLATION Interpolation )
+    {
+        m_Interpolation = Interpolation;
+    }
+    DXUT_TRAJECTORY_INTERPOLATION GetInterpolation() const
+    {
+        return m_Interpolation;
+    }
+
+    // The pose at fTime, clamped to the first and last keys.  Returns false if there
+    // are no keys.
+    bool    Evaluate( double fTime, DXUT_CAMERA_KEY* pPose ) const;
+
+    // Sampling at a fixed rate from the first key, so every playback of a trajectory
+    // gives the same poses however long each frame takes to render.  The last frame
+    // is at or just before the last key.
+    unsigned int GetNumFrames( double fFrameRate ) const;
+    bool    EvaluateFrame( unsigned int iFrame, double fFrameRate, DXUT_CAMERA_KEY* pPose ) const
+    {
+        return Evaluate( GetStartTime() + iFrame / fFrameRate, pPose );
+    }
+
+private:
+    std::vector<DXUT_CAMERA_KEY> m_Keys;
+    DXUT_TRAJECTORY_INTERPOLATION m_Interpolation;
+};
+
+
+//--------------------------------------------------------------------------------------
+// The viewer's matrices for a pose: left handed with Direct3D's [0, 1] depth, as
+// CModelViewerCamera builds them.  Any output may be NULL.
+//--------------------------------------------------------------------------------------
+void    DXUTGetCameraKeyMatrices( const DXUT_CAMERA_KEY* pPose, DXUTMATRIX4* pWorld, DXUTMATRIX4* pView,
+                                  DXUTMATRIX4* pProj );
+
+#endif
@@ -11,6 +11,10 @@
 #include "DXUT.h"
 #include "SDKMesh.h"
 #include "SDKMisc.h"
+#include "DXUTAdjacency.h"
+#include "DXUTJobSystem.h"
+#include "DXUTMath.h"
+#include <new>
 
 //--------------------------------------------------------------------------------------
 void CDXUTSDKMesh::LoadMaterials( ID3D10Device* pd3dDevice, SDKMESH_MATERIAL* pMaterials, UINT numMaterials,
@@ -324,11 +328,20 @@ HRESULT CDXUTSDKMesh::CreateFromFile( ID3D10Device* pDev10, IDirect3DDevice9* pD
     // Find the path for the file
     V_RETURN( DXUTFindDXSDKMediaFileCch( m_strPathW, sizeof( m_strPathW ) / sizeof( WCHAR ), szFileName ) );
 
+    // Map the file copy-on-write.  CreateFromMemory patches the headers in place (pointer
+    // fixups and the D3D objects it stores in them), so only those pages get copied; the
+    // vertex and index data is only read and stays shared with the page cache.
+    bool bMapped = m_bUseFileMapping &&
+        m_MappedFile.Open( m_strPathW, DXUT_MAPPED_FILE_COPY_ON_WRITE | DXUT_MAPPED_FILE_SEQUENTIAL );
+
     // Open the file
-    m_hFile = CreateFile( m_strPathW, FILE_READ_DATA, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN,
-                          NULL );
-    if( INVALID_HANDLE_VALUE == m_hFile )
-        return DXUTERR_MEDIANOTFOUND;
+    if( !bMapped )
+    {
+        m_hFile = CreateFile( m_strPathW, FILE_READ_DATA, FILE_SHARE_READ, NULL, OPEN_EXISTING,
+                              FILE_FLAG_SEQUENTIAL_SCAN, NULL );
+        if( INVALID_HANDLE_VALUE == m_hFile )
+            return DXUTERR_MEDIANOTFOUND;
+    }
 
     // Change the path to just the directory
     WCHAR* pLastBSlash = wcsrchr( m_strPathW, L'\\' );
@@ -339,6 +352,41 @@ HRESULT CDXUTSDKMesh::CreateFromFile( ID3D10Device* pDev10, IDirect3DDevice9* pD
 
     WideCharToMultiByte( CP_ACP, 0, m_strPathW, -1, m_strPath, MAX_PATH, NULL, FALSE );
 
+    if( bMapped )
+    {
+        BYTE* pData = m_MappedFile.GetData();
+        UINT cBytes = ( UINT )m_MappedFile.GetSize();
+
+        // The buffer data is about to be streamed into vertex and index buffers, so start
+        // paging it in while the headers are processed
+        if( cBytes >= sizeof( SDKMESH_HEADER ) )
+        {
+            SDKMESH_HEADER* pHeader = ( SDKMESH_HEADER* )pData;
+            UINT64 BufferDataStart = pHeader->HeaderSize + pHeader->NonBufferDataSize;
+            if( BufferDataStart < cBytes )
+                m_MappedFile.Advise( ( size_t )BufferDataStart, ( size_t )( cBytes - BufferDataStart ),
+                                     DXUT_MAPPED_FILE_WILLNEED );
+        }
+
+        hr = CreateFromMemory( pDev10,
+                               pDev9,
+                               pData,
+                               cBytes,
+                               bCreateAdjacencyIndices,
+                               false,
+                               pLoaderCallbacks10, pLoaderCallbacks9 );
+
+        // The mapping owns the data, it must not be deleted
+        m_pHeapData = NULL;
+        if( FAILED( hr ) )
+        {
+            m_MappedFile.Close();
+            m_pStaticMeshData = NULL;
+        }
+
+        return hr;
+    }
+
     // Get the file size
     LARGE_INTEGER FileSize;
     GetFileSizeEx( m_hFile, &FileSize );
@@ -493,6 +541,20 @@ HRESULT CDXUTSDKMesh::CreateFromMemory( ID3D10Device* pDev10,
     if( !m_pTransformedFrameMatrices )
         goto Error;
 
+    // Inverse bind pose, cached by TransformBindPose.  Both start as the identity so a
+    // mesh animated without a bind pose transform is not fed garbage.
+    m_pInvBindPoseFrameMatrices = new D3DXMATRIX[ m_pMeshHeader->NumFrames ];
+    if( !m_pInvBindPoseFrameMatrices )
+        goto Error;
+    for( UINT i = 0; i < m_pMeshHeader->NumFrames; i++ )
+    {
+        D3DXMatrixIdentity( &m_pBindPoseFrameMatrices[i] );
+        D3DXMatrixIdentity( &m_pInvBindPoseFrameMatrices[i] );
+    }
+
+    if( FAILED( hr = BuildFrameOrder() ) )
+        goto Error;
+
     hr = S_OK;
 
     SDKMESH_SUBSET* pSubset = NULL;
@@ -598,81 +660,168 @@ Error:
 }
 
 //--------------------------------------------------------------------------------------
-// transform bind pose frame using a recursive traversal
+// pOut = pA * pB.  D3DXMATRIX and DXUTMATRIX4 share a layout, so this uses the SIMD
+// multiply from DXUTMath.h.  pOut may alias either input.
 //--------------------------------------------------------------------------------------
-void CDXUTSDKMesh::TransformBindPoseFrame( UINT iFrame, D3DXMATRIX* pParentWorld )
+static inline void SDKMeshMatrixMultiply( D3DXMATRIX* pOut, const D3DXMATRIX* pA, const D3DXMATRIX* pB )
 {
-    if( !m_pBindPoseFrameMatrices )
-        return;
+    DXUTMatrixMultiply( ( DXUTMATRIX4* )pOut, ( const DXUTMATRIX4* )pA, ( const DXUTMATRIX4* )pB );
+}
 
-    // Transform ourselves
-    D3DXMATRIX LocalWorld;
-    D3DXMatrixMultiply( &LocalWorld, &m_pFrameArray[iFrame].Matrix, pParentWorld );
-    m_pBindPoseFrameMatrices[iFrame] = LocalWorld;
+//--------------------------------------------------------------------------------------
+// Spherical interpolation between two unit quaternions along the shorter arc
+//--------------------------------------------------------------------------------------
+static void SDKMeshQuaternionSlerp( D3DXQUATERNION* pOut, const D3DXQUATERNION* pQ0, const D3DXQUATERNION* pQ1,
+                                    float t )
+{
+    float fCos = pQ0->x * pQ1->x + pQ0->y * pQ1->y + pQ0->z * pQ1->z + pQ0->w * pQ1->w;
+    float fSign = 1.0f;
+    if( fCos < 0.0f )
+    {
+        fCos = -fCos;
+        fSign = -1.0f;
+    }
 
-    // Transform our siblings
-    if( m_pFrameArray[iFrame].SiblingFrame != INVALID_FRAME )
-        TransformBindPoseFrame( m_pFrameArray[iFrame].SiblingFrame, pParentWorld );
+    float w0, w1;
+    if( fCos > 0.9995f )
+    {
+        // Nearly parallel; sin() underflows, so fall back to a normalized lerp
+        w0 = 1.0f - t;
+        w1 = t;
+    }
+    else
+    {
+        float fAngle = acosf( fCos );
+        float fInvSin = 1.0f / sinf( fAngle );
+        w0 = sinf( ( 1.0f - t ) * fAngle ) * fInvSin;
+        w1 = sinf( t * fAngle ) * fInvSin;
+    }
+    w1 *= fSign;
 
-    // Transform our children
-    if( m_pFrameArray[iFrame].ChildFrame != INVALID_FRAME )
-        TransformBindPoseFrame( m_pFrameArray[iFrame].ChildFrame, &LocalWorld );
+    D3DXQUATERNION quat( pQ0->x * w0 + pQ1->x * w1,
+                         pQ0->y * w0 + pQ1->y * w1,
+                         pQ0->z * w0 + pQ1->z * w1,
+                         pQ0->w * w0 + pQ1->w * w1 );
+    D3DXQuaternionNormalize( pOut, &quat );
 }
 
 //--------------------------------------------------------------------------------------
-// transform frame using a recursive traversal
+// Blend the translation and orientation of two animation keys.  An all-zero orientation
+// is treated as the identity.
 //--------------------------------------------------------------------------------------
-void CDXUTSDKMesh::TransformFrame( UINT iFrame, D3DXMATRIX* pParentWorld, double fTime )
+static inline void SDKMeshGetKeyOrientation( const SDKANIMATION_DATA* pData, D3DXQUATERNION* pQuat )
 {
-    // Get the tick data
-    D3DXMATRIX LocalTransform;
-    UINT iTick = GetAnimationKeyFromTime( fTime );
+    pQuat->x = pData->Orientation.x;
+    pQuat->y = pData->Orientation.y;
+    pQuat->z = pData->Orientation.z;
+    pQuat->w = pData->Orientation.w;
+    if( pQuat->w == 0 && pQuat->x == 0 && pQuat->y == 0 && pQuat->z == 0 )
+        D3DXQuaternionIdentity( pQuat );
+    D3DXQuaternionNormalize( pQuat, pQuat );
+}
 
-    if( INVALID_ANIMATION_DATA != m_pFrameArray[iFrame].AnimationDataIndex )
+static void SDKMeshInterpolateKeys( const SDKANIMATION_DATA* pData0, const SDKANIMATION_DATA* pData1, float fBlend,
+                                    D3DXVECTOR3* pTranslation, D3DXQUATERNION* pOrientation )
+{
+    SDKMeshGetKeyOrientation( pData0, pOrientation );
+    *pTranslation = pData0->Translation;
+
+    if( fBlend > 0.0f && pData0 != pData1 )
     {
-        SDKANIMATION_FRAME_DATA* pFrameData = &m_pAnimationFrameData[ m_pFrameArray[iFrame].AnimationDataIndex ];
-        SDKANIMATION_DATA* pData = &pFrameData->pAnimationData[ iTick ];
-
-        // turn it into a matrix (Ignore scaling for now)
-        D3DXVECTOR3 parentPos = pData->Translation;
-        D3DXMATRIX mTranslate;
-        D3DXMatrixTranslation( &mTranslate, parentPos.x, parentPos.y, parentPos.z );
-
-        D3DXQUATERNION quat;
-        D3DXMATRIX mQuat;
-        quat.w = pData->Orientation.w;
-        quat.x = pData->Orientation.x;
-        quat.y = pData->Orientation.y;
-        quat.z = pData->Orientation.z;
-        if( quat.w == 0 && quat.x == 0 && quat.y == 0 && quat.z == 0 )
-            D3DXQuaternionIdentity( &quat );
-        D3DXQuaternionNormalize( &quat, &quat );
-        D3DXMatrixRotationQuaternion( &mQuat, &quat );
-        LocalTransform = ( mQuat * mTranslate );
+        D3DXQUATERNION quat1;
+        SDKMeshGetKeyOrientation( pData1, &quat1 );
+        SDKMeshQuaternionSlerp( pOrientation, pOrientation, &quat1, fBlend );
+        D3DXVec3Lerp( pTranslation, &pData0->Translation, &pData1->Translation, fBlend );
     }
-    else
+}
+
+//--------------------------------------------------------------------------------------
+// Flatten the frame hierarchy so that every frame comes after its parent
+//--------------------------------------------------------------------------------------
+#define SDKMESH_UNVISITED_FRAME ((UINT)-2)
+
+HRESULT CDXUTSDKMesh::BuildFrameOrder()
+{
+    UINT NumFrames = m_pMeshHeader->NumFrames;
+    m_NumOrderedFrames = 0;
+    if( 0 == NumFrames )
+        return S_OK;
+
+    m_pFrameOrder = new( std::nothrow ) UINT[ NumFrames ];
+    m_pFrameParents = new( std::nothrow ) UINT[ NumFrames ];
+    UINT* pStack = new( std::nothrow ) UINT[ NumFrames ];
+    if( !m_pFrameOrder || !m_pFrameParents || !pStack )
     {
-        LocalTransform = m_pFrameArray[iFrame].Matrix;
+        SAFE_DELETE_ARRAY( pStack );
+        return E_OUTOFMEMORY;
     }
 
-    // Transform ourselves
-    D3DXMATRIX LocalWorld;
-    D3DXMatrixMultiply( &LocalWorld, &LocalTransform, pParentWorld );
-    m_pTransformedFrameMatrices[iFrame] = LocalWorld;
+    for( UINT i = 0; i < NumFrames; i++ )
+        m_pFrameParents[i] = SDKMESH_UNVISITED_FRAME;
 
-    // Transform our siblings
-    if( m_pFrameArray[iFrame].SiblingFrame != INVALID_FRAME )
-        TransformFrame( m_pFrameArray[iFrame].SiblingFrame, pParentWorld, fTime );
+    // Depth first walk with an explicit stack.  A frame's parent is recorded when it is
+    // pushed, and a frame that is already recorded is never pushed again, so a damaged
+    // file with a cycle in its links cannot overflow the stack.
+    UINT StackSize = 0;
+    pStack[StackSize++] = 0;
+    m_pFrameParents[0] = INVALID_FRAME;
 
-    // Transform our children
-    if( m_pFrameArray[iFrame].ChildFrame != INVALID_FRAME )
-        TransformFrame( m_pFrameArray[iFrame].ChildFrame, &LocalWorld, fTime );
+    while( StackSize > 0 )
+    {
+        UINT iFrame = pStack[--StackSize];
+        m_pFrameOrder[m_NumOrderedFrames++] = iFrame;
+
+        UINT iSibling = m_pFrameArray[iFrame].SiblingFrame;
+        if( iSibling < NumFrames && SDKMESH_UNVISITED_FRAME == m_pFrameParents[iSibling] )
+        {
+            m_pFrameParents[iSibling] = m_pFrameParents[iFrame];
+            pStack[StackSize++] = iSibling;
+        }
+
+        UINT iChild = m_pFrameArray[iFrame].ChildFrame;
+        if( iChild < NumFrames && SDKMESH_UNVISITED_FRAME == m_pFrameParents[iChild] )
+        {
+            m_pFrameParents[iChild] = iFrame;
+            pStack[StackSize++] = iChild;
+        }
+    }
+
+    SAFE_DELETE_ARRAY( pStack );
+    return S_OK;
+}
+
+//--------------------------------------------------------------------------------------
+// local transform of a frame: its animation blended between two keys, or its bind pose
+// matrix if it is not animated
+//--------------------------------------------------------------------------------------
+void CDXUTSDKMesh::GetAnimationLocalTransform( UINT iFrame, UINT iKey0, UINT iKey1, float fBlend,
+                                               D3DXMATRIX* pLocal )
+{
+    if( INVALID_ANIMATION_DATA == m_pFrameArray[iFrame].AnimationDataIndex )
+    {
+        *pLocal = m_pFrameArray[iFrame].Matrix;
+        return;
+    }
+
+    SDKANIMATION_FRAME_DATA* pFrameData = &m_pAnimationFrameData[ m_pFrameArray[iFrame].AnimationDataIndex ];
+    D3DXVECTOR3 vTranslation;
+    D3DXQUATERNION quat;
+    SDKMeshInterpolateKeys( &pFrameData->pAnimationData[ iKey0 ], &pFrameData->pAnimationData[ iKey1 ], fBlend,
+                            &vTranslation, &quat );
+
+    // turn it into a matrix (Ignore scaling for now).  This is the rotation followed by
+    // the translation, so the translation goes straight into the last row.
+    D3DXMatrixRotationQuaternion( pLocal, &quat );
+    pLocal->_41 = vTranslation.x;
+    pLocal->_42 = vTranslation.y;
+    pLocal->_43 = vTranslation.z;
 }
 
 //--------------------------------------------------------------------------------------
 // transform frame assuming that it is an absolute transformation
 //--------------------------------------------------------------------------------------
-void CDXUTSDKMesh::TransformFrameAbsolute( UINT iFrame, double fTime )
+void CDXUTSDKMesh::TransformFrameAbsolute( UINT iFrame, UINT iKey0, UINT iKey1, float fBlend,
+                                           D3DXMATRIX* pFrameMatrices )
 {
     D3DXMATRIX mTrans1;
     D3DXMATRIX mTrans2;
@@ -680,24 +829,18 @@ void CDXUTSDKMesh::TransformFrameAbsolute( UINT iFrame, double fTime )
     D3DXMATRIX mRot2;
     D3DXQUATERNION quat1;
     D3DXQUATERNION quat2;
-    D3DXMATRIX mTo;
+    D3DXVECTOR3 vTrans2;
     D3DXMATRIX mInvTo;
     D3DXMATRIX mFrom;
 
-    UINT iTick = GetAnimationKeyFromTime( fTime );
-
     if( INVALID_ANIMATION_DATA != m_pFrameArray[iFrame].AnimationDataIndex )
     {
         SDKANIMATION_FRAME_DATA* pFrameData = &m_pAnimationFrameData[ m_pFrameArray[iFrame].AnimationDataIndex ];
-        SDKANIMATION_DATA* pData = &pFrameData->pAnimationData[ iTick ];
         SDKANIMATION_DATA* pDataOrig = &pFrameData->pAnimationData[ 0 ];
 
         D3DXMatrixTranslation( &mTrans1, -pDataOrig->Translation.x,
                                -pDataOrig->Translation.y,
                                -pDataOrig->Translation.z );
-        D3DXMatrixTranslation( &mTrans2, pData->Translation.x,
-                               pData->Translation.y,
-                               pData->Translation.z );
 
         quat1.x = pDataOrig->Orientation.x;
         quat1.y = pDataOrig->Orientation.y;
@@ -705,17 +848,58 @@ void CDXUTSDKMesh::TransformFrameAbsolute( UINT iFrame, double fTime )
         quat1.w = pDataOrig->Orientation.w;
         D3DXQuaternionInverse( &quat1, &quat1 );
         D3DXMatrixRotationQuaternion( &mRot1, &quat1 );
-        mInvTo = mTrans1 * mRot1;
+        SDKMeshMatrixMultiply( &mInvTo, &mTrans1, &mRot1 );
 
-        quat2.x = pData->Orientation.x;
-        quat2.y = pData->Orientation.y;
-        quat2.z = pData->Orientation.z;
-        quat2.w = pData->Orientation.w;
+        SDKMeshInterpolateKeys( &pFrameData->pAnimationData[ iKey0 ], &pFrameData->pAnimationData[ iKey1 ], fBlend,
+                                &vTrans2, &quat2 );
+        D3DXMatrixTranslation( &mTrans2, vTrans2.x, vTrans2.y, vTrans2.z );
         D3DXMatrixRotationQuaternion( &mRot2, &quat2 );
-        mFrom = mRot2 * mTrans2;
+        SDKMeshMatrixMultiply( &mFrom, &mRot2, &mTrans2 );
+
+        SDKMeshMatrixMultiply( &pFrameMatrices[iFrame], &mInvTo, &mFrom );
+    }
+}
+
+//--------------------------------------------------------------------------------------
+// evaluate every frame at time fTime into pFrameMatrices.  Only reads the mesh, so
+// several times can be evaluated at once into different arrays.
+//--------------------------------------------------------------------------------------
+void CDXUTSDKMesh::EvaluateFrames( const D3DXMATRIX* pWorld, double fTime, D3DXMATRIX* pFrameMatrices )
+{
+    UINT iKey0;
+    UINT iKey1;
+    float fBlend;
+    GetAnimationKeysFromTime( fTime, &iKey0, &iKey1, &fBlend );
+    if( !m_bInterpolateAnimation )
+    {
+        iKey1 = iKey0;
+        fBlend = 0.0f;
+    }
 
-        D3DXMATRIX mOutput = mInvTo * mFrom;
-        m_pTransformedFrameMatrices[iFrame] = mOutput;
+    if( FTT_RELATIVE == m_pAnimationHeader->FrameTransformType )
+    {
+        // Parents come before their children in the frame order, so every parent's world
+        // matrix is final by the time its children read it
+        for( UINT i = 0; i < m_NumOrderedFrames; i++ )
+        {
+            UINT iFrame = m_pFrameOrder[i];
+            UINT iParent = m_pFrameParents[iFrame];
+
+            D3DXMATRIX LocalTransform;
+            GetAnimationLocalTransform( iFrame, iKey0, iKey1, fBlend, &LocalTransform );
+            SDKMeshMatrixMultiply( &pFrameMatrices[iFrame], &LocalTransform,
+                                   INVALID_FRAME == iParent ? pWorld : &pFrameMatrices[iParent] );
+        }
+
+        // For each frame, move the transform to the bind pose, then
+        // move it to the final position
+        for( UINT i = 0; i < m_pMeshHeader->NumFrames; i++ )
+            SDKMeshMatrixMultiply( &pFrameMatrices[i], &m_pInvBindPoseFrameMatrices[i], &pFrameMatrices[i] );
+    }
+    else if( FTT_ABSOLUTE == m_pAnimationHeader->FrameTransformType )
+    {
+        for( UINT i = 0; i < m_pAnimationHeader->NumFrames; i++ )
+            TransformFrameAbsolute( i, iKey0, iKey1, fBlend, pFrameMatrices );
     }
 }
 
@@ -1123,7 +1307,7 @@ void CDXUTSDKMesh::RenderFrame( UINT iFrame,
 CDXUTSDKMesh::CDXUTSDKMesh() : m_NumOutstandingResources( 0 ),
                                m_bLoading( false ),
                                m_hFile( 0 ),
-                               m_hFileMappingObject( 0 ),
+                               m_bUseFileMapping( true ),
                                m_pMeshHeader( NULL ),
                                m_pStaticMeshData( NULL ),
                                m_pHeapData( NULL ),
@@ -1132,7 +1316,12 @@ CDXUTSDKMesh::CDXUTSDKMesh() : m_NumOutstandingResources( 0 ),
                                m_ppVertices( NULL ),
                                m_ppIndices( NULL ),
                                m_pBindPoseFrameMatrices( NULL ),
+                               m_pInvBindPoseFrameMatrices( NULL ),
                                m_pTransformedFrameMatrices( NULL ),
+                               m_bInterpolateAnimation( true ),
+                               m_pFrameOrder( NULL ),
+                               m_pFrameParents( NULL ),
+                               m_NumOrderedFrames( 0 ),
                                m_pDev9( NULL ),
                                m_pDev10( NULL )
 {
@@ -1312,10 +1501,15 @@ void CDXUTSDKMesh::Destroy()
     SAFE_DELETE_ARRAY( m_pAdjacencyIndexBufferArray );
 
     SAFE_DELETE_ARRAY( m_pHeapData );
+    m_MappedFile.Close();
     m_pStaticMeshData = NULL;
     SAFE_DELETE_ARRAY( m_pAnimationData );
     SAFE_DELETE_ARRAY( m_pBindPoseFrameMatrices );
+    SAFE_DELETE_ARRAY( m_pInvBindPoseFrameMatrices );
     SAFE_DELETE_ARRAY( m_pTransformedFrameMatrices );
+    SAFE_DELETE_ARRAY( m_pFrameOrder );
+    SAFE_DELETE_ARRAY( m_pFrameParents );
+    m_NumOrderedFrames = 0;
 
     SAFE_DELETE_ARRAY( m_ppVertices );
     SAFE_DELETE_ARRAY( m_ppIndices );
@@ -1338,7 +1532,21 @@ void CDXUTSDKMesh::Destroy()
 //--------------------------------------------------------------------------------------
 void CDXUTSDKMesh::TransformBindPose( D3DXMATRIX* pWorld )
 {
-    TransformBindPoseFrame( 0, pWorld );
+    if( !m_pBindPoseFrameMatrices )
+        return;
+
+    for( UINT i = 0; i < m_NumOrderedFrames; i++ )
+    {
+        UINT iFrame = m_pFrameOrder[i];
+        UINT iParent = m_pFrameParents[iFrame];
+        SDKMeshMatrixMultiply( &m_pBindPoseFrameMatrices[iFrame], &m_pFrameArray[iFrame].Matrix,
+                               INVALID_FRAME == iParent ? pWorld : &m_pBindPoseFrameMatrices[iParent] );
+    }
+
+    // Every animated pose is moved out of the bind pose, so invert it once here rather
+    // than for every frame of every TransformMesh
+    for( UINT i = 0; i < m_pMeshHeader->NumFrames; i++ )
+        D3DXMatrixInverse( &m_pInvBindPoseFrameMatrices[i], NULL, &m_pBindPoseFrameMatrices[i] );
 }
 
 //--------------------------------------------------------------------------------------
@@ -1349,28 +1557,72 @@ void CDXUTSDKMesh::TransformMesh( D3DXMATRIX* pWorld, double fTime )
     if( !m_pAnimationHeader )
         return;
 
-    if( FTT_RELATIVE == m_pAnimationHeader->FrameTransformType )
-    {
-        TransformFrame( 0, pWorld, fTime );
+    EvaluateFrames( pWorld, fTime, m_pTransformedFrameMatrices );
+}
 
-        // For each frame, move the transform to the bind pose, then
-        // move it to the final position
-        D3DXMATRIX mInvBindPose;
-        D3DXMATRIX mFinal;
-        for( UINT i = 0; i < m_pMeshHeader->NumFrames; i++ )
+//--------------------------------------------------------------------------------------
+// transform the mesh frames for many times at once, one block of frame matrices per time
+//--------------------------------------------------------------------------------------
+HRESULT CDXUTSDKMesh::TransformMeshBatch( const D3DXMATRIX* pWorld, const double* pTimes, UINT NumTimes,
+                                          D3DXMATRIX* pFrameMatrices )
+{
+    if( !m_pAnimationHeader || !m_pMeshHeader )
+        return E_FAIL;
+
+    UINT NumFrames = m_pMeshHeader->NumFrames;
+    DXUTGetJobSystem()->ParallelFor( 0, NumTimes, 1, [&]( UINT iBegin, UINT iEnd )
+    {
+        for( UINT i = iBegin; i < iEnd; i++ )
         {
-            D3DXMatrixInverse( &mInvBindPose, NULL, &m_pBindPoseFrameMatrices[i] );
-            mFinal = mInvBindPose * m_pTransformedFrameMatrices[i];
-            m_pTransformedFrameMatrices[i] = mFinal;
+            // Frames the animation does not reach are left as the identity
+            D3DXMATRIX* pBlock = &pFrameMatrices[ ( size_t )i * NumFrames ];
+            for( UINT iFrame = 0; iFrame < NumFrames; iFrame++ )
+                D3DXMatrixIdentity( &pBlock[iFrame] );
+
+            EvaluateFrames( pWorld, pTimes[i], pBlock );
         }
-    }
-    else if( FTT_ABSOLUTE == m_pAnimationHeader->FrameTransformType )
+    } );
+
+    return S_OK;
+}
+
+//--------------------------------------------------------------------------------------
+// Adjacency for one mesh, generated on the CPU by a job
+//--------------------------------------------------------------------------------------
+struct SDKMESH_ADJACENCY_JOB
+{
+    const BYTE* pVertices;
+    UINT Stride;
+    UINT NumVertices;
+    const BYTE* pIndices;
+    UINT NumIndices;
+    bool b32BitIndices;
+    float fEpsilon;
+    BYTE* pAdjIndices;
+    bool bSucceeded;
+};
+
+static void GenerateMeshAdjacency( UINT iBegin, UINT iEnd, void* pUserContext )
+{
+    SDKMESH_ADJACENCY_JOB* pJobs = ( SDKMESH_ADJACENCY_JOB* )pUserContext;
+    for( UINT i = iBegin; i < iEnd; i++ )
     {
-        for( UINT i = 0; i < m_pAnimationHeader->NumFrames; i++ )
-            TransformFrameAbsolute( i, fTime );
+        SDKMESH_ADJACENCY_JOB* pJob = &pJobs[i];
+        pJob->bSucceeded = false;
+
+        UINT* pPointReps = new( std::nothrow ) UINT[ pJob->NumVertices ];
+        if( !pPointReps )
+            continue;
+
+        if( DXUTGeneratePointReps( pJob->pVertices, pJob->Stride, pJob->NumVertices, pJob->fEpsilon, pPointReps ) )
+            pJob->bSucceeded = DXUTGenerateGSAdjacency( pJob->pIndices, pJob->b32BitIndices, pJob->NumIndices,
+                                                        pPointReps, pJob->NumVertices, pJob->pAdjIndices );
+
+        delete []pPointReps;
     }
 }
 
+
 //--------------------------------------------------------------------------------------
 // Generate an adjacency index buffer for each mesh
 //--------------------------------------------------------------------------------------
@@ -1379,90 +1631,86 @@ HRESULT CDXUTSDKMesh::CreateAdjacencyIndices( ID3D10Device* pd3dDevice, float fE
     HRESULT hr = S_OK;
     UINT IBIndex = 0;
     UINT VBIndex = 0;
+    UINT NumMeshes = m_pMeshHeader->NumMeshes;
 
     m_pAdjacencyIndexBufferArray = new SDKMESH_INDEX_BUFFER_HEADER[ m_pMeshHeader->NumIndexBuffers ];
     if( !m_pAdjacencyIndexBufferArray )
         return E_OUTOFMEMORY;
+    ZeroMemory( m_pAdjacencyIndexBufferArray, sizeof( SDKMESH_INDEX_BUFFER_HEADER ) * m_pMeshHeader->NumIndexBuffers );
 
-    for( UINT i = 0; i < m_pMeshHeader->NumMeshes; i++ )
+    SDKMESH_ADJACENCY_JOB* pJobs = new SDKMESH_ADJACENCY_JOB[ NumMeshes ];
+    if( !pJobs )
+        return E_OUTOFMEMORY;
+    ZeroMemory( pJobs, sizeof( SDKMESH_ADJACENCY_JOB ) * NumMeshes );
+
+    for( UINT i = 0; i < NumMeshes; i++ )
     {
         VBIndex = m_pMeshArray[i].VertexBuffers[0];
         IBIndex = m_pMeshArray[i].IndexBuffer;
 
-        BYTE* pVertices = ( BYTE* )( pBufferData + m_pVertexBufferArray[VBIndex].DataOffset );
-        BYTE* pIndices = ( BYTE* )( pBufferData + m_pIndexBufferArray[IBIndex].DataOffset );
+        SDKMESH_ADJACENCY_JOB* pJob = &pJobs[i];
+        pJob->pVertices = ( BYTE* )( pBufferData + m_pVertexBufferArray[VBIndex].DataOffset );
+        pJob->Stride = ( UINT )m_pVertexBufferArray[VBIndex].StrideBytes;
+        pJob->NumVertices = ( UINT )GetNumVertices( i, 0 );
+        pJob->pIndices = ( BYTE* )( pBufferData + m_pIndexBufferArray[IBIndex].DataOffset );
+        pJob->NumIndices = ( UINT )GetNumIndices( i );
+        pJob->b32BitIndices = ( m_pIndexBufferArray[IBIndex].IndexType == IT_32BIT );
+        pJob->fEpsilon = fEpsilon;
+
+        // Two indices per original index: each corner plus the vertex across its edge
+        pJob->pAdjIndices = new BYTE[ ( SIZE_T )( m_pIndexBufferArray[IBIndex].SizeBytes * 2 ) ];
+        if( !pJob->pAdjIndices )
+        {
+            hr = E_OUTOFMEMORY;
+            goto Cleanup;
+        }
+    }
 
-        UINT stride = ( UINT )m_pVertexBufferArray[VBIndex].StrideBytes;
+    // Meshes are independent, and each one splits its own work into chunks as well
+    DXUTGetJobSystem()->ParallelFor( 0, NumMeshes, 1, GenerateMeshAdjacency, pJobs );
 
-        D3D10_INPUT_ELEMENT_DESC layout[2] =
-            {
-                { "POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 0, D3D10_INPUT_PER_VERTEX_DATA, 0 },
-                { "END", 0, DXGI_FORMAT_R8_UINT, 0, 0, D3D10_INPUT_PER_VERTEX_DATA, 0 },
-            };
-
-        layout[1].AlignedByteOffset = stride - 1;
-
-        // create the mesh 
-        UINT NumVertices = ( UINT )GetNumVertices( i, 0 );
-        UINT NumIndices = ( UINT )GetNumIndices( i );
-        UINT Options = 0;
-        ID3DX10Mesh* pMesh = NULL;
-
-        if( DXGI_FORMAT_R32_UINT == GetIBFormat10( i ) )
-            Options |= D3DX10_MESH_32_BIT;
-        V_RETURN( D3DX10CreateMesh( pd3dDevice,
-                                    layout,
-                                    2,
-                                    layout[0].SemanticName,
-                                    NumVertices,
-                                    NumIndices / 3,
-                                    Options,
-                                    &pMesh ) );
-
-        //set the VB
-        pMesh->SetVertexData( 0, ( void* )pVertices );
-
-        //set the IB
-        pMesh->SetIndexData( ( void* )pIndices, NumIndices );
-
-        //generate adjacency
-        pMesh->GenerateAdjacencyAndPointReps( fEpsilon );
-
-        //generate adjacency indices
-        pMesh->GenerateGSAdjacency();
-
-        //get the adjacency data out of the mesh
-        ID3DX10MeshBuffer* pIndexBuffer = NULL;
-        BYTE* pAdjIndices = NULL;
-        SIZE_T Size = 0;
-        V_RETURN( pMesh->GetIndexBuffer( &pIndexBuffer ) );
-        V_RETURN( pIndexBuffer->Map( ( void** )&pAdjIndices, &Size ) );
+    for( UINT i = 0; i < NumMeshes; i++ )
+    {
+        if( !pJobs[i].bSucceeded )
+        {
+            hr = E_OUTOFMEMORY;
+            goto Cleanup;
+        }
+
+        IBIndex = m_pMeshArray[i].IndexBuffer;
 
         //Copy info about the original IB with a few modifications
+        SAFE_RELEASE( m_pAdjacencyIndexBufferArray[IBIndex].pIB10 );
         m_pAdjacencyIndexBufferArray[IBIndex] = m_pIndexBufferArray[IBIndex];
         m_pAdjacencyIndexBufferArray[IBIndex].SizeBytes *= 2;
+        m_pAdjacencyIndexBufferArray[IBIndex].pIB10 = NULL;
 
         //create a new adjacency IB
         D3D10_BUFFER_DESC bufferDesc;
-        bufferDesc.ByteWidth = ( UINT )( Size );
+        bufferDesc.ByteWidth = ( UINT )( m_pAdjacencyIndexBufferArray[IBIndex].SizeBytes );
         bufferDesc.Usage = D3D10_USAGE_IMMUTABLE;
         bufferDesc.BindFlags = D3D10_BIND_INDEX_BUFFER;
         bufferDesc.CPUAccessFlags = 0;
         bufferDesc.MiscFlags = 0;
 
         D3D10_SUBRESOURCE_DATA InitData;
-        InitData.pSysMem = pAdjIndices;
-        V_RETURN( pd3dDevice->CreateBuffer( &bufferDesc, &InitData, &m_pAdjacencyIndexBufferArray[IBIndex].pIB10 ) );
+        InitData.pSysMem = pJobs[i].pAdjIndices;
+        InitData.SysMemPitch = 0;
+        InitData.SysMemSlicePitch = 0;
+        hr = pd3dDevice->CreateBuffer( &bufferDesc, &InitData, &m_pAdjacencyIndexBufferArray[IBIndex].pIB10 );
+        if( FAILED( hr ) )
+        {
+            DXUT_ERR( L"CreateBuffer", hr );
+            goto Cleanup;
+        }
         DXUT_SetDebugName( m_pAdjacencyIndexBufferArray[IBIndex].pIB10, "CDXUTSDKMesh" );
-
-        //cleanup
-        pIndexBuffer->Unmap();
-        SAFE_RELEASE( pIndexBuffer );
-
-        //release the ID3DX10Mesh
-        SAFE_RELEASE( pMesh );
     }
 
+Cleanup:
+    for( UINT i = 0; i < NumMeshes; i++ )
+        SAFE_DELETE_ARRAY( pJobs[i].pAdjIndices );
+    SAFE_DELETE_ARRAY( pJobs );
+
     return hr;
 }
 
@@ -1666,6 +1914,14 @@ UINT CDXUTSDKMesh::GetNumMaterials()
     return m_pMeshHeader->NumMaterials;
 }
 
+//--------------------------------------------------------------------------------------
+UINT CDXUTSDKMesh::GetNumFrames()
+{
+    if( !m_pMeshHeader )
+        return 0;
+    return m_pMeshHeader->NumFrames;
+}
+
 //--------------------------------------------------------------------------------------
 UINT CDXUTSDKMesh::GetNumVBs()
 {
@@ -1947,6 +2203,31 @@ UINT CDXUTSDKMesh::GetAnimationKeyFromTime( double fTime )
     return iTick;
 }
 
+//--------------------------------------------------------------------------------------
+// The keys either side of fTime and how far fTime is from the first towards the second.
+// Key 0 is the rest pose, so playback loops over keys 1 to NumAnimationKeys - 1 and the
+// last key blends back into key 1.  *piKey0 matches GetAnimationKeyFromTime.
+//--------------------------------------------------------------------------------------
+void CDXUTSDKMesh::GetAnimationKeysFromTime( double fTime, UINT* piKey0, UINT* piKey1, float* pfBlend )
+{
+    if( m_pAnimationHeader->NumAnimationKeys < 2 )
+    {
+        *piKey0 = 0;
+        *piKey1 = 0;
+        *pfBlend = 0.0f;
+        return;
+    }
+
+    UINT NumLoopKeys = m_pAnimationHeader->NumAnimationKeys - 1;
+    double fTick = m_pAnimationHeader->AnimationFPS * fTime;
+    double fWhole = floor( fTick );
+    UINT iTick = ( UINT )fWhole;
+
+    *piKey0 = iTick % NumLoopKeys + 1;
+    *piKey1 = ( iTick + 1 ) % NumLoopKeys + 1;
+    *pfBlend = ( float )( fTick - fWhole );
+}
+
 
 //-------------------------------------------------------------------------------------
 // CDXUTXFileMesh implementation.
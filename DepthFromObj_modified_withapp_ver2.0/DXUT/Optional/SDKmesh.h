@@ -13,6 +13,8 @@
 #ifndef _SDKMESH_
 #define _SDKMESH_
 
+#include "DXUTMappedFile.h"
+
 //--------------------------------------------------------------------------------------
 // Hard Defines for the various structures
 //--------------------------------------------------------------------------------------
@@ -30,15 +32,19 @@
 #define INVALID_MATERIAL ((UINT)-1)
 #define INVALID_SUBSET ((UINT)-1)
 #define INVALID_ANIMATION_DATA ((UINT)-1)
-#define ERROR_RESOURCE_VALUE 1
 #define INVALID_SAMPLER_SLOT ((UINT)-1)
 
+// MeshLoader10.h has the same helper; whichever header comes first defines it
+#ifndef ERROR_RESOURCE_VALUE
+#define ERROR_RESOURCE_VALUE 1
+
 template<typename TYPE> BOOL IsErrorResource( TYPE data )
 {
     if( ( TYPE )ERROR_RESOURCE_VALUE == data )
         return TRUE;
     return FALSE;
 }
+#endif
 //--------------------------------------------------------------------------------------
 // Enumerated Types.  These will have mirrors in both D3D9 and D3D10
 //--------------------------------------------------------------------------------------
@@ -313,8 +319,8 @@ private:
     bool m_bLoading;
     //BYTE*                         m_pBufferData;
     HANDLE m_hFile;
-    HANDLE m_hFileMappingObject;
-    CGrowableArray <BYTE*> m_MappedPointers;
+    CDXUTMappedFile m_MappedFile;       // Owns m_pStaticMeshData when the mesh was mapped
+    bool m_bUseFileMapping;
     IDirect3DDevice9* m_pDev9;
     ID3D10Device* m_pDev10;
 
@@ -346,7 +352,16 @@ protected:
     SDKANIMATION_FILE_HEADER* m_pAnimationHeader;
     SDKANIMATION_FRAME_DATA* m_pAnimationFrameData;
     D3DXMATRIX* m_pBindPoseFrameMatrices;
+    D3DXMATRIX* m_pInvBindPoseFrameMatrices;
     D3DXMATRIX* m_pTransformedFrameMatrices;
+    bool m_bInterpolateAnimation;
+
+    // Frames reachable from frame 0 in parent-before-child order, and the parent of each
+    // frame (INVALID_FRAME for the root and its siblings), so the hierarchy can be
+    // evaluated with a single loop instead of a recursive walk
+    UINT* m_pFrameOrder;
+    UINT* m_pFrameParents;
+    UINT m_NumOrderedFrames;
 
 protected:
     void                            LoadMaterials( ID3D10Device* pd3dDevice, SDKMESH_MATERIAL* pMaterials,
@@ -379,9 +394,13 @@ protected:
                                                       SDKMESH_CALLBACKS9* pLoaderCallbacks9=NULL );
 
     //frame manipulation
-    void                            TransformBindPoseFrame( UINT iFrame, D3DXMATRIX* pParentWorld );
-    void                            TransformFrame( UINT iFrame, D3DXMATRIX* pParentWorld, double fTime );
-    void                            TransformFrameAbsolute( UINT iFrame, double fTime );
+    HRESULT                         BuildFrameOrder();
+    void                            GetAnimationLocalTransform( UINT iFrame, UINT iKey0, UINT iKey1, float fBlend,
+                                                                D3DXMATRIX* pLocal );
+    void                            TransformFrameAbsolute( UINT iFrame, UINT iKey0, UINT iKey1, float fBlend,
+                                                            D3DXMATRIX* pFrameMatrices );
+    void                            EvaluateFrames( const D3DXMATRIX* pWorld, double fTime,
+                                                    D3DXMATRIX* pFrameMatrices );
 
     //Direct3D 10 rendering helpers
     void                            RenderMesh( UINT iMesh,
@@ -452,10 +471,31 @@ public:
     virtual HRESULT                 LoadAnimation( WCHAR* szFileName );
     virtual void                    Destroy();
 
+    // Create from a file maps it into memory rather than reading it into a heap copy
+    // unless this is turned off.  Takes effect on the next Create.
+    void                            SetUseFileMapping( bool bUseFileMapping )
+    {
+        m_bUseFileMapping = bUseFileMapping;
+    }
+
     //Frame manipulation
     void                            TransformBindPose( D3DXMATRIX* pWorld );
     void                            TransformMesh( D3DXMATRIX* pWorld, double fTime );
 
+    // Evaluates the animation at NumTimes times in parallel.  pFrameMatrices receives
+    // NumTimes blocks of GetNumFrames() matrices, the same values TransformMesh would
+    // leave in the transformed frame matrices for each time.  TransformBindPose must have
+    // been called first.  Fails if no animation has been loaded.
+    HRESULT                         TransformMeshBatch( const D3DXMATRIX* pWorld, const double* pTimes, UINT NumTimes,
+                                                        D3DXMATRIX* pFrameMatrices );
+
+    // Blend between the two animation keys around each time (the default) or snap to the
+    // earlier one as GetAnimationKeyFromTime does
+    void                            SetAnimationInterpolation( bool bInterpolate )
+    {
+        m_bInterpolateAnimation = bInterpolate;
+    }
+
     //Adjacency
     HRESULT                         CreateAdjacencyIndices( ID3D10Device* pd3dDevice, float fEpsilon,
                                                             BYTE* pBufferData );
@@ -511,6 +551,7 @@ public:
     UINT                            GetNumMaterials();
     UINT                            GetNumVBs();
     UINT                            GetNumIBs();
+    UINT                            GetNumFrames();
     IDirect3DVertexBuffer9* GetVB9At( UINT iVB );
     IDirect3DIndexBuffer9* GetIB9At( UINT iIB );
     ID3D10Buffer* GetVB10At( UINT iVB );
@@ -539,6 +580,8 @@ public:
     UINT                            GetNumInfluences( UINT iMesh );
     const D3DXMATRIX* GetMeshInfluenceMatrix( UINT iMesh, UINT iInfluence );
     UINT                            GetAnimationKeyFromTime( double fTime );
+    void                            GetAnimationKeysFromTime( double fTime, UINT* piKey0, UINT* piKey1,
+                                                              float* pfBlend );
 };
 
 //-----------------------------------------------------------------------------
@@ -207,24 +207,337 @@ HRESULT WINAPI DXUTSetMediaSearchPath( LPCWSTR strPath )
         }
     }
 
+    // Results found relative to the old search path are no longer valid
+    DXUTClearMediaPathCache();
+
     return hr;
 }
 
 
 //--------------------------------------------------------------------------------------
-// Tries to find the location of a SDK media file
-//       cchDest is the size in WCHARs of strDestPath.  Be careful not to 
-//       pass in sizeof(strDest) on UNICODE builds.
+// Resolved media path cache
+//
+// DXUTFindDXSDKMediaFileCch probes dozens of directories, and every parent of the
+// current and exe directories, with a GetFileAttributes call each.  The results are
+// remembered here, keyed on the current directory and the requested name (the typical
+// and parent searches are relative to both), and failed searches are remembered as
+// well.  Optionally a media root can be walked once with DXUTBuildMediaDirectoryIndex;
+// the search still tries the same places in the same order, but answers the ones below
+// the root with a lookup in the index instead of a call to the file system.
 //--------------------------------------------------------------------------------------
-HRESULT WINAPI DXUTFindDXSDKMediaFileCch( WCHAR* strDestPath, int cchDest, 
-                                          LPCWSTR strFilename )
+#define DXUT_MEDIA_CACHE_BUCKETS 1024   // must be a power of 2
+
+struct DXUTMediaPathEntry
 {
-    bool bFound;
-    WCHAR strSearchFor[MAX_PATH];
+    UINT nHash;
+    WCHAR* strKey;
+    WCHAR* strPath;     // NULL if the file could not be found
+    DXUTMediaPathEntry* pNext;
+};
 
-    if( NULL == strFilename || strFilename[0] == 0 || NULL == strDestPath || cchDest < 10 )
+class CDXUTMediaPathTable
+{
+public:
+            CDXUTMediaPathTable()
+            {
+                ZeroMemory( m_pBuckets, sizeof( m_pBuckets ) );
+                m_nNumEntries = 0;
+            }
+            ~CDXUTMediaPathTable()
+            {
+                RemoveAll();
+            }
+
+    // Returns the entry for strKey, or NULL if there isn't one
+    DXUTMediaPathEntry* Find( LPCWSTR strKey, UINT nHash )
+    {
+        DXUTMediaPathEntry* pEntry = m_pBuckets[ nHash & ( DXUT_MEDIA_CACHE_BUCKETS - 1 ) ];
+        while( pEntry != NULL )
+        {
+            if( pEntry->nHash == nHash && 0 == wcscmp( pEntry->strKey, strKey ) )
+                return pEntry;
+            pEntry = pEntry->pNext;
+        }
+        return NULL;
+    }
+
+    // Adds strKey unless it is already present; the first entry for a key wins
+    HRESULT Add( LPCWSTR strKey, UINT nHash, LPCWSTR strPath )
+    {
+        if( Find( strKey, nHash ) != NULL )
+            return S_FALSE;
+
+        DXUTMediaPathEntry* pEntry = new DXUTMediaPathEntry;
+        if( pEntry == NULL )
+            return E_OUTOFMEMORY;
+
+        pEntry->nHash = nHash;
+        pEntry->strKey = _wcsdup( strKey );
+        pEntry->strPath = strPath ? _wcsdup( strPath ) : NULL;
+        if( pEntry->strKey == NULL || ( strPath && pEntry->strPath == NULL ) )
+        {
+            free( pEntry->strKey );
+            free( pEntry->strPath );
+            delete pEntry;
+            return E_OUTOFMEMORY;
+        }
+
+        UINT iBucket = nHash & ( DXUT_MEDIA_CACHE_BUCKETS - 1 );
+        pEntry->pNext = m_pBuckets[iBucket];
+        m_pBuckets[iBucket] = pEntry;
+        m_nNumEntries++;
+
+        return S_OK;
+    }
+
+    void RemoveAll()
+    {
+        for( UINT i = 0; i < DXUT_MEDIA_CACHE_BUCKETS; i++ )
+        {
+            DXUTMediaPathEntry* pEntry = m_pBuckets[i];
+            while( pEntry != NULL )
+            {
+                DXUTMediaPathEntry* pNext = pEntry->pNext;
+                free( pEntry->strKey );
+                free( pEntry->strPath );
+                delete pEntry;
+                pEntry = pNext;
+            }
+            m_pBuckets[i] = NULL;
+        }
+        m_nNumEntries = 0;
+    }
+
+    UINT GetNumEntries() const
+    {
+        return m_nNumEntries;
+    }
+
+private:
+    DXUTMediaPathEntry* m_pBuckets[DXUT_MEDIA_CACHE_BUCKETS];
+    UINT m_nNumEntries;
+};
+
+class CDXUTMediaPathCache
+{
+public:
+            CDXUTMediaPathCache()
+            {
+                InitializeCriticalSection( &m_cs );
+                m_bEnabled = true;
+                m_strIndexRoot[0] = 0;
+            }
+            ~CDXUTMediaPathCache()
+            {
+                DeleteCriticalSection( &m_cs );
+            }
+
+    CRITICAL_SECTION m_cs;
+    bool m_bEnabled;
+    CDXUTMediaPathTable m_Resolved;     // "<current dir>|<requested name>" -> result
+    CDXUTMediaPathTable m_Index;        // path relative to m_strIndexRoot -> full path
+    WCHAR m_strIndexRoot[MAX_PATH];
+};
+
+// Constructed before main() so the critical section exists before any thread can search
+static CDXUTMediaPathCache g_MediaPathCache;
+
+
+//--------------------------------------------------------------------------------------
+// Automatically enters & leaves the media cache CS upon object creation/deletion
+//--------------------------------------------------------------------------------------
+class DXUTMediaPathCacheLock
+{
+public:
+    inline  DXUTMediaPathCacheLock()
+    {
+        EnterCriticalSection( &g_MediaPathCache.m_cs );
+    }
+    inline  ~DXUTMediaPathCacheLock()
+    {
+        LeaveCriticalSection( &g_MediaPathCache.m_cs );
+    }
+};
+
+
+//--------------------------------------------------------------------------------------
+// Lower-cases strPath in place and converts forward slashes to backslashes, so that
+// equivalent spellings of a path share one cache entry.  Returns the FNV-1a hash.
+//--------------------------------------------------------------------------------------
+static UINT DXUTNormalizeMediaKey( WCHAR* strPath )
+{
+    UINT nHash = 2166136261U;
+    for( WCHAR* pch = strPath; *pch != 0; pch++ )
+    {
+        if( *pch == L'/' )
+            *pch = L'\\';
+        else
+            *pch = towlower( *pch );
+
+        nHash = ( nHash ^ ( UINT )*pch ) * 16777619U;
+    }
+    return nHash;
+}
+
+
+//--------------------------------------------------------------------------------------
+// Recursively adds every file below strDir to the directory index.  strRelDir is the
+// path of strDir relative to the index root, including a trailing backslash.
+//--------------------------------------------------------------------------------------
+static HRESULT DXUTIndexMediaDirectory( LPCWSTR strDir, LPCWSTR strRelDir )
+{
+    HRESULT hr = S_OK;
+    WCHAR strSearch[MAX_PATH];
+    WIN32_FIND_DATA FindData;
+
+    if( FAILED( swprintf_s( strSearch, MAX_PATH, L"%s\\*", strDir ) ) )
+        return S_FALSE;
+
+    HANDLE hFind = FindFirstFile( strSearch, &FindData );
+    if( hFind == INVALID_HANDLE_VALUE )
+        return S_FALSE;
+
+    do
+    {
+        if( 0 == wcscmp( FindData.cFileName, L"." ) || 0 == wcscmp( FindData.cFileName, L".." ) )
+            continue;
+
+        WCHAR strFullPath[MAX_PATH];
+        WCHAR strRelPath[MAX_PATH];
+        if( swprintf_s( strFullPath, MAX_PATH, L"%s\\%s", strDir, FindData.cFileName ) < 0 ||
+            swprintf_s( strRelPath, MAX_PATH, L"%s%s", strRelDir, FindData.cFileName ) < 0 )
+            continue;
+
+        if( FindData.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY )
+        {
+            // Don't follow junctions/symlinks; they can create cycles
+            if( FindData.dwFileAttributes & FILE_ATTRIBUTE_REPARSE_POINT )
+                continue;
+
+            WCHAR strSubDir[MAX_PATH];
+            if( swprintf_s( strSubDir, MAX_PATH, L"%s\\", strRelPath ) < 0 )
+                continue;
+
+            hr = DXUTIndexMediaDirectory( strFullPath, strSubDir );
+        }
+        else
+        {
+            // Only by the relative path; a bare file name could match several files and
+            // which one won would depend on the enumeration order
+            UINT nHash = DXUTNormalizeMediaKey( strRelPath );
+            hr = g_MediaPathCache.m_Index.Add( strRelPath, nHash, strFullPath );
+        }
+    } while( SUCCEEDED( hr ) && FindNextFile( hFind, &FindData ) );
+
+    FindClose( hFind );
+
+    return FAILED( hr ) ? hr : S_OK;
+}
+
+
+//--------------------------------------------------------------------------------------
+void WINAPI DXUTSetMediaPathCacheEnabled( bool bEnabled )
+{
+    DXUTMediaPathCacheLock l;
+    g_MediaPathCache.m_bEnabled = bEnabled;
+    if( !bEnabled )
+        g_MediaPathCache.m_Resolved.RemoveAll();
+}
+
+
+//--------------------------------------------------------------------------------------
+void WINAPI DXUTClearMediaPathCache()
+{
+    DXUTMediaPathCacheLock l;
+    g_MediaPathCache.m_Resolved.RemoveAll();
+}
+
+
+//--------------------------------------------------------------------------------------
+// Walks strMediaRoot once and indexes every file below it by its path relative to the
+// root.  Replaces any previously built index.
+//--------------------------------------------------------------------------------------
+HRESULT WINAPI DXUTBuildMediaDirectoryIndex( LPCWSTR strMediaRoot )
+{
+    if( NULL == strMediaRoot || strMediaRoot[0] == 0 )
         return E_INVALIDARG;
 
+    WCHAR strFullRoot[MAX_PATH];
+    if( 0 == GetFullPathName( strMediaRoot, MAX_PATH, strFullRoot, NULL ) )
+        return DXTRACE_ERR( L"GetFullPathName", HRESULT_FROM_WIN32( GetLastError() ) );
+
+    // Trim the trailing slash so it isn't doubled when building paths
+    size_t ch = wcslen( strFullRoot );
+    if( ch > 0 && ( strFullRoot[ch - 1] == L'\\' || strFullRoot[ch - 1] == L'/' ) )
+        strFullRoot[ch - 1] = 0;
+
+    DWORD dwAttributes = GetFileAttributes( strFullRoot );
+    if( dwAttributes == INVALID_FILE_ATTRIBUTES || !( dwAttributes & FILE_ATTRIBUTE_DIRECTORY ) )
+        return DXUTERR_MEDIANOTFOUND;
+
+    DXUTMediaPathCacheLock l;
+
+    g_MediaPathCache.m_Index.RemoveAll();
+    g_MediaPathCache.m_Resolved.RemoveAll();
+
+    HRESULT hr = DXUTIndexMediaDirectory( strFullRoot, L"" );
+    if( FAILED( hr ) )
+    {
+        g_MediaPathCache.m_Index.RemoveAll();
+        g_MediaPathCache.m_strIndexRoot[0] = 0;
+        return hr;
+    }
+
+    wcscpy_s( g_MediaPathCache.m_strIndexRoot, MAX_PATH, strFullRoot );
+
+    return S_OK;
+}
+
+
+//--------------------------------------------------------------------------------------
+void WINAPI DXUTClearMediaDirectoryIndex()
+{
+    DXUTMediaPathCacheLock l;
+    g_MediaPathCache.m_Index.RemoveAll();
+    g_MediaPathCache.m_strIndexRoot[0] = 0;
+    g_MediaPathCache.m_Resolved.RemoveAll();
+}
+
+
+//--------------------------------------------------------------------------------------
+// Whether the search stops at strPath.  Paths below the indexed media root are looked
+// up in the index, so the first search for a file there costs no file system calls.
+//--------------------------------------------------------------------------------------
+static bool DXUTMediaFileExists( LPCWSTR strPath )
+{
+    WCHAR strFullPath[MAX_PATH];
+    DWORD cchFull = GetFullPathName( strPath, MAX_PATH, strFullPath, NULL );
+    if( cchFull > 0 && cchFull < MAX_PATH )
+    {
+        DXUTMediaPathCacheLock l;
+
+        size_t cchRoot = wcslen( g_MediaPathCache.m_strIndexRoot );
+        if( g_MediaPathCache.m_bEnabled && cchRoot > 0 && cchFull > cchRoot + 1 &&
+            strFullPath[cchRoot] == L'\\' && 0 == _wcsnicmp( strFullPath, g_MediaPathCache.m_strIndexRoot, cchRoot ) )
+        {
+            WCHAR* strRelative = strFullPath + cchRoot + 1;
+            return NULL != g_MediaPathCache.m_Index.Find( strRelative, DXUTNormalizeMediaKey( strRelative ) );
+        }
+    }
+
+    return GetFileAttributes( strPath ) != INVALID_FILE_ATTRIBUTES;
+}
+
+
+//--------------------------------------------------------------------------------------
+// Searches the typical and parent directories for strFilename without consulting the
+// path cache
+//--------------------------------------------------------------------------------------
+static HRESULT DXUTFindDXSDKMediaFileUncached( WCHAR* strDestPath, int cchDest, LPCWSTR strFilename )
+{
+    bool bFound;
+    WCHAR strSearchFor[MAX_PATH];
+
     // Get the exe name, and exe path
     WCHAR strExePath[MAX_PATH] = {0};
     WCHAR strExeName[MAX_PATH] = {0};
@@ -297,6 +610,70 @@ HRESULT WINAPI DXUTFindDXSDKMediaFileCch( WCHAR* strDestPath, int cchDest,
 }
 
 
+//--------------------------------------------------------------------------------------
+// Tries to find the location of a SDK media file
+//       cchDest is the size in WCHARs of strDestPath.  Be careful not to 
+//       pass in sizeof(strDest) on UNICODE builds.
+//--------------------------------------------------------------------------------------
+HRESULT WINAPI DXUTFindDXSDKMediaFileCch( WCHAR* strDestPath, int cchDest, 
+                                          LPCWSTR strFilename )
+{
+    if( NULL == strFilename || strFilename[0] == 0 || NULL == strDestPath || cchDest < 10 )
+        return E_INVALIDARG;
+
+    WCHAR strName[MAX_PATH];
+    if( 0 != wcscpy_s( strName, MAX_PATH, strFilename ) )
+        return DXUTFindDXSDKMediaFileUncached( strDestPath, cchDest, strFilename );
+    DXUTNormalizeMediaKey( strName );
+
+    // The typical and parent directory searches are relative to the current directory,
+    // so it is part of the key
+    WCHAR strKey[MAX_PATH * 2];
+    DWORD cchDir = GetCurrentDirectory( MAX_PATH, strKey );
+    if( cchDir == 0 || cchDir >= MAX_PATH )
+        return DXUTFindDXSDKMediaFileUncached( strDestPath, cchDest, strFilename );
+    swprintf_s( strKey + cchDir, MAX_PATH * 2 - cchDir, L"|%s", strName );
+    UINT nHash = DXUTNormalizeMediaKey( strKey );
+
+    bool bEnabled;
+    {
+        DXUTMediaPathCacheLock l;
+
+        bEnabled = g_MediaPathCache.m_bEnabled;
+
+        DXUTMediaPathEntry* pEntry = bEnabled ? g_MediaPathCache.m_Resolved.Find( strKey, nHash ) : NULL;
+        if( pEntry != NULL )
+        {
+            if( pEntry->strPath == NULL )
+            {
+                // Negative hit: behave exactly like a failed search
+                wcscpy_s( strDestPath, cchDest, strFilename );
+                return DXUTERR_MEDIANOTFOUND;
+            }
+            if( 0 == wcscpy_s( strDestPath, cchDest, pEntry->strPath ) )
+                return S_OK;
+        }
+    }
+
+    // Don't hold the lock while probing the file system; if two threads miss on the same
+    // name at once both search and the first result is kept
+    HRESULT hr = DXUTFindDXSDKMediaFileUncached( strDestPath, cchDest, strFilename );
+    if( !bEnabled )
+        return hr;
+
+    DXUTMediaPathCacheLock l;
+    if( g_MediaPathCache.m_bEnabled )
+    {
+        if( SUCCEEDED( hr ) )
+            g_MediaPathCache.m_Resolved.Add( strKey, nHash, strDestPath );
+        else if( hr == DXUTERR_MEDIANOTFOUND )
+            g_MediaPathCache.m_Resolved.Add( strKey, nHash, NULL );
+    }
+
+    return hr;
+}
+
+
 //--------------------------------------------------------------------------------------
 // Search a set of typical directories
 //--------------------------------------------------------------------------------------
@@ -316,47 +693,47 @@ bool DXUTFindMediaSearchTypicalDirs( WCHAR* strSearchPath, int cchSearch, LPCWST
 
     // Search in .\  
     wcscpy_s( strSearchPath, cchSearch, strLeaf );
-    if( GetFileAttributes( strSearchPath ) != 0xFFFFFFFF )
+    if( DXUTMediaFileExists( strSearchPath ) )
         return true;
 
     // Search in ..\  
     swprintf_s( strSearchPath, cchSearch, L"..\\%s", strLeaf );
-    if( GetFileAttributes( strSearchPath ) != 0xFFFFFFFF )
+    if( DXUTMediaFileExists( strSearchPath ) )
         return true;
 
     // Search in ..\..\ 
     swprintf_s( strSearchPath, cchSearch, L"..\\..\\%s", strLeaf );
-    if( GetFileAttributes( strSearchPath ) != 0xFFFFFFFF )
+    if( DXUTMediaFileExists( strSearchPath ) )
         return true;
 
     // Search in ..\..\ 
     swprintf_s( strSearchPath, cchSearch, L"..\\..\\%s", strLeaf );
-    if( GetFileAttributes( strSearchPath ) != 0xFFFFFFFF )
+    if( DXUTMediaFileExists( strSearchPath ) )
         return true;
 
     // Search in the %EXE_DIR%\ 
     swprintf_s( strSearchPath, cchSearch, L"%s\\%s", strExePath, strLeaf );
-    if( GetFileAttributes( strSearchPath ) != 0xFFFFFFFF )
+    if( DXUTMediaFileExists( strSearchPath ) )
         return true;
 
     // Search in the %EXE_DIR%\..\ 
     swprintf_s( strSearchPath, cchSearch, L"%s\\..\\%s", strExePath, strLeaf );
-    if( GetFileAttributes( strSearchPath ) != 0xFFFFFFFF )
+    if( DXUTMediaFileExists( strSearchPath ) )
         return true;
 
     // Search in the %EXE_DIR%\..\..\ 
     swprintf_s( strSearchPath, cchSearch, L"%s\\..\\..\\%s", strExePath, strLeaf );
-    if( GetFileAttributes( strSearchPath ) != 0xFFFFFFFF )
+    if( DXUTMediaFileExists( strSearchPath ) )
         return true;
 
     // Search in "%EXE_DIR%\..\%EXE_NAME%\".  This matches the DirectX SDK layout
     swprintf_s( strSearchPath, cchSearch, L"%s\\..\\%s\\%s", strExePath, strExeName, strLeaf );
-    if( GetFileAttributes( strSearchPath ) != 0xFFFFFFFF )
+    if( DXUTMediaFileExists( strSearchPath ) )
         return true;
 
     // Search in "%EXE_DIR%\..\..\%EXE_NAME%\".  This matches the DirectX SDK layout
     swprintf_s( strSearchPath, cchSearch, L"%s\\..\\..\\%s\\%s", strExePath, strExeName, strLeaf );
-    if( GetFileAttributes( strSearchPath ) != 0xFFFFFFFF )
+    if( DXUTMediaFileExists( strSearchPath ) )
         return true;
 
     // Search in media search dir 
@@ -364,7 +741,7 @@ bool DXUTFindMediaSearchTypicalDirs( WCHAR* strSearchPath, int cchSearch, LPCWST
     if( s_strSearchPath[0] != 0 )
     {
         swprintf_s( strSearchPath, cchSearch, L"%s%s", s_strSearchPath, strLeaf );
-        if( GetFileAttributes( strSearchPath ) != 0xFFFFFFFF )
+        if( DXUTMediaFileExists( strSearchPath ) )
             return true;
     }
 
@@ -392,7 +769,7 @@ bool DXUTFindMediaSearchParentDirs( WCHAR* strSearchPath, int cchSearch, WCHAR*
     while( strFilePart != NULL && *strFilePart != '\0' )
     {
         swprintf_s( strFullFileName, MAX_PATH, L"%s\\%s", strFullPath, strLeafName );
-        if( GetFileAttributes( strFullFileName ) != 0xFFFFFFFF )
+        if( DXUTMediaFileExists( strFullFileName ) )
         {
             wcscpy_s( strSearchPath, cchSearch, strFullFileName );
             return true;
@@ -664,6 +1041,21 @@ HRESULT CDXUTResourceCache::CreateTextureFromFileEx( ID3D10Device* pDevice, LPCT
     return S_OK;
 }
 
+//--------------------------------------------------------------------------------------
+HRESULT CDXUTResourceCache::ReleaseTexture( ID3D10ShaderResourceView* pSRV )
+{
+    for( int i = m_TextureCache.GetSize() - 1; i >= 0; --i )
+    {
+        if( m_TextureCache[i].pSRV10 == pSRV )
+        {
+            SAFE_RELEASE( m_TextureCache[i].pSRV10 );
+            m_TextureCache.Remove( i );
+            return S_OK;
+        }
+    }
+    return S_FALSE;
+}
+
 //--------------------------------------------------------------------------------------
 HRESULT CDXUTResourceCache::CreateTextureFromResource( LPDIRECT3DDEVICE9 pDevice, HMODULE hSrcModule,
                                                        LPCTSTR pSrcResource, LPDIRECT3DTEXTURE9* ppTexture )
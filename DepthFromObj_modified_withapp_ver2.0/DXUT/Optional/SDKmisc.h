@@ -97,6 +97,10 @@ public:
     HRESULT                 CreateTextureFromFileEx( ID3D10Device* pDevice, LPCTSTR pSrcFile,
                                                      D3DX10_IMAGE_LOAD_INFO* pLoadInfo, ID3DX10ThreadPump* pPump,
                                                      ID3D10ShaderResourceView** ppOutputRV, bool bSRGB );
+
+    // Drops the cache's reference to a texture view it returned, so the texture is freed
+    // once its users release theirs.  Returns S_FALSE if the view isn't in the cache.
+    HRESULT                 ReleaseTexture( ID3D10ShaderResourceView* pSRV );
     HRESULT                 CreateTextureFromResource( LPDIRECT3DDEVICE9 pDevice, HMODULE hSrcModule,
                                                        LPCTSTR pSrcResource, LPDIRECT3DTEXTURE9* ppTexture );
     HRESULT                 CreateTextureFromResourceEx( LPDIRECT3DDEVICE9 pDevice, HMODULE hSrcModule,
@@ -272,6 +276,19 @@ HRESULT WINAPI DXUTFindDXSDKMediaFileCch( __out_ecount(cchDest) WCHAR* strDestPa
 HRESULT WINAPI DXUTSetMediaSearchPath( LPCWSTR strPath );
 LPCWSTR WINAPI DXUTGetMediaSearchPath();
 
+//--------------------------------------------------------------------------------------
+// Controls the process-wide cache of DXUTFindDXSDKMediaFileCch results (enabled by
+// default).  Failed searches are cached too, so clear the cache if media files are
+// created while the app runs.  DXUTBuildMediaDirectoryIndex walks a media root once;
+// the search then answers the places it tries below that root from memory, in the same
+// order, so only the places outside it touch the file system.  Rebuild the index if
+// files below the root change.
+//--------------------------------------------------------------------------------------
+void WINAPI DXUTSetMediaPathCacheEnabled( bool bEnabled );
+void WINAPI DXUTClearMediaPathCache();
+HRESULT WINAPI DXUTBuildMediaDirectoryIndex( LPCWSTR strMediaRoot );
+void WINAPI DXUTClearMediaDirectoryIndex();
+
 
 //--------------------------------------------------------------------------------------
 // Returns a view matrix for rendering to a face of a cubemap.
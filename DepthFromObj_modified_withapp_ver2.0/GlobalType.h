@@ -3,4 +3,7 @@
 
 #define KEY_S	83
 #define KEY_F	70
+#define KEY_K	75
+#define KEY_P	80
+#define KEY_R	82
 #endif
\ No newline at end of file
@@ -16,6 +16,11 @@
 #include "meshloader10.h"
 #pragma warning(default: 4995)
 #include "SDKmisc.h"
+#include "DXUTProfiler.h"
+#include "DXUTJobSystem.h"
+#include "DXUTMemTrack.h"
+#include "DXUTTrajectory.h"
+#include "DXUTDepthSequence.h"
 #include "GlobalType.h"
 
 
@@ -24,6 +29,7 @@
 //--------------------------------------------------------------------------------------
 ID3DX10Font*                        g_pFont10 = NULL;
 ID3DX10Sprite*                      g_pSprite10 = NULL;
+CDXUTTextHelper*                    g_pTxtHelper = NULL;
 
 ID3D10Effect*                       g_pEffect10 = NULL;
 ID3D10InputLayout*                  g_pVertexLayout = NULL;
@@ -69,6 +75,29 @@ bool								g_bSaveImage                = false;
 float								g_nearPlane					= 0.1f;
 float								g_farPlane					= 200.0f;
 
+//-- Camera trajectories --
+CDXUTTrajectory                     g_Trajectory;               // Being recorded, or played back
+WCHAR                               g_strTrajectoryFile[MAX_PATH] = L"trajectory.txt";
+WCHAR                               g_strCaptureDir[MAX_PATH]   = {0};  // Playback saves every frame here when set
+CDXUTDepthSequenceWriter            g_DepthSequence;            // Playback capture when g_strCaptureDir is a .dsq file
+bool                                g_bRecording                = false;
+bool                                g_bRecordMoves              = false;    // Every frame the camera moved, not just K presses
+double                              g_fRecordStart              = 0.0;
+DXUT_CAMERA_KEY                     g_LastPose;                 // Camera pose of the previous frame while recording
+bool                                g_bPlaying                  = false;
+bool                                g_bExitAfterPlayback        = false;
+UINT                                g_iPlaybackFrame            = 0;
+double                              g_fPlaybackFrameRate        = 30.0;
+
+//-- Idle skipping --
+bool                                g_bIdleSkip                 = true;     // Reuse the depth image when nothing changed
+bool                                g_bDepthValid               = false;    // The depth texture holds the state below
+D3DXMATRIX                          g_mLastWorldViewProjection;
+float                               g_fLastNear                 = 0.0f;
+float                               g_fLastFar                  = 0.0f;
+UINT                                g_NumFramesRendered         = 0;
+UINT                                g_NumFramesSkipped          = 0;
+
 typedef struct _FSVertex {
 
 	D3DXVECTOR3         Pos;
@@ -98,11 +127,21 @@ HRESULT CALLBACK OnD3D10ResizedSwapChain( ID3D10Device* pd3dDevice, IDXGISwapCha
 void CALLBACK OnD3D10ReleasingSwapChain( void* pUserContext );
 void CALLBACK OnD3D10DestroyDevice( void* pUserContext );
 void CALLBACK OnD3D10FrameRender( ID3D10Device* pd3dDevice, double fTime, float fElapsedTime, void* pUserContext );
+void CALLBACK OnFrameMove( double fTime, float fElapsedTime, void* pUserContext );
+LRESULT CALLBACK MsgProc( HWND hWnd, UINT uMsg, WPARAM wParam, LPARAM lParam, bool* pbNoFurtherProcessing,
+						  void* pUserContext );
 void CALLBACK OnGUIEvent( UINT nEvent, int nControlID, CDXUTControl* pControl, void* pUserContext );
 void InitApp();
+void ParseCommandLine();
+void RenderText();
 void RenderSubset( UINT iSubset );
-void SaveImage(ID3D10Device* pd3dDevice, ID3D10RenderTargetView* pRTView);
+bool IsSequenceCapture();
+void SaveDepthFrame( ID3D10Device* pd3dDevice, const DXUT_CAMERA_KEY* pPose, const D3DXMATRIX* pProj );
+void SaveImage(ID3D10Device* pd3dDevice, ID3D10RenderTargetView* pRTView, const WCHAR* strFileName);
 void CALLBACK OnKeyboard( UINT nChar, bool bKeyDown, bool bAltDown, void* pUserContext );
+void StartRecording( bool bRecordMoves );
+void StopRecording();
+void StartPlayback();
 //--------------------------------------------------------------------------------------
 // Entry point to the program. Initializes everything and goes into a message processing 
 // loop. Idle time is used to render the scene.
@@ -122,15 +161,31 @@ INT WINAPI wWinMain( HINSTANCE, HINSTANCE, LPWSTR, int )
 	DXUTSetCallbackD3D10SwapChainReleasing( OnD3D10ReleasingSwapChain );
 	DXUTSetCallbackD3D10DeviceDestroyed( OnD3D10DestroyDevice );
 	DXUTSetCallbackD3D10FrameRender( OnD3D10FrameRender );
+	DXUTSetCallbackFrameMove( OnFrameMove );
+	DXUTSetCallbackMsgProc( MsgProc );
 	DXUTSetCallbackKeyboard( OnKeyboard );
 
+	// Set DXUT_TRACE_FILE to record a Chrome trace of the load and render stages
+	DXUTProfilerInitFromEnvironment();
+	DXUTProfilerSetThreadName( "Main" );
+
+	// Set DXUT_MEMTRACK=1 to report loader allocations to the debugger after each load
+	DXUTMemTrackInitFromEnvironment();
+
+	// One shared pool of workers for loading and image processing
+	DXUTGetJobSystem()->Init();
+
 	InitApp();
+	ParseCommandLine();
 	DXUTInit( true, true, NULL ); // Parse the command line, show msgboxes on error, no extra command line params
 	DXUTSetCursorSettings( true, true ); // Show the cursor and clip it when in full screen
 	DXUTCreateWindow( L"MeshFromOBJ10" );
 	DXUTCreateDevice( true, 1000, 1000 );
 	DXUTMainLoop(); // Enter into the DXUT render loop
 
+	DXUTGetJobSystem()->Shutdown();
+	DXUTProfilerShutdown();
+
 	return DXUTGetExitCode();
 }
 
@@ -156,6 +211,57 @@ void InitApp()
 }
 
 
+//--------------------------------------------------------------------------------------
+// Trajectory options, in DXUT's -flag:value form.  DXUT skips flags it doesn't know.
+//
+//   -trajectory:file    file recorded to and played back (trajectory.txt)
+//   -play               play the trajectory from the start
+//   -capture:dir        save every played back frame to dir and exit when it ends; a
+//                       name ending in .dsq gets the frames' linear depth instead, as
+//                       one depth sequence file
+//   -fps:30             playback rate; each frame advances the trajectory by 1 / fps
+//   -alwaysrender       render the mesh every frame, even when nothing changed
+//--------------------------------------------------------------------------------------
+void ParseCommandLine()
+{
+	int nArgs;
+	LPWSTR* pstrArgs = CommandLineToArgvW( GetCommandLine(), &nArgs );
+	if( pstrArgs == NULL )
+		return;
+
+	for( int iArg = 1; iArg < nArgs; iArg++ )
+	{
+		const WCHAR* strArg = pstrArgs[iArg];
+		if( *strArg != L'-' && *strArg != L'/' )
+			continue;
+		strArg++;
+
+		const WCHAR* strValue = wcschr( strArg, L':' );
+		size_t cchName = strValue ? strValue - strArg : wcslen( strArg );
+		if( strValue )
+			strValue++;
+
+		if( 10 == cchName && 0 == _wcsnicmp( strArg, L"trajectory", cchName ) && strValue )
+			wcscpy_s( g_strTrajectoryFile, MAX_PATH, strValue );
+		else if( 4 == cchName && 0 == _wcsnicmp( strArg, L"play", cchName ) )
+			g_bPlaying = true;
+		else if( 7 == cchName && 0 == _wcsnicmp( strArg, L"capture", cchName ) && strValue )
+		{
+			wcscpy_s( g_strCaptureDir, MAX_PATH, strValue );
+			g_bExitAfterPlayback = true;
+		}
+		else if( 3 == cchName && 0 == _wcsnicmp( strArg, L"fps", cchName ) && strValue && _wtof( strValue ) > 0.0 )
+			g_fPlaybackFrameRate = _wtof( strValue );
+		else if( 12 == cchName && 0 == _wcsnicmp( strArg, L"alwaysrender", cchName ) )
+			g_bIdleSkip = false;
+	}
+	LocalFree( pstrArgs );
+
+	if( g_bPlaying )
+		StartPlayback();
+}
+
+
 //--------------------------------------------------------------------------------------
 //  Create a vertex buffer which contains a full-screen quad in view space.
 //  The buffer contains a texture coordinate ranging [0,1] accross the quad.
@@ -235,7 +341,7 @@ HRESULT CALLBACK OnD3D10CreateDevice( ID3D10Device* pd3dDevice, const DXGI_SURFA
 								OUT_DEFAULT_PRECIS, DEFAULT_QUALITY, DEFAULT_PITCH | FF_DONTCARE,
 								L"Arial", &g_pFont10 ) );
 	V_RETURN( D3DX10CreateSprite( pd3dDevice, 512, &g_pSprite10 ) );
-	//g_pTxtHelper = new CDXUTTextHelper( NULL, NULL, g_pFont10, g_pSprite10, 15 );
+	g_pTxtHelper = new CDXUTTextHelper( NULL, NULL, g_pFont10, g_pSprite10, 15 );
 
 
 	// Read the D3DX effect file
@@ -287,6 +393,7 @@ HRESULT CALLBACK OnD3D10CreateDevice( ID3D10Device* pd3dDevice, const DXGI_SURFA
 
 	// Load the mesh
 	V_RETURN( g_MeshLoader.Create( pd3dDevice, L"media\\flowers.obj" ) );
+	g_bDepthValid = false;
 
 	// Add the identified subsets to the UI
 	CDXUTComboBox* pComboBox = g_SampleUI.GetComboBox( IDC_SUBSET );
@@ -332,6 +439,7 @@ HRESULT CALLBACK OnD3D10ResizedSwapChain( ID3D10Device* pd3dDevice, IDXGISwapCha
 
 	g_width                   = pBufferSurfaceDesc->Width;
 	g_height                  = pBufferSurfaceDesc->Height;					
+	g_bDepthValid             = false;  // The depth target is recreated below
 	//
 	//  Create full-screen render target and its views
 	//
@@ -427,6 +535,8 @@ void CALLBACK OnD3D10FrameRender( ID3D10Device* pd3dDevice, double fTime, float
 		g_SettingsDlg.OnRender( fElapsedTime );
 		return;
 	}
+
+	DXUT_PROFILE_ZONE( "OnD3D10FrameRender" );
 	
 	const UINT                  uOffset             = 0;
 	const UINT                  uStride             = sizeof( FSVertex );
@@ -442,56 +552,89 @@ void CALLBACK OnD3D10FrameRender( ID3D10Device* pd3dDevice, double fTime, float
 	ID3D10DepthStencilView*     pDSView             = DXUTGetD3D10DepthStencilView();
 
 
-	pd3dDevice->ClearRenderTargetView( 
-		g_pColorRTView, 
-		ClearColor );
-
-
-	pd3dDevice->ClearDepthStencilView( 
-		g_pDepthStencilDSView, 
-		D3D10_CLEAR_DEPTH, 
-		1.0, 
-		0 );
-
-	pd3dDevice->OMSetRenderTargets(
-		1,
-		&g_pColorRTView,
-		g_pDepthStencilDSView );
-
 	HRESULT hr;
 	D3DXMATRIXA16 mWorld;
 	D3DXMATRIXA16 mView;
 	D3DXMATRIXA16 mProj;
 	D3DXMATRIXA16 mWorldViewProjection;
 
-	// Get the projection & view matrix from the camera class
-	mWorld = *g_Camera.GetWorldMatrix();
-	mView = *g_Camera.GetViewMatrix();
-	mProj = *g_Camera.GetProjMatrix();
+	// Get the projection & view matrix from the camera class, or from the trajectory
+	// while it is being played back
+	float fNear = g_nearPlane;
+	float fFar = g_farPlane;
+	DXUT_CAMERA_KEY Pose;
+	if( g_bPlaying && g_Trajectory.EvaluateFrame( g_iPlaybackFrame, g_fPlaybackFrameRate, &Pose ) )
+	{
+		DXUTGetCameraKeyMatrices( &Pose, ( DXUTMATRIX4* )&mWorld, ( DXUTMATRIX4* )&mView, ( DXUTMATRIX4* )&mProj );
+		fNear = Pose.fNear;
+		fFar = Pose.fFar;
+	}
+	else
+	{
+		mWorld = *g_Camera.GetWorldMatrix();
+		mView = *g_Camera.GetViewMatrix();
+		mProj = *g_Camera.GetProjMatrix();
+	}
 
 	mWorldViewProjection = mWorld * mView * mProj;
 
-	// Update the effect's variables. 
-	V( g_pWorldViewProjection->SetMatrix( (float*)&mWorldViewProjection ) );
+	// The depth pass only has to run when its result would differ from what the depth
+	// texture already holds.  The linearizing pass below runs every frame, since the
+	// back buffer is discarded by Present, but that is one quad.
+	bool bRenderDepth = !g_bIdleSkip || !g_bDepthValid || fNear != g_fLastNear || fFar != g_fLastFar ||
+						0 != memcmp( &mWorldViewProjection, &g_mLastWorldViewProjection, sizeof( D3DXMATRIX ) );
 
-	//
-	// Set the Vertex Layout
-	//
-	pd3dDevice->IASetInputLayout( g_pVertexLayout );
+	if( bRenderDepth )
+	{
+		pd3dDevice->ClearRenderTargetView( 
+			g_pColorRTView, 
+			ClearColor );
 
-	UINT iCurSubset = ( UINT )( INT_PTR )g_SampleUI.GetComboBox( IDC_SUBSET )->GetSelectedData();
 
-	//
-	// Render the mesh
-	//
+		pd3dDevice->ClearDepthStencilView( 
+			g_pDepthStencilDSView, 
+			D3D10_CLEAR_DEPTH, 
+			1.0, 
+			0 );
 
-		for ( UINT iSubset = 0; iSubset < g_MeshLoader.GetNumSubsets(); ++iSubset )
+		pd3dDevice->OMSetRenderTargets(
+			1,
+			&g_pColorRTView,
+			g_pDepthStencilDSView );
+
+		// Update the effect's variables. 
+		V( g_pWorldViewProjection->SetMatrix( (float*)&mWorldViewProjection ) );
+
+		//
+		// Set the Vertex Layout
+		//
+		pd3dDevice->IASetInputLayout( g_pVertexLayout );
+
+		//
+		// Render the mesh
+		//
 		{
+			DXUT_PROFILE_ZONE( "Render mesh" );
 
-			g_pTechnique->GetPassByIndex( 0 )->Apply( 0 );
-			g_MeshLoader.GetMesh()->DrawSubset(iSubset);
+			for ( UINT iSubset = 0; iSubset < g_MeshLoader.GetNumSubsets(); ++iSubset )
+			{
+
+				g_pTechnique->GetPassByIndex( 0 )->Apply( 0 );
+				g_MeshLoader.GetMesh()->DrawSubset(iSubset);
+			}
 		}
 
+		g_mLastWorldViewProjection = mWorldViewProjection;
+		g_fLastNear = fNear;
+		g_fLastFar = fFar;
+		g_bDepthValid = true;
+		g_NumFramesRendered++;
+	}
+	else
+	{
+		g_NumFramesSkipped++;
+	}
+
 /////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
 	//
@@ -512,6 +655,10 @@ void CALLBACK OnD3D10FrameRender( ID3D10Device* pd3dDevice, double fTime, float
 		&pRTView,
 		pDSView );
 
+	// The quad's vertices have the mesh's layout.  Bound here every frame, since on the
+	// frames that skip the depth pass the HUD's sprites were the last to set one.
+	pd3dDevice->IASetInputLayout( g_pVertexLayout );
+
 	pd3dDevice->IASetVertexBuffers(
 		0,
 		1,
@@ -520,8 +667,8 @@ void CALLBACK OnD3D10FrameRender( ID3D10Device* pd3dDevice, double fTime, float
 		&uOffset );
 
 	g_pDepthTex->SetResource( g_pDepthStencilSRView );
-	g_pNearPlane->SetFloat( g_nearPlane);
-	g_pFarPlane->SetFloat( g_farPlane);
+	g_pNearPlane->SetFloat( fNear );
+	g_pFarPlane->SetFloat( fFar );
 
 
 	g_pRenderVerticiesQuad->GetPassByIndex( 0 )->Apply( 0 );
@@ -533,14 +680,214 @@ void CALLBACK OnD3D10FrameRender( ID3D10Device* pd3dDevice, double fTime, float
 		0 );
 	if (g_bSaveImage)
 	{
-		SaveImage(pd3dDevice, pRTView);
+		SaveImage(pd3dDevice, pRTView, L"test.bmp");
 		g_bSaveImage = false;
 	}
+
+	if( g_bPlaying )
+	{
+		if( IsSequenceCapture() )
+		{
+			SaveDepthFrame( pd3dDevice, &Pose, &mProj );
+		}
+		else if( g_strCaptureDir[0] )
+		{
+			WCHAR strFrame[MAX_PATH];
+			swprintf_s( strFrame, MAX_PATH, L"%s\\frame_%05u.bmp", g_strCaptureDir, g_iPlaybackFrame );
+			SaveImage( pd3dDevice, pRTView, strFrame );
+		}
+
+		if( ++g_iPlaybackFrame >= g_Trajectory.GetNumFrames( g_fPlaybackFrameRate ) )
+		{
+			g_bPlaying = false;
+			g_DepthSequence.Close();
+			if( g_bExitAfterPlayback )
+				PostMessage( DXUTGetHWND(), WM_CLOSE, 0, 0 );
+		}
+	}
 	
 
+	RenderText();
 	g_HUD.OnRender( fElapsedTime );
 	g_SampleUI.OnRender( fElapsedTime );    
-	
+
+	// Nothing is changing, so give the CPU back until there is input to react to.  The
+	// timeout keeps the HUD and DXUT's timers ticking.
+	if( !bRenderDepth && !g_bRecording && !g_bPlaying )
+		MsgWaitForMultipleObjects( 0, NULL, FALSE, 50, QS_ALLINPUT );
+}
+
+//--------------------------------------------------------------------------------------
+// Render the help and statistics text
+//--------------------------------------------------------------------------------------
+void RenderText()
+{
+	UINT NumFrames = g_NumFramesRendered + g_NumFramesSkipped;
+
+	g_pTxtHelper->Begin();
+	g_pTxtHelper->SetInsertionPos( 5, 5 );
+	g_pTxtHelper->SetForegroundColor( D3DXCOLOR( 1.0f, 1.0f, 0.0f, 1.0f ) );
+	g_pTxtHelper->DrawTextLine( DXUTGetFrameStats( DXUTIsVsyncEnabled() ) );
+	g_pTxtHelper->DrawFormattedTextLine( L"Depth pass skipped on %u of %u frames (%.1f%%)", g_NumFramesSkipped,
+										 NumFrames, NumFrames ? 100.0 * g_NumFramesSkipped / NumFrames : 0.0 );
+	if( g_bRecording )
+		g_pTxtHelper->DrawFormattedTextLine( L"Recording %u camera keys (R to stop%s)", g_Trajectory.GetNumKeys(),
+											 g_bRecordMoves ? L"" : L", K to add a key" );
+	else if( g_bPlaying )
+		g_pTxtHelper->DrawFormattedTextLine( L"Playing frame %u of %u (P to stop)", g_iPlaybackFrame + 1,
+											 g_Trajectory.GetNumFrames( g_fPlaybackFrameRate ) );
+	g_pTxtHelper->End();
+}
+
+//--------------------------------------------------------------------------------------
+// Camera pose in trajectory form.  The up vector is the view's y axis and the intrinsics
+// come back out of the projection matrix.
+//--------------------------------------------------------------------------------------
+void GetCameraPose( double fTime, DXUT_CAMERA_KEY* pPose )
+{
+	const D3DXMATRIX* pWorld = g_Camera.GetWorldMatrix();
+	const D3DXMATRIX* pView = g_Camera.GetViewMatrix();
+	const D3DXMATRIX* pProj = g_Camera.GetProjMatrix();
+
+	pPose->fTime = fTime;
+	memcpy( pPose->vEye, g_Camera.GetEyePt(), sizeof( pPose->vEye ) );
+	memcpy( pPose->vAt, g_Camera.GetLookAtPt(), sizeof( pPose->vAt ) );
+	pPose->vUp[0] = pView->_12;
+	pPose->vUp[1] = pView->_22;
+	pPose->vUp[2] = pView->_32;
+
+	D3DXQUATERNION qWorld;
+	D3DXQuaternionRotationMatrix( &qWorld, pWorld );
+	memcpy( pPose->qWorld, &qWorld, sizeof( pPose->qWorld ) );
+	pPose->vWorldPosition[0] = pWorld->_41;
+	pPose->vWorldPosition[1] = pWorld->_42;
+	pPose->vWorldPosition[2] = pWorld->_43;
+
+	pPose->fFovY = 2.0f * atanf( 1.0f / pProj->_22 );
+	pPose->fAspect = pProj->_22 / pProj->_11;
+	pPose->fNear = g_Camera.GetNearClip();
+	pPose->fFar = g_Camera.GetFarClip();
+}
+
+bool SameCameraPose( const DXUT_CAMERA_KEY* pA, const DXUT_CAMERA_KEY* pB )
+{
+	return 0 == memcmp( pA->vEye, pB->vEye, sizeof( pA->vEye ) ) &&
+		   0 == memcmp( pA->vAt, pB->vAt, sizeof( pA->vAt ) ) &&
+		   0 == memcmp( pA->vUp, pB->vUp, sizeof( pA->vUp ) ) &&
+		   0 == memcmp( pA->qWorld, pB->qWorld, sizeof( pA->qWorld ) ) &&
+		   0 == memcmp( pA->vWorldPosition, pB->vWorldPosition, sizeof( pA->vWorldPosition ) ) &&
+		   pA->fFovY == pB->fFovY && pA->fAspect == pB->fAspect && pA->fNear == pB->fNear && pA->fFar == pB->fFar;
+}
+
+//--------------------------------------------------------------------------------------
+// Recording.  R records every frame the camera moves; K records only the poses it is
+// pressed at, for a sparse trajectory that playback fills in with splines.  R stops
+// either kind of recording and saves it.
+//--------------------------------------------------------------------------------------
+void StartRecording( bool bRecordMoves )
+{
+	g_bPlaying = false;
+	g_bRecording = true;
+	g_bRecordMoves = bRecordMoves;
+	g_fRecordStart = DXUTGetTime();
+	g_Trajectory.Clear();
+	g_Trajectory.SetInterpolation( DXUT_TRAJECTORY_SPLINE );
+
+	GetCameraPose( 0.0, &g_LastPose );
+	g_Trajectory.AddKey( &g_LastPose );
+	DXUTOutputDebugString( L"Recording the camera to %s\n", g_strTrajectoryFile );
+}
+
+void StopRecording()
+{
+	// Close a hold at the end so playback lasts as long as the recording did
+	GetCameraPose( DXUTGetTime() - g_fRecordStart, &g_LastPose );
+	if( g_bRecordMoves )
+		g_Trajectory.AddKey( &g_LastPose );
+	g_bRecording = false;
+
+	char strFile[MAX_PATH * 3];
+	if( 0 == WideCharToMultiByte( CP_UTF8, 0, g_strTrajectoryFile, -1, strFile, sizeof( strFile ), NULL, NULL ) ||
+		!g_Trajectory.Save( strFile ) )
+		DXUTOutputDebugString( L"Could not save %s\n", g_strTrajectoryFile );
+	else
+		DXUTOutputDebugString( L"Saved %u camera keys to %s\n", g_Trajectory.GetNumKeys(), g_strTrajectoryFile );
+}
+
+void StartPlayback()
+{
+	g_bRecording = false;
+	g_bPlaying = false;
+
+	char strFile[MAX_PATH * 3];
+	if( 0 == WideCharToMultiByte( CP_UTF8, 0, g_strTrajectoryFile, -1, strFile, sizeof( strFile ), NULL, NULL ) ||
+		!g_Trajectory.Load( strFile ) || 0 == g_Trajectory.GetNumKeys() )
+	{
+		DXUTOutputDebugString( L"Could not load a trajectory from %s\n", g_strTrajectoryFile );
+		return;
+	}
+
+	g_bPlaying = true;
+	g_iPlaybackFrame = 0;
+	g_DepthSequence.Close();
+	if( g_strCaptureDir[0] && !IsSequenceCapture() )
+		CreateDirectory( g_strCaptureDir, NULL );
+}
+
+//--------------------------------------------------------------------------------------
+// Handle updates to the scene.  This is called regardless of which D3D API is used
+//--------------------------------------------------------------------------------------
+void CALLBACK OnFrameMove( double fTime, float fElapsedTime, void* pUserContext )
+{
+	// Update the camera's position based on user input
+	g_Camera.FrameMove( fElapsedTime );
+
+	if( g_bRecording && g_bRecordMoves )
+	{
+		DXUT_CAMERA_KEY Pose;
+		GetCameraPose( fTime - g_fRecordStart, &Pose );
+		if( !SameCameraPose( &Pose, &g_LastPose ) )
+		{
+			// The camera was held still since the last key; keep it still until it moved
+			const DXUT_CAMERA_KEY* pLast = g_Trajectory.GetKey( g_Trajectory.GetNumKeys() - 1 );
+			if( g_LastPose.fTime > pLast->fTime )
+				g_Trajectory.AddKey( &g_LastPose );
+			g_Trajectory.AddKey( &Pose );
+		}
+		g_LastPose = Pose;
+	}
+}
+
+//--------------------------------------------------------------------------------------
+// Handle messages to the application
+//--------------------------------------------------------------------------------------
+LRESULT CALLBACK MsgProc( HWND hWnd, UINT uMsg, WPARAM wParam, LPARAM lParam, bool* pbNoFurtherProcessing,
+						  void* pUserContext )
+{
+	// Pass messages to dialog resource manager calls so GUI state is updated correctly
+	*pbNoFurtherProcessing = g_DialogResourceManager.MsgProc( hWnd, uMsg, wParam, lParam );
+	if( *pbNoFurtherProcessing )
+		return 0;
+
+	// Pass messages to settings dialog if its active
+	if( g_SettingsDlg.IsActive() )
+	{
+		g_SettingsDlg.MsgProc( hWnd, uMsg, wParam, lParam );
+		return 0;
+	}
+
+	// Give the dialogs a chance to handle the message first
+	*pbNoFurtherProcessing = g_HUD.MsgProc( hWnd, uMsg, wParam, lParam );
+	if( *pbNoFurtherProcessing )
+		return 0;
+	*pbNoFurtherProcessing = g_SampleUI.MsgProc( hWnd, uMsg, wParam, lParam );
+	if( *pbNoFurtherProcessing )
+		return 0;
+
+	// Pass all remaining windows messages to camera so it can respond to user input
+	g_Camera.HandleMessages( hWnd, uMsg, wParam, lParam );
+
+	return 0;
 }
 
 //--------------------------------------------------------------------------------------
@@ -588,7 +935,7 @@ void CALLBACK OnD3D10DestroyDevice( void* pUserContext )
 	g_DialogResourceManager.OnD3D10DestroyDevice();
 	g_SettingsDlg.OnD3D10DestroyDevice();
 	DXUTGetGlobalResourceCache().OnDestroyDevice();
-	//SAFE_DELETE( g_pTxtHelper );
+	SAFE_DELETE( g_pTxtHelper );
 	SAFE_RELEASE( g_pVertexLayout );
 	SAFE_RELEASE( g_pFont10 );
 	SAFE_RELEASE( g_pSprite10 );
@@ -597,8 +944,10 @@ void CALLBACK OnD3D10DestroyDevice( void* pUserContext )
 	g_MeshLoader.Destroy();
 }
 
-void SaveImage(ID3D10Device* pd3dDevice, ID3D10RenderTargetView* pRTView)
+void SaveImage(ID3D10Device* pd3dDevice, ID3D10RenderTargetView* pRTView, const WCHAR* strFileName)
 {
+	DXUT_PROFILE_ZONE( "SaveImage" );
+
 	HRESULT hr;
 
 	ID3D10Resource *backbufferRes;
@@ -622,11 +971,88 @@ void SaveImage(ID3D10Device* pd3dDevice, ID3D10RenderTargetView* pRTView)
 	V( pd3dDevice->CreateTexture2D(&texDesc, 0, &texture) );
 	pd3dDevice->CopyResource(texture, backbufferRes);
 
-	V( D3DX10SaveTextureToFile(texture, D3DX10_IFF_BMP, L"test.bmp") );
+	V( D3DX10SaveTextureToFile(texture, D3DX10_IFF_BMP, strFileName) );
 	texture->Release();
 	backbufferRes->Release();
 }
 
+//--------------------------------------------------------------------------------------
+// Depth sequence capture.  The sequence is created on the first frame played back, at
+// the size of the back buffer then, and a resize part way stops the capture.
+//--------------------------------------------------------------------------------------
+bool IsSequenceCapture()
+{
+	size_t cchCapture = wcslen( g_strCaptureDir );
+	return cchCapture > 4 && 0 == _wcsicmp( g_strCaptureDir + cchCapture - 4, L".dsq" );
+}
+
+void SaveDepthFrame( ID3D10Device* pd3dDevice, const DXUT_CAMERA_KEY* pPose, const D3DXMATRIX* pProj )
+{
+	DXUT_PROFILE_ZONE( "SaveDepthFrame" );
+
+	HRESULT hr;
+
+	if( !g_DepthSequence.IsOpen() )
+	{
+		if( g_iPlaybackFrame != 0 )
+			return;
+		char strFile[MAX_PATH * 3];
+		if( 0 == WideCharToMultiByte( CP_UTF8, 0, g_strCaptureDir, -1, strFile, sizeof( strFile ), NULL, NULL ) ||
+			!g_DepthSequence.Create( strFile, g_width, g_height, 64 ) )
+		{
+			DXUTOutputDebugString( L"Could not create %s\n", g_strCaptureDir );
+			return;
+		}
+	}
+	if( g_DepthSequence.GetWidth() != ( UINT )g_width || g_DepthSequence.GetHeight() != ( UINT )g_height )
+	{
+		DXUTOutputDebugString( L"The back buffer was resized, %s stops at %u frames\n", g_strCaptureDir,
+							   g_DepthSequence.GetNumFrames() );
+		g_DepthSequence.Close();
+		return;
+	}
+
+	D3D10_TEXTURE2D_DESC texDesc;
+	g_pDepthStencilTexture->GetDesc( &texDesc );
+	texDesc.BindFlags = 0;
+	texDesc.CPUAccessFlags = D3D10_CPU_ACCESS_READ;
+	texDesc.Usage = D3D10_USAGE_STAGING;
+
+	ID3D10Texture2D *texture;
+	V( pd3dDevice->CreateTexture2D( &texDesc, 0, &texture ) );
+	if( FAILED( hr ) )
+		return;
+	pd3dDevice->CopyResource( texture, g_pDepthStencilTexture );
+
+	// The depth buffer holds z / w, with clip z = a w + b for either handedness.  Back
+	// to the w a linear depth image holds, and 0 where it is still cleared.
+	float a = pProj->_33 / pProj->_34;
+	float b = pProj->_43;
+
+	D3D10_MAPPED_TEXTURE2D mapped;
+	V( texture->Map( 0, D3D10_MAP_READ, 0, &mapped ) );
+	if( SUCCEEDED( hr ) )
+	{
+		// Rows come out top down; the sequence stores them bottom up
+		std::vector<float> depth( ( size_t )g_width * g_height );
+		for( int y = 0; y < g_height; y++ )
+		{
+			const USHORT* pRow = ( const USHORT* )( ( const BYTE* )mapped.pData + y * mapped.RowPitch );
+			float* pDepth = &depth[( size_t )( g_height - 1 - y ) * g_width];
+			for( int x = 0; x < g_width; x++ )
+			{
+				float d = pRow[x] / 65535.0f;
+				pDepth[x] = d < 1.0f ? b / ( d - a ) : 0.0f;
+			}
+		}
+		texture->Unmap( 0 );
+
+		if( !g_DepthSequence.AddFrame( &depth[0], g_width, pPose ) )
+			DXUTOutputDebugString( L"Could not write frame %u to %s\n", g_iPlaybackFrame, g_strCaptureDir );
+	}
+	texture->Release();
+}
+
 //--------------------------------------------------------------------------------------
 // Handle key presses
 //--------------------------------------------------------------------------------------
@@ -638,6 +1064,32 @@ void CALLBACK OnKeyboard( UINT nChar, bool bKeyDown, bool bAltDown, void* pUserC
 		{
 		case KEY_F:
 			g_bSaveImage = true;
+			break;
+
+		case KEY_R:
+			if( g_bRecording )
+				StopRecording();
+			else
+				StartRecording( true );
+			break;
+
+		case KEY_K:
+			if( !g_bRecording )
+				StartRecording( false );
+			else if( !g_bRecordMoves )
+			{
+				DXUT_CAMERA_KEY Pose;
+				GetCameraPose( DXUTGetTime() - g_fRecordStart, &Pose );
+				g_Trajectory.AddKey( &Pose );
+			}
+			break;
+
+		case KEY_P:
+			if( g_bPlaying )
+				g_bPlaying = false;
+			else
+				StartPlayback();
+			break;
 		}
 	}
 }
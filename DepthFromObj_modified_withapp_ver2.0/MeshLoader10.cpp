@@ -8,12 +8,13 @@
 //--------------------------------------------------------------------------------------
 #include "DXUT.h"
 #include "SDKmisc.h"
+#include "DXUTProfiler.h"
 #pragma warning(disable: 4995)
 #include "meshloader10.h"
-#include <fstream>
-using namespace std;
 #pragma warning(default: 4995)
 
+C_ASSERT( sizeof( VERTEX ) == sizeof( DXUTOBJ_VERTEX ) );
+
 
 // Define the input layout
 const D3D10_INPUT_ELEMENT_DESC layout_CMeshLoader10[] =
@@ -26,7 +27,83 @@ UINT numElements_layout_CMeshLoader10 = sizeof( layout_CMeshLoader10 ) / sizeof(
 
 
 //--------------------------------------------------------------------------------------
-CMeshLoader10::CMeshLoader10()
+static double SecondsSince( DXUT_PROFILE_TIME tStart )
+{
+    return ( DXUTProfilerGetTimeNs() - tStart ) * 1e-9;
+}
+
+
+//--------------------------------------------------------------------------------------
+// Size estimates for DXUTMemTrack.  D3DX keeps a system memory copy of the mesh next to
+// the committed device buffers, so both are counted.
+//--------------------------------------------------------------------------------------
+static UINT64 GetMeshBytes( ID3DX10Mesh* pMesh )
+{
+    UINT64 nBytes = ( UINT64 )pMesh->GetVertexCount() * sizeof( VERTEX ) +
+                    ( UINT64 )pMesh->GetFaceCount() * ( 3 * sizeof( DWORD ) + sizeof( UINT ) );
+    return 2 * nBytes;
+}
+
+static UINT64 GetTextureBytes( ID3D10ShaderResourceView* pTextureRV )
+{
+    UINT64 nBytes = 0;
+    ID3D10Resource* pResource = NULL;
+    ID3D10Texture2D* pTexture = NULL;
+    pTextureRV->GetResource( &pResource );
+    if( pResource && SUCCEEDED( pResource->QueryInterface( __uuidof( ID3D10Texture2D ), ( void** )&pTexture ) ) )
+    {
+        D3D10_TEXTURE2D_DESC Desc;
+        pTexture->GetDesc( &Desc );
+
+        UINT nBits = 32;
+        bool bBlockCompressed = false;
+        switch( Desc.Format )
+        {
+            case DXGI_FORMAT_BC1_UNORM: case DXGI_FORMAT_BC1_UNORM_SRGB: case DXGI_FORMAT_BC4_UNORM:
+                nBits = 4; bBlockCompressed = true; break;
+            case DXGI_FORMAT_BC2_UNORM: case DXGI_FORMAT_BC2_UNORM_SRGB: case DXGI_FORMAT_BC3_UNORM:
+            case DXGI_FORMAT_BC3_UNORM_SRGB: case DXGI_FORMAT_BC5_UNORM:
+                nBits = 8; bBlockCompressed = true; break;
+            case DXGI_FORMAT_R8_UNORM: case DXGI_FORMAT_A8_UNORM:
+                nBits = 8; break;
+            case DXGI_FORMAT_R8G8_UNORM: case DXGI_FORMAT_R16_UNORM: case DXGI_FORMAT_B5G6R5_UNORM:
+                nBits = 16; break;
+            case DXGI_FORMAT_R16G16B16A16_UNORM: case DXGI_FORMAT_R16G16B16A16_FLOAT:
+                nBits = 64; break;
+            case DXGI_FORMAT_R32G32B32A32_FLOAT:
+                nBits = 128; break;
+        }
+
+        for( UINT iMip = 0; iMip < Desc.MipLevels; iMip++ )
+        {
+            UINT64 nWidth = __max( 1, Desc.Width >> iMip );
+            UINT64 nHeight = __max( 1, Desc.Height >> iMip );
+            if( bBlockCompressed )
+                nBytes += ( ( nWidth + 3 ) / 4 ) * ( ( nHeight + 3 ) / 4 ) * 2 * nBits;
+            else
+                nBytes += nWidth * nHeight * nBits / 8;
+        }
+        nBytes *= Desc.ArraySize;
+    }
+    SAFE_RELEASE( pTexture );
+    SAFE_RELEASE( pResource );
+    return nBytes;
+}
+
+
+//--------------------------------------------------------------------------------------
+// Names in CDXUTObjGeometry are UTF-8; anything that doesn't convert is left empty
+//--------------------------------------------------------------------------------------
+static void CopyFromUTF8( WCHAR* wstrDest, const char* strSource )
+{
+    if( 0 == MultiByteToWideChar( CP_UTF8, 0, strSource, -1, wstrDest, MAX_PATH ) )
+        wstrDest[0] = 0;
+}
+
+
+//--------------------------------------------------------------------------------------
+CMeshLoader10::CMeshLoader10() :
+    m_MaterialArena( DXUT_MEM_MATERIALS, 16 * sizeof( Material ) )
 {
     m_pd3dDevice = NULL;
     m_pMesh = NULL;
@@ -35,6 +112,7 @@ CMeshLoader10::CMeshLoader10()
     m_pAttribTable = NULL;
 
     ZeroMemory( m_strMediaDir, sizeof( m_strMediaDir ) );
+    ZeroMemory( &m_Stats, sizeof( m_Stats ) );
 }
 
 
@@ -45,6 +123,27 @@ CMeshLoader10::~CMeshLoader10()
 }
 
 
+//--------------------------------------------------------------------------------------
+UINT64 CMeshLoader10::GetTextureBytes()
+{
+    UINT64 nBytes = 0;
+    for( int iMaterial = 0; iMaterial < m_Materials.GetSize(); ++iMaterial )
+    {
+        ID3D10ShaderResourceView* pTextureRV = m_Materials.GetAt( iMaterial )->pTextureRV10;
+        if( pTextureRV == NULL || IsErrorResource( pTextureRV ) )
+            continue;
+
+        // Materials naming the same file get the same view from the resource cache
+        bool bCounted = false;
+        for( int iPrev = 0; !bCounted && iPrev < iMaterial; ++iPrev )
+            bCounted = m_Materials.GetAt( iPrev )->pTextureRV10 == pTextureRV;
+        if( !bCounted )
+            nBytes += ::GetTextureBytes( pTextureRV );
+    }
+    return nBytes;
+}
+
+
 //--------------------------------------------------------------------------------------
 void CMeshLoader10::Destroy()
 {
@@ -54,6 +153,8 @@ void CMeshLoader10::Destroy()
 
         if ( pMaterial->pTextureRV10 && !IsErrorResource(pMaterial->pTextureRV10) )
         {
+            DXUT_MEM_FREE( DXUT_MEM_TEXTURES, ( size_t )GetTextureBytes( pMaterial->pTextureRV10 ) );
+
             ID3D10Resource* pRes = NULL;
             
             pMaterial->pTextureRV10->GetResource( &pRes );
@@ -62,18 +163,19 @@ void CMeshLoader10::Destroy()
 
             SAFE_RELEASE( pMaterial->pTextureRV10 );
         }
-
-        SAFE_DELETE( pMaterial );
     }
 
+    // The materials themselves live in the arena
     m_Materials.RemoveAll();
-    m_Vertices.RemoveAll();
-    m_Indices.RemoveAll();
-    m_Attributes.RemoveAll();
+    m_MaterialArena.Release();
 
+    if( m_pAttribTable )
+        DXUT_MEM_FREE( DXUT_MEM_MESH, m_NumAttribTableEntries * sizeof( D3DX10_ATTRIBUTE_RANGE ) );
     SAFE_DELETE_ARRAY( m_pAttribTable );
     m_NumAttribTableEntries = 0;
 
+    if( m_pMesh )
+        DXUT_MEM_FREE( DXUT_MEM_MESH, ( size_t )GetMeshBytes( m_pMesh ) );
     SAFE_RELEASE( m_pMesh );
     m_pd3dDevice = NULL;
 }
@@ -82,6 +184,8 @@ void CMeshLoader10::Destroy()
 //--------------------------------------------------------------------------------------
 HRESULT CMeshLoader10::Create( ID3D10Device* pd3dDevice, const WCHAR* strFilename )
 {
+    DXUT_PROFILE_ZONE( "CMeshLoader10::Create" );
+
     HRESULT hr;
     WCHAR str[ MAX_PATH ] = {0};
 
@@ -90,11 +194,14 @@ HRESULT CMeshLoader10::Create( ID3D10Device* pd3dDevice, const WCHAR* strFilenam
 
     // Store the device pointer
     m_pd3dDevice = pd3dDevice;
+    ZeroMemory( &m_Stats, sizeof( m_Stats ) );
+    DXUT_MEM_BEGIN_TIMELINE();
 
     // Load the vertex buffer, index buffer, and subset information from a file. In this case, 
     // an .obj file was chosen for simplicity, but it's meant to illustrate that ID3DXMesh objects
     // can be filled from any mesh file format once the necessary data is extracted from file.
-    V_RETURN( LoadGeometryFromOBJ( strFilename ) );
+    CDXUTObjGeometry Geometry;
+    V_RETURN( LoadGeometryFromOBJ( strFilename, &Geometry ) );
 
     // Set the current directory based on where the mesh was found
     WCHAR wstrOldDir[MAX_PATH] = {0};
@@ -102,59 +209,158 @@ HRESULT CMeshLoader10::Create( ID3D10Device* pd3dDevice, const WCHAR* strFilenam
     SetCurrentDirectory( m_strMediaDir );    
 
     // Load material textures
-    for ( int iMaterial = 0; iMaterial < m_Materials.GetSize(); ++iMaterial )
     {
-        Material *pMaterial = m_Materials.GetAt( iMaterial );
-        if ( pMaterial->strTexture[0] )
-        {            
-            pMaterial->pTextureRV10 = (ID3D10ShaderResourceView*)ERROR_RESOURCE_VALUE;
-
-            if ( SUCCEEDED(DXUTFindDXSDKMediaFileCch( str, MAX_PATH, pMaterial->strTexture) ) )
-            {
-                DXUTGetGlobalResourceCache().CreateTextureFromFile( pd3dDevice, str, 
-                    &pMaterial->pTextureRV10, false ) ;
+        DXUT_PROFILE_ZONE( "Load textures" );
+        DXUT_PROFILE_TIME tStart = DXUTProfilerGetTimeNs();
+        for ( int iMaterial = 0; iMaterial < m_Materials.GetSize(); ++iMaterial )
+        {
+            Material *pMaterial = m_Materials.GetAt( iMaterial );
+            if ( pMaterial->strTexture[0] )
+            {            
+                pMaterial->pTextureRV10 = (ID3D10ShaderResourceView*)ERROR_RESOURCE_VALUE;
+
+                if ( SUCCEEDED(DXUTFindDXSDKMediaFileCch( str, MAX_PATH, pMaterial->strTexture) ) )
+                {
+                    if( SUCCEEDED( DXUTGetGlobalResourceCache().CreateTextureFromFile( pd3dDevice, str,
+                        &pMaterial->pTextureRV10, false ) ) )
+                        DXUT_MEM_ALLOC( DXUT_MEM_TEXTURES, ( size_t )GetTextureBytes( pMaterial->pTextureRV10 ) );
+                }
             }
         }
+        m_Stats.fMaterialSeconds += SecondsSince( tStart );
+        DXUT_MEM_PHASE( "Load textures" );
     }
 
     // Restore the original current directory
     SetCurrentDirectory( wstrOldDir );
 
+    V_RETURN( CreateMeshFromGeometry( &Geometry ) );
+    DXUT_MEM_REPORT( "CMeshLoader10::Create" );
+    return S_OK;
+}
+
+
+//--------------------------------------------------------------------------------------
+// Generated shapes have no textures and no duplicate vertices to weld, so they go
+// straight into the arrays of the geometry
+//--------------------------------------------------------------------------------------
+HRESULT CMeshLoader10::CreateFromShapes( ID3D10Device* pd3dDevice, const DXUT_SHAPE_INSTANCE* pInstances,
+                                         UINT NumInstances )
+{
+    DXUT_PROFILE_ZONE( "CMeshLoader10::CreateFromShapes" );
+
+    C_ASSERT( sizeof( VERTEX ) == sizeof( DXUTSHAPE_VERTEX ) );
+
+    HRESULT hr;
+
+    // Start clean
+    Destroy();
+
+    m_pd3dDevice = pd3dDevice;
+    ZeroMemory( &m_Stats, sizeof( m_Stats ) );
+    DXUT_MEM_BEGIN_TIMELINE();
+
+    UINT NumVertices, NumIndices;
+    if( !DXUTGetShapeSceneCounts( pInstances, NumInstances, &NumVertices, &NumIndices ) ||
+        NumVertices > INT_MAX || NumIndices > INT_MAX )
+        return E_INVALIDARG;
+
+    CDXUTObjGeometry Geometry;
+    if( !Geometry.SetSize( NumVertices, NumIndices ) )
+        return E_OUTOFMEMORY;
+
+    {
+        DXUT_PROFILE_ZONE( "Generate shapes" );
+        DXUT_PROFILE_TIME tStart = DXUTProfilerGetTimeNs();
+        if( !DXUTGenerateShapeScene( pInstances, NumInstances, ( DXUTSHAPE_VERTEX* )Geometry.GetVertices(),
+                                     Geometry.GetIndices(), Geometry.GetAttributes() ) )
+            return E_INVALIDARG;
+        m_Stats.fParseSeconds = SecondsSince( tStart );
+        DXUT_MEM_PHASE( "Generate shapes" );
+    }
+
+    // One material per attribute, shaded a little differently so instances can be told apart
+    UINT NumMaterials = 0;
+    for( UINT i = 0; i < NumInstances; i++ )
+        NumMaterials = __max( NumMaterials, pInstances[i].Attribute + 1 );
+
+    for( UINT i = 0; i < NumMaterials; i++ )
+    {
+        Material* pMaterial = m_MaterialArena.New<Material>();
+        if( pMaterial == NULL )
+            return E_OUTOFMEMORY;
+
+        InitMaterial( pMaterial );
+        swprintf_s( pMaterial->strName, MAX_PATH, L"shape%u", i );
+        float fShade = 0.4f + 0.6f * ( float )( ( i * 7 ) % 11 ) / 10.0f;
+        pMaterial->vDiffuse = D3DXVECTOR3( fShade, 0.8f, 1.2f - fShade );
+        m_Materials.Add( pMaterial );
+    }
+
+    V_RETURN( CreateMeshFromGeometry( &Geometry ) );
+    DXUT_MEM_REPORT( "CMeshLoader10::CreateFromShapes" );
+    return S_OK;
+}
+
+
+//--------------------------------------------------------------------------------------
+// Build the D3DX mesh from the vertex, index and attribute arrays.  The geometry is
+// released as soon as D3DX has its own copy.
+//--------------------------------------------------------------------------------------
+HRESULT CMeshLoader10::CreateMeshFromGeometry( CDXUTObjGeometry* pGeometry )
+{
+    HRESULT hr;
+
+    DXUT_PROFILE_ZONE( "Create D3DX mesh" );
+
     // Create the encapsulated mesh
     ID3DX10Mesh *pMesh = NULL;
 
-    V_RETURN( D3DX10CreateMesh( pd3dDevice,
+    V_RETURN( D3DX10CreateMesh( m_pd3dDevice,
                                 layout_CMeshLoader10,
                                 numElements_layout_CMeshLoader10,
                                 layout_CMeshLoader10[0].SemanticName,
-                                m_Vertices.GetSize(),
-                                m_Indices.GetSize() / 3,
+                                pGeometry->GetNumVertices(),
+                                pGeometry->GetNumIndices() / 3,
                                 D3DX10_MESH_32_BIT,
                                 &pMesh ) );
 
     // Set the vertex data
-    pMesh->SetVertexData( 0, (void*)m_Vertices.GetData() );
-    m_Vertices.RemoveAll();
+    pMesh->SetVertexData( 0, (void*)pGeometry->GetVertices() );
 
     // Set the index data
-    pMesh->SetIndexData( (void*)m_Indices.GetData(), m_Indices.GetSize() );
-    m_Indices.RemoveAll();
+    pMesh->SetIndexData( (void*)pGeometry->GetIndices(), pGeometry->GetNumIndices() );
 
     // Set the attribute data
-    pMesh->SetAttributeData( (UINT*)m_Attributes.GetData() );
-    m_Attributes.RemoveAll();
+    pMesh->SetAttributeData( (UINT*)pGeometry->GetAttributes() );
+    pGeometry->Release();
+    DXUT_MEM_ALLOC( DXUT_MEM_MESH, ( size_t )GetMeshBytes( pMesh ) );
+    DXUT_MEM_PHASE( "Create mesh" );
 
     // Reorder the vertices according to subset and optimize the mesh for this graphics 
     // card's vertex cache. When rendering the mesh's triangle list the vertices will 
     // cache hit more often so it won't have to re-execute the vertex shader.
-    V( pMesh->GenerateAdjacencyAndPointReps( 1e-6f ) );
-    V( pMesh->Optimize( D3DXMESHOPT_ATTRSORT | D3DXMESHOPT_VERTEXCACHE, NULL, NULL ) );
+    {
+        DXUT_PROFILE_ZONE( "Optimize mesh" );
+        DXUT_PROFILE_TIME tStart = DXUTProfilerGetTimeNs();
+        V( pMesh->GenerateAdjacencyAndPointReps( 1e-6f ) );
+        V( pMesh->Optimize( D3DXMESHOPT_ATTRSORT | D3DXMESHOPT_VERTEXCACHE, NULL, NULL ) );
+        m_Stats.fOptimizeSeconds = SecondsSince( tStart );
+        DXUT_MEM_PHASE( "Optimize mesh" );
+    }
 
     pMesh->GetAttributeTable( NULL, &m_NumAttribTableEntries );
     m_pAttribTable = new D3DX10_ATTRIBUTE_RANGE[m_NumAttribTableEntries];
+    DXUT_MEM_ALLOC( DXUT_MEM_MESH, m_NumAttribTableEntries * sizeof( D3DX10_ATTRIBUTE_RANGE ) );
     pMesh->GetAttributeTable( m_pAttribTable, &m_NumAttribTableEntries );
 
-    V( pMesh->CommitToDevice() );
+    {
+        DXUT_PROFILE_ZONE( "Commit to device" );
+        DXUT_PROFILE_TIME tStart = DXUTProfilerGetTimeNs();
+        V( pMesh->CommitToDevice() );
+        m_Stats.fCommitSeconds = SecondsSince( tStart );
+        DXUT_MEM_PHASE( "Commit to device" );
+    }
     
     m_pMesh = pMesh;
 
@@ -163,16 +369,21 @@ HRESULT CMeshLoader10::Create( ID3D10Device* pd3dDevice, const WCHAR* strFilenam
 
 
 //--------------------------------------------------------------------------------------
-HRESULT CMeshLoader10::LoadGeometryFromOBJ( const WCHAR* strFileName )
+// Parsing and welding are done by CDXUTObjGeometry, which the OpenGL tools share; this
+// finds the files through the SDK media search and turns its materials into Materials.
+//--------------------------------------------------------------------------------------
+HRESULT CMeshLoader10::LoadGeometryFromOBJ( const WCHAR* strFileName, CDXUTObjGeometry* pGeometry )
 {
-    WCHAR strMaterialFilename[MAX_PATH] = {0};
+    DXUT_PROFILE_ZONE( "CMeshLoader10::LoadGeometryFromOBJ" );
+
     WCHAR wstr[MAX_PATH];
-    char str[MAX_PATH];
+    char str[MAX_PATH * 3];
     HRESULT hr;
 
     // Find the file
     V_RETURN( DXUTFindDXSDKMediaFileCch( wstr, MAX_PATH, strFileName ) );
-    WideCharToMultiByte( CP_ACP, 0, wstr, -1, str, MAX_PATH, NULL, NULL );
+    if( 0 == WideCharToMultiByte( CP_UTF8, 0, wstr, -1, str, sizeof( str ), NULL, NULL ) )
+        return DXTRACE_ERR( L"WideCharToMultiByte", E_FAIL );
 
     // Store the directory where the mesh was found
     wcscpy_s( m_strMediaDir, MAX_PATH - 1, wstr );
@@ -180,377 +391,79 @@ HRESULT CMeshLoader10::LoadGeometryFromOBJ( const WCHAR* strFileName )
     if( pch )
         *pch = NULL;
 
-    // Create temporary storage for the input data. Once the data has been loaded into
-    // a reasonable format we can create a D3DXMesh object and load it with the mesh data.
-    CGrowableArray <D3DXVECTOR3> Positions;
-    CGrowableArray <D3DXVECTOR2> TexCoords;
-    CGrowableArray <D3DXVECTOR3> Normals;
-
-    // The first subset uses the default material
-    Material* pMaterial = new Material();
-    if( pMaterial == NULL )
-        return E_OUTOFMEMORY;
-
-    InitMaterial( pMaterial );
-    wcscpy_s( pMaterial->strName, MAX_PATH - 1, L"default" );
-    m_Materials.Add( pMaterial );
-
-    DWORD dwCurSubset = 0;
-
-    // File input
-    WCHAR strCommand[256] = {0};
-    wifstream InFile( str );
-    if( !InFile )
-        return DXTRACE_ERR( L"wifstream::open", E_FAIL );
-
-    for(; ; )
     {
-        InFile >> strCommand;
-        if( !InFile )
-            break;
-
-        if( 0 == wcscmp( strCommand, L"#" ) )
-        {
-            // Comment
-        }
-        else if( 0 == wcscmp( strCommand, L"v" ) )
-        {
-            // Vertex Position
-            float x, y, z;
-            InFile >> x >> y >> z;
-            Positions.Add( D3DXVECTOR3( x, y, z ) );
-        }
-        else if( 0 == wcscmp( strCommand, L"vt" ) )
-        {
-            // Vertex TexCoord
-            float u, v;
-            InFile >> u >> v;
-            TexCoords.Add( D3DXVECTOR2( u, v ) );
-        }
-        else if( 0 == wcscmp( strCommand, L"vn" ) )
-        {
-            // Vertex Normal
-            float x, y, z;
-            InFile >> x >> y >> z;
-            Normals.Add( D3DXVECTOR3( x, y, z ) );
-        }
-        else if( 0 == wcscmp( strCommand, L"f" ) )
-        {
-            // Face
-            UINT iPosition, iTexCoord, iNormal;
-            VERTEX vertex;
-
-            for( UINT iFace = 0; iFace < 3; iFace++ )
-            {
-                ZeroMemory( &vertex, sizeof( VERTEX ) );
-
-                // OBJ format uses 1-based arrays
-                InFile >> iPosition;
-                vertex.position = Positions[ iPosition - 1 ];
-
-                if( '/' == InFile.peek() )
-                {
-                    InFile.ignore();
-
-                    if( '/' != InFile.peek() )
-                    {
-                        // Optional texture coordinate
-                        InFile >> iTexCoord;
-                        vertex.texcoord = TexCoords[ iTexCoord - 1 ];
-                    }
-
-                    if( '/' == InFile.peek() )
-                    {
-                        InFile.ignore();
-
-                        // Optional vertex normal
-                        InFile >> iNormal;
-                        vertex.normal = Normals[ iNormal - 1 ];
-                    }
-                }
-
-                // If a duplicate vertex doesn't exist, add this vertex to the Vertices
-                // list. Store the index in the Indices array. The Vertices and Indices
-                // lists will eventually become the Vertex Buffer and Index Buffer for
-                // the mesh.
-                DWORD index = AddVertex( iPosition, &vertex );
-                if ( index == (DWORD)-1 )
-                   return E_OUTOFMEMORY;
-
-                m_Indices.Add( index );
-            }
-            m_Attributes.Add( dwCurSubset );
-        }
-        else if( 0 == wcscmp( strCommand, L"mtllib" ) )
-        {
-            // Material library
-            InFile >> strMaterialFilename;
-        }
-        else if( 0 == wcscmp( strCommand, L"usemtl" ) )
-        {
-            // Material
-            WCHAR strName[MAX_PATH] = {0};
-            InFile >> strName;
-
-            bool bFound = false;
-            for( int iMaterial = 0; iMaterial < m_Materials.GetSize(); iMaterial++ )
-            {
-                Material* pCurMaterial = m_Materials.GetAt( iMaterial );
-                if( 0 == wcscmp( pCurMaterial->strName, strName ) )
-                {
-                    bFound = true;
-                    dwCurSubset = iMaterial;
-                    break;
-                }
-            }
-
-            if( !bFound )
-            {
-                pMaterial = new Material();
-                if( pMaterial == NULL )
-                    return E_OUTOFMEMORY;
-
-                dwCurSubset = m_Materials.GetSize();
-
-                InitMaterial( pMaterial );
-                wcscpy_s( pMaterial->strName, MAX_PATH - 1, strName );
-
-                m_Materials.Add( pMaterial );
-            }
-        }
-        else
-        {
-            // Unimplemented or unrecognized command
-        }
-
-        InFile.ignore( 1000, '\n' );
+        DXUT_PROFILE_ZONE( "Parse OBJ" );
+        DXUT_PROFILE_TIME tParseStart = DXUTProfilerGetTimeNs();
+        if( !pGeometry->Load( str ) )
+            return DXTRACE_ERR( L"CDXUTObjGeometry::Load", E_FAIL );
+
+        m_Stats.FileBytes = pGeometry->GetFileBytes();
+        m_Stats.NumFaceVertices = pGeometry->GetNumFaceVertices();
+        m_Stats.fParseSeconds = SecondsSince( tParseStart );
+        DXUT_MEM_PHASE( "Parse OBJ" );
     }
 
-    // Cleanup
-    InFile.close();
-    DeleteCache();
-
     // If an associated material file was found, read that in as well.
-    if( strMaterialFilename[0] )
+    DXUT_PROFILE_TIME tStart = DXUTProfilerGetTimeNs();
+    if( pGeometry->GetMaterialLibrary()[0] )
     {
-        V_RETURN( LoadMaterialsFromMTL( strMaterialFilename ) );
+        WCHAR strMaterialFilename[MAX_PATH];
+        CopyFromUTF8( strMaterialFilename, pGeometry->GetMaterialLibrary() );
+        V_RETURN( LoadMaterialsFromMTL( strMaterialFilename, pGeometry ) );
     }
 
-    return S_OK;
-}
-
-
-//--------------------------------------------------------------------------------------
-DWORD CMeshLoader10::AddVertex( UINT hash, VERTEX* pVertex )
-{
-    // If this vertex doesn't already exist in the Vertices list, create a new entry.
-    // Add the index of the vertex to the Indices list.
-    bool bFoundInList = false;
-    DWORD index = 0;
-
-    // Since it's very slow to check every element in the vertex list, a hashtable stores
-    // vertex indices according to the vertex position's index as reported by the OBJ file
-    if( ( UINT )m_VertexCache.GetSize() > hash )
-    {
-        CacheEntry* pEntry = m_VertexCache.GetAt( hash );
-        while( pEntry != NULL )
-        {
-            VERTEX* pCacheVertex = m_Vertices.GetData() + pEntry->index;
-
-            // If this vertex is identical to the vertex already in the list, simply
-            // point the index buffer to the existing vertex
-            if( 0 == memcmp( pVertex, pCacheVertex, sizeof( VERTEX ) ) )
-            {
-                bFoundInList = true;
-                index = pEntry->index;
-                break;
-            }
-
-            pEntry = pEntry->pNext;
-        }
-    }
-
-    // Vertex was not found in the list. Create a new entry, both within the Vertices list
-    // and also within the hashtable cache
-    if( !bFoundInList )
+    // One Material per subset, starting with the default one
+    for( UINT iMaterial = 0; iMaterial < pGeometry->GetNumMaterials(); iMaterial++ )
     {
-        // Add to the Vertices list
-        index = m_Vertices.GetSize();
-        m_Vertices.Add( *pVertex );
-
-        // Add this to the hashtable
-        CacheEntry* pNewEntry = new CacheEntry;
-        if( pNewEntry == NULL )
-            return (DWORD)-1;
-
-        pNewEntry->index = index;
-        pNewEntry->pNext = NULL;
-
-        // Grow the cache if needed
-        while( ( UINT )m_VertexCache.GetSize() <= hash )
-        {
-            m_VertexCache.Add( NULL );
-        }
-
-        // Add to the end of the linked list
-        CacheEntry* pCurEntry = m_VertexCache.GetAt( hash );
-        if( pCurEntry == NULL )
-        {
-            // This is the head element
-            m_VertexCache.SetAt( hash, pNewEntry );
-        }
-        else
-        {
-            // Find the tail
-            while( pCurEntry->pNext != NULL )
-            {
-                pCurEntry = pCurEntry->pNext;
-            }
-
-            pCurEntry->pNext = pNewEntry;
-        }
-    }
-
-    return index;
-}
-
-
-//--------------------------------------------------------------------------------------
-void CMeshLoader10::DeleteCache()
-{
-    // Iterate through all the elements in the cache and subsequent linked lists
-    for( int i = 0; i < m_VertexCache.GetSize(); i++ )
-    {
-        CacheEntry* pEntry = m_VertexCache.GetAt( i );
-        while( pEntry != NULL )
-        {
-            CacheEntry* pNext = pEntry->pNext;
-            SAFE_DELETE( pEntry );
-            pEntry = pNext;
-        }
+        const DXUTOBJ_MATERIAL* pSource = pGeometry->GetMaterial( iMaterial );
+        Material* pMaterial = m_MaterialArena.New<Material>();
+        if( pMaterial == NULL )
+            return E_OUTOFMEMORY;
+
+        InitMaterial( pMaterial );
+        CopyFromUTF8( pMaterial->strName, pSource->strName );
+        CopyFromUTF8( pMaterial->strTexture, pSource->strTexture );
+        pMaterial->vAmbient = D3DXVECTOR3( pSource->vAmbient );
+        pMaterial->vDiffuse = D3DXVECTOR3( pSource->vDiffuse );
+        pMaterial->vSpecular = D3DXVECTOR3( pSource->vSpecular );
+        pMaterial->nShininess = pSource->nShininess;
+        pMaterial->fAlpha = pSource->fAlpha;
+        pMaterial->bSpecular = pSource->bSpecular;
+        m_Materials.Add( pMaterial );
     }
+    m_Stats.fMaterialSeconds += SecondsSince( tStart );
+    DXUT_MEM_PHASE( "Load materials" );
 
-    m_VertexCache.RemoveAll();
+    return S_OK;
 }
 
 
 //--------------------------------------------------------------------------------------
-HRESULT CMeshLoader10::LoadMaterialsFromMTL( const WCHAR* strFileName )
+HRESULT CMeshLoader10::LoadMaterialsFromMTL( const WCHAR* strFileName, CDXUTObjGeometry* pGeometry )
 {
-    HRESULT hr;
+    DXUT_PROFILE_ZONE( "CMeshLoader10::LoadMaterialsFromMTL" );
 
     // Set the current directory based on where the mesh was found
     WCHAR wstrOldDir[MAX_PATH] = {0};
     GetCurrentDirectory( MAX_PATH, wstrOldDir );
     SetCurrentDirectory( m_strMediaDir );
 
-    // Find the file
+    // Find the file.  The path may be relative to the media directory, so it is read
+    // before the current directory is restored.
     WCHAR strPath[MAX_PATH];
-    char cstrPath[MAX_PATH];
-    V_RETURN( DXUTFindDXSDKMediaFileCch( strPath, MAX_PATH, strFileName ) );
-    WideCharToMultiByte( CP_ACP, 0, strPath, -1, cstrPath, MAX_PATH, NULL, NULL );
-
-    // File input
-    WCHAR strCommand[256] = {0};
-    wifstream InFile( cstrPath );
-    if( !InFile )
-        return DXTRACE_ERR( L"wifstream::open", E_FAIL );
-
-    // Restore the original current directory
-    SetCurrentDirectory( wstrOldDir );
-
-    Material* pMaterial = NULL;
-
-    for(; ; )
+    char cstrPath[MAX_PATH * 3];
+    HRESULT hr = DXUTFindDXSDKMediaFileCch( strPath, MAX_PATH, strFileName );
+    if( SUCCEEDED( hr ) )
     {
-        InFile >> strCommand;
-        if( !InFile )
-            break;
-
-        if( 0 == wcscmp( strCommand, L"newmtl" ) )
-        {
-            // Switching active materials
-            WCHAR strName[MAX_PATH] = {0};
-            InFile >> strName;
-
-            pMaterial = NULL;
-            for( int i = 0; i < m_Materials.GetSize(); i++ )
-            {
-                Material* pCurMaterial = m_Materials.GetAt( i );
-                if( 0 == wcscmp( pCurMaterial->strName, strName ) )
-                {
-                    pMaterial = pCurMaterial;
-                    break;
-                }
-            }
-        }
-
-        // The rest of the commands rely on an active material
-        if( pMaterial == NULL )
-            continue;
-
-        if( 0 == wcscmp( strCommand, L"#" ) )
-        {
-            // Comment
-        }
-        else if( 0 == wcscmp( strCommand, L"Ka" ) )
-        {
-            // Ambient color
-            float r, g, b;
-            InFile >> r >> g >> b;
-            pMaterial->vAmbient = D3DXVECTOR3( r, g, b );
-        }
-        else if( 0 == wcscmp( strCommand, L"Kd" ) )
-        {
-            // Diffuse color
-            float r, g, b;
-            InFile >> r >> g >> b;
-            pMaterial->vDiffuse = D3DXVECTOR3( r, g, b );
-        }
-        else if( 0 == wcscmp( strCommand, L"Ks" ) )
-        {
-            // Specular color
-            float r, g, b;
-            InFile >> r >> g >> b;
-            pMaterial->vSpecular = D3DXVECTOR3( r, g, b );
-        }
-        else if( 0 == wcscmp( strCommand, L"d" ) ||
-                 0 == wcscmp( strCommand, L"Tr" ) )
-        {
-            // Alpha
-            InFile >> pMaterial->fAlpha;
-        }
-        else if( 0 == wcscmp( strCommand, L"Ns" ) )
-        {
-            // Shininess
-            int nShininess;
-            InFile >> nShininess;
-            pMaterial->nShininess = nShininess;
-        }
-        else if( 0 == wcscmp( strCommand, L"illum" ) )
-        {
-            // Specular on/off
-            int illumination;
-            InFile >> illumination;
-            pMaterial->bSpecular = ( illumination == 2 );
-        }
-        else if( 0 == wcscmp( strCommand, L"map_Kd" ) )
-        {
-            // Texture
-            InFile >> pMaterial->strTexture;
-        }
-
-        else
-        {
-            // Unimplemented or unrecognized command
-        }
-
-        InFile.ignore( 1000, L'\n' );
+        if( 0 == WideCharToMultiByte( CP_UTF8, 0, strPath, -1, cstrPath, sizeof( cstrPath ), NULL, NULL ) ||
+            !pGeometry->LoadMaterials( cstrPath ) )
+            hr = DXTRACE_ERR( L"CDXUTObjGeometry::LoadMaterials", E_FAIL );
     }
 
-    InFile.close();
+    // Restore the original current directory
+    SetCurrentDirectory( wstrOldDir );
 
-    return S_OK;
+    return hr;
 }
 
 
@@ -10,6 +10,13 @@
 #define _MESHLOADER10_H_
 #pragma once
 
+#include "DXUTShapeGen.h"
+#include "DXUTMemTrack.h"
+#include "DXUTArena.h"
+#include "DXUTObjGeometry.h"
+
+// SDKmesh.h has the same helper; whichever header comes first defines it
+#ifndef ERROR_RESOURCE_VALUE
 #define ERROR_RESOURCE_VALUE 1
 
 template<typename TYPE> BOOL IsErrorResource( TYPE data )
@@ -18,6 +25,52 @@ template<typename TYPE> BOOL IsErrorResource( TYPE data )
         return TRUE;
     return FALSE;
 }
+#endif
+
+// CGrowableArray that reports its allocation to DXUTMemTrack under Tag.  Only the
+// members the loader uses are wrapped; anything that can reallocate goes through here.
+template<typename TYPE, DXUT_MEM_TAG Tag> class CTrackedGrowableArray : public CGrowableArray <TYPE>
+{
+public:
+    ~CTrackedGrowableArray()
+    {
+        RemoveAll();
+    }
+
+    HRESULT Add( const TYPE& value )
+    {
+        int nOldMaxSize = this->m_nMaxSize;
+        HRESULT hr = CGrowableArray <TYPE>::Add( value );
+        TrackResize( nOldMaxSize );
+        return hr;
+    }
+    HRESULT SetSize( int nNewMaxSize )
+    {
+        int nOldMaxSize = this->m_nMaxSize;
+        HRESULT hr = CGrowableArray <TYPE>::SetSize( nNewMaxSize );
+        TrackResize( nOldMaxSize );
+        return hr;
+    }
+    void    RemoveAll()
+    {
+        int nOldMaxSize = this->m_nMaxSize;
+        CGrowableArray <TYPE>::RemoveAll();
+        TrackResize( nOldMaxSize );
+    }
+
+private:
+    void    TrackResize( int nOldMaxSize )
+    {
+        if( nOldMaxSize != this->m_nMaxSize )
+        {
+            if( nOldMaxSize )
+                DXUT_MEM_FREE( Tag, nOldMaxSize * sizeof( TYPE ) );
+            if( this->m_nMaxSize )
+                DXUT_MEM_ALLOC( Tag, this->m_nMaxSize * sizeof( TYPE ) );
+        }
+    }
+};
+
 
 // Vertex format
 struct VERTEX
@@ -28,14 +81,6 @@ struct VERTEX
 };
 
 
-// Used for a hashtable vertex cache when creating the mesh from a .obj file
-struct CacheEntry
-{
-    UINT index;
-    CacheEntry* pNext;
-};
-
-
 // Material properties per mesh subset
 struct Material
 {
@@ -56,6 +101,18 @@ struct Material
 };
 
 
+// Timings of the last Create or CreateFromShapes, for the benchmarks
+struct MeshLoaderStats
+{
+    UINT64  FileBytes;          // Size of the .obj, 0 for shapes
+    UINT    NumFaceVertices;    // Face corners welded by CDXUTObjGeometry
+    double  fParseSeconds;      // Reading the .obj and welding vertices, or generating shapes
+    double  fMaterialSeconds;   // Reading the .mtl and loading textures
+    double  fOptimizeSeconds;   // Adjacency, attribute sort and vertex cache optimization
+    double  fCommitSeconds;     // Creating the device buffers
+};
+
+
 class CMeshLoader10
 {
 public:
@@ -63,6 +120,11 @@ public:
             ~CMeshLoader10();
 
     HRESULT Create( ID3D10Device* pd3dDevice, const WCHAR* strFilename );
+
+    // Builds the mesh from procedural shapes instead of a file, for synthetic benchmark
+    // scenes.  Each distinct instance attribute gets its own untextured material.
+    HRESULT CreateFromShapes( ID3D10Device* pd3dDevice, const DXUT_SHAPE_INSTANCE* pInstances,
+                              UINT NumInstances );
     void    Destroy();
 
 
@@ -92,29 +154,33 @@ public:
     {
         return m_strMediaDir;
     }
+    const MeshLoaderStats& GetLoadStats() const
+    {
+        return m_Stats;
+    }
+
+    // Video memory of the materials' textures, each texture counted once
+    UINT64  GetTextureBytes();
 
 private:
 
-    HRESULT LoadGeometryFromOBJ( const WCHAR* strFilename );
-    HRESULT LoadMaterialsFromMTL( const WCHAR* strFileName );
+    HRESULT LoadGeometryFromOBJ( const WCHAR* strFilename, CDXUTObjGeometry* pGeometry );
+    HRESULT CreateMeshFromGeometry( CDXUTObjGeometry* pGeometry );
+    HRESULT LoadMaterialsFromMTL( const WCHAR* strFileName, CDXUTObjGeometry* pGeometry );
     void    InitMaterial( Material* pMaterial );
 
-    DWORD   AddVertex( UINT hash, VERTEX* pVertex );
-    void    DeleteCache();
-
     ID3D10Device* m_pd3dDevice;    // Direct3D Device object associated with this mesh
     ID3DX10Mesh* m_pMesh;         // Encapsulated D3DX Mesh
 
-    CGrowableArray <CacheEntry*> m_VertexCache;   // Hashtable cache for locating duplicate vertices
-    CGrowableArray <VERTEX> m_Vertices;      // Filled and copied to the vertex buffer
-    CGrowableArray <DWORD> m_Indices;       // Filled and copied to the index buffer
-    CGrowableArray <DWORD> m_Attributes;    // Filled and copied to the attribute buffer
-    CGrowableArray <Material*> m_Materials;     // Holds material properties per subset
+    CTrackedGrowableArray <Material*, DXUT_MEM_MATERIALS> m_Materials;     // Holds material properties per subset
+    CDXUTArena m_MaterialArena;     // Owns the Materials; released by Destroy
 
     UINT        m_NumAttribTableEntries;
     D3DX10_ATTRIBUTE_RANGE *m_pAttribTable;
 
     WCHAR   m_strMediaDir[ MAX_PATH ];               // Directory where the mesh was found
+
+    MeshLoaderStats m_Stats;
 };
 
 #endif // _MESHLOADER_H_
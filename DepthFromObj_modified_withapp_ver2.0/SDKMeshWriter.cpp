@@ -0,0 +1,265 @@
+//--------------------------------------------------------------------------------------
+// File: SDKMeshWriter.cpp
+//
+// Serializes a CMeshLoader10 mesh into the .sdkmesh layout read by CDXUTSDKMesh.
+//--------------------------------------------------------------------------------------
+#include "DXUT.h"
+#include "SDKmesh.h"
+#include "DXUTProfiler.h"
+#pragma warning(disable: 4995)
+#include "meshloader10.h"
+#pragma warning(default: 4995)
+#include "SDKMeshWriter.h"
+
+
+// Buffer data is aligned so vertex and index arrays can be used in place straight out
+// of a memory mapped file
+#define SDKMESH_BUFFER_ALIGNMENT 16
+
+static UINT64 AlignSDKMeshOffset( UINT64 Offset )
+{
+    return ( Offset + SDKMESH_BUFFER_ALIGNMENT - 1 ) & ~( UINT64 )( SDKMESH_BUFFER_ALIGNMENT - 1 );
+}
+
+
+//--------------------------------------------------------------------------------------
+// Vertex declaration matching the VERTEX struct used by CMeshLoader10
+//--------------------------------------------------------------------------------------
+static void FillSDKMeshVertexDecl( D3DVERTEXELEMENT9* pDecl )
+{
+    const D3DVERTEXELEMENT9 End = D3DDECL_END();
+    for( UINT i = 0; i < MAX_VERTEX_ELEMENTS; i++ )
+        pDecl[i] = End;
+
+    const D3DVERTEXELEMENT9 Elements[] =
+    {
+        { 0, 0, D3DDECLTYPE_FLOAT3, D3DDECLMETHOD_DEFAULT, D3DDECLUSAGE_POSITION, 0 },
+        { 0, 12, D3DDECLTYPE_FLOAT3, D3DDECLMETHOD_DEFAULT, D3DDECLUSAGE_NORMAL, 0 },
+        { 0, 24, D3DDECLTYPE_FLOAT2, D3DDECLMETHOD_DEFAULT, D3DDECLUSAGE_TEXCOORD, 0 },
+    };
+    for( UINT i = 0; i < sizeof( Elements ) / sizeof( Elements[0] ); i++ )
+        pDecl[i] = Elements[i];
+}
+
+
+//--------------------------------------------------------------------------------------
+static void FillSDKMeshMaterial( SDKMESH_MATERIAL* pOut, const Material* pMaterial )
+{
+    WideCharToMultiByte( CP_ACP, 0, pMaterial->strName, -1, pOut->Name, MAX_MATERIAL_NAME, NULL, NULL );
+    pOut->Name[MAX_MATERIAL_NAME - 1] = 0;
+    WideCharToMultiByte( CP_ACP, 0, pMaterial->strTexture, -1, pOut->DiffuseTexture, MAX_TEXTURE_NAME, NULL, NULL );
+    pOut->DiffuseTexture[MAX_TEXTURE_NAME - 1] = 0;
+
+    pOut->Diffuse = D3DXVECTOR4( pMaterial->vDiffuse.x, pMaterial->vDiffuse.y, pMaterial->vDiffuse.z,
+                                 pMaterial->fAlpha );
+    pOut->Ambient = D3DXVECTOR4( pMaterial->vAmbient.x, pMaterial->vAmbient.y, pMaterial->vAmbient.z, 1.0f );
+    if( pMaterial->bSpecular )
+        pOut->Specular = D3DXVECTOR4( pMaterial->vSpecular.x, pMaterial->vSpecular.y, pMaterial->vSpecular.z, 1.0f );
+    else
+        pOut->Specular = D3DXVECTOR4( 0.0f, 0.0f, 0.0f, 1.0f );
+    pOut->Emissive = D3DXVECTOR4( 0.0f, 0.0f, 0.0f, 1.0f );
+    pOut->Power = ( FLOAT )pMaterial->nShininess;
+}
+
+
+//--------------------------------------------------------------------------------------
+HRESULT WriteSDKMesh( CMeshLoader10* pLoader, const WCHAR* strFilename )
+{
+    DXUT_PROFILE_ZONE( "WriteSDKMesh" );
+
+    HRESULT hr = S_OK;
+
+    ID3DX10Mesh* pMesh = pLoader->GetMesh();
+    if( pMesh == NULL )
+        return E_INVALIDARG;
+
+    UINT NumVertices = pMesh->GetVertexCount();
+    UINT NumIndices = pMesh->GetFaceCount() * 3;
+    UINT NumMaterials = pLoader->GetNumMaterials();
+
+    UINT NumSubsets = 0;
+    V_RETURN( pMesh->GetAttributeTable( NULL, &NumSubsets ) );
+    D3DX10_ATTRIBUTE_RANGE* pAttribTable = new D3DX10_ATTRIBUTE_RANGE[ NumSubsets ];
+    if( !pAttribTable )
+        return E_OUTOFMEMORY;
+    pMesh->GetAttributeTable( pAttribTable, &NumSubsets );
+
+    // 16-bit indices halve the index data whenever every vertex can be addressed
+    bool b16BitIndices = NumVertices <= 0xFFFF;
+    UINT IndexSize = b16BitIndices ? sizeof( WORD ) : sizeof( DWORD );
+
+    // Lay out the file: headers and non-buffer data first, then the aligned buffers
+    UINT64 Offset = sizeof( SDKMESH_HEADER );
+    UINT64 VertexStreamHeadersOffset = Offset;  Offset += sizeof( SDKMESH_VERTEX_BUFFER_HEADER );
+    UINT64 IndexStreamHeadersOffset = Offset;   Offset += sizeof( SDKMESH_INDEX_BUFFER_HEADER );
+    UINT64 MeshDataOffset = Offset;             Offset += sizeof( SDKMESH_MESH );
+    UINT64 SubsetDataOffset = Offset;           Offset += sizeof( SDKMESH_SUBSET ) * NumSubsets;
+    UINT64 FrameDataOffset = Offset;            Offset += sizeof( SDKMESH_FRAME );
+    UINT64 MaterialDataOffset = Offset;         Offset += sizeof( SDKMESH_MATERIAL ) * NumMaterials;
+    UINT64 SubsetListOffset = Offset;           Offset += sizeof( UINT ) * NumSubsets;
+    UINT64 BufferDataStart = AlignSDKMeshOffset( Offset );
+
+    UINT64 VertexDataSize = ( UINT64 )NumVertices * sizeof( VERTEX );
+    UINT64 IndexDataSize = ( UINT64 )NumIndices * IndexSize;
+    UINT64 VertexDataOffset = BufferDataStart;
+    UINT64 IndexDataOffset = AlignSDKMeshOffset( VertexDataOffset + VertexDataSize );
+    UINT64 FileSize = AlignSDKMeshOffset( IndexDataOffset + IndexDataSize );
+
+    if( FileSize > 0xFFFFFFFF )
+    {
+        SAFE_DELETE_ARRAY( pAttribTable );
+        return DXUT_ERR( L"WriteSDKMesh: mesh is too large for a single file", E_INVALIDARG );
+    }
+
+    BYTE* pFile = new BYTE[ ( SIZE_T )FileSize ];
+    if( !pFile )
+    {
+        SAFE_DELETE_ARRAY( pAttribTable );
+        return E_OUTOFMEMORY;
+    }
+    ZeroMemory( pFile, ( SIZE_T )FileSize );
+
+    SDKMESH_HEADER* pHeader = ( SDKMESH_HEADER* )pFile;
+    SDKMESH_VERTEX_BUFFER_HEADER* pVBHeader = ( SDKMESH_VERTEX_BUFFER_HEADER* )( pFile + VertexStreamHeadersOffset );
+    SDKMESH_INDEX_BUFFER_HEADER* pIBHeader = ( SDKMESH_INDEX_BUFFER_HEADER* )( pFile + IndexStreamHeadersOffset );
+    SDKMESH_MESH* pSDKMesh = ( SDKMESH_MESH* )( pFile + MeshDataOffset );
+    SDKMESH_SUBSET* pSubsets = ( SDKMESH_SUBSET* )( pFile + SubsetDataOffset );
+    SDKMESH_FRAME* pFrame = ( SDKMESH_FRAME* )( pFile + FrameDataOffset );
+    SDKMESH_MATERIAL* pMaterials = ( SDKMESH_MATERIAL* )( pFile + MaterialDataOffset );
+    UINT* pSubsetList = ( UINT* )( pFile + SubsetListOffset );
+
+    pHeader->Version = SDKMESH_FILE_VERSION;
+    pHeader->IsBigEndian = 0;
+    pHeader->HeaderSize = sizeof( SDKMESH_HEADER );
+    pHeader->NonBufferDataSize = BufferDataStart - sizeof( SDKMESH_HEADER );
+    pHeader->BufferDataSize = FileSize - BufferDataStart;
+    pHeader->NumVertexBuffers = 1;
+    pHeader->NumIndexBuffers = 1;
+    pHeader->NumMeshes = 1;
+    pHeader->NumTotalSubsets = NumSubsets;
+    pHeader->NumFrames = 1;
+    pHeader->NumMaterials = NumMaterials;
+    pHeader->VertexStreamHeadersOffset = VertexStreamHeadersOffset;
+    pHeader->IndexStreamHeadersOffset = IndexStreamHeadersOffset;
+    pHeader->MeshDataOffset = MeshDataOffset;
+    pHeader->SubsetDataOffset = SubsetDataOffset;
+    pHeader->FrameDataOffset = FrameDataOffset;
+    pHeader->MaterialDataOffset = MaterialDataOffset;
+
+    // Vertex data, read back from the optimized mesh
+    pVBHeader->NumVertices = NumVertices;
+    pVBHeader->SizeBytes = VertexDataSize;
+    pVBHeader->StrideBytes = sizeof( VERTEX );
+    pVBHeader->DataOffset = VertexDataOffset;
+    FillSDKMeshVertexDecl( pVBHeader->Decl );
+
+    D3DXVECTOR3 vMin( FLT_MAX, FLT_MAX, FLT_MAX );
+    D3DXVECTOR3 vMax( -FLT_MAX, -FLT_MAX, -FLT_MAX );
+
+    ID3DX10MeshBuffer* pVB = NULL;
+    VERTEX* pVertices = NULL;
+    SIZE_T cbVertices = 0;
+    hr = pMesh->GetVertexBuffer( 0, &pVB );
+    if( SUCCEEDED( hr ) )
+        hr = pVB->Map( ( void** )&pVertices, &cbVertices );
+    if( SUCCEEDED( hr ) )
+    {
+        CopyMemory( pFile + VertexDataOffset, pVertices, ( SIZE_T )VertexDataSize );
+        for( UINT i = 0; i < NumVertices; i++ )
+        {
+            D3DXVec3Minimize( &vMin, &vMin, &pVertices[i].position );
+            D3DXVec3Maximize( &vMax, &vMax, &pVertices[i].position );
+        }
+        pVB->Unmap();
+    }
+    SAFE_RELEASE( pVB );
+
+    // Index data, narrowed to 16 bits when possible
+    pIBHeader->NumIndices = NumIndices;
+    pIBHeader->SizeBytes = IndexDataSize;
+    pIBHeader->IndexType = b16BitIndices ? IT_16BIT : IT_32BIT;
+    pIBHeader->DataOffset = IndexDataOffset;
+
+    ID3DX10MeshBuffer* pIB = NULL;
+    DWORD* pIndices = NULL;
+    SIZE_T cbIndices = 0;
+    if( SUCCEEDED( hr ) )
+        hr = pMesh->GetIndexBuffer( &pIB );
+    if( SUCCEEDED( hr ) )
+        hr = pIB->Map( ( void** )&pIndices, &cbIndices );
+    if( SUCCEEDED( hr ) )
+    {
+        if( b16BitIndices )
+        {
+            WORD* pOut = ( WORD* )( pFile + IndexDataOffset );
+            for( UINT i = 0; i < NumIndices; i++ )
+                pOut[i] = ( WORD )pIndices[i];
+        }
+        else
+        {
+            CopyMemory( pFile + IndexDataOffset, pIndices, ( SIZE_T )IndexDataSize );
+        }
+        pIB->Unmap();
+    }
+    SAFE_RELEASE( pIB );
+
+    // One mesh, with a subset per attribute range
+    strcpy_s( pSDKMesh->Name, MAX_MESH_NAME, "mesh" );
+    pSDKMesh->NumVertexBuffers = 1;
+    pSDKMesh->VertexBuffers[0] = 0;
+    pSDKMesh->IndexBuffer = 0;
+    pSDKMesh->NumSubsets = NumSubsets;
+    pSDKMesh->NumFrameInfluences = 0;
+    pSDKMesh->BoundingBoxCenter = ( vMin + vMax ) * 0.5f;
+    pSDKMesh->BoundingBoxExtents = ( vMax - vMin ) * 0.5f;
+    pSDKMesh->SubsetOffset = SubsetListOffset;
+    pSDKMesh->FrameInfluenceOffset = SubsetListOffset + sizeof( UINT ) * NumSubsets;
+
+    for( UINT i = 0; i < NumSubsets; i++ )
+    {
+        sprintf_s( pSubsets[i].Name, MAX_SUBSET_NAME, "subset%u", i );
+        pSubsets[i].MaterialID = pAttribTable[i].AttribId;
+        pSubsets[i].PrimitiveType = PT_TRIANGLE_LIST;
+        pSubsets[i].IndexStart = ( UINT64 )pAttribTable[i].FaceStart * 3;
+        pSubsets[i].IndexCount = ( UINT64 )pAttribTable[i].FaceCount * 3;
+        // The indices are D3DX's, which count from the start of the vertex buffer, and
+        // CDXUTSDKMesh adds VertexStart to them as the base vertex when it draws; the
+        // vertex range the subset uses then starts at 0 too
+        pSubsets[i].VertexStart = 0;
+        pSubsets[i].VertexCount = ( UINT64 )pAttribTable[i].VertexStart + pAttribTable[i].VertexCount;
+        pSubsetList[i] = i;
+    }
+
+    // A single root frame places the mesh at the origin
+    strcpy_s( pFrame->Name, MAX_FRAME_NAME, "root" );
+    pFrame->Mesh = 0;
+    pFrame->ParentFrame = INVALID_FRAME;
+    pFrame->ChildFrame = INVALID_FRAME;
+    pFrame->SiblingFrame = INVALID_FRAME;
+    D3DXMatrixIdentity( &pFrame->Matrix );
+    pFrame->AnimationDataIndex = INVALID_ANIMATION_DATA;
+
+    for( UINT i = 0; i < NumMaterials; i++ )
+        FillSDKMeshMaterial( &pMaterials[i], pLoader->GetMaterial( i ) );
+
+    SAFE_DELETE_ARRAY( pAttribTable );
+
+    if( SUCCEEDED( hr ) )
+    {
+        HANDLE hFile = CreateFile( strFilename, GENERIC_WRITE, 0, NULL, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL );
+        if( INVALID_HANDLE_VALUE == hFile )
+        {
+            hr = HRESULT_FROM_WIN32( GetLastError() );
+        }
+        else
+        {
+            DWORD dwBytesWritten = 0;
+            if( !WriteFile( hFile, pFile, ( DWORD )FileSize, &dwBytesWritten, NULL ) || dwBytesWritten != FileSize )
+                hr = E_FAIL;
+            CloseHandle( hFile );
+        }
+    }
+
+    SAFE_DELETE_ARRAY( pFile );
+    return hr;
+}
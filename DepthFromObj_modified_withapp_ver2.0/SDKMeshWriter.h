@@ -0,0 +1,20 @@
+//--------------------------------------------------------------------------------------
+// File: SDKMeshWriter.h
+//
+// Writes the welded, optimized mesh built by CMeshLoader10 out as a .sdkmesh file, so
+// production runs can load it with CDXUTSDKMesh instead of parsing and optimizing the
+// .obj every time.
+//--------------------------------------------------------------------------------------
+#ifndef _SDKMESHWRITER_H_
+#define _SDKMESHWRITER_H_
+#pragma once
+
+class CMeshLoader10;
+
+// Writes one mesh with one subset per attribute table entry and one material per OBJ
+// material.  Indices are stored as 16-bit when every vertex can be addressed with
+// them and as 32-bit otherwise.  Texture names are written as they appear in the .mtl,
+// so the .sdkmesh should be written next to the .obj for CDXUTSDKMesh to find them.
+HRESULT WriteSDKMesh( CMeshLoader10* pLoader, const WCHAR* strFilename );
+
+#endif // _SDKMESHWRITER_H_
@@ -0,0 +1,661 @@
+//--------------------------------------------------------------------------------------
+// File: DepthRegression.cpp
+//
+// Golden-image regression test for the depth output.  Each mesh is rendered from a
+// fixed set of poses through the same pipeline as the viewer (MeshFromOBJ10.fx
+// "NoSpecular" into a 16-bit depth buffer), read back and converted to view space
+// depth with the viewer's linearization, then compared against stored references.
+//
+// A pixel passes when its error is within -abs world units or within -rel of the
+// reference depth.  Silhouettes and creases are masked out before comparing, since a
+// change in rasterization rules or vertex precision legitimately moves them by a
+// pixel: a pixel is masked when any of its 8 neighbours in the reference is background
+// or differs from it by more than -edge relative depth.  A pose fails when more than
+// -maxfail of its unmasked covered pixels fail, counting coverage changes as failures.
+//
+// Usage: DepthRegression [-capture] [-references dir] [-out dir] [-size 640x480]
+//                        [-abs 0.001] [-rel 0.0001] [-edge 0.02] [-maxfail 0]
+//                        [-reference_device] [mesh.obj ...]
+//
+// With no meshes a built in scene of procedural shapes is tested, plus every .obj in
+// media\ (the sample ships none).  -capture writes the references instead of comparing.
+// References are little-endian .pfm float images holding view space depth, 0 where
+// nothing was drawn.  Each comparison writes a diff image to the -out directory: the
+// reference depth in grey, passing errors in green scaled to the tolerance, failures
+// in red, coverage changes in magenta and masked pixels in blue.
+//
+// The references are not part of the build.  Capture them once from the sample
+// directory, on the reference device so they hold on any machine, and commit
+// media\depth_reference:
+//
+//      DepthRegression -capture -reference_device
+//
+// Compare with -reference_device as well.  Hardware captures only compare on the same
+// GPU and driver.  A change that is meant to move the depth output is recaptured the
+// same way, in the same commit.
+//
+// Exit code 0 when every pose passes, 1 when any fails and 2 when none fails but some
+// have no reference to compare against.
+//--------------------------------------------------------------------------------------
+#include "DXUT.h"
+#include "SDKmisc.h"
+#include "DXUTShapeGen.h"
+#pragma warning(disable: 4995)
+#include "meshloader10.h"
+#pragma warning(default: 4995)
+#include <stdio.h>
+#include <string>
+#include <vector>
+
+struct REGRESSION_SETTINGS
+{
+    bool bCapture;
+    bool bReferenceDevice;
+    UINT Width;
+    UINT Height;
+    float fAbsTolerance;
+    float fRelTolerance;
+    float fEdgeThreshold;
+    float fMaxFailFraction;
+    WCHAR strReferenceDir[MAX_PATH];
+    WCHAR strOutputDir[MAX_PATH];
+};
+
+struct REGRESSION_RESULT
+{
+    UINT NumCovered;            // Pixels covered in the reference or the output
+    UINT NumMasked;
+    UINT NumCompared;
+    UINT NumFailed;
+    UINT NumCoverageFailed;     // Unmasked pixels drawn in only one of the two
+    float fMaxError;
+    double fMeanError;
+};
+
+// Fixed camera directions around the mesh, in degrees
+static const struct
+{
+    float fYaw;
+    float fPitch;
+} s_Poses[] =
+{
+    { 0.0f, 15.0f },
+    { 90.0f, 15.0f },
+    { 180.0f, 15.0f },
+    { 270.0f, 15.0f },
+    { 45.0f, 60.0f },
+    { 225.0f, -30.0f },
+};
+
+static const D3D10_INPUT_ELEMENT_DESC s_MeshLayout[] =
+{
+    { "POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 0, D3D10_INPUT_PER_VERTEX_DATA, 0 },
+    { "NORMAL", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 12, D3D10_INPUT_PER_VERTEX_DATA, 0 },
+    { "TEXCOORD", 0, DXGI_FORMAT_R32G32_FLOAT, 0, 24, D3D10_INPUT_PER_VERTEX_DATA, 0 },
+};
+
+
+//--------------------------------------------------------------------------------------
+// Portable float map, the simplest float image format most viewers read
+//--------------------------------------------------------------------------------------
+static bool WritePFM( const WCHAR* strFilename, const float* pDepth, UINT Width, UINT Height )
+{
+    FILE* fp;
+    if( 0 != _wfopen_s( &fp, strFilename, L"wb" ) )
+        return false;
+
+    // Rows are stored bottom to top
+    bool bOK = fprintf( fp, "Pf\n%u %u\n-1.0\n", Width, Height ) > 0;
+    for( UINT y = Height; bOK && y-- > 0; )
+        bOK = Width == fwrite( pDepth + y * Width, sizeof( float ), Width, fp );
+    return ( 0 == fclose( fp ) ) && bOK;
+}
+
+static bool ReadPFM( const WCHAR* strFilename, std::vector<float>* pDepth, UINT* pWidth, UINT* pHeight )
+{
+    FILE* fp;
+    if( 0 != _wfopen_s( &fp, strFilename, L"rb" ) )
+        return false;
+
+    char strMagic[3] = { 0 };
+    float fScale = 0.0f;
+    bool bOK = 4 == fscanf_s( fp, "%2s %u %u %f", strMagic, ( unsigned )sizeof( strMagic ), pWidth, pHeight, &fScale ) &&
+               0 == strcmp( strMagic, "Pf" ) && fScale < 0.0f && *pWidth && *pHeight && '\n' == fgetc( fp );
+    if( bOK )
+    {
+        pDepth->resize( *pWidth * *pHeight );
+        for( UINT y = *pHeight; bOK && y-- > 0; )
+            bOK = *pWidth == fread( &( *pDepth )[y * *pWidth], sizeof( float ), *pWidth, fp );
+    }
+    fclose( fp );
+    return bOK;
+}
+
+
+//--------------------------------------------------------------------------------------
+// Renders depth the way the viewer does and reads it back as view space depth
+//--------------------------------------------------------------------------------------
+class CDepthCapture
+{
+public:
+    CDepthCapture() : m_pDevice( NULL ), m_pEffect( NULL ), m_pTechnique( NULL ), m_pWorldViewProjection( NULL ),
+                      m_pLayout( NULL ), m_pColor( NULL ), m_pDepth( NULL ), m_pStaging( NULL ), m_pRTV( NULL ),
+                      m_pDSV( NULL ), m_Width( 0 ), m_Height( 0 )
+    {
+    }
+    ~CDepthCapture()
+    {
+        SAFE_RELEASE( m_pDSV );
+        SAFE_RELEASE( m_pRTV );
+        SAFE_RELEASE( m_pStaging );
+        SAFE_RELEASE( m_pDepth );
+        SAFE_RELEASE( m_pColor );
+        SAFE_RELEASE( m_pLayout );
+        SAFE_RELEASE( m_pEffect );
+    }
+
+    HRESULT Create( ID3D10Device* pDevice, UINT Width, UINT Height )
+    {
+        HRESULT hr;
+        WCHAR str[MAX_PATH];
+        m_pDevice = pDevice;
+        m_Width = Width;
+        m_Height = Height;
+
+        V_RETURN( DXUTFindDXSDKMediaFileCch( str, MAX_PATH, L"MeshFromOBJ10.fx" ) );
+        V_RETURN( D3DX10CreateEffectFromFile( str, NULL, NULL, "fx_4_0", D3D10_SHADER_ENABLE_STRICTNESS, 0, pDevice,
+                                              NULL, NULL, &m_pEffect, NULL, NULL ) );
+        m_pTechnique = m_pEffect->GetTechniqueByName( "NoSpecular" );
+        m_pWorldViewProjection = m_pEffect->GetVariableByName( "g_mWorldViewProjection" )->AsMatrix();
+
+        D3D10_PASS_DESC PassDesc;
+        V_RETURN( m_pTechnique->GetPassByIndex( 0 )->GetDesc( &PassDesc ) );
+        V_RETURN( pDevice->CreateInputLayout( s_MeshLayout, ARRAYSIZE( s_MeshLayout ), PassDesc.pIAInputSignature,
+                                              PassDesc.IAInputSignatureSize, &m_pLayout ) );
+
+        // Same formats as the viewer's offscreen targets
+        D3D10_TEXTURE2D_DESC TexDesc;
+        ZeroMemory( &TexDesc, sizeof( TexDesc ) );
+        TexDesc.Width = Width;
+        TexDesc.Height = Height;
+        TexDesc.MipLevels = 1;
+        TexDesc.ArraySize = 1;
+        TexDesc.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
+        TexDesc.SampleDesc.Count = 1;
+        TexDesc.Usage = D3D10_USAGE_DEFAULT;
+        TexDesc.BindFlags = D3D10_BIND_RENDER_TARGET;
+        V_RETURN( pDevice->CreateTexture2D( &TexDesc, NULL, &m_pColor ) );
+        V_RETURN( pDevice->CreateRenderTargetView( m_pColor, NULL, &m_pRTV ) );
+
+        TexDesc.Format = DXGI_FORMAT_R16_TYPELESS;
+        TexDesc.BindFlags = D3D10_BIND_DEPTH_STENCIL;
+        V_RETURN( pDevice->CreateTexture2D( &TexDesc, NULL, &m_pDepth ) );
+
+        D3D10_DEPTH_STENCIL_VIEW_DESC DSDesc;
+        ZeroMemory( &DSDesc, sizeof( DSDesc ) );
+        DSDesc.Format = DXGI_FORMAT_D16_UNORM;
+        DSDesc.ViewDimension = D3D10_DSV_DIMENSION_TEXTURE2D;
+        V_RETURN( pDevice->CreateDepthStencilView( m_pDepth, &DSDesc, &m_pDSV ) );
+
+        TexDesc.Usage = D3D10_USAGE_STAGING;
+        TexDesc.BindFlags = 0;
+        TexDesc.CPUAccessFlags = D3D10_CPU_ACCESS_READ;
+        V_RETURN( pDevice->CreateTexture2D( &TexDesc, NULL, &m_pStaging ) );
+        return S_OK;
+    }
+
+    // pDepth receives Width * Height view space depths, 0 where nothing was drawn
+    HRESULT Capture( CMeshLoader10* pLoader, const D3DXMATRIX* pViewProjection, float fNear, float fFar,
+                     float* pDepth )
+    {
+        HRESULT hr;
+        float ClearColor[4] = { 0.0f, 0.0f, 0.0f, 1.0f };
+        D3D10_VIEWPORT Viewport = { 0, 0, m_Width, m_Height, 0.0f, 1.0f };
+        m_pDevice->RSSetViewports( 1, &Viewport );
+        m_pDevice->ClearRenderTargetView( m_pRTV, ClearColor );
+        m_pDevice->ClearDepthStencilView( m_pDSV, D3D10_CLEAR_DEPTH, 1.0f, 0 );
+        m_pDevice->OMSetRenderTargets( 1, &m_pRTV, m_pDSV );
+        m_pDevice->IASetInputLayout( m_pLayout );
+        m_pWorldViewProjection->SetMatrix( ( float* )pViewProjection );
+
+        for( UINT iSubset = 0; iSubset < pLoader->GetNumSubsets(); iSubset++ )
+        {
+            m_pTechnique->GetPassByIndex( 0 )->Apply( 0 );
+            pLoader->GetMesh()->DrawSubset( iSubset );
+        }
+        m_pDevice->OMSetRenderTargets( 0, NULL, NULL );
+        m_pDevice->CopyResource( m_pStaging, m_pDepth );
+
+        D3D10_MAPPED_TEXTURE2D Mapped;
+        V_RETURN( m_pStaging->Map( 0, D3D10_MAP_READ, 0, &Mapped ) );
+        for( UINT y = 0; y < m_Height; y++ )
+        {
+            const USHORT* pRow = ( const USHORT* )( ( const BYTE* )Mapped.pData + y * Mapped.RowPitch );
+            for( UINT x = 0; x < m_Width; x++ )
+            {
+                // Inverse of the projection, as PSQuad in MeshFromOBJ10.fx does before it
+                // scales to the near/far range for display
+                float d = pRow[x] / 65535.0f;
+                pDepth[y * m_Width + x] = ( 0xFFFF == pRow[x] ) ? 0.0f : fNear * fFar / ( fFar - d * ( fFar - fNear ) );
+            }
+        }
+        m_pStaging->Unmap( 0 );
+        return S_OK;
+    }
+
+private:
+    ID3D10Device* m_pDevice;
+    ID3D10Effect* m_pEffect;
+    ID3D10EffectTechnique* m_pTechnique;
+    ID3D10EffectMatrixVariable* m_pWorldViewProjection;
+    ID3D10InputLayout* m_pLayout;
+    ID3D10Texture2D* m_pColor;
+    ID3D10Texture2D* m_pDepth;
+    ID3D10Texture2D* m_pStaging;
+    ID3D10RenderTargetView* m_pRTV;
+    ID3D10DepthStencilView* m_pDSV;
+    UINT m_Width;
+    UINT m_Height;
+};
+
+
+//--------------------------------------------------------------------------------------
+// Camera for a pose, looking at the centre of the mesh's bounding sphere from 2.5 radii
+//--------------------------------------------------------------------------------------
+static void GetPoseCamera( const D3DXVECTOR3* pCenter, float fRadius, UINT iPose, float fAspect,
+                           D3DXMATRIX* pViewProjection, float* pfNear, float* pfFar )
+{
+    float fYaw = D3DXToRadian( s_Poses[iPose].fYaw );
+    float fPitch = D3DXToRadian( s_Poses[iPose].fPitch );
+    D3DXVECTOR3 vDir( sinf( fYaw ) * cosf( fPitch ), sinf( fPitch ), -cosf( fYaw ) * cosf( fPitch ) );
+    D3DXVECTOR3 vEye = *pCenter + vDir * ( 2.5f * fRadius );
+    D3DXVECTOR3 vUp( 0.0f, 1.0f, 0.0f );
+
+    *pfNear = 1.0f * fRadius;
+    *pfFar = 4.0f * fRadius;
+
+    D3DXMATRIX mView, mProj;
+    D3DXMatrixLookAtLH( &mView, &vEye, pCenter, &vUp );
+    D3DXMatrixPerspectiveFovLH( &mProj, D3DX_PI / 4, fAspect, *pfNear, *pfFar );
+    *pViewProjection = mView * mProj;
+}
+
+static void GetMeshBounds( ID3DX10Mesh* pMesh, D3DXVECTOR3* pCenter, float* pfRadius )
+{
+    D3DXVECTOR3 vMin( 0, 0, 0 ), vMax( 0, 0, 0 );
+    ID3DX10MeshBuffer* pVB = NULL;
+    if( SUCCEEDED( pMesh->GetVertexBuffer( 0, &pVB ) ) )
+    {
+        void* pData;
+        SIZE_T cbSize;
+        if( SUCCEEDED( pVB->Map( &pData, &cbSize ) ) )
+        {
+            D3DXComputeBoundingBox( ( D3DXVECTOR3* )pData, pMesh->GetVertexCount(), sizeof( VERTEX ), &vMin, &vMax );
+            pVB->Unmap();
+        }
+        SAFE_RELEASE( pVB );
+    }
+
+    *pCenter = ( vMin + vMax ) * 0.5f;
+    *pfRadius = D3DXVec3Length( &( vMax - *pCenter ) ) + 1e-3f;
+}
+
+
+//--------------------------------------------------------------------------------------
+// Per-pixel comparison.  pDiff receives an RGBA8 visualization.
+//--------------------------------------------------------------------------------------
+static void CompareDepth( const float* pReference, const float* pOutput, UINT Width, UINT Height,
+                          const REGRESSION_SETTINGS* pSettings, REGRESSION_RESULT* pResult, DWORD* pDiff )
+{
+    ZeroMemory( pResult, sizeof( REGRESSION_RESULT ) );
+    double fErrorSum = 0.0;
+
+    float fMaxDepth = 0.0f;
+    for( UINT i = 0; i < Width * Height; i++ )
+        fMaxDepth = __max( fMaxDepth, pReference[i] );
+
+    for( UINT y = 0; y < Height; y++ )
+    {
+        for( UINT x = 0; x < Width; x++ )
+        {
+            UINT i = y * Width + x;
+            float fRef = pReference[i];
+            float fOut = pOutput[i];
+            BYTE Grey = fMaxDepth > 0.0f && fRef > 0.0f ? ( BYTE )( 255.0f - 191.0f * fRef / fMaxDepth ) : 0;
+            DWORD Color = 0xFF000000 | Grey << 16 | Grey << 8 | Grey;
+
+            if( fRef > 0.0f || fOut > 0.0f )
+            {
+                pResult->NumCovered++;
+
+                bool bMasked = false;
+                for( UINT ny = ( y ? y - 1 : 0 ); ny <= __min( y + 1, Height - 1 ) && !bMasked; ny++ )
+                {
+                    for( UINT nx = ( x ? x - 1 : 0 ); nx <= __min( x + 1, Width - 1 ) && !bMasked; nx++ )
+                    {
+                        float fNeighbour = pReference[ny * Width + nx];
+                        bMasked = ( fNeighbour > 0.0f ) != ( fRef > 0.0f ) ||
+                                  fabsf( fNeighbour - fRef ) > pSettings->fEdgeThreshold * fRef;
+                    }
+                }
+
+                if( bMasked )
+                {
+                    pResult->NumMasked++;
+                    Color = 0xFFFF0000 | Grey << 8 | Grey;
+                }
+                else if( ( fRef > 0.0f ) != ( fOut > 0.0f ) )
+                {
+                    pResult->NumFailed++;
+                    pResult->NumCoverageFailed++;
+                    Color = 0xFFFF00FF;
+                }
+                else
+                {
+                    float fError = fabsf( fOut - fRef );
+                    float fTolerance = __max( pSettings->fAbsTolerance, pSettings->fRelTolerance * fRef );
+                    pResult->NumCompared++;
+                    pResult->fMaxError = __max( pResult->fMaxError, fError );
+                    fErrorSum += fError;
+
+                    if( fError > fTolerance )
+                    {
+                        pResult->NumFailed++;
+                        Color = 0xFF0000FF;
+                    }
+                    else if( fError > 0.0f )
+                    {
+                        BYTE Green = ( BYTE )( 64.0f + 191.0f * fError / fTolerance );
+                        Color = 0xFF000000 | Green << 8;
+                    }
+                }
+            }
+
+            // DXGI_FORMAT_R8G8B8A8_UNORM: red in the low byte
+            pDiff[i] = Color;
+        }
+    }
+
+    pResult->fMeanError = pResult->NumCompared ? fErrorSum / pResult->NumCompared : 0.0;
+}
+
+static HRESULT SaveDiffImage( ID3D10Device* pDevice, const DWORD* pDiff, UINT Width, UINT Height,
+                              const WCHAR* strFilename )
+{
+    HRESULT hr;
+    D3D10_TEXTURE2D_DESC TexDesc;
+    ZeroMemory( &TexDesc, sizeof( TexDesc ) );
+    TexDesc.Width = Width;
+    TexDesc.Height = Height;
+    TexDesc.MipLevels = 1;
+    TexDesc.ArraySize = 1;
+    TexDesc.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
+    TexDesc.SampleDesc.Count = 1;
+    TexDesc.Usage = D3D10_USAGE_DEFAULT;
+
+    D3D10_SUBRESOURCE_DATA InitData = { pDiff, Width * sizeof( DWORD ), 0 };
+    ID3D10Texture2D* pTexture = NULL;
+    V_RETURN( pDevice->CreateTexture2D( &TexDesc, &InitData, &pTexture ) );
+    hr = D3DX10SaveTextureToFile( pTexture, D3DX10_IFF_PNG, strFilename );
+    SAFE_RELEASE( pTexture );
+    return hr;
+}
+
+
+//--------------------------------------------------------------------------------------
+// The built in scene: a few procedural shapes with curved and flat faces and some
+// occlusion, so the harness has something to compare without any media
+//--------------------------------------------------------------------------------------
+static HRESULT CreateShapeScene( ID3D10Device* pDevice, CMeshLoader10* pLoader )
+{
+    DXUT_SHAPE_DESC Shapes[4];
+    ZeroMemory( Shapes, sizeof( Shapes ) );
+    Shapes[0].Type = DXUT_SHAPE_SPHERE;
+    Shapes[0].fSize[0] = 1.0f;
+    Shapes[0].nSlices = 48;
+    Shapes[0].nStacks = 24;
+    Shapes[1].Type = DXUT_SHAPE_TORUS;
+    Shapes[1].fSize[0] = 0.25f;
+    Shapes[1].fSize[1] = 1.0f;
+    Shapes[1].nSlices = 24;
+    Shapes[1].nStacks = 48;
+    Shapes[2].Type = DXUT_SHAPE_BOX;
+    Shapes[2].fSize[0] = Shapes[2].fSize[1] = Shapes[2].fSize[2] = 1.5f;
+    Shapes[2].nSlices = 4;
+    Shapes[3].Type = DXUT_SHAPE_CYLINDER;
+    Shapes[3].fSize[0] = 0.5f;
+    Shapes[3].fSize[1] = 0.25f;
+    Shapes[3].fSize[2] = 2.0f;
+    Shapes[3].nSlices = 32;
+    Shapes[3].nStacks = 4;
+
+    DXUT_SHAPE_INSTANCE Instances[12];
+    DXUTScatterShapeInstances( Shapes, ARRAYSIZE( Shapes ), ARRAYSIZE( Instances ), 3.0f, 37, Instances );
+    return pLoader->CreateFromShapes( pDevice, Instances, ARRAYSIZE( Instances ) );
+}
+
+
+//--------------------------------------------------------------------------------------
+// Captures or compares every pose of one mesh.  Returns the number of failed poses;
+// poses with no reference are not failures but are added to *pNumMissing.
+//--------------------------------------------------------------------------------------
+static UINT TestMesh( ID3D10Device* pDevice, CDepthCapture* pCapture, CMeshLoader10* pLoader, const WCHAR* strName,
+                      const REGRESSION_SETTINGS* pSettings, UINT* pNumMissing )
+{
+    D3DXVECTOR3 vCenter;
+    float fRadius;
+    GetMeshBounds( pLoader->GetMesh(), &vCenter, &fRadius );
+
+    UINT Width = pSettings->Width, Height = pSettings->Height;
+    std::vector<float> Depth( Width * Height );
+    std::vector<DWORD> Diff( Width * Height );
+    UINT NumFailed = 0;
+
+    for( UINT iPose = 0; iPose < ARRAYSIZE( s_Poses ); iPose++ )
+    {
+        D3DXMATRIX mViewProjection;
+        float fNear, fFar;
+        GetPoseCamera( &vCenter, fRadius, iPose, ( float )Width / ( float )Height, &mViewProjection, &fNear, &fFar );
+
+        WCHAR strReference[MAX_PATH];
+        swprintf_s( strReference, MAX_PATH, L"%s\\%s_pose%u.pfm", pSettings->strReferenceDir, strName, iPose );
+
+        if( FAILED( pCapture->Capture( pLoader, &mViewProjection, fNear, fFar, &Depth[0] ) ) )
+        {
+            wprintf( L"%-24s pose %u  FAILED to render\n", strName, iPose );
+            NumFailed++;
+            continue;
+        }
+
+        if( pSettings->bCapture )
+        {
+            if( !WritePFM( strReference, &Depth[0], Width, Height ) )
+            {
+                wprintf( L"Could not write %s\n", strReference );
+                NumFailed++;
+            }
+            else
+                wprintf( L"%-24s pose %u  captured\n", strName, iPose );
+            continue;
+        }
+
+        std::vector<float> Reference;
+        UINT RefWidth, RefHeight;
+        if( INVALID_FILE_ATTRIBUTES == GetFileAttributes( strReference ) )
+        {
+            wprintf( L"%-24s pose %u  no reference %s\n", strName, iPose, strReference );
+            ( *pNumMissing )++;
+            continue;
+        }
+        if( !ReadPFM( strReference, &Reference, &RefWidth, &RefHeight ) || RefWidth != Width || RefHeight != Height )
+        {
+            wprintf( L"%-24s pose %u  FAILED: %s is not a %ux%u reference\n", strName, iPose, strReference, Width,
+                     Height );
+            NumFailed++;
+            continue;
+        }
+
+        REGRESSION_RESULT Result;
+        CompareDepth( &Reference[0], &Depth[0], Width, Height, pSettings, &Result, &Diff[0] );
+
+        UINT NumUnmasked = Result.NumCovered - Result.NumMasked;
+        bool bPassed = Result.NumFailed <= pSettings->fMaxFailFraction * NumUnmasked;
+        if( !bPassed )
+            NumFailed++;
+
+        wprintf( L"%-24s pose %u  %s  max %.6f  mean %.6f  failed %u/%u (coverage %u)  masked %u\n", strName, iPose,
+                 bPassed ? L"pass" : L"FAIL", Result.fMaxError, Result.fMeanError, Result.NumFailed, NumUnmasked,
+                 Result.NumCoverageFailed, Result.NumMasked );
+
+        WCHAR strDiff[MAX_PATH];
+        swprintf_s( strDiff, MAX_PATH, L"%s\\%s_pose%u_diff.png", pSettings->strOutputDir, strName, iPose );
+        if( FAILED( SaveDiffImage( pDevice, &Diff[0], Width, Height, strDiff ) ) )
+            wprintf( L"Could not write %s\n", strDiff );
+    }
+
+    return NumFailed;
+}
+
+
+//--------------------------------------------------------------------------------------
+int wmain( int argc, WCHAR* argv[] )
+{
+    REGRESSION_SETTINGS Settings;
+    ZeroMemory( &Settings, sizeof( Settings ) );
+    Settings.Width = 640;
+    Settings.Height = 480;
+    Settings.fAbsTolerance = 0.001f;
+    Settings.fRelTolerance = 0.0001f;
+    Settings.fEdgeThreshold = 0.02f;
+    wcscpy_s( Settings.strReferenceDir, MAX_PATH, L"media\\depth_reference" );
+    wcscpy_s( Settings.strOutputDir, MAX_PATH, L"." );
+
+    std::vector<std::wstring> Meshes;
+    for( int i = 1; i < argc; i++ )
+    {
+        bool bHasValue = i + 1 < argc;
+        if( 0 == _wcsicmp( argv[i], L"-capture" ) )
+            Settings.bCapture = true;
+        else if( 0 == _wcsicmp( argv[i], L"-reference_device" ) )
+            Settings.bReferenceDevice = true;
+        else if( 0 == _wcsicmp( argv[i], L"-references" ) && bHasValue )
+            wcscpy_s( Settings.strReferenceDir, MAX_PATH, argv[++i] );
+        else if( 0 == _wcsicmp( argv[i], L"-out" ) && bHasValue )
+            wcscpy_s( Settings.strOutputDir, MAX_PATH, argv[++i] );
+        else if( 0 == _wcsicmp( argv[i], L"-size" ) && bHasValue )
+        {
+            WCHAR* pEnd;
+            Settings.Width = wcstoul( argv[++i], &pEnd, 10 );
+            Settings.Height = ( L'x' == *pEnd ) ? wcstoul( pEnd + 1, NULL, 10 ) : Settings.Width;
+        }
+        else if( 0 == _wcsicmp( argv[i], L"-abs" ) && bHasValue )
+            Settings.fAbsTolerance = ( float )_wtof( argv[++i] );
+        else if( 0 == _wcsicmp( argv[i], L"-rel" ) && bHasValue )
+            Settings.fRelTolerance = ( float )_wtof( argv[++i] );
+        else if( 0 == _wcsicmp( argv[i], L"-edge" ) && bHasValue )
+            Settings.fEdgeThreshold = ( float )_wtof( argv[++i] );
+        else if( 0 == _wcsicmp( argv[i], L"-maxfail" ) && bHasValue )
+            Settings.fMaxFailFraction = ( float )_wtof( argv[++i] );
+        else if( L'-' == argv[i][0] )
+        {
+            wprintf( L"Usage: DepthRegression [-capture] [-references dir] [-out dir] [-size 640x480]\n"
+                     L"                       [-abs 0.001] [-rel 0.0001] [-edge 0.02] [-maxfail 0]\n"
+                     L"                       [-reference_device] [mesh.obj ...]\n" );
+            return 1;
+        }
+        else
+            Meshes.push_back( argv[i] );
+    }
+
+    if( 0 == Settings.Width || 0 == Settings.Height )
+    {
+        wprintf( L"Invalid -size\n" );
+        return 1;
+    }
+
+    bool bShapeScene = Meshes.empty();
+    if( bShapeScene )
+    {
+        WIN32_FIND_DATA FindData;
+        HANDLE hFind = FindFirstFile( L"media\\*.obj", &FindData );
+        if( INVALID_HANDLE_VALUE != hFind )
+        {
+            do
+            {
+                Meshes.push_back( std::wstring( L"media\\" ) + FindData.cFileName );
+            } while( FindNextFile( hFind, &FindData ) );
+            FindClose( hFind );
+        }
+    }
+
+    if( Settings.bCapture && !Settings.bReferenceDevice )
+        wprintf( L"Capturing on the hardware device; these references only hold for this GPU and driver\n" );
+    if( Settings.bCapture )
+        CreateDirectory( Settings.strReferenceDir, NULL );
+    else
+        CreateDirectory( Settings.strOutputDir, NULL );
+
+    // References captured on the reference device compare the same on every machine;
+    // hardware captures are only comparable on the same GPU and driver
+    ID3D10Device* pDevice = NULL;
+    HRESULT hr = D3D10CreateDevice( NULL, Settings.bReferenceDevice ? D3D10_DRIVER_TYPE_REFERENCE :
+                                    D3D10_DRIVER_TYPE_HARDWARE, NULL, 0, D3D10_SDK_VERSION, &pDevice );
+    if( FAILED( hr ) )
+    {
+        wprintf( L"Could not create a Direct3D 10 device (0x%08x)\n", hr );
+        return 1;
+    }
+
+    UINT NumFailed = 0, NumMissing = 0;
+    {
+        CDepthCapture Capture;
+        if( FAILED( hr = Capture.Create( pDevice, Settings.Width, Settings.Height ) ) )
+        {
+            wprintf( L"Could not set up depth capture (0x%08x)\n", hr );
+            SAFE_RELEASE( pDevice );
+            return 1;
+        }
+
+        if( bShapeScene )
+        {
+            CMeshLoader10 Loader;
+            if( SUCCEEDED( CreateShapeScene( pDevice, &Loader ) ) )
+                NumFailed += TestMesh( pDevice, &Capture, &Loader, L"shapes", &Settings, &NumMissing );
+            else
+            {
+                wprintf( L"Could not build the shape scene\n" );
+                NumFailed++;
+            }
+        }
+
+        for( size_t iMesh = 0; iMesh < Meshes.size(); iMesh++ )
+        {
+            // References are named after the file, without directory or extension
+            WCHAR strName[MAX_PATH];
+            const WCHAR* pName = wcsrchr( Meshes[iMesh].c_str(), L'\\' );
+            wcscpy_s( strName, MAX_PATH, pName ? pName + 1 : Meshes[iMesh].c_str() );
+            WCHAR* pExt = wcsrchr( strName, L'.' );
+            if( pExt )
+                *pExt = 0;
+
+            CMeshLoader10 Loader;
+            if( FAILED( Loader.Create( pDevice, Meshes[iMesh].c_str() ) ) )
+            {
+                wprintf( L"Could not load %s\n", Meshes[iMesh].c_str() );
+                NumFailed++;
+                continue;
+            }
+            NumFailed += TestMesh( pDevice, &Capture, &Loader, strName, &Settings, &NumMissing );
+        }
+    }
+
+    DXUTGetGlobalResourceCache().OnDestroyDevice();
+    SAFE_RELEASE( pDevice );
+
+    if( NumFailed )
+        wprintf( L"%u pose(s) failed\n", NumFailed );
+    if( NumMissing )
+        wprintf( L"%u pose(s) have no reference in %s; capture them with -capture -reference_device\n", NumMissing,
+                 Settings.strReferenceDir );
+    return NumFailed ? 1 : ( NumMissing ? 2 : 0 );
+}
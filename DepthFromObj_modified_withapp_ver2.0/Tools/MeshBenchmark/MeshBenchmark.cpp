@@ -0,0 +1,819 @@
+//--------------------------------------------------------------------------------------
+// File: MeshBenchmark.cpp
+//
+// Load and render throughput benchmarks for the .obj path:
+//
+//   obj_parse       .obj read and tokenize rate, including vertex welding
+//   vertex_weld     CDXUTObjGeometry::WeldVertex calls per second on its own
+//   mesh_optimize   D3DX adjacency, attribute sort and vertex cache optimization
+//   depth_render    depth pass frames per second at each resolution
+//   image_encode    depth image encode rate (BMP and PNG)
+//   image_write     encoded image write rate
+//   sdkmesh_write   WriteSDKMesh output rate
+//
+// The CPU stages are repeated for each thread count, since the job system is shared by
+// everything that loads.  Each stage runs -iterations times and the fastest run is
+// kept.  Results are written as JSON, one record per stage, input and setting, so the
+// output of two builds can be diffed directly.  Without -out they go to stdout and
+// progress to stderr, so the JSON can be piped.
+//
+// Usage: MeshBenchmark [-out results.json] [-threads 1,4] [-sizes 100000,1000000]
+//                      [-resolutions 640x480,1920x1080] [-frames 100] [-iterations 3]
+//                      [mesh.obj ...]
+//
+// With no meshes on the command line every .obj in media\ is used.  Synthetic scenes of
+// each -sizes triangle count are generated with DXUTShapeGen, written to %TEMP% as .obj
+// and loaded through the same path.
+//--------------------------------------------------------------------------------------
+#include "DXUT.h"
+#include "SDKmisc.h"
+#include "DXUTProfiler.h"
+#include "DXUTJobSystem.h"
+#include "DXUTShapeGen.h"
+#include "DXUTObjGeometry.h"
+#pragma warning(disable: 4995)
+#include "meshloader10.h"
+#pragma warning(default: 4995)
+#include "SDKMeshWriter.h"
+#include <stdio.h>
+#include <string>
+#include <vector>
+
+#define MAX_BENCHMARK_LIST  16
+
+struct BENCHMARK_RESOLUTION
+{
+    UINT Width;
+    UINT Height;
+};
+
+struct BENCHMARK_SETTINGS
+{
+    UINT Threads[MAX_BENCHMARK_LIST];
+    UINT NumThreads;
+    UINT Sizes[MAX_BENCHMARK_LIST];
+    UINT NumSizes;
+    BENCHMARK_RESOLUTION Resolutions[MAX_BENCHMARK_LIST];
+    UINT NumResolutions;
+    UINT NumFrames;
+    UINT NumIterations;
+    WCHAR strOutput[MAX_PATH];
+};
+
+static const D3D10_INPUT_ELEMENT_DESC s_MeshLayout[] =
+{
+    { "POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 0, D3D10_INPUT_PER_VERTEX_DATA, 0 },
+    { "NORMAL", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 12, D3D10_INPUT_PER_VERTEX_DATA, 0 },
+    { "TEXCOORD", 0, DXGI_FORMAT_R32G32_FLOAT, 0, 24, D3D10_INPUT_PER_VERTEX_DATA, 0 },
+};
+
+
+//--------------------------------------------------------------------------------------
+// Times vertex welding without the parser by replaying every index of a finished mesh
+// through WeldVertex.  The .obj reader keys its cache by position index; here each
+// vertex is its own key, so the cost is the cache lookup and growth rather than the
+// length of the chains.
+//--------------------------------------------------------------------------------------
+static double TimeVertexWelding( const VERTEX* pVertices, const DWORD* pIndices, UINT NumIndices )
+{
+    CDXUTObjGeometry Geometry;
+    DXUT_PROFILE_TIME tStart = DXUTProfilerGetTimeNs();
+    for( UINT i = 0; i < NumIndices; i++ )
+    {
+        if( DXUT_OBJ_INVALID_INDEX == Geometry.WeldVertex( pIndices[i], ( const DXUTOBJ_VERTEX* )&pVertices[ pIndices[i] ] ) )
+            return -1.0;
+    }
+    return ( DXUTProfilerGetTimeNs() - tStart ) * 1e-9;
+}
+
+
+//--------------------------------------------------------------------------------------
+// JSON output: one object per result, with the input and settings first and the
+// measurements after them
+//--------------------------------------------------------------------------------------
+class CBenchmarkResults
+{
+public:
+    CBenchmarkResults() : m_NumRecords( 0 ), m_bFirstField( true )
+    {
+    }
+
+    void Begin( const char* szName, const WCHAR* strInput, UINT nThreads )
+    {
+        m_Json += m_NumRecords++ ? ",\n    {" : "    {";
+        m_bFirstField = true;
+        AddString( "name", szName );
+        AddString( "input", ToUtf8( strInput ).c_str() );
+        AddNumber( "threads", nThreads );
+    }
+    void AddString( const char* szKey, const char* szValue )
+    {
+        AddKey( szKey );
+        m_Json += '"';
+        m_Json += Escape( szValue );
+        m_Json += '"';
+    }
+    void AddNumber( const char* szKey, double fValue )
+    {
+        char str[64];
+        sprintf_s( str, sizeof( str ), "%.6g", fValue );
+        AddKey( szKey );
+        m_Json += str;
+    }
+    void End()
+    {
+        m_Json += " }";
+    }
+
+    bool Write( const WCHAR* strFilename, const char* szHeader )
+    {
+        FILE* fp = stdout;
+        if( strFilename[0] && 0 != _wfopen_s( &fp, strFilename, L"wt" ) )
+            return false;
+
+        fprintf( fp, "{\n%s,\n  \"results\": [\n%s\n  ]\n}\n", szHeader, m_Json.c_str() );
+        if( fp != stdout )
+            fclose( fp );
+        return true;
+    }
+
+    // For use between quotes
+    static std::string Escape( const char* szValue )
+    {
+        std::string strEscaped;
+        for( const char* p = szValue; *p; p++ )
+        {
+            if( ( unsigned char )*p < 0x20 )
+            {
+                char str[8];
+                sprintf_s( str, sizeof( str ), "\\u%04x", ( unsigned char )*p );
+                strEscaped += str;
+                continue;
+            }
+            if( '"' == *p || '\\' == *p )
+                strEscaped += '\\';
+            strEscaped += *p;
+        }
+        return strEscaped;
+    }
+
+    static std::string ToUtf8( const WCHAR* str )
+    {
+        char strUtf8[MAX_PATH * 3];
+        if( !WideCharToMultiByte( CP_UTF8, 0, str, -1, strUtf8, sizeof( strUtf8 ), NULL, NULL ) )
+            strUtf8[0] = 0;
+        return strUtf8;
+    }
+
+private:
+    void AddKey( const char* szKey )
+    {
+        if( !m_bFirstField )
+            m_Json += ',';
+        m_bFirstField = false;
+        m_Json += " \"";
+        m_Json += szKey;
+        m_Json += "\": ";
+    }
+
+    std::string m_Json;
+    UINT m_NumRecords;
+    bool m_bFirstField;
+};
+
+
+//--------------------------------------------------------------------------------------
+// Command line lists: "1,2,4" and "640x480,1920x1080"
+//--------------------------------------------------------------------------------------
+static UINT ParseList( const WCHAR* str, UINT* pValues )
+{
+    UINT nValues = 0;
+    while( *str && nValues < MAX_BENCHMARK_LIST )
+    {
+        WCHAR* pEnd;
+        pValues[nValues++] = wcstoul( str, &pEnd, 10 );
+        str = ( L',' == *pEnd ) ? pEnd + 1 : L"";
+    }
+    return nValues;
+}
+
+static UINT ParseResolutions( const WCHAR* str, BENCHMARK_RESOLUTION* pResolutions )
+{
+    UINT nValues = 0;
+    while( *str && nValues < MAX_BENCHMARK_LIST )
+    {
+        WCHAR* pEnd;
+        pResolutions[nValues].Width = wcstoul( str, &pEnd, 10 );
+        pResolutions[nValues].Height = ( L'x' == *pEnd ) ? wcstoul( pEnd + 1, &pEnd, 10 ) : pResolutions[nValues].Width;
+        nValues++;
+        str = ( L',' == *pEnd ) ? pEnd + 1 : L"";
+    }
+    return nValues;
+}
+
+
+//--------------------------------------------------------------------------------------
+// Writes a seeded scene of about NumTriangles triangles as a .obj with positions,
+// texture coordinates and normals, the most expensive face form to parse
+//--------------------------------------------------------------------------------------
+static HRESULT WriteSyntheticOBJ( UINT NumTriangles, const WCHAR* strFilename )
+{
+    // Spheres and tori at about 4 * n^2 triangles each for n stacks
+    const UINT NumInstances = 64;
+    UINT n = ( UINT )sqrt( ( double )NumTriangles / NumInstances / 4.0 );
+    if( n < 3 )
+        n = 3;
+
+    DXUT_SHAPE_DESC Shapes[2];
+    ZeroMemory( Shapes, sizeof( Shapes ) );
+    Shapes[0].Type = DXUT_SHAPE_SPHERE;
+    Shapes[0].fSize[0] = 1.0f;
+    Shapes[0].nSlices = 2 * n;
+    Shapes[0].nStacks = n + 1;
+    Shapes[1].Type = DXUT_SHAPE_TORUS;
+    Shapes[1].fSize[0] = 0.3f;
+    Shapes[1].fSize[1] = 1.0f;
+    Shapes[1].nSlices = n;
+    Shapes[1].nStacks = 2 * n;
+
+    std::vector<DXUT_SHAPE_INSTANCE> Instances( NumInstances );
+    DXUTScatterShapeInstances( Shapes, 2, NumInstances, 10.0f, 1, &Instances[0] );
+
+    UINT NumVertices, NumIndices;
+    if( !DXUTGetShapeSceneCounts( &Instances[0], NumInstances, &NumVertices, &NumIndices ) )
+        return E_INVALIDARG;
+
+    std::vector<DXUTSHAPE_VERTEX> Vertices( NumVertices );
+    std::vector<unsigned int> Indices( NumIndices );
+    std::vector<unsigned int> Attributes( NumIndices / 3 );
+    DXUTGenerateShapeScene( &Instances[0], NumInstances, &Vertices[0], &Indices[0], &Attributes[0] );
+
+    FILE* fp;
+    if( 0 != _wfopen_s( &fp, strFilename, L"wt" ) )
+        return E_FAIL;
+
+    fprintf( fp, "# MeshBenchmark synthetic scene, %u triangles\n", NumIndices / 3 );
+    for( UINT i = 0; i < NumVertices; i++ )
+    {
+        const DXUTSHAPE_VERTEX* p = &Vertices[i];
+        fprintf( fp, "v %f %f %f\nvt %f %f\nvn %f %f %f\n", p->Position[0], p->Position[1], p->Position[2],
+                 p->TexCoord[0], p->TexCoord[1], p->Normal[0], p->Normal[1], p->Normal[2] );
+    }
+
+    UINT CurAttribute = ( UINT )-1;
+    for( UINT i = 0; i < NumIndices; i += 3 )
+    {
+        if( Attributes[i / 3] != CurAttribute )
+        {
+            CurAttribute = Attributes[i / 3];
+            fprintf( fp, "usemtl shape%u\n", CurAttribute );
+        }
+        UINT a = Indices[i] + 1, b = Indices[i + 1] + 1, c = Indices[i + 2] + 1;
+        fprintf( fp, "f %u/%u/%u %u/%u/%u %u/%u/%u\n", a, a, a, b, b, b, c, c, c );
+    }
+
+    fclose( fp );
+    return S_OK;
+}
+
+
+//--------------------------------------------------------------------------------------
+// Offscreen depth pass with the viewer's effect
+//--------------------------------------------------------------------------------------
+class CDepthRenderer
+{
+public:
+    CDepthRenderer() : m_pDevice( NULL ), m_pEffect( NULL ), m_pTechnique( NULL ), m_pWorldViewProjection( NULL ),
+                       m_pLayout( NULL ), m_pQuery( NULL )
+    {
+    }
+    ~CDepthRenderer()
+    {
+        SAFE_RELEASE( m_pQuery );
+        SAFE_RELEASE( m_pLayout );
+        SAFE_RELEASE( m_pEffect );
+    }
+
+    HRESULT Create( ID3D10Device* pDevice )
+    {
+        HRESULT hr;
+        WCHAR str[MAX_PATH];
+        m_pDevice = pDevice;
+
+        V_RETURN( DXUTFindDXSDKMediaFileCch( str, MAX_PATH, L"MeshFromOBJ10.fx" ) );
+        V_RETURN( D3DX10CreateEffectFromFile( str, NULL, NULL, "fx_4_0", D3D10_SHADER_ENABLE_STRICTNESS, 0, pDevice,
+                                              NULL, NULL, &m_pEffect, NULL, NULL ) );
+        m_pTechnique = m_pEffect->GetTechniqueByName( "NoSpecular" );
+        m_pWorldViewProjection = m_pEffect->GetVariableByName( "g_mWorldViewProjection" )->AsMatrix();
+
+        D3D10_PASS_DESC PassDesc;
+        V_RETURN( m_pTechnique->GetPassByIndex( 0 )->GetDesc( &PassDesc ) );
+        V_RETURN( pDevice->CreateInputLayout( s_MeshLayout, ARRAYSIZE( s_MeshLayout ), PassDesc.pIAInputSignature,
+                                              PassDesc.IAInputSignatureSize, &m_pLayout ) );
+
+        D3D10_QUERY_DESC QueryDesc = { D3D10_QUERY_EVENT, 0 };
+        V_RETURN( pDevice->CreateQuery( &QueryDesc, &m_pQuery ) );
+        return S_OK;
+    }
+
+    // Renders NumFrames depth frames of the whole mesh and returns the seconds taken,
+    // including waiting for the GPU to finish.  The colour target is left holding the
+    // last frame for the encode benchmarks.
+    HRESULT Render( CMeshLoader10* pLoader, const D3DXMATRIX* pWorldViewProjection, UINT Width, UINT Height,
+                    UINT NumFrames, double* pfSeconds, ID3D10Texture2D** ppColor )
+    {
+        HRESULT hr;
+        ID3D10Texture2D* pColor = NULL;
+        ID3D10Texture2D* pDepth = NULL;
+        ID3D10RenderTargetView* pRTV = NULL;
+        ID3D10DepthStencilView* pDSV = NULL;
+
+        D3D10_TEXTURE2D_DESC TexDesc;
+        ZeroMemory( &TexDesc, sizeof( TexDesc ) );
+        TexDesc.Width = Width;
+        TexDesc.Height = Height;
+        TexDesc.MipLevels = 1;
+        TexDesc.ArraySize = 1;
+        TexDesc.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
+        TexDesc.SampleDesc.Count = 1;
+        TexDesc.Usage = D3D10_USAGE_DEFAULT;
+        TexDesc.BindFlags = D3D10_BIND_RENDER_TARGET;
+        V_RETURN( m_pDevice->CreateTexture2D( &TexDesc, NULL, &pColor ) );
+
+        TexDesc.Format = DXGI_FORMAT_D16_UNORM;
+        TexDesc.BindFlags = D3D10_BIND_DEPTH_STENCIL;
+        hr = m_pDevice->CreateTexture2D( &TexDesc, NULL, &pDepth );
+        if( SUCCEEDED( hr ) )
+            hr = m_pDevice->CreateRenderTargetView( pColor, NULL, &pRTV );
+        if( SUCCEEDED( hr ) )
+            hr = m_pDevice->CreateDepthStencilView( pDepth, NULL, &pDSV );
+
+        if( SUCCEEDED( hr ) )
+        {
+            D3D10_VIEWPORT Viewport = { 0, 0, Width, Height, 0.0f, 1.0f };
+            m_pDevice->RSSetViewports( 1, &Viewport );
+            m_pDevice->OMSetRenderTargets( 1, &pRTV, pDSV );
+            m_pDevice->IASetInputLayout( m_pLayout );
+            m_pWorldViewProjection->SetMatrix( ( float* )pWorldViewProjection );
+
+            // One frame to warm up the driver, then the timed run
+            for( UINT iFrame = 0; iFrame <= NumFrames; iFrame++ )
+            {
+                if( 1 == iFrame )
+                {
+                    Finish();
+                    *pfSeconds = ( double )DXUTProfilerGetTimeNs();
+                }
+
+                float ClearColor[4] = { 0.0f, 0.0f, 0.0f, 1.0f };
+                m_pDevice->ClearRenderTargetView( pRTV, ClearColor );
+                m_pDevice->ClearDepthStencilView( pDSV, D3D10_CLEAR_DEPTH, 1.0f, 0 );
+                for( UINT iSubset = 0; iSubset < pLoader->GetNumSubsets(); iSubset++ )
+                {
+                    m_pTechnique->GetPassByIndex( 0 )->Apply( 0 );
+                    pLoader->GetMesh()->DrawSubset( iSubset );
+                }
+            }
+
+            Finish();
+            *pfSeconds = ( DXUTProfilerGetTimeNs() - *pfSeconds ) * 1e-9;
+            m_pDevice->OMSetRenderTargets( 0, NULL, NULL );
+        }
+
+        SAFE_RELEASE( pDSV );
+        SAFE_RELEASE( pRTV );
+        SAFE_RELEASE( pDepth );
+        if( SUCCEEDED( hr ) )
+            *ppColor = pColor;
+        else
+            SAFE_RELEASE( pColor );
+        return hr;
+    }
+
+private:
+    // Blocks until the GPU has caught up with everything submitted so far
+    void Finish()
+    {
+        m_pQuery->End();
+        while( S_FALSE == m_pQuery->GetData( NULL, 0, 0 ) )
+            ;
+    }
+
+    ID3D10Device* m_pDevice;
+    ID3D10Effect* m_pEffect;
+    ID3D10EffectTechnique* m_pTechnique;
+    ID3D10EffectMatrixVariable* m_pWorldViewProjection;
+    ID3D10InputLayout* m_pLayout;
+    ID3D10Query* m_pQuery;
+};
+
+
+//--------------------------------------------------------------------------------------
+// Camera that frames the whole mesh, as the viewer's default camera would for a mesh
+// of unit size
+//--------------------------------------------------------------------------------------
+static void GetFramingMatrix( ID3DX10Mesh* pMesh, float fAspect, D3DXMATRIX* pWorldViewProjection )
+{
+    D3DXVECTOR3 vMin( 0, 0, 0 ), vMax( 0, 0, 0 );
+    ID3DX10MeshBuffer* pVB = NULL;
+    if( SUCCEEDED( pMesh->GetVertexBuffer( 0, &pVB ) ) )
+    {
+        void* pData;
+        SIZE_T cbSize;
+        if( SUCCEEDED( pVB->Map( &pData, &cbSize ) ) )
+        {
+            D3DXComputeBoundingBox( ( D3DXVECTOR3* )pData, pMesh->GetVertexCount(), sizeof( VERTEX ), &vMin, &vMax );
+            pVB->Unmap();
+        }
+        SAFE_RELEASE( pVB );
+    }
+
+    D3DXVECTOR3 vCenter = ( vMin + vMax ) * 0.5f;
+    float fRadius = D3DXVec3Length( &( vMax - vCenter ) ) + 1e-3f;
+    D3DXVECTOR3 vEye = vCenter - D3DXVECTOR3( 0.0f, 0.0f, 2.5f * fRadius );
+    D3DXVECTOR3 vUp( 0.0f, 1.0f, 0.0f );
+
+    D3DXMATRIX mView, mProj;
+    D3DXMatrixLookAtLH( &mView, &vEye, &vCenter, &vUp );
+    D3DXMatrixPerspectiveFovLH( &mProj, D3DX_PI / 4, fAspect, 0.5f * fRadius, 4.0f * fRadius );
+    *pWorldViewProjection = mView * mProj;
+}
+
+
+//--------------------------------------------------------------------------------------
+static double TimeFileWrite( const WCHAR* strFilename, const void* pData, DWORD cbData )
+{
+    DXUT_PROFILE_TIME tStart = DXUTProfilerGetTimeNs();
+    HANDLE hFile = CreateFile( strFilename, GENERIC_WRITE, 0, NULL, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL );
+    if( INVALID_HANDLE_VALUE == hFile )
+        return -1.0;
+
+    DWORD dwWritten = 0;
+    BOOL bOK = WriteFile( hFile, pData, cbData, &dwWritten, NULL ) && FlushFileBuffers( hFile );
+    CloseHandle( hFile );
+    DeleteFile( strFilename );
+    return bOK ? ( DXUTProfilerGetTimeNs() - tStart ) * 1e-9 : -1.0;
+}
+
+
+//--------------------------------------------------------------------------------------
+// CPU stages: parse, welding, optimization and .sdkmesh writing
+//--------------------------------------------------------------------------------------
+static void BenchmarkLoad( ID3D10Device* pDevice, const WCHAR* strMesh, UINT nThreads,
+                           const BENCHMARK_SETTINGS* pSettings, CBenchmarkResults* pResults )
+{
+    MeshLoaderStats Best;
+    double fBestWeld = 1e30, fBestWrite = 1e30;
+    UINT NumIndices = 0, NumVertices = 0;
+    UINT64 cbSDKMesh = 0;
+    WCHAR strTemp[MAX_PATH], strSDKMesh[MAX_PATH];
+    GetTempPath( MAX_PATH, strTemp );
+    swprintf_s( strSDKMesh, MAX_PATH, L"%sMeshBenchmark.sdkmesh", strTemp );
+
+    for( UINT iIteration = 0; iIteration < pSettings->NumIterations; iIteration++ )
+    {
+        CMeshLoader10 Loader;
+        if( FAILED( Loader.Create( pDevice, strMesh ) ) )
+        {
+            fwprintf( stderr, L"Could not load %s\n", strMesh );
+            return;
+        }
+
+        const MeshLoaderStats& Stats = Loader.GetLoadStats();
+        if( 0 == iIteration )
+            Best = Stats;
+        Best.fParseSeconds = __min( Best.fParseSeconds, Stats.fParseSeconds );
+        Best.fOptimizeSeconds = __min( Best.fOptimizeSeconds, Stats.fOptimizeSeconds );
+
+        ID3DX10Mesh* pMesh = Loader.GetMesh();
+        NumVertices = pMesh->GetVertexCount();
+        NumIndices = pMesh->GetFaceCount() * 3;
+
+        ID3DX10MeshBuffer* pVB = NULL;
+        ID3DX10MeshBuffer* pIB = NULL;
+        void* pVertices;
+        void* pIndices;
+        SIZE_T cbSize;
+        if( SUCCEEDED( pMesh->GetVertexBuffer( 0, &pVB ) ) && SUCCEEDED( pMesh->GetIndexBuffer( &pIB ) ) &&
+            SUCCEEDED( pVB->Map( &pVertices, &cbSize ) ) )
+        {
+            if( SUCCEEDED( pIB->Map( &pIndices, &cbSize ) ) )
+            {
+                double fWeld = TimeVertexWelding( ( VERTEX* )pVertices, ( DWORD* )pIndices, NumIndices );
+                if( fWeld >= 0.0 )
+                    fBestWeld = __min( fBestWeld, fWeld );
+                pIB->Unmap();
+            }
+            pVB->Unmap();
+        }
+        SAFE_RELEASE( pIB );
+        SAFE_RELEASE( pVB );
+
+        DXUT_PROFILE_TIME tStart = DXUTProfilerGetTimeNs();
+        if( SUCCEEDED( WriteSDKMesh( &Loader, strSDKMesh ) ) )
+        {
+            fBestWrite = __min( fBestWrite, ( DXUTProfilerGetTimeNs() - tStart ) * 1e-9 );
+            WIN32_FILE_ATTRIBUTE_DATA FileData;
+            if( GetFileAttributesEx( strSDKMesh, GetFileExInfoStandard, &FileData ) )
+                cbSDKMesh = ( ( UINT64 )FileData.nFileSizeHigh << 32 ) | FileData.nFileSizeLow;
+            DeleteFile( strSDKMesh );
+        }
+    }
+
+    pResults->Begin( "obj_parse", strMesh, nThreads );
+    pResults->AddNumber( "bytes", ( double )Best.FileBytes );
+    pResults->AddNumber( "faces", NumIndices / 3 );
+    pResults->AddNumber( "seconds", Best.fParseSeconds );
+    pResults->AddNumber( "mb_per_s", Best.FileBytes / 1e6 / Best.fParseSeconds );
+    pResults->End();
+
+    if( fBestWeld < 1e30 )
+    {
+        pResults->Begin( "vertex_weld", strMesh, nThreads );
+        pResults->AddNumber( "calls", NumIndices );
+        pResults->AddNumber( "unique", NumVertices );
+        pResults->AddNumber( "seconds", fBestWeld );
+        pResults->AddNumber( "mcalls_per_s", NumIndices / 1e6 / fBestWeld );
+        pResults->End();
+    }
+
+    pResults->Begin( "mesh_optimize", strMesh, nThreads );
+    pResults->AddNumber( "vertices", NumVertices );
+    pResults->AddNumber( "faces", NumIndices / 3 );
+    pResults->AddNumber( "seconds", Best.fOptimizeSeconds );
+    pResults->AddNumber( "mfaces_per_s", NumIndices / 3 / 1e6 / Best.fOptimizeSeconds );
+    pResults->End();
+
+    if( fBestWrite < 1e30 )
+    {
+        pResults->Begin( "sdkmesh_write", strMesh, nThreads );
+        pResults->AddNumber( "bytes", ( double )cbSDKMesh );
+        pResults->AddNumber( "seconds", fBestWrite );
+        pResults->AddNumber( "mb_per_s", cbSDKMesh / 1e6 / fBestWrite );
+        pResults->End();
+    }
+}
+
+
+//--------------------------------------------------------------------------------------
+// GPU and image stages, once per resolution
+//--------------------------------------------------------------------------------------
+static void BenchmarkRender( ID3D10Device* pDevice, CDepthRenderer* pRenderer, const WCHAR* strMesh, UINT nThreads,
+                             const BENCHMARK_SETTINGS* pSettings, CBenchmarkResults* pResults )
+{
+    CMeshLoader10 Loader;
+    if( FAILED( Loader.Create( pDevice, strMesh ) ) )
+        return;
+
+    WCHAR strTemp[MAX_PATH], strImage[MAX_PATH];
+    GetTempPath( MAX_PATH, strTemp );
+    swprintf_s( strImage, MAX_PATH, L"%sMeshBenchmark.img", strTemp );
+
+    for( UINT iRes = 0; iRes < pSettings->NumResolutions; iRes++ )
+    {
+        UINT Width = pSettings->Resolutions[iRes].Width;
+        UINT Height = pSettings->Resolutions[iRes].Height;
+
+        D3DXMATRIX mWorldViewProjection;
+        GetFramingMatrix( Loader.GetMesh(), ( float )Width / ( float )Height, &mWorldViewProjection );
+
+        double fBest = 1e30;
+        ID3D10Texture2D* pColor = NULL;
+        for( UINT iIteration = 0; iIteration < pSettings->NumIterations; iIteration++ )
+        {
+            double fSeconds;
+            SAFE_RELEASE( pColor );
+            if( FAILED( pRenderer->Render( &Loader, &mWorldViewProjection, Width, Height, pSettings->NumFrames,
+                                           &fSeconds, &pColor ) ) )
+                break;
+            fBest = __min( fBest, fSeconds );
+        }
+        if( !pColor )
+            continue;
+
+        pResults->Begin( "depth_render", strMesh, nThreads );
+        pResults->AddNumber( "width", Width );
+        pResults->AddNumber( "height", Height );
+        pResults->AddNumber( "frames", pSettings->NumFrames );
+        pResults->AddNumber( "seconds", fBest );
+        pResults->AddNumber( "frames_per_s", pSettings->NumFrames / fBest );
+        pResults->End();
+
+        static const struct
+        {
+            D3DX10_IMAGE_FILE_FORMAT Format;
+            const char* szName;
+        } s_Formats[] = { { D3DX10_IFF_BMP, "bmp" }, { D3DX10_IFF_PNG, "png" } };
+
+        double fRawMB = Width * Height * 4 / 1e6;
+        for( UINT iFormat = 0; iFormat < ARRAYSIZE( s_Formats ); iFormat++ )
+        {
+            double fBestEncode = 1e30, fBestWrite = 1e30;
+            SIZE_T cbEncoded = 0;
+            for( UINT iIteration = 0; iIteration < pSettings->NumIterations; iIteration++ )
+            {
+                ID3D10Blob* pBlob = NULL;
+                DXUT_PROFILE_TIME tStart = DXUTProfilerGetTimeNs();
+                if( FAILED( D3DX10SaveTextureToMemory( pColor, s_Formats[iFormat].Format, &pBlob, 0 ) ) )
+                    break;
+                fBestEncode = __min( fBestEncode, ( DXUTProfilerGetTimeNs() - tStart ) * 1e-9 );
+
+                cbEncoded = pBlob->GetBufferSize();
+                double fWrite = TimeFileWrite( strImage, pBlob->GetBufferPointer(), ( DWORD )cbEncoded );
+                if( fWrite >= 0.0 )
+                    fBestWrite = __min( fBestWrite, fWrite );
+                SAFE_RELEASE( pBlob );
+            }
+
+            if( fBestEncode < 1e30 )
+            {
+                pResults->Begin( "image_encode", strMesh, nThreads );
+                pResults->AddString( "format", s_Formats[iFormat].szName );
+                pResults->AddNumber( "width", Width );
+                pResults->AddNumber( "height", Height );
+                pResults->AddNumber( "seconds", fBestEncode );
+                pResults->AddNumber( "mb_per_s", fRawMB / fBestEncode );
+                pResults->End();
+            }
+            if( fBestWrite < 1e30 )
+            {
+                pResults->Begin( "image_write", strMesh, nThreads );
+                pResults->AddString( "format", s_Formats[iFormat].szName );
+                pResults->AddNumber( "bytes", ( double )cbEncoded );
+                pResults->AddNumber( "seconds", fBestWrite );
+                pResults->AddNumber( "mb_per_s", cbEncoded / 1e6 / fBestWrite );
+                pResults->End();
+            }
+        }
+
+        SAFE_RELEASE( pColor );
+    }
+}
+
+
+//--------------------------------------------------------------------------------------
+int wmain( int argc, WCHAR* argv[] )
+{
+    BENCHMARK_SETTINGS Settings;
+    ZeroMemory( &Settings, sizeof( Settings ) );
+    SYSTEM_INFO SysInfo;
+    GetSystemInfo( &SysInfo );
+    Settings.Threads[0] = 1;
+    Settings.Threads[1] = SysInfo.dwNumberOfProcessors;
+    Settings.NumThreads = SysInfo.dwNumberOfProcessors > 1 ? 2 : 1;
+    Settings.Sizes[0] = 100000;
+    Settings.Sizes[1] = 1000000;
+    Settings.NumSizes = 2;
+    Settings.NumResolutions = ParseResolutions( L"640x480,1920x1080,4096x4096", Settings.Resolutions );
+    Settings.NumFrames = 100;
+    Settings.NumIterations = 3;
+
+    std::vector<std::wstring> Meshes;
+    for( int i = 1; i < argc; i++ )
+    {
+        bool bHasValue = i + 1 < argc;
+        if( 0 == _wcsicmp( argv[i], L"-out" ) && bHasValue )
+            wcscpy_s( Settings.strOutput, MAX_PATH, argv[++i] );
+        else if( 0 == _wcsicmp( argv[i], L"-threads" ) && bHasValue )
+            Settings.NumThreads = ParseList( argv[++i], Settings.Threads );
+        else if( 0 == _wcsicmp( argv[i], L"-sizes" ) && bHasValue )
+            Settings.NumSizes = ParseList( argv[++i], Settings.Sizes );
+        else if( 0 == _wcsicmp( argv[i], L"-resolutions" ) && bHasValue )
+            Settings.NumResolutions = ParseResolutions( argv[++i], Settings.Resolutions );
+        else if( 0 == _wcsicmp( argv[i], L"-frames" ) && bHasValue )
+            Settings.NumFrames = __max( 1, _wtoi( argv[++i] ) );
+        else if( 0 == _wcsicmp( argv[i], L"-iterations" ) && bHasValue )
+            Settings.NumIterations = __max( 1, _wtoi( argv[++i] ) );
+        else if( L'-' == argv[i][0] )
+        {
+            fwprintf( stderr, L"Usage: MeshBenchmark [-out results.json] [-threads 1,4] [-sizes 100000,1000000]\n"
+                              L"                     [-resolutions 640x480,1920x1080] [-frames 100] [-iterations 3]\n"
+                              L"                     [mesh.obj ...]\n" );
+            return 1;
+        }
+        else
+            Meshes.push_back( argv[i] );
+    }
+
+    // Default inputs: the shipped media
+    if( Meshes.empty() )
+    {
+        WIN32_FIND_DATA FindData;
+        HANDLE hFind = FindFirstFile( L"media\\*.obj", &FindData );
+        if( INVALID_HANDLE_VALUE != hFind )
+        {
+            do
+            {
+                Meshes.push_back( std::wstring( L"media\\" ) + FindData.cFileName );
+            } while( FindNextFile( hFind, &FindData ) );
+            FindClose( hFind );
+        }
+    }
+
+    // Synthetic inputs
+    WCHAR strTemp[MAX_PATH];
+    GetTempPath( MAX_PATH, strTemp );
+    std::vector<std::wstring> SyntheticMeshes;
+    for( UINT i = 0; i < Settings.NumSizes; i++ )
+    {
+        WCHAR strSynthetic[MAX_PATH];
+        swprintf_s( strSynthetic, MAX_PATH, L"%sMeshBenchmark_%u.obj", strTemp, Settings.Sizes[i] );
+        fwprintf( stderr, L"Generating %s\n", strSynthetic );
+        if( SUCCEEDED( WriteSyntheticOBJ( Settings.Sizes[i], strSynthetic ) ) )
+        {
+            Meshes.push_back( strSynthetic );
+            SyntheticMeshes.push_back( strSynthetic );
+        }
+    }
+
+    if( Meshes.empty() )
+    {
+        fwprintf( stderr, L"Nothing to benchmark\n" );
+        return 1;
+    }
+
+    // Rendering needs real hardware to mean anything; the reference rasterizer is only
+    // there so the CPU stages still run on machines without it
+    ID3D10Device* pDevice = NULL;
+    const char* szDriver = "hardware";
+    HRESULT hr = D3D10CreateDevice( NULL, D3D10_DRIVER_TYPE_HARDWARE, NULL, 0, D3D10_SDK_VERSION, &pDevice );
+    if( FAILED( hr ) )
+    {
+        szDriver = "reference";
+        hr = D3D10CreateDevice( NULL, D3D10_DRIVER_TYPE_REFERENCE, NULL, 0, D3D10_SDK_VERSION, &pDevice );
+    }
+    if( FAILED( hr ) )
+    {
+        fwprintf( stderr, L"Could not create a Direct3D 10 device (0x%08x)\n", hr );
+        return 1;
+    }
+
+    WCHAR strAdapter[128] = L"unknown";
+    IDXGIDevice* pDXGIDevice = NULL;
+    IDXGIAdapter* pAdapter = NULL;
+    if( SUCCEEDED( pDevice->QueryInterface( __uuidof( IDXGIDevice ), ( void** )&pDXGIDevice ) ) &&
+        SUCCEEDED( pDXGIDevice->GetAdapter( &pAdapter ) ) )
+    {
+        DXGI_ADAPTER_DESC AdapterDesc;
+        if( SUCCEEDED( pAdapter->GetDesc( &AdapterDesc ) ) )
+            wcscpy_s( strAdapter, ARRAYSIZE( strAdapter ), AdapterDesc.Description );
+    }
+    SAFE_RELEASE( pAdapter );
+    SAFE_RELEASE( pDXGIDevice );
+
+    CDepthRenderer Renderer;
+    bool bRender = SUCCEEDED( Renderer.Create( pDevice ) );
+    if( !bRender )
+        fwprintf( stderr, L"MeshFromOBJ10.fx not found; skipping the render and encode stages\n" );
+
+    CBenchmarkResults Results;
+    for( UINT iThreads = 0; iThreads < Settings.NumThreads; iThreads++ )
+    {
+        // The caller is one of the threads
+        UINT nThreads = __max( 1, Settings.Threads[iThreads] );
+        DXUTGetJobSystem()->Shutdown();
+        DXUTGetJobSystem()->Init( ( int )nThreads - 1 );
+
+        for( size_t iMesh = 0; iMesh < Meshes.size(); iMesh++ )
+        {
+            fwprintf( stderr, L"%s, %u threads\n", Meshes[iMesh].c_str(), nThreads );
+            BenchmarkLoad( pDevice, Meshes[iMesh].c_str(), nThreads, &Settings, &Results );
+
+            // The GPU and D3DX image stages don't use the job system; once is enough
+            if( bRender && 0 == iThreads )
+                BenchmarkRender( pDevice, &Renderer, Meshes[iMesh].c_str(), nThreads, &Settings, &Results );
+        }
+    }
+    DXUTGetJobSystem()->Shutdown();
+
+    for( size_t i = 0; i < SyntheticMeshes.size(); i++ )
+        DeleteFile( SyntheticMeshes[i].c_str() );
+
+    // Room for an adapter name that is all escapes
+    char szHeader[1536];
+    sprintf_s( szHeader, sizeof( szHeader ),
+               "  \"benchmark\": \"MeshBenchmark\",\n"
+               "  \"version\": 1,\n"
+               "  \"build\": \"%s\",\n"
+               "  \"driver\": \"%s\",\n"
+               "  \"adapter\": \"%s\",\n"
+               "  \"logical_processors\": %u,\n"
+               "  \"iterations\": %u",
+#if defined( DEBUG ) || defined( _DEBUG )
+               "debug",
+#else
+               "release",
+#endif
+               szDriver, CBenchmarkResults::Escape( CBenchmarkResults::ToUtf8( strAdapter ).c_str() ).c_str(),
+               SysInfo.dwNumberOfProcessors, Settings.NumIterations );
+
+    DXUTGetGlobalResourceCache().OnDestroyDevice();
+    SAFE_RELEASE( pDevice );
+
+    if( !Results.Write( Settings.strOutput, szHeader ) )
+    {
+        fwprintf( stderr, L"Could not write %s\n", Settings.strOutput );
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,689 @@
+//--------------------------------------------------------------------------------------
+// File: ObjGen.cpp
+//
+// Writes large synthetic .obj/.mtl pairs for parser and vertex welding work, so scale
+// tests don't depend on copies of customer data.
+//
+// The mesh is a rolling height field cut into square patches.  Vertices are shared
+// inside a patch but not across patch borders, the way exporters split meshes at
+// material and smoothing seams, so the patch size sets how many face corners share
+// each position.  Faces are written in patch order and switch material every -churn
+// faces.  Every line is a pure function of the seed, the options and its position in
+// the file, so the output is byte-identical for any number of threads; blocks of lines
+// are formatted in parallel on DXUTGetJobSystem() while the previous batch is written.
+//
+// Usage: ObjGen [options] output.obj
+//
+//   -faces N       triangles to write, with optional k, M or G suffix (default 1M)
+//   -seed N        height field, material and comment seed (default 1)
+//   -sharing R     face corners per position: 1 writes every triangle with its own
+//                  vertices, up to 6 for one shared grid (default 5)
+//   -format F      face form: v, vt, vn, vtn (v/vt/vn) or mixed (default vtn)
+//   -materials N   materials in the .mtl (default 16)
+//   -churn N       faces between usemtl lines; 0 gives each material one run (default 0)
+//   -comments F    chance of a comment line before each line (default 0)
+//   -crlf          Windows line endings
+//
+// The .mtl is written next to the .obj with the same name.
+//--------------------------------------------------------------------------------------
+#include "DXUTJobSystem.h"
+#include "DXUTProfiler.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <thread>
+#include <vector>
+
+enum OBJGEN_FACE_FORMAT
+{
+    OBJGEN_FACE_V,              // f 1 2 3
+    OBJGEN_FACE_VT,             // f 1/1 2/2 3/3
+    OBJGEN_FACE_VN,             // f 1//1 2//2 3//3
+    OBJGEN_FACE_VTN,            // f 1/1/1 2/2/2 3/3/3
+    OBJGEN_FACE_MIXED,          // Any of the above, chosen per face
+};
+
+enum OBJGEN_SECTION
+{
+    OBJGEN_SECTION_POSITIONS,
+    OBJGEN_SECTION_TEXCOORDS,
+    OBJGEN_SECTION_NORMALS,
+    OBJGEN_SECTION_FACES,
+};
+
+struct OBJGEN_SETTINGS
+{
+    unsigned long long nFaces;
+    unsigned int nSeed;
+    float fSharing;
+    OBJGEN_FACE_FORMAT Format;
+    unsigned int nMaterials;
+    unsigned long long nChurn;
+    float fComments;
+    bool bCRLF;
+};
+
+// Lines per block formatted by one job
+#define OBJGEN_BLOCK_LINES  16384
+
+// Height field octaves: lattice spacing and amplitude in patch widths
+static const float s_fNoiseSpacing[2] = { 16.0f, 3.0f };
+static const float s_fNoiseAmplitude[2] = { 4.0f, 0.5f };
+
+static const char* s_szComments[] =
+{
+    "# ObjGen synthetic mesh",
+    "# patch boundary",
+    "# smoothing group carried over from the source asset",
+    "# TODO: re-export with welded seams",
+    "#",
+};
+
+
+//--------------------------------------------------------------------------------------
+// Stateless hashing, so any line can be produced without producing the ones before it
+//--------------------------------------------------------------------------------------
+static unsigned int Hash32( unsigned int a, unsigned int b, unsigned int c )
+{
+    unsigned int h = a * 0x9E3779B1u ^ ( b + 0x7F4A7C15u ) * 0x85EBCA77u ^ ( c + 0x165667B1u ) * 0xC2B2AE3Du;
+    h ^= h >> 16;
+    h *= 0x7FEB352Du;
+    h ^= h >> 15;
+    h *= 0x846CA68Bu;
+    h ^= h >> 16;
+    return h;
+}
+
+// splitmix64, one stream per block
+struct ObjGenRandom
+{
+    unsigned long long nState;
+
+    ObjGenRandom( unsigned int nSeed, unsigned int nSection, unsigned long long iBlock )
+    {
+        nState = ( ( unsigned long long )nSeed << 32 | nSection ) ^ ( iBlock * 0xD1B54A32D192ED03ull );
+    }
+    unsigned long long Next()
+    {
+        unsigned long long z = ( nState += 0x9E3779B97F4A7C15ull );
+        z = ( z ^ ( z >> 30 ) ) * 0xBF58476D1CE4E5B9ull;
+        z = ( z ^ ( z >> 27 ) ) * 0x94D049BB133111EBull;
+        return z ^ ( z >> 31 );
+    }
+    // Uniform in [0, 1)
+    float NextFloat()
+    {
+        return ( float )( Next() >> 40 ) * ( 1.0f / 16777216.0f );
+    }
+};
+
+
+//--------------------------------------------------------------------------------------
+// Mesh layout.  A welded patch is an nCells x nCells grid sharing (nCells + 1)^2
+// vertices.  With nCells == 0 each triangle has three vertices of its own, laid out
+// over the same grid of unit cells.
+//--------------------------------------------------------------------------------------
+struct ObjGenLayout
+{
+    unsigned int nCells;
+    unsigned long long nPatches;
+    unsigned long long nFacesPerPatch;
+    unsigned long long nVerticesPerPatch;
+    unsigned long long nFaces;
+    unsigned long long nVertices;
+    unsigned int nPatchesPerRow;
+    float fSharing;
+
+    void Init( unsigned long long nRequestedFaces, float fRequestedSharing )
+    {
+        nCells = 0;
+        nFacesPerPatch = 2;
+        nVerticesPerPatch = 6;
+        fSharing = 1.0f;
+
+        // Smallest patch that reaches the requested corners per position, which is
+        // 6k^2 / (k+1)^2 for k cells a side
+        if( fRequestedSharing > 1.0f )
+        {
+            for( nCells = 1; nCells < 1024; nCells++ )
+            {
+                fSharing = 6.0f * nCells * nCells / ( float )( ( nCells + 1 ) * ( nCells + 1 ) );
+                if( fSharing >= fRequestedSharing )
+                    break;
+            }
+            nFacesPerPatch = 2ull * nCells * nCells;
+            nVerticesPerPatch = ( unsigned long long )( nCells + 1 ) * ( nCells + 1 );
+        }
+
+        nPatches = ( nRequestedFaces + nFacesPerPatch - 1 ) / nFacesPerPatch;
+        if( nPatches < 1 )
+            nPatches = 1;
+        nFaces = nPatches * nFacesPerPatch;
+        nVertices = nPatches * nVerticesPerPatch;
+        nPatchesPerRow = ( unsigned int )ceil( sqrt( ( double )nPatches ) );
+    }
+
+    // Grid position of a vertex, in cells from the mesh corner
+    void GetVertexCell( unsigned long long iVertex, unsigned long long* pX, unsigned long long* pZ ) const
+    {
+        unsigned long long iPatch, i, j;
+        unsigned int nSide;
+        if( nCells )
+        {
+            iPatch = iVertex / nVerticesPerPatch;
+            unsigned long long iLocal = iVertex % nVerticesPerPatch;
+            i = iLocal % ( nCells + 1 );
+            j = iLocal / ( nCells + 1 );
+            nSide = nCells;
+        }
+        else
+        {
+            // Six vertices per unit cell: the two triangles of GetFace
+            static const unsigned int s_Corner[6][2] = { { 0, 0 }, { 0, 1 }, { 1, 0 }, { 1, 0 }, { 0, 1 }, { 1, 1 } };
+            iPatch = iVertex / 6;
+            i = s_Corner[iVertex % 6][0];
+            j = s_Corner[iVertex % 6][1];
+            nSide = 1;
+        }
+        *pX = ( iPatch % nPatchesPerRow ) * nSide + i;
+        *pZ = ( iPatch / nPatchesPerRow ) * nSide + j;
+    }
+
+    // 1-based vertex indices of a face, wound clockwise seen from +y
+    void GetFace( unsigned long long iFace, unsigned long long pIndices[3] ) const
+    {
+        if( !nCells )
+        {
+            pIndices[0] = iFace * 3 + 1;
+            pIndices[1] = iFace * 3 + 2;
+            pIndices[2] = iFace * 3 + 3;
+            return;
+        }
+
+        unsigned long long iBase = ( iFace / nFacesPerPatch ) * nVerticesPerPatch + 1;
+        unsigned long long iLocal = iFace % nFacesPerPatch;
+        unsigned long long iCell = iLocal / 2;
+        unsigned long long a = iBase + ( iCell / nCells ) * ( nCells + 1 ) + iCell % nCells;
+        unsigned long long b = a + 1;
+        unsigned long long c = a + nCells + 1;
+        unsigned long long d = c + 1;
+        if( iLocal & 1 )
+        {
+            pIndices[0] = b;
+            pIndices[1] = c;
+            pIndices[2] = d;
+        }
+        else
+        {
+            pIndices[0] = a;
+            pIndices[1] = c;
+            pIndices[2] = b;
+        }
+    }
+};
+
+
+//--------------------------------------------------------------------------------------
+// Value noise height field with analytic normals.  Only +, *, / and sqrt are used, so
+// the values are the same with every compiler.
+//--------------------------------------------------------------------------------------
+static void EvaluateHeight( unsigned int nSeed, float x, float z, float* pHeight, float* pdx, float* pdz )
+{
+    *pHeight = *pdx = *pdz = 0.0f;
+    for( unsigned int iOctave = 0; iOctave < 2; iOctave++ )
+    {
+        float fInvSpacing = 1.0f / s_fNoiseSpacing[iOctave];
+        float fx = x * fInvSpacing, fz = z * fInvSpacing;
+        unsigned int ix = ( unsigned int )fx, iz = ( unsigned int )fz;
+        float tx = fx - ix, tz = fz - iz;
+        float sx = tx * tx * ( 3.0f - 2.0f * tx ), dsx = 6.0f * tx * ( 1.0f - tx );
+        float sz = tz * tz * ( 3.0f - 2.0f * tz ), dsz = 6.0f * tz * ( 1.0f - tz );
+
+        float h[4];
+        for( unsigned int i = 0; i < 4; i++ )
+            h[i] = ( Hash32( nSeed + iOctave, ix + ( i & 1 ), iz + ( i >> 1 ) ) >> 8 ) * ( 2.0f / 16777216.0f ) - 1.0f;
+
+        float a = s_fNoiseAmplitude[iOctave];
+        *pHeight += a * ( ( h[0] + ( h[1] - h[0] ) * sx ) * ( 1.0f - sz ) + ( h[2] + ( h[3] - h[2] ) * sx ) * sz );
+        *pdx += a * fInvSpacing * dsx * ( ( h[1] - h[0] ) * ( 1.0f - sz ) + ( h[3] - h[2] ) * sz );
+        *pdz += a * fInvSpacing * dsz * ( ( h[2] - h[0] ) * ( 1.0f - sx ) + ( h[3] - h[1] ) * sx );
+    }
+}
+
+
+//--------------------------------------------------------------------------------------
+// Number formatting.  printf is several times slower than the disk for this much
+// output.
+//--------------------------------------------------------------------------------------
+static char* AppendUInt( char* p, unsigned long long n )
+{
+    char str[20];
+    int nDigits = 0;
+    do
+    {
+        str[nDigits++] = ( char )( '0' + n % 10 );
+        n /= 10;
+    } while( n );
+    while( nDigits )
+        *p++ = str[--nDigits];
+    return p;
+}
+
+// Six decimals, as most exporters write
+static char* AppendFloat( char* p, float f )
+{
+    double d = f;
+    if( d < 0.0 )
+    {
+        *p++ = '-';
+        d = -d;
+    }
+    unsigned long long n = ( unsigned long long )( d * 1000000.0 + 0.5 );
+    p = AppendUInt( p, n / 1000000 );
+    *p++ = '.';
+    unsigned int nFraction = ( unsigned int )( n % 1000000 );
+    for( unsigned int nDivisor = 100000; nDivisor; nDivisor /= 10 )
+        *p++ = ( char )( '0' + nFraction / nDivisor % 10 );
+    return p;
+}
+
+static char* AppendString( char* p, const char* str )
+{
+    while( *str )
+        *p++ = *str++;
+    return p;
+}
+
+
+//--------------------------------------------------------------------------------------
+class CObjGenerator
+{
+public:
+    CObjGenerator( const OBJGEN_SETTINGS* pSettings ) : m_pSettings( pSettings )
+    {
+        m_Layout.Init( pSettings->nFaces, pSettings->fSharing );
+        m_bTexCoords = OBJGEN_FACE_VT == pSettings->Format || OBJGEN_FACE_VTN == pSettings->Format ||
+                       OBJGEN_FACE_MIXED == pSettings->Format;
+        m_bNormals = OBJGEN_FACE_VN == pSettings->Format || OBJGEN_FACE_VTN == pSettings->Format ||
+                     OBJGEN_FACE_MIXED == pSettings->Format;
+        m_szEndOfLine = pSettings->bCRLF ? "\r\n" : "\n";
+        m_nBytes = 0;
+    }
+
+    const ObjGenLayout& GetLayout() const
+    {
+        return m_Layout;
+    }
+    unsigned long long GetBytesWritten() const
+    {
+        return m_nBytes;
+    }
+
+    bool WriteOBJ( FILE* fp, const char* szMaterialLibrary )
+    {
+        char str[512];
+        char* p = str;
+        p = AppendString( p, "# ObjGen seed " );
+        p = AppendUInt( p, m_pSettings->nSeed );
+        p = AppendString( p, ", " );
+        p = AppendUInt( p, m_Layout.nVertices );
+        p = AppendString( p, " vertices, " );
+        p = AppendUInt( p, m_Layout.nFaces );
+        p = AppendString( p, " faces" );
+        p = AppendString( p, m_szEndOfLine );
+        p = AppendString( p, "mtllib " );
+        p = AppendString( p, szMaterialLibrary );
+        p = AppendString( p, m_szEndOfLine );
+        if( !Write( fp, str, p - str ) )
+            return false;
+
+        return WriteSection( fp, OBJGEN_SECTION_POSITIONS, m_Layout.nVertices ) &&
+               ( !m_bTexCoords || WriteSection( fp, OBJGEN_SECTION_TEXCOORDS, m_Layout.nVertices ) ) &&
+               ( !m_bNormals || WriteSection( fp, OBJGEN_SECTION_NORMALS, m_Layout.nVertices ) ) &&
+               WriteSection( fp, OBJGEN_SECTION_FACES, m_Layout.nFaces );
+    }
+
+    bool WriteMTL( FILE* fp )
+    {
+        std::string Text;
+        for( unsigned int i = 0; i < m_pSettings->nMaterials; i++ )
+        {
+            char str[512];
+            char* p = str;
+            p = AppendString( p, "newmtl " );
+            p = AppendMaterialName( p, i );
+            p = AppendString( p, m_szEndOfLine );
+
+            p = AppendString( p, "Ka 0.200000 0.200000 0.200000" );
+            p = AppendString( p, m_szEndOfLine );
+
+            p = AppendString( p, "Kd" );
+            for( unsigned int c = 0; c < 3; c++ )
+            {
+                *p++ = ' ';
+                p = AppendFloat( p, 0.2f + 0.8f * ( Hash32( m_pSettings->nSeed, i, c ) >> 8 ) / 16777216.0f );
+            }
+            p = AppendString( p, m_szEndOfLine );
+
+            unsigned int nShininess = Hash32( m_pSettings->nSeed, i, 3 ) % 4;
+            p = AppendString( p, nShininess ? "Ks 0.500000 0.500000 0.500000" : "Ks 0.000000 0.000000 0.000000" );
+            p = AppendString( p, m_szEndOfLine );
+            p = AppendString( p, "Ns " );
+            p = AppendUInt( p, 8ull << ( nShininess * 2 ) );
+            p = AppendString( p, m_szEndOfLine );
+            p = AppendString( p, nShininess ? "illum 2" : "illum 1" );
+            p = AppendString( p, m_szEndOfLine );
+            p = AppendString( p, m_szEndOfLine );
+            Text.append( str, p - str );
+        }
+        return Write( fp, Text.data(), Text.size() );
+    }
+
+private:
+    bool Write( FILE* fp, const char* pData, size_t nBytes )
+    {
+        m_nBytes += nBytes;
+        return nBytes == fwrite( pData, 1, nBytes, fp );
+    }
+
+    char* AppendMaterialName( char* p, unsigned int iMaterial )
+    {
+        p = AppendString( p, "material" );
+        return AppendUInt( p, iMaterial );
+    }
+
+    unsigned int GetFaceMaterial( unsigned long long iFace, unsigned long long* piRun ) const
+    {
+        if( m_pSettings->nChurn )
+        {
+            *piRun = iFace / m_pSettings->nChurn;
+            return Hash32( m_pSettings->nSeed, ( unsigned int )*piRun, ( unsigned int )( *piRun >> 32 ) ) %
+                   m_pSettings->nMaterials;
+        }
+        *piRun = iFace * m_pSettings->nMaterials / m_Layout.nFaces;
+        return ( unsigned int )*piRun;
+    }
+
+    // Formats lines [iBegin, iEnd) of one section
+    void FormatBlock( OBJGEN_SECTION Section, unsigned long long iBegin, unsigned long long iEnd, std::string* pText )
+    {
+        ObjGenRandom Random( m_pSettings->nSeed, Section, iBegin / OBJGEN_BLOCK_LINES );
+        pText->clear();
+
+        for( unsigned long long i = iBegin; i < iEnd; i++ )
+        {
+            char str[512];
+            char* p = str;
+
+            if( m_pSettings->fComments > 0.0f && Random.NextFloat() < m_pSettings->fComments )
+            {
+                p = AppendString( p, s_szComments[Random.Next() % ( sizeof( s_szComments ) / sizeof( s_szComments[0] ) )] );
+                p = AppendString( p, m_szEndOfLine );
+            }
+
+            if( OBJGEN_SECTION_FACES == Section )
+            {
+                unsigned long long iRun, iPrevRun;
+                unsigned int iMaterial = GetFaceMaterial( i, &iRun );
+                if( 0 == i || ( GetFaceMaterial( i - 1, &iPrevRun ), iPrevRun != iRun ) )
+                {
+                    p = AppendString( p, "usemtl " );
+                    p = AppendMaterialName( p, iMaterial );
+                    p = AppendString( p, m_szEndOfLine );
+                }
+
+                OBJGEN_FACE_FORMAT Format = m_pSettings->Format;
+                if( OBJGEN_FACE_MIXED == Format )
+                    Format = ( OBJGEN_FACE_FORMAT )( Random.Next() % 4 );
+
+                unsigned long long Indices[3];
+                m_Layout.GetFace( i, Indices );
+                *p++ = 'f';
+                for( unsigned int c = 0; c < 3; c++ )
+                {
+                    *p++ = ' ';
+                    p = AppendUInt( p, Indices[c] );
+                    if( OBJGEN_FACE_V == Format )
+                        continue;
+                    *p++ = '/';
+                    if( OBJGEN_FACE_VN != Format )
+                        p = AppendUInt( p, Indices[c] );
+                    if( OBJGEN_FACE_VT == Format )
+                        continue;
+                    *p++ = '/';
+                    p = AppendUInt( p, Indices[c] );
+                }
+            }
+            else
+            {
+                unsigned long long x, z;
+                m_Layout.GetVertexCell( i, &x, &z );
+                float fCellSize = m_Layout.nCells ? 1.0f / m_Layout.nCells : 1.0f;
+                float fx = x * fCellSize, fz = z * fCellSize;
+
+                float fHeight, dx, dz;
+                EvaluateHeight( m_pSettings->nSeed, fx, fz, &fHeight, &dx, &dz );
+
+                if( OBJGEN_SECTION_POSITIONS == Section )
+                {
+                    float fHalfWidth = 0.5f * m_Layout.nPatchesPerRow;
+                    p = AppendString( p, "v " );
+                    p = AppendFloat( p, fx - fHalfWidth );
+                    *p++ = ' ';
+                    p = AppendFloat( p, fHeight );
+                    *p++ = ' ';
+                    p = AppendFloat( p, fz - fHalfWidth );
+                }
+                else if( OBJGEN_SECTION_TEXCOORDS == Section )
+                {
+                    p = AppendString( p, "vt " );
+                    p = AppendFloat( p, fx / m_Layout.nPatchesPerRow );
+                    *p++ = ' ';
+                    p = AppendFloat( p, fz / m_Layout.nPatchesPerRow );
+                }
+                else
+                {
+                    float fInvLength = 1.0f / sqrtf( dx * dx + 1.0f + dz * dz );
+                    p = AppendString( p, "vn " );
+                    p = AppendFloat( p, -dx * fInvLength );
+                    *p++ = ' ';
+                    p = AppendFloat( p, fInvLength );
+                    *p++ = ' ';
+                    p = AppendFloat( p, -dz * fInvLength );
+                }
+            }
+
+            p = AppendString( p, m_szEndOfLine );
+            pText->append( str, p - str );
+        }
+    }
+
+    // Formats a batch of blocks in parallel while the writer thread writes the previous
+    // batch
+    bool WriteSection( FILE* fp, OBJGEN_SECTION Section, unsigned long long nLines )
+    {
+        unsigned long long nBlocks = ( nLines + OBJGEN_BLOCK_LINES - 1 ) / OBJGEN_BLOCK_LINES;
+        unsigned int nBatch = ( DXUTGetJobSystem()->GetWorkerCount() + 1 ) * 4;
+        std::vector<std::string> Batches[2];
+        Batches[0].resize( nBatch );
+        Batches[1].resize( nBatch );
+
+        std::thread Writer;
+        bool bWriteOK = true;
+        unsigned int iCurrent = 0;
+        for( unsigned long long iFirstBlock = 0; iFirstBlock < nBlocks; iFirstBlock += nBatch )
+        {
+            unsigned int nBlocksInBatch = ( unsigned int )( nBlocks - iFirstBlock < nBatch ? nBlocks - iFirstBlock : nBatch );
+            std::vector<std::string>& Batch = Batches[iCurrent];
+
+            DXUTGetJobSystem()->ParallelFor( 0, nBlocksInBatch, 1, [&]( unsigned int iBegin, unsigned int iEnd )
+            {
+                for( unsigned int iBlock = iBegin; iBlock < iEnd; iBlock++ )
+                {
+                    unsigned long long iLine = ( iFirstBlock + iBlock ) * OBJGEN_BLOCK_LINES;
+                    unsigned long long iLineEnd = iLine + OBJGEN_BLOCK_LINES < nLines ? iLine + OBJGEN_BLOCK_LINES : nLines;
+                    FormatBlock( Section, iLine, iLineEnd, &Batch[iBlock] );
+                }
+            } );
+
+            if( Writer.joinable() )
+                Writer.join();
+            if( !bWriteOK )
+                return false;
+
+            Writer = std::thread( [this, fp, &Batch, nBlocksInBatch, &bWriteOK]()
+            {
+                for( unsigned int iBlock = 0; iBlock < nBlocksInBatch && bWriteOK; iBlock++ )
+                    bWriteOK = Write( fp, Batch[iBlock].data(), Batch[iBlock].size() );
+            } );
+            iCurrent ^= 1;
+        }
+
+        if( Writer.joinable() )
+            Writer.join();
+        return bWriteOK;
+    }
+
+    const OBJGEN_SETTINGS* m_pSettings;
+    ObjGenLayout m_Layout;
+    bool m_bTexCoords;
+    bool m_bNormals;
+    const char* m_szEndOfLine;
+    unsigned long long m_nBytes;
+};
+
+
+//--------------------------------------------------------------------------------------
+// "250000", "10M", "1.5G"
+//--------------------------------------------------------------------------------------
+static unsigned long long ParseCount( const char* str )
+{
+    char* pEnd;
+    double fCount = strtod( str, &pEnd );
+    switch( *pEnd )
+    {
+        case 'k': case 'K': fCount *= 1e3; break;
+        case 'm': case 'M': fCount *= 1e6; break;
+        case 'g': case 'G': fCount *= 1e9; break;
+    }
+    return fCount > 0.0 ? ( unsigned long long )( fCount + 0.5 ) : 0;
+}
+
+
+//--------------------------------------------------------------------------------------
+static void PrintUsage()
+{
+    printf( "Usage: ObjGen [-faces N] [-seed N] [-sharing R] [-format v|vt|vn|vtn|mixed]\n"
+            "              [-materials N] [-churn N] [-comments F] [-crlf] output.obj\n" );
+}
+
+
+//--------------------------------------------------------------------------------------
+int main( int argc, char* argv[] )
+{
+    OBJGEN_SETTINGS Settings;
+    Settings.nFaces = 1000000;
+    Settings.nSeed = 1;
+    Settings.fSharing = 5.0f;
+    Settings.Format = OBJGEN_FACE_VTN;
+    Settings.nMaterials = 16;
+    Settings.nChurn = 0;
+    Settings.fComments = 0.0f;
+    Settings.bCRLF = false;
+    const char* szOutput = NULL;
+
+    for( int i = 1; i < argc; i++ )
+    {
+        bool bHasValue = i + 1 < argc;
+        if( 0 == strcmp( argv[i], "-faces" ) && bHasValue )
+            Settings.nFaces = ParseCount( argv[++i] );
+        else if( 0 == strcmp( argv[i], "-seed" ) && bHasValue )
+            Settings.nSeed = ( unsigned int )strtoul( argv[++i], NULL, 10 );
+        else if( 0 == strcmp( argv[i], "-sharing" ) && bHasValue )
+            Settings.fSharing = ( float )atof( argv[++i] );
+        else if( 0 == strcmp( argv[i], "-materials" ) && bHasValue )
+            Settings.nMaterials = ( unsigned int )ParseCount( argv[++i] );
+        else if( 0 == strcmp( argv[i], "-churn" ) && bHasValue )
+            Settings.nChurn = ParseCount( argv[++i] );
+        else if( 0 == strcmp( argv[i], "-comments" ) && bHasValue )
+            Settings.fComments = ( float )atof( argv[++i] );
+        else if( 0 == strcmp( argv[i], "-crlf" ) )
+            Settings.bCRLF = true;
+        else if( 0 == strcmp( argv[i], "-format" ) && bHasValue )
+        {
+            static const char* s_szFormats[] = { "v", "vt", "vn", "vtn", "mixed" };
+            const char* szFormat = argv[++i];
+            unsigned int iFormat = 0;
+            while( iFormat < 5 && 0 != strcmp( szFormat, s_szFormats[iFormat] ) )
+                iFormat++;
+            if( 5 == iFormat )
+            {
+                PrintUsage();
+                return 1;
+            }
+            Settings.Format = ( OBJGEN_FACE_FORMAT )iFormat;
+        }
+        else if( '-' == argv[i][0] || szOutput )
+        {
+            PrintUsage();
+            return 1;
+        }
+        else
+            szOutput = argv[i];
+    }
+
+    if( !szOutput || 0 == Settings.nFaces || 0 == Settings.nMaterials )
+    {
+        PrintUsage();
+        return 1;
+    }
+
+    // The .mtl goes next to the .obj; mtllib names it relative to the .obj
+    std::string MaterialPath( szOutput );
+    size_t iName = MaterialPath.find_last_of( "\\/" );
+    size_t iExt = MaterialPath.find_last_of( '.' );
+    if( std::string::npos == iExt || ( std::string::npos != iName && iExt < iName ) )
+        iExt = MaterialPath.size();
+    MaterialPath = MaterialPath.substr( 0, iExt ) + ".mtl";
+    std::string MaterialLibrary = MaterialPath.substr( std::string::npos == iName ? 0 : iName + 1 );
+
+    DXUTGetJobSystem()->Init();
+    DXUT_PROFILE_TIME tStart = DXUTProfilerGetTimeNs();
+
+    CObjGenerator Generator( &Settings );
+    FILE* fp = fopen( szOutput, "wb" );
+    bool bOK = fp && Generator.WriteOBJ( fp, MaterialLibrary.c_str() );
+    if( fp )
+        bOK = ( 0 == fclose( fp ) ) && bOK;
+    if( !bOK )
+    {
+        printf( "Could not write %s\n", szOutput );
+        DXUTGetJobSystem()->Shutdown();
+        return 1;
+    }
+
+    fp = fopen( MaterialPath.c_str(), "wb" );
+    bOK = fp && Generator.WriteMTL( fp );
+    if( fp )
+        bOK = ( 0 == fclose( fp ) ) && bOK;
+    if( !bOK )
+    {
+        printf( "Could not write %s\n", MaterialPath.c_str() );
+        DXUTGetJobSystem()->Shutdown();
+        return 1;
+    }
+
+    double fSeconds = ( DXUTProfilerGetTimeNs() - tStart ) * 1e-9;
+    DXUTGetJobSystem()->Shutdown();
+
+    const ObjGenLayout& Layout = Generator.GetLayout();
+    printf( "%s, %s\n", szOutput, MaterialPath.c_str() );
+    printf( "  %llu vertices, %llu faces, %.2f corners per position, %u materials\n", Layout.nVertices,
+            Layout.nFaces, Layout.fSharing, Settings.nMaterials );
+    printf( "  %.1f MB in %.2f s, %.1f MB/s\n", Generator.GetBytesWritten() / 1e6, fSeconds,
+            Generator.GetBytesWritten() / 1e6 / fSeconds );
+    return 0;
+}
@@ -0,0 +1,105 @@
+//--------------------------------------------------------------------------------------
+// File: ObjToSDKMesh.cpp
+//
+// Pre-bakes .obj files into .sdkmesh.  Each mesh is loaded with CMeshLoader10 exactly
+// as the viewer does (vertex welding plus attribute sort and vertex cache optimization)
+// and the result is written with WriteSDKMesh.
+//
+// Usage: ObjToSDKMesh input.obj [output.sdkmesh]
+//
+// The output defaults to the input path with a .sdkmesh extension, which keeps it next
+// to the textures the .mtl refers to.
+//--------------------------------------------------------------------------------------
+#include "DXUT.h"
+#include "DXUTProfiler.h"
+#pragma warning(disable: 4995)
+#include "meshloader10.h"
+#pragma warning(default: 4995)
+#include "SDKMeshWriter.h"
+#include <stdio.h>
+
+
+//--------------------------------------------------------------------------------------
+// Nothing is rendered, so a device without rendering support is enough to build the
+// D3DX mesh.  The reference rasterizer is the fallback where the null device is missing.
+//--------------------------------------------------------------------------------------
+static HRESULT CreateConverterDevice( ID3D10Device** ppDevice )
+{
+    HRESULT hr = D3D10CreateDevice( NULL, D3D10_DRIVER_TYPE_NULL, NULL, 0, D3D10_SDK_VERSION, ppDevice );
+    if( FAILED( hr ) )
+        hr = D3D10CreateDevice( NULL, D3D10_DRIVER_TYPE_REFERENCE, NULL, 0, D3D10_SDK_VERSION, ppDevice );
+    return hr;
+}
+
+
+//--------------------------------------------------------------------------------------
+int wmain( int argc, WCHAR* argv[] )
+{
+    if( argc < 2 )
+    {
+        wprintf( L"Usage: ObjToSDKMesh input.obj [output.sdkmesh]\n" );
+        return 1;
+    }
+
+    WCHAR strOutput[MAX_PATH];
+    if( argc > 2 )
+    {
+        wcscpy_s( strOutput, MAX_PATH, argv[2] );
+    }
+    else
+    {
+        wcscpy_s( strOutput, MAX_PATH, argv[1] );
+        WCHAR* pExt = wcsrchr( strOutput, L'.' );
+        if( pExt && !wcschr( pExt, L'\\' ) && !wcschr( pExt, L'/' ) )
+            *pExt = 0;
+        wcscat_s( strOutput, MAX_PATH, L".sdkmesh" );
+    }
+
+    DXUTProfilerInitFromEnvironment();
+
+    ID3D10Device* pDevice = NULL;
+    HRESULT hr = CreateConverterDevice( &pDevice );
+    if( FAILED( hr ) )
+    {
+        wprintf( L"Could not create a Direct3D 10 device (0x%08x)\n", hr );
+        return 1;
+    }
+
+    DXUT_PROFILE_TIME tStart = DXUTProfilerGetTimeNs();
+
+    CMeshLoader10 MeshLoader;
+    hr = MeshLoader.Create( pDevice, argv[1] );
+    if( FAILED( hr ) )
+    {
+        wprintf( L"Could not load %s (0x%08x)\n", argv[1], hr );
+        SAFE_RELEASE( pDevice );
+        return 1;
+    }
+
+    DXUT_PROFILE_TIME tLoaded = DXUTProfilerGetTimeNs();
+
+    hr = WriteSDKMesh( &MeshLoader, strOutput );
+    if( FAILED( hr ) )
+    {
+        wprintf( L"Could not write %s (0x%08x)\n", strOutput, hr );
+        MeshLoader.Destroy();
+        SAFE_RELEASE( pDevice );
+        return 1;
+    }
+
+    DXUT_PROFILE_TIME tWritten = DXUTProfilerGetTimeNs();
+
+    ID3DX10Mesh* pMesh = MeshLoader.GetMesh();
+    wprintf( L"%s -> %s\n", argv[1], strOutput );
+    wprintf( L"  %u vertices, %u triangles, %s indices, %u subsets, %u materials\n",
+             pMesh->GetVertexCount(), pMesh->GetFaceCount(),
+             pMesh->GetVertexCount() <= 0xFFFF ? L"16-bit" : L"32-bit",
+             MeshLoader.GetNumSubsets(), MeshLoader.GetNumMaterials() );
+    wprintf( L"  load %.1f ms, write %.1f ms\n", ( tLoaded - tStart ) * 1e-6, ( tWritten - tLoaded ) * 1e-6 );
+
+    MeshLoader.Destroy();
+    SAFE_RELEASE( pDevice );
+
+    DXUTProfilerShutdown();
+    return 0;
+}
@@ -0,0 +1,176 @@
+//--------------------------------------------------------------------------------------
+// File: QueueBenchmark.cpp
+//
+// Contention benchmark for DXUTLockFreeQueue.  Runs every combination of producer and
+// consumer thread counts, pushing a fixed number of items through the queue, and
+// compares the throughput against a std::mutex protected std::deque.  Every run checks
+// that each item was received exactly once.
+//
+// Usage: QueueBenchmark [items per run] [max threads per side] [queue capacity]
+//--------------------------------------------------------------------------------------
+#include "DXUTLockFreeQueue.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+
+//--------------------------------------------------------------------------------------
+// Baseline: the obvious locked queue with the same bounded Try/Push/Pop interface
+//--------------------------------------------------------------------------------------
+template <typename TYPE> class CLockedQueue
+{
+public:
+    explicit CLockedQueue( size_t nCapacity ) : m_nCapacity( nCapacity )
+    {
+    }
+
+    bool TryPush( const TYPE& value )
+    {
+        std::lock_guard<std::mutex> lock( m_Lock );
+        if( m_Queue.size() >= m_nCapacity )
+            return false;
+        m_Queue.push_back( value );
+        return true;
+    }
+
+    bool TryPop( TYPE& value )
+    {
+        std::lock_guard<std::mutex> lock( m_Lock );
+        if( m_Queue.empty() )
+            return false;
+        value = m_Queue.front();
+        m_Queue.pop_front();
+        return true;
+    }
+
+    void Push( const TYPE& value )
+    {
+        while( !TryPush( value ) )
+            std::this_thread::yield();
+    }
+
+private:
+    std::mutex m_Lock;
+    std::deque<TYPE> m_Queue;
+    size_t m_nCapacity;
+};
+
+
+//--------------------------------------------------------------------------------------
+// Pushes nItems through pQueue with the given number of threads on each side.  Returns
+// the elapsed time in seconds, or a negative value if items were lost or duplicated.
+//--------------------------------------------------------------------------------------
+template <typename QUEUE> double RunContention( QUEUE* pQueue, unsigned int nProducers,
+                                                unsigned int nConsumers, unsigned int nItems )
+{
+    std::vector<std::atomic<unsigned char> > Received( nItems );
+    for( unsigned int i = 0; i < nItems; i++ )
+        Received[i].store( 0, std::memory_order_relaxed );
+
+    std::atomic<unsigned int> nConsumed( 0 );
+    std::atomic<bool> bGo( false );
+    std::vector<std::thread> Threads;
+
+    for( unsigned int iProducer = 0; iProducer < nProducers; iProducer++ )
+    {
+        Threads.push_back( std::thread( [&, iProducer]()
+        {
+            while( !bGo.load( std::memory_order_acquire ) )
+                std::this_thread::yield();
+
+            // Producers interleave so every item is pushed exactly once
+            for( unsigned int i = iProducer; i < nItems; i += nProducers )
+                pQueue->Push( i );
+        } ) );
+    }
+
+    for( unsigned int iConsumer = 0; iConsumer < nConsumers; iConsumer++ )
+    {
+        Threads.push_back( std::thread( [&]()
+        {
+            while( !bGo.load( std::memory_order_acquire ) )
+                std::this_thread::yield();
+
+            unsigned int nValue;
+            while( nConsumed.load( std::memory_order_relaxed ) < nItems )
+            {
+                if( pQueue->TryPop( nValue ) )
+                {
+                    Received[nValue].fetch_add( 1, std::memory_order_relaxed );
+                    nConsumed.fetch_add( 1, std::memory_order_relaxed );
+                }
+                else
+                {
+                    std::this_thread::yield();
+                }
+            }
+        } ) );
+    }
+
+    std::chrono::high_resolution_clock::time_point tStart = std::chrono::high_resolution_clock::now();
+    bGo.store( true, std::memory_order_release );
+
+    for( size_t i = 0; i < Threads.size(); i++ )
+        Threads[i].join();
+
+    double fSeconds = std::chrono::duration<double>( std::chrono::high_resolution_clock::now() - tStart ).count();
+
+    for( unsigned int i = 0; i < nItems; i++ )
+    {
+        if( Received[i].load( std::memory_order_relaxed ) != 1 )
+        {
+            fprintf( stderr, "item %u received %u times\n", i, ( unsigned int )Received[i].load() );
+            return -1.0;
+        }
+    }
+
+    return fSeconds;
+}
+
+
+//--------------------------------------------------------------------------------------
+int main( int argc, char* argv[] )
+{
+    unsigned int nItems = ( argc > 1 ) ? ( unsigned int )atoi( argv[1] ) : 2000000;
+    unsigned int nMaxThreads = ( argc > 2 ) ? ( unsigned int )atoi( argv[2] ) : 0;
+    unsigned int nCapacity = ( argc > 3 ) ? ( unsigned int )atoi( argv[3] ) : 1024;
+
+    if( nMaxThreads == 0 )
+    {
+        nMaxThreads = std::thread::hardware_concurrency() / 2;
+        if( nMaxThreads < 1 )
+            nMaxThreads = 1;
+    }
+
+    printf( "%u items, queue capacity %u\n", nItems, nCapacity );
+    printf( "%9s %9s %16s %16s %8s\n", "producers", "consumers", "lock-free Mops/s", "mutex Mops/s", "speedup" );
+
+    bool bFailed = false;
+    for( unsigned int nProducers = 1; nProducers <= nMaxThreads; nProducers *= 2 )
+    {
+        for( unsigned int nConsumers = 1; nConsumers <= nMaxThreads; nConsumers *= 2 )
+        {
+            DXUTLockFreeQueue<unsigned int> LockFree( nCapacity );
+            CLockedQueue<unsigned int> Locked( nCapacity );
+
+            double fLockFree = RunContention( &LockFree, nProducers, nConsumers, nItems );
+            double fLocked = RunContention( &Locked, nProducers, nConsumers, nItems );
+            if( fLockFree < 0.0 || fLocked < 0.0 )
+            {
+                bFailed = true;
+                continue;
+            }
+
+            printf( "%9u %9u %16.2f %16.2f %7.2fx\n", nProducers, nConsumers,
+                    nItems / fLockFree * 1e-6, nItems / fLocked * 1e-6, fLocked / fLockFree );
+        }
+    }
+
+    return bFailed ? 1 : 0;
+}
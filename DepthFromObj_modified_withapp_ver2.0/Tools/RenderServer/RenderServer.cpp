@@ -0,0 +1,1123 @@
+//--------------------------------------------------------------------------------------
+// File: RenderServer.cpp
+//
+// Long running depth renderer.  Keeps one device and an LRU of loaded meshes, and
+// serves render requests from other processes over a named pipe so a capture job pays
+// for process start, device creation and .obj parsing once instead of on every frame.
+// See RenderServerProtocol.h for the wire format.
+//
+// Usage: RenderServer [-cache_meshes 8] [-cache_mb 2048] [-reference_device] [-verbose]
+//
+// -cache_mb counts each mesh's buffers and its textures; a texture two meshes share is
+// counted for both.
+//
+// The same executable is also a client, for scripts and for timing the server:
+//
+//        RenderServer -request mesh.obj [-size 640x480] [-fov 45 | -intrinsics fx fy cx cy]
+//                     [-eye x y z] [-at x y z] [-up x y z] [-near 0.1] [-far 100]
+//                     [-format view|window] [-repeat 1] [-out depth.pfm]
+//                     [-trajectory path.txt [-fps 30]]
+//        RenderServer -stats
+//        RenderServer -evict [mesh.obj]
+//        RenderServer -shutdown
+//
+// -trajectory replaces -eye, -at, -up, -fov, -near and -far with the poses of a camera
+// trajectory recorded in the viewer (see DXUTTrajectory.h), sampled at -fps.  Every
+// frame is a request on one connection, written to the -out name with the frame number
+// added (depth_00000.pfm, ...), so a recorded sequence is reproduced at batch speed.
+//
+// Requests are served one at a time on the device; connections are handled on their
+// own threads so a slow client doesn't hold up the others.  Meshes are evicted least
+// recently used first when either cache limit is exceeded.
+//--------------------------------------------------------------------------------------
+#include "DXUT.h"
+#include "SDKmisc.h"
+#include "DXUTProfiler.h"
+#pragma warning(disable: 4995)
+#include "meshloader10.h"
+#pragma warning(default: 4995)
+#include "RenderServerProtocol.h"
+#include "DXUTTrajectory.h"
+#include <stdio.h>
+#include <algorithm>
+#include <atomic>
+#include <list>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+struct SERVER_SETTINGS
+{
+    UINT    MaxMeshes;
+    UINT64  MaxBytes;
+    bool    bReferenceDevice;
+    bool    bVerbose;
+};
+
+static const D3D10_INPUT_ELEMENT_DESC s_MeshLayout[] =
+{
+    { "POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 0, D3D10_INPUT_PER_VERTEX_DATA, 0 },
+    { "NORMAL", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 12, D3D10_INPUT_PER_VERTEX_DATA, 0 },
+    { "TEXCOORD", 0, DXGI_FORMAT_R32G32_FLOAT, 0, 24, D3D10_INPUT_PER_VERTEX_DATA, 0 },
+};
+
+
+//--------------------------------------------------------------------------------------
+// Off-centre perspective projection matching pinhole intrinsics.  Pixel (u, v) in the
+// camera's convention is centred at (u + 0.5, v + 0.5) in Direct3D's.
+//--------------------------------------------------------------------------------------
+static void ProjectionFromIntrinsics( const RENDER_SERVER_REQUEST* pRequest, D3DXMATRIX* pProj )
+{
+    float W = ( float )pRequest->Width, H = ( float )pRequest->Height;
+    float n = pRequest->fNear, f = pRequest->fFar;
+
+    ZeroMemory( pProj, sizeof( D3DXMATRIX ) );
+    pProj->_11 = 2.0f * pRequest->fx / W;
+    pProj->_22 = 2.0f * pRequest->fy / H;
+    pProj->_31 = ( 2.0f * pRequest->cx + 1.0f ) / W - 1.0f;
+    pProj->_32 = 1.0f - ( 2.0f * pRequest->cy + 1.0f ) / H;
+    pProj->_33 = f / ( f - n );
+    pProj->_34 = 1.0f;
+    pProj->_43 = -n * f / ( f - n );
+}
+
+static void GetMeshBounds( ID3DX10Mesh* pMesh, D3DXVECTOR3* pCenter, float* pfRadius )
+{
+    D3DXVECTOR3 vMin( 0, 0, 0 ), vMax( 0, 0, 0 );
+    ID3DX10MeshBuffer* pVB = NULL;
+    if( SUCCEEDED( pMesh->GetVertexBuffer( 0, &pVB ) ) )
+    {
+        void* pData;
+        SIZE_T cbSize;
+        if( SUCCEEDED( pVB->Map( &pData, &cbSize ) ) )
+        {
+            D3DXComputeBoundingBox( ( D3DXVECTOR3* )pData, pMesh->GetVertexCount(), sizeof( VERTEX ), &vMin, &vMax );
+            pVB->Unmap();
+        }
+        SAFE_RELEASE( pVB );
+    }
+
+    *pCenter = ( vMin + vMax ) * 0.5f;
+    *pfRadius = D3DXVec3Length( &( vMax - *pCenter ) );
+}
+
+static bool WritePFM( const WCHAR* strFilename, const float* pDepth, UINT Width, UINT Height )
+{
+    FILE* fp;
+    if( 0 != _wfopen_s( &fp, strFilename, L"wb" ) )
+        return false;
+
+    // Rows are stored bottom to top
+    bool bOK = fprintf( fp, "Pf\n%u %u\n-1.0\n", Width, Height ) > 0;
+    for( UINT y = Height; bOK && y-- > 0; )
+        bOK = Width == fwrite( pDepth + y * Width, sizeof( float ), Width, fp );
+    return ( 0 == fclose( fp ) ) && bOK;
+}
+
+static double Milliseconds( UINT64 Ns )
+{
+    return Ns * 1e-6;
+}
+
+
+//--------------------------------------------------------------------------------------
+// Depth target and readback.  Uses a 32-bit float depth buffer rather than the
+// viewer's 16-bit one, since the output is the product here.  The targets are
+// recreated when a request asks for a different size.
+//--------------------------------------------------------------------------------------
+class CDepthTarget
+{
+public:
+    CDepthTarget() : m_pDevice( NULL ), m_pEffect( NULL ), m_pTechnique( NULL ), m_pWorldViewProjection( NULL ),
+                     m_pLayout( NULL ), m_pColor( NULL ), m_pDepth( NULL ), m_pStaging( NULL ), m_pRTV( NULL ),
+                     m_pDSV( NULL ), m_Width( 0 ), m_Height( 0 )
+    {
+    }
+    ~CDepthTarget()
+    {
+        ReleaseTargets();
+        SAFE_RELEASE( m_pLayout );
+        SAFE_RELEASE( m_pEffect );
+    }
+
+    HRESULT Create( ID3D10Device* pDevice )
+    {
+        HRESULT hr;
+        WCHAR str[MAX_PATH];
+        m_pDevice = pDevice;
+
+        V_RETURN( DXUTFindDXSDKMediaFileCch( str, MAX_PATH, L"MeshFromOBJ10.fx" ) );
+        V_RETURN( D3DX10CreateEffectFromFile( str, NULL, NULL, "fx_4_0", D3D10_SHADER_ENABLE_STRICTNESS, 0, pDevice,
+                                              NULL, NULL, &m_pEffect, NULL, NULL ) );
+        m_pTechnique = m_pEffect->GetTechniqueByName( "NoSpecular" );
+        m_pWorldViewProjection = m_pEffect->GetVariableByName( "g_mWorldViewProjection" )->AsMatrix();
+
+        D3D10_PASS_DESC PassDesc;
+        V_RETURN( m_pTechnique->GetPassByIndex( 0 )->GetDesc( &PassDesc ) );
+        V_RETURN( pDevice->CreateInputLayout( s_MeshLayout, ARRAYSIZE( s_MeshLayout ), PassDesc.pIAInputSignature,
+                                              PassDesc.IAInputSignatureSize, &m_pLayout ) );
+        return S_OK;
+    }
+
+    HRESULT Render( CMeshLoader10* pLoader, const D3DXMATRIX* pViewProjection, UINT Width, UINT Height )
+    {
+        HRESULT hr;
+        if( Width != m_Width || Height != m_Height )
+            V_RETURN( CreateTargets( Width, Height ) );
+
+        float ClearColor[4] = { 0.0f, 0.0f, 0.0f, 1.0f };
+        D3D10_VIEWPORT Viewport = { 0, 0, m_Width, m_Height, 0.0f, 1.0f };
+        m_pDevice->RSSetViewports( 1, &Viewport );
+        m_pDevice->ClearRenderTargetView( m_pRTV, ClearColor );
+        m_pDevice->ClearDepthStencilView( m_pDSV, D3D10_CLEAR_DEPTH, 1.0f, 0 );
+        m_pDevice->OMSetRenderTargets( 1, &m_pRTV, m_pDSV );
+        m_pDevice->IASetInputLayout( m_pLayout );
+        m_pWorldViewProjection->SetMatrix( ( float* )pViewProjection );
+
+        for( UINT iSubset = 0; iSubset < pLoader->GetNumSubsets(); iSubset++ )
+        {
+            m_pTechnique->GetPassByIndex( 0 )->Apply( 0 );
+            pLoader->GetMesh()->DrawSubset( iSubset );
+        }
+        m_pDevice->OMSetRenderTargets( 0, NULL, NULL );
+        return S_OK;
+    }
+
+    // pOutput receives Width * Height floats, rows packed
+    HRESULT Readback( RENDER_SERVER_FORMAT Format, float fNear, float fFar, float* pOutput )
+    {
+        HRESULT hr;
+        m_pDevice->CopyResource( m_pStaging, m_pDepth );
+
+        D3D10_MAPPED_TEXTURE2D Mapped;
+        V_RETURN( m_pStaging->Map( 0, D3D10_MAP_READ, 0, &Mapped ) );
+        for( UINT y = 0; y < m_Height; y++ )
+        {
+            const float* pRow = ( const float* )( ( const BYTE* )Mapped.pData + y * Mapped.RowPitch );
+            float* pDst = pOutput + y * m_Width;
+            if( RENDER_SERVER_WINDOW_DEPTH == Format )
+                memcpy( pDst, pRow, m_Width * sizeof( float ) );
+            else
+            {
+                // Same linearization as PSQuad in MeshFromOBJ10.fx
+                for( UINT x = 0; x < m_Width; x++ )
+                    pDst[x] = ( pRow[x] >= 1.0f ) ? 0.0f : fNear * fFar / ( fFar - pRow[x] * ( fFar - fNear ) );
+            }
+        }
+        m_pStaging->Unmap( 0 );
+        return S_OK;
+    }
+
+private:
+    HRESULT CreateTargets( UINT Width, UINT Height )
+    {
+        HRESULT hr;
+        ReleaseTargets();
+
+        D3D10_TEXTURE2D_DESC TexDesc;
+        ZeroMemory( &TexDesc, sizeof( TexDesc ) );
+        TexDesc.Width = Width;
+        TexDesc.Height = Height;
+        TexDesc.MipLevels = 1;
+        TexDesc.ArraySize = 1;
+        TexDesc.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
+        TexDesc.SampleDesc.Count = 1;
+        TexDesc.Usage = D3D10_USAGE_DEFAULT;
+        TexDesc.BindFlags = D3D10_BIND_RENDER_TARGET;
+        V_RETURN( m_pDevice->CreateTexture2D( &TexDesc, NULL, &m_pColor ) );
+        V_RETURN( m_pDevice->CreateRenderTargetView( m_pColor, NULL, &m_pRTV ) );
+
+        TexDesc.Format = DXGI_FORMAT_R32_TYPELESS;
+        TexDesc.BindFlags = D3D10_BIND_DEPTH_STENCIL;
+        V_RETURN( m_pDevice->CreateTexture2D( &TexDesc, NULL, &m_pDepth ) );
+
+        D3D10_DEPTH_STENCIL_VIEW_DESC DSDesc;
+        ZeroMemory( &DSDesc, sizeof( DSDesc ) );
+        DSDesc.Format = DXGI_FORMAT_D32_FLOAT;
+        DSDesc.ViewDimension = D3D10_DSV_DIMENSION_TEXTURE2D;
+        V_RETURN( m_pDevice->CreateDepthStencilView( m_pDepth, &DSDesc, &m_pDSV ) );
+
+        TexDesc.Usage = D3D10_USAGE_STAGING;
+        TexDesc.BindFlags = 0;
+        TexDesc.CPUAccessFlags = D3D10_CPU_ACCESS_READ;
+        V_RETURN( m_pDevice->CreateTexture2D( &TexDesc, NULL, &m_pStaging ) );
+
+        m_Width = Width;
+        m_Height = Height;
+        return S_OK;
+    }
+
+    void ReleaseTargets()
+    {
+        SAFE_RELEASE( m_pDSV );
+        SAFE_RELEASE( m_pRTV );
+        SAFE_RELEASE( m_pStaging );
+        SAFE_RELEASE( m_pDepth );
+        SAFE_RELEASE( m_pColor );
+        m_Width = m_Height = 0;
+    }
+
+    ID3D10Device* m_pDevice;
+    ID3D10Effect* m_pEffect;
+    ID3D10EffectTechnique* m_pTechnique;
+    ID3D10EffectMatrixVariable* m_pWorldViewProjection;
+    ID3D10InputLayout* m_pLayout;
+    ID3D10Texture2D* m_pColor;
+    ID3D10Texture2D* m_pDepth;
+    ID3D10Texture2D* m_pStaging;
+    ID3D10RenderTargetView* m_pRTV;
+    ID3D10DepthStencilView* m_pDSV;
+    UINT m_Width;
+    UINT m_Height;
+};
+
+
+//--------------------------------------------------------------------------------------
+// Loaded meshes, most recently used first
+//--------------------------------------------------------------------------------------
+struct CACHED_MESH
+{
+    std::wstring strId;
+    CMeshLoader10* pLoader;
+    std::vector<ID3D10ShaderResourceView*> Textures;    // Held by DXUT's resource cache
+    UINT64 Bytes;
+    D3DXVECTOR3 vCenter;
+    float fRadius;
+};
+
+class CMeshCache
+{
+public:
+    CMeshCache( UINT MaxMeshes, UINT64 MaxBytes ) : m_MaxMeshes( MaxMeshes ), m_MaxBytes( MaxBytes ),
+                                                    m_ResidentBytes( 0 ), m_NumEvictions( 0 )
+    {
+    }
+    ~CMeshCache()
+    {
+        EvictAll();
+    }
+
+    // Returns the mesh, loading it if it isn't resident.  *pbHit says which.
+    HRESULT Acquire( ID3D10Device* pDevice, const WCHAR* strId, CACHED_MESH** ppMesh, bool* pbHit )
+    {
+        HRESULT hr;
+        std::map<std::wstring, std::list<CACHED_MESH>::iterator>::iterator it = m_Index.find( strId );
+        if( it != m_Index.end() )
+        {
+            m_Meshes.splice( m_Meshes.begin(), m_Meshes, it->second );
+            *ppMesh = &m_Meshes.front();
+            *pbHit = true;
+            return S_OK;
+        }
+
+        *pbHit = false;
+        CMeshLoader10* pLoader = new CMeshLoader10();
+        if( pLoader == NULL )
+            return E_OUTOFMEMORY;
+        if( FAILED( hr = pLoader->Create( pDevice, strId ) ) )
+        {
+            delete pLoader;
+            return hr;
+        }
+
+        CACHED_MESH Mesh;
+        Mesh.strId = strId;
+        Mesh.pLoader = pLoader;
+        ID3DX10Mesh* pMesh = pLoader->GetMesh();
+        Mesh.Bytes = ( UINT64 )pMesh->GetVertexCount() * sizeof( VERTEX ) + ( UINT64 )pMesh->GetFaceCount() * 3 *
+                     sizeof( DWORD ) + pLoader->GetTextureBytes();
+        for( UINT i = 0; i < pLoader->GetNumMaterials(); i++ )
+        {
+            ID3D10ShaderResourceView* pTexture = pLoader->GetMaterial( i )->pTextureRV10;
+            if( pTexture && !IsErrorResource( pTexture ) &&
+                Mesh.Textures.end() == std::find( Mesh.Textures.begin(), Mesh.Textures.end(), pTexture ) )
+                Mesh.Textures.push_back( pTexture );
+        }
+        GetMeshBounds( pMesh, &Mesh.vCenter, &Mesh.fRadius );
+
+        m_Meshes.push_front( Mesh );
+        m_Index[Mesh.strId] = m_Meshes.begin();
+        m_ResidentBytes += Mesh.Bytes;
+
+        // Make room, but never evict the mesh that is about to be drawn
+        while( m_Meshes.size() > 1 && ( m_Meshes.size() > m_MaxMeshes || m_ResidentBytes > m_MaxBytes ) )
+            Evict( --m_Meshes.end() );
+
+        *ppMesh = &m_Meshes.front();
+        return S_OK;
+    }
+
+    bool Evict( const WCHAR* strId )
+    {
+        std::map<std::wstring, std::list<CACHED_MESH>::iterator>::iterator it = m_Index.find( strId );
+        if( it == m_Index.end() )
+            return false;
+        Evict( it->second );
+        return true;
+    }
+
+    void EvictAll()
+    {
+        while( !m_Meshes.empty() )
+            Evict( m_Meshes.begin() );
+    }
+
+    UINT64 GetNumMeshes() const
+    {
+        return m_Meshes.size();
+    }
+    UINT64 GetResidentBytes() const
+    {
+        return m_ResidentBytes;
+    }
+    UINT64 GetNumEvictions() const
+    {
+        return m_NumEvictions;
+    }
+
+private:
+    void Evict( std::list<CACHED_MESH>::iterator it )
+    {
+        m_ResidentBytes -= it->Bytes;
+        m_NumEvictions++;
+        delete it->pLoader;
+
+        // The resource cache keeps every texture it loaded until the device goes away;
+        // let go of the ones no other resident mesh still draws with
+        for( size_t i = 0; i < it->Textures.size(); i++ )
+        {
+            bool bShared = false;
+            for( std::list<CACHED_MESH>::iterator itOther = m_Meshes.begin(); !bShared && itOther != m_Meshes.end();
+                 ++itOther )
+                bShared = itOther != it && itOther->Textures.end() != std::find( itOther->Textures.begin(),
+                                                                                 itOther->Textures.end(),
+                                                                                 it->Textures[i] );
+            if( !bShared )
+                DXUTGetGlobalResourceCache().ReleaseTexture( it->Textures[i] );
+        }
+        m_Index.erase( it->strId );
+        m_Meshes.erase( it );
+    }
+
+    std::list<CACHED_MESH> m_Meshes;
+    std::map<std::wstring, std::list<CACHED_MESH>::iterator> m_Index;
+    UINT m_MaxMeshes;
+    UINT64 m_MaxBytes;
+    UINT64 m_ResidentBytes;
+    UINT64 m_NumEvictions;
+};
+
+
+//--------------------------------------------------------------------------------------
+// Output buffer shared with one client.  Grown by replacing the mapping with a bigger
+// one under a new name; the client notices the name change and reopens it.
+//--------------------------------------------------------------------------------------
+class CSharedOutput
+{
+public:
+    CSharedOutput( UINT iConnection ) : m_hMapping( NULL ), m_pData( NULL ), m_Bytes( 0 ), m_iConnection( iConnection ),
+                                        m_iGeneration( 0 )
+    {
+        m_strName[0] = 0;
+    }
+    ~CSharedOutput()
+    {
+        Release();
+    }
+
+    void* Reserve( UINT64 Bytes )
+    {
+        if( Bytes <= m_Bytes )
+            return m_pData;
+
+        Release();
+
+        // Round up so a client stepping through sizes doesn't remap every request
+        UINT64 NewBytes = 1 << 20;
+        while( NewBytes < Bytes )
+            NewBytes *= 2;
+
+        swprintf_s( m_strName, RENDER_SERVER_MAX_MAPPING_NAME, L"Local\\DepthFromObjRenderServer.%u.%u.%u",
+                    GetCurrentProcessId(), m_iConnection, ++m_iGeneration );
+        m_hMapping = CreateFileMapping( INVALID_HANDLE_VALUE, NULL, PAGE_READWRITE, ( DWORD )( NewBytes >> 32 ),
+                                        ( DWORD )NewBytes, m_strName );
+        if( m_hMapping )
+            m_pData = MapViewOfFile( m_hMapping, FILE_MAP_WRITE, 0, 0, ( SIZE_T )NewBytes );
+        if( m_pData == NULL )
+        {
+            Release();
+            return NULL;
+        }
+        m_Bytes = NewBytes;
+        return m_pData;
+    }
+
+    const WCHAR* GetName() const
+    {
+        return m_strName;
+    }
+
+private:
+    void Release()
+    {
+        if( m_pData )
+            UnmapViewOfFile( m_pData );
+        if( m_hMapping )
+            CloseHandle( m_hMapping );
+        m_hMapping = NULL;
+        m_pData = NULL;
+        m_Bytes = 0;
+        m_strName[0] = 0;
+    }
+
+    HANDLE m_hMapping;
+    void* m_pData;
+    UINT64 m_Bytes;
+    UINT m_iConnection;
+    UINT m_iGeneration;
+    WCHAR m_strName[RENDER_SERVER_MAX_MAPPING_NAME];
+};
+
+
+//--------------------------------------------------------------------------------------
+// The server: accepts connections on the main thread and serves each on its own
+//--------------------------------------------------------------------------------------
+class CRenderServer
+{
+public:
+    CRenderServer( const SERVER_SETTINGS* pSettings ) : m_Settings( *pSettings ), m_pDevice( NULL ),
+                                                         m_Cache( pSettings->MaxMeshes, pSettings->MaxBytes ),
+                                                         m_bShutdown( false )
+    {
+        ZeroMemory( &m_Stats, sizeof( m_Stats ) );
+    }
+    ~CRenderServer()
+    {
+        m_Cache.EvictAll();
+        DXUTGetGlobalResourceCache().OnDestroyDevice();
+        SAFE_RELEASE( m_pDevice );
+    }
+
+    HRESULT Create()
+    {
+        HRESULT hr;
+        V_RETURN( D3D10CreateDevice( NULL, m_Settings.bReferenceDevice ? D3D10_DRIVER_TYPE_REFERENCE :
+                                     D3D10_DRIVER_TYPE_HARDWARE, NULL, 0, D3D10_SDK_VERSION, &m_pDevice ) );
+        return m_Target.Create( m_pDevice );
+    }
+
+    void Run()
+    {
+        wprintf( L"Listening on %s\n", RENDER_SERVER_PIPE_NAME );
+
+        UINT iConnection = 0;
+        while( !m_bShutdown )
+        {
+            HANDLE hPipe = CreateNamedPipe( RENDER_SERVER_PIPE_NAME, PIPE_ACCESS_DUPLEX,
+                                            PIPE_TYPE_MESSAGE | PIPE_READMODE_MESSAGE | PIPE_WAIT |
+                                            PIPE_REJECT_REMOTE_CLIENTS, PIPE_UNLIMITED_INSTANCES,
+                                            sizeof( RENDER_SERVER_RESPONSE ), sizeof( RENDER_SERVER_REQUEST ), 0, NULL );
+            if( INVALID_HANDLE_VALUE == hPipe )
+            {
+                wprintf( L"CreateNamedPipe failed (%u)\n", GetLastError() );
+                break;
+            }
+
+            bool bConnected = ConnectNamedPipe( hPipe, NULL ) || ERROR_PIPE_CONNECTED == GetLastError();
+            if( !bConnected || m_bShutdown )
+            {
+                CloseHandle( hPipe );
+                continue;
+            }
+
+            JoinFinishedClients();
+            CLIENT_THREAD* pClient = new CLIENT_THREAD;
+            pClient->bDone = false;
+            pClient->hPipe = hPipe;
+            pClient->Thread = std::thread( &CRenderServer::ServeClient, this, pClient, ++iConnection );
+            std::lock_guard<std::mutex> Lock( m_ClientLock );
+            m_Clients.push_back( pClient );
+        }
+
+        // Clients blocked on their pipes are woken up and see the flag.  One that hasn't
+        // reached its ReadFile yet has nothing to cancel, so keep cancelling until it has
+        // left its loop.  No new clients are added from here on.
+        m_bShutdown = true;
+        while( !m_Clients.empty() )
+        {
+            CLIENT_THREAD* pClient = m_Clients.front();
+            while( !pClient->bDone )
+            {
+                CancelSynchronousIo( pClient->Thread.native_handle() );
+                Sleep( 1 );
+            }
+            pClient->Thread.join();
+            m_Clients.pop_front();
+            delete pClient;
+        }
+    }
+
+private:
+    struct CLIENT_THREAD
+    {
+        std::thread Thread;
+        std::atomic<bool> bDone;
+        HANDLE hPipe;
+    };
+
+    void JoinFinishedClients()
+    {
+        std::lock_guard<std::mutex> Lock( m_ClientLock );
+        for( std::list<CLIENT_THREAD*>::iterator it = m_Clients.begin(); it != m_Clients.end(); )
+        {
+            if( ( *it )->bDone )
+            {
+                ( *it )->Thread.join();
+                delete *it;
+                it = m_Clients.erase( it );
+            }
+            else
+                ++it;
+        }
+    }
+
+    void ServeClient( CLIENT_THREAD* pClient, UINT iConnection )
+    {
+        DXUTProfilerSetThreadName( "Client" );
+        CSharedOutput Output( iConnection );
+
+        while( !m_bShutdown )
+        {
+            RENDER_SERVER_REQUEST Request;
+            DWORD cbRead = 0;
+            if( !ReadFile( pClient->hPipe, &Request, sizeof( Request ), &cbRead, NULL ) || cbRead != sizeof( Request ) )
+                break;
+
+            RENDER_SERVER_RESPONSE Response;
+            HandleRequest( &Request, &Output, &Response );
+
+            DWORD cbWritten = 0;
+            if( !WriteFile( pClient->hPipe, &Response, sizeof( Response ), &cbWritten, NULL ) )
+                break;
+
+            if( RENDER_SERVER_SHUTDOWN == Request.Command && SUCCEEDED( Response.hr ) )
+            {
+                // Wake the accept loop with a connection of our own
+                m_bShutdown = true;
+                HANDLE hWake = CreateFile( RENDER_SERVER_PIPE_NAME, GENERIC_READ | GENERIC_WRITE, 0, NULL,
+                                           OPEN_EXISTING, 0, NULL );
+                if( INVALID_HANDLE_VALUE != hWake )
+                    CloseHandle( hWake );
+                break;
+            }
+        }
+
+        FlushFileBuffers( pClient->hPipe );
+        DisconnectNamedPipe( pClient->hPipe );
+        CloseHandle( pClient->hPipe );
+
+        // Meshes loaded for this client parsed in the thread's arena
+        DXUTReleaseThreadArena();
+        pClient->bDone = true;
+    }
+
+    void HandleRequest( const RENDER_SERVER_REQUEST* pRequest, CSharedOutput* pOutput, RENDER_SERVER_RESPONSE* pResponse )
+    {
+        UINT64 tStart = DXUTProfilerGetTimeNs();
+        ZeroMemory( pResponse, sizeof( RENDER_SERVER_RESPONSE ) );
+        pResponse->Magic = RENDER_SERVER_MAGIC;
+        pResponse->Version = RENDER_SERVER_VERSION;
+
+        if( RENDER_SERVER_MAGIC != pRequest->Magic || RENDER_SERVER_VERSION != pRequest->Version )
+        {
+            pResponse->hr = E_INVALIDARG;
+            return;
+        }
+
+        // The device and the cache are only touched by one request at a time
+        std::lock_guard<std::mutex> Lock( m_DeviceLock );
+        UINT64 tLocked = DXUTProfilerGetTimeNs();
+        pResponse->QueueNs = tLocked - tStart;
+
+        WCHAR strMeshId[RENDER_SERVER_MAX_MESH_ID];
+        wcsncpy_s( strMeshId, RENDER_SERVER_MAX_MESH_ID, pRequest->strMeshId, _TRUNCATE );
+
+        switch( pRequest->Command )
+        {
+            case RENDER_SERVER_RENDER:
+                pResponse->hr = Render( pRequest, strMeshId, pOutput, pResponse );
+                break;
+
+            case RENDER_SERVER_STATS:
+            case RENDER_SERVER_SHUTDOWN:
+                pResponse->hr = S_OK;
+                break;
+
+            case RENDER_SERVER_EVICT:
+                if( strMeshId[0] )
+                    pResponse->hr = m_Cache.Evict( strMeshId ) ? S_OK : S_FALSE;
+                else
+                {
+                    m_Cache.EvictAll();
+                    pResponse->hr = S_OK;
+                }
+                break;
+
+            default:
+                pResponse->hr = E_INVALIDARG;
+                break;
+        }
+
+        pResponse->TotalNs = DXUTProfilerGetTimeNs() - tStart;
+        m_Stats.NumResidentMeshes = m_Cache.GetNumMeshes();
+        m_Stats.ResidentBytes = m_Cache.GetResidentBytes();
+        m_Stats.NumEvictions = m_Cache.GetNumEvictions();
+        pResponse->Stats = m_Stats;
+
+        if( m_Settings.bVerbose && RENDER_SERVER_RENDER == pRequest->Command )
+            wprintf( L"%s %ux%u  %s  0x%08x  total %.2f ms  (queue %.2f  load %.2f  render %.2f  readback %.2f)\n",
+                     strMeshId, pRequest->Width, pRequest->Height, pResponse->bCacheHit ? L"hit " : L"miss",
+                     pResponse->hr, Milliseconds( pResponse->TotalNs ), Milliseconds( pResponse->QueueNs ),
+                     Milliseconds( pResponse->LoadNs ), Milliseconds( pResponse->RenderNs ),
+                     Milliseconds( pResponse->ReadbackNs ) );
+    }
+
+    HRESULT Render( const RENDER_SERVER_REQUEST* pRequest, const WCHAR* strMeshId, CSharedOutput* pOutput,
+                    RENDER_SERVER_RESPONSE* pResponse )
+    {
+        HRESULT hr;
+        if( pRequest->Width == 0 || pRequest->Width > D3D10_REQ_TEXTURE2D_U_OR_V_DIMENSION ||
+            pRequest->Height == 0 || pRequest->Height > D3D10_REQ_TEXTURE2D_U_OR_V_DIMENSION ||
+            !( pRequest->fNear > 0.0f ) || !( pRequest->fFar > pRequest->fNear ) ||
+            !( pRequest->fx > 0.0f ) || !( pRequest->fy > 0.0f ) ||
+            ( RENDER_SERVER_VIEW_DEPTH != pRequest->Format && RENDER_SERVER_WINDOW_DEPTH != pRequest->Format ) )
+            return E_INVALIDARG;
+
+        m_Stats.NumRequests++;
+
+        UINT64 tStart = DXUTProfilerGetTimeNs();
+        CACHED_MESH* pMesh;
+        bool bHit;
+        V_RETURN( m_Cache.Acquire( m_pDevice, strMeshId, &pMesh, &bHit ) );
+        pResponse->bCacheHit = bHit;
+        pResponse->vCenter[0] = pMesh->vCenter.x;
+        pResponse->vCenter[1] = pMesh->vCenter.y;
+        pResponse->vCenter[2] = pMesh->vCenter.z;
+        pResponse->fRadius = pMesh->fRadius;
+        if( bHit )
+            m_Stats.NumCacheHits++;
+        else
+        {
+            m_Stats.NumCacheMisses++;
+            pResponse->LoadNs = DXUTProfilerGetTimeNs() - tStart;
+            m_Stats.TotalLoadNs += pResponse->LoadNs;
+        }
+
+        D3DXMATRIX mView( pRequest->mView ), mProj;
+        ProjectionFromIntrinsics( pRequest, &mProj );
+        D3DXMATRIX mViewProjection = mView * mProj;
+
+        tStart = DXUTProfilerGetTimeNs();
+        V_RETURN( m_Target.Render( pMesh->pLoader, &mViewProjection, pRequest->Width, pRequest->Height ) );
+        pResponse->RenderNs = DXUTProfilerGetTimeNs() - tStart;
+        m_Stats.TotalRenderNs += pResponse->RenderNs;
+
+        tStart = DXUTProfilerGetTimeNs();
+        UINT64 DataBytes = ( UINT64 )pRequest->Width * pRequest->Height * sizeof( float );
+        float* pData = ( float* )pOutput->Reserve( DataBytes );
+        if( pData == NULL )
+            return E_OUTOFMEMORY;
+        V_RETURN( m_Target.Readback( ( RENDER_SERVER_FORMAT )pRequest->Format, pRequest->fNear, pRequest->fFar,
+                                     pData ) );
+        pResponse->ReadbackNs = DXUTProfilerGetTimeNs() - tStart;
+
+        pResponse->Format = pRequest->Format;
+        pResponse->Width = pRequest->Width;
+        pResponse->Height = pRequest->Height;
+        pResponse->BytesPerPixel = sizeof( float );
+        pResponse->DataBytes = DataBytes;
+        wcscpy_s( pResponse->strMappingName, RENDER_SERVER_MAX_MAPPING_NAME, pOutput->GetName() );
+        return S_OK;
+    }
+
+    SERVER_SETTINGS m_Settings;
+    ID3D10Device* m_pDevice;
+    CDepthTarget m_Target;
+    CMeshCache m_Cache;
+    RENDER_SERVER_STATS m_Stats;
+    std::mutex m_DeviceLock;
+
+    std::atomic<bool> m_bShutdown;
+    std::mutex m_ClientLock;
+    std::list<CLIENT_THREAD*> m_Clients;
+};
+
+
+//--------------------------------------------------------------------------------------
+// Client side of the command line
+//--------------------------------------------------------------------------------------
+static HANDLE ConnectToServer()
+{
+    for( ;; )
+    {
+        HANDLE hPipe = CreateFile( RENDER_SERVER_PIPE_NAME, GENERIC_READ | GENERIC_WRITE, 0, NULL, OPEN_EXISTING, 0,
+                                   NULL );
+        if( INVALID_HANDLE_VALUE != hPipe )
+        {
+            DWORD dwMode = PIPE_READMODE_MESSAGE;
+            SetNamedPipeHandleState( hPipe, &dwMode, NULL, NULL );
+            return hPipe;
+        }
+
+        // Every instance is busy; wait for the server to create another
+        if( ERROR_PIPE_BUSY != GetLastError() || !WaitNamedPipe( RENDER_SERVER_PIPE_NAME, 5000 ) )
+            return INVALID_HANDLE_VALUE;
+    }
+}
+
+static bool Transact( HANDLE hPipe, RENDER_SERVER_REQUEST* pRequest, RENDER_SERVER_RESPONSE* pResponse )
+{
+    pRequest->Magic = RENDER_SERVER_MAGIC;
+    pRequest->Version = RENDER_SERVER_VERSION;
+    DWORD cbRead = 0;
+    return TransactNamedPipe( hPipe, pRequest, sizeof( RENDER_SERVER_REQUEST ), pResponse,
+                              sizeof( RENDER_SERVER_RESPONSE ), &cbRead, NULL ) &&
+           cbRead == sizeof( RENDER_SERVER_RESPONSE ) && RENDER_SERVER_MAGIC == pResponse->Magic;
+}
+
+static void PrintStats( const RENDER_SERVER_STATS* pStats )
+{
+    wprintf( L"requests %llu  hits %llu  misses %llu  evictions %llu  resident %llu meshes, %.1f MB\n",
+             pStats->NumRequests, pStats->NumCacheHits, pStats->NumCacheMisses, pStats->NumEvictions,
+             pStats->NumResidentMeshes, pStats->ResidentBytes / ( 1024.0 * 1024.0 ) );
+    if( pStats->NumRequests )
+        wprintf( L"mean render %.2f ms", Milliseconds( pStats->TotalRenderNs / pStats->NumRequests ) );
+    if( pStats->NumCacheMisses )
+        wprintf( L"  mean load %.2f ms", Milliseconds( pStats->TotalLoadNs / pStats->NumCacheMisses ) );
+    wprintf( L"\n" );
+}
+
+// Read the image before the next request on this connection replaces it
+static bool SaveResponse( const RENDER_SERVER_RESPONSE* pResponse, const WCHAR* strOutput )
+{
+    HANDLE hMapping = OpenFileMapping( FILE_MAP_READ, FALSE, pResponse->strMappingName );
+    const float* pData = hMapping ? ( const float* )MapViewOfFile( hMapping, FILE_MAP_READ, 0, 0,
+                                                                    ( SIZE_T )pResponse->DataBytes ) : NULL;
+    bool bOK = pData != NULL && WritePFM( strOutput, pData, pResponse->Width, pResponse->Height );
+    if( !bOK )
+        wprintf( L"Could not write %s\n", strOutput );
+    if( pData )
+        UnmapViewOfFile( pData );
+    if( hMapping )
+        CloseHandle( hMapping );
+    return bOK;
+}
+
+static int RunClient( RENDER_SERVER_REQUEST* pRequest, UINT NumRepeats, const WCHAR* strOutput )
+{
+    HANDLE hPipe = ConnectToServer();
+    if( INVALID_HANDLE_VALUE == hPipe )
+    {
+        wprintf( L"Could not connect to %s (%u)\n", RENDER_SERVER_PIPE_NAME, GetLastError() );
+        return 1;
+    }
+
+    int Result = 0;
+    RENDER_SERVER_RESPONSE Response;
+    for( UINT i = 0; i < NumRepeats; i++ )
+    {
+        UINT64 tStart = DXUTProfilerGetTimeNs();
+        if( !Transact( hPipe, pRequest, &Response ) )
+        {
+            wprintf( L"Lost the connection to the server (%u)\n", GetLastError() );
+            Result = 1;
+            break;
+        }
+        UINT64 RoundTripNs = DXUTProfilerGetTimeNs() - tStart;
+
+        if( FAILED( Response.hr ) )
+        {
+            wprintf( L"The server failed the request (0x%08x)\n", Response.hr );
+            Result = 1;
+            break;
+        }
+        if( RENDER_SERVER_RENDER == pRequest->Command )
+            wprintf( L"%s  round trip %.2f ms  server %.2f ms  (queue %.2f  load %.2f  render %.2f  readback %.2f)\n",
+                     Response.bCacheHit ? L"hit " : L"miss", Milliseconds( RoundTripNs ),
+                     Milliseconds( Response.TotalNs ), Milliseconds( Response.QueueNs ), Milliseconds( Response.LoadNs ),
+                     Milliseconds( Response.RenderNs ), Milliseconds( Response.ReadbackNs ) );
+    }
+
+    if( 0 == Result && RENDER_SERVER_RENDER == pRequest->Command && strOutput &&
+        !SaveResponse( &Response, strOutput ) )
+        Result = 1;
+
+    if( 0 == Result && RENDER_SERVER_STATS == pRequest->Command )
+        PrintStats( &Response.Stats );
+
+    CloseHandle( hPipe );
+    return Result;
+}
+
+
+//--------------------------------------------------------------------------------------
+// Renders every frame of a trajectory.  The model rotation the viewer applied is folded
+// into the view, since the server draws meshes untransformed.
+//--------------------------------------------------------------------------------------
+static int RunTrajectoryClient( RENDER_SERVER_REQUEST* pRequest, const CDXUTTrajectory* pTrajectory,
+                                double fFrameRate, bool bIntrinsics, const WCHAR* strOutput )
+{
+    HANDLE hPipe = ConnectToServer();
+    if( INVALID_HANDLE_VALUE == hPipe )
+    {
+        wprintf( L"Could not connect to %s (%u)\n", RENDER_SERVER_PIPE_NAME, GetLastError() );
+        return 1;
+    }
+
+    // depth.pfm becomes depth_00000.pfm, depth_00001.pfm, ...
+    WCHAR strBase[MAX_PATH] = L"", strExtension[MAX_PATH] = L"";
+    if( strOutput )
+    {
+        wcscpy_s( strBase, MAX_PATH, strOutput );
+        WCHAR* pDot = wcsrchr( strBase, L'.' );
+        if( pDot && pDot > wcsrchr( strBase, L'\\' ) && pDot > wcsrchr( strBase, L'/' ) )
+        {
+            wcscpy_s( strExtension, MAX_PATH, pDot );
+            *pDot = 0;
+        }
+    }
+
+    int Result = 0;
+    UINT NumFrames = pTrajectory->GetNumFrames( fFrameRate );
+    UINT64 ServerNs = 0;
+    UINT64 tStart = DXUTProfilerGetTimeNs();
+    for( UINT iFrame = 0; iFrame < NumFrames; iFrame++ )
+    {
+        DXUT_CAMERA_KEY Pose;
+        DXUTMATRIX4 mWorld, mView;
+        pTrajectory->EvaluateFrame( iFrame, fFrameRate, &Pose );
+        DXUTGetCameraKeyMatrices( &Pose, &mWorld, &mView, NULL );
+        DXUTMatrixMultiply( ( DXUTMATRIX4* )pRequest->mView, &mWorld, &mView );
+        pRequest->fNear = Pose.fNear;
+        pRequest->fFar = Pose.fFar;
+        if( !bIntrinsics )
+        {
+            // Square pixels with the recorded vertical field of view
+            pRequest->fy = 0.5f * pRequest->Height / tanf( 0.5f * Pose.fFovY );
+            pRequest->fx = pRequest->fy;
+            pRequest->cx = 0.5f * ( pRequest->Width - 1.0f );
+            pRequest->cy = 0.5f * ( pRequest->Height - 1.0f );
+        }
+
+        RENDER_SERVER_RESPONSE Response;
+        if( !Transact( hPipe, pRequest, &Response ) )
+        {
+            wprintf( L"Lost the connection to the server (%u)\n", GetLastError() );
+            Result = 1;
+            break;
+        }
+        if( FAILED( Response.hr ) )
+        {
+            wprintf( L"The server failed frame %u (0x%08x)\n", iFrame, Response.hr );
+            Result = 1;
+            break;
+        }
+        ServerNs += Response.TotalNs;
+
+        if( strOutput )
+        {
+            WCHAR strFrame[MAX_PATH];
+            swprintf_s( strFrame, MAX_PATH, L"%s_%05u%s", strBase, iFrame, strExtension );
+            if( !SaveResponse( &Response, strFrame ) )
+            {
+                Result = 1;
+                break;
+            }
+        }
+    }
+    UINT64 TotalNs = DXUTProfilerGetTimeNs() - tStart;
+
+    if( 0 == Result && NumFrames )
+        wprintf( L"%u frames in %.1f ms  (%.2f ms per frame, %.2f ms of it in the server)\n", NumFrames,
+                 Milliseconds( TotalNs ), Milliseconds( TotalNs / NumFrames ), Milliseconds( ServerNs / NumFrames ) );
+
+    CloseHandle( hPipe );
+    return Result;
+}
+
+
+//--------------------------------------------------------------------------------------
+static void PrintUsage()
+{
+    wprintf( L"Usage: RenderServer [-cache_meshes 8] [-cache_mb 2048] [-reference_device] [-verbose]\n"
+             L"       RenderServer -request mesh.obj [-size 640x480] [-fov 45 | -intrinsics fx fy cx cy]\n"
+             L"                    [-eye x y z] [-at x y z] [-up x y z] [-near 0.1] [-far 100]\n"
+             L"                    [-format view|window] [-repeat 1] [-out depth.pfm]\n"
+             L"                    [-trajectory path.txt [-fps 30]]\n"
+             L"       RenderServer -stats | -evict [mesh.obj] | -shutdown\n" );
+}
+
+static bool ParseVector( int argc, WCHAR* argv[], int* pi, D3DXVECTOR3* pVector )
+{
+    if( *pi + 3 >= argc )
+        return false;
+    pVector->x = ( float )_wtof( argv[++*pi] );
+    pVector->y = ( float )_wtof( argv[++*pi] );
+    pVector->z = ( float )_wtof( argv[++*pi] );
+    return true;
+}
+
+int wmain( int argc, WCHAR* argv[] )
+{
+    SERVER_SETTINGS Settings;
+    ZeroMemory( &Settings, sizeof( Settings ) );
+    Settings.MaxMeshes = 8;
+    Settings.MaxBytes = 2048ULL << 20;
+
+    RENDER_SERVER_REQUEST Request;
+    ZeroMemory( &Request, sizeof( Request ) );
+    Request.Width = 640;
+    Request.Height = 480;
+    Request.fNear = 0.1f;
+    Request.fFar = 100.0f;
+
+    bool bClient = false, bIntrinsics = false;
+    float fFov = 45.0f;
+    UINT NumRepeats = 1;
+    const WCHAR* strOutput = NULL;
+    const WCHAR* strTrajectory = NULL;
+    double fFrameRate = 30.0;
+    D3DXVECTOR3 vEye( 0.0f, 0.0f, -5.0f ), vAt( 0.0f, 0.0f, 0.0f ), vUp( 0.0f, 1.0f, 0.0f );
+
+    for( int i = 1; i < argc; i++ )
+    {
+        bool bHasValue = i + 1 < argc;
+        bool bOK = true;
+        if( 0 == _wcsicmp( argv[i], L"-cache_meshes" ) && bHasValue )
+            Settings.MaxMeshes = __max( 1, wcstoul( argv[++i], NULL, 10 ) );
+        else if( 0 == _wcsicmp( argv[i], L"-cache_mb" ) && bHasValue )
+            Settings.MaxBytes = ( UINT64 )_wtoi64( argv[++i] ) << 20;
+        else if( 0 == _wcsicmp( argv[i], L"-reference_device" ) )
+            Settings.bReferenceDevice = true;
+        else if( 0 == _wcsicmp( argv[i], L"-verbose" ) )
+            Settings.bVerbose = true;
+        else if( 0 == _wcsicmp( argv[i], L"-request" ) && bHasValue )
+        {
+            // The server may have been started from another directory
+            bClient = true;
+            Request.Command = RENDER_SERVER_RENDER;
+            if( !GetFullPathName( argv[++i], RENDER_SERVER_MAX_MESH_ID, Request.strMeshId, NULL ) )
+                bOK = false;
+        }
+        else if( 0 == _wcsicmp( argv[i], L"-stats" ) )
+        {
+            bClient = true;
+            Request.Command = RENDER_SERVER_STATS;
+        }
+        else if( 0 == _wcsicmp( argv[i], L"-evict" ) )
+        {
+            bClient = true;
+            Request.Command = RENDER_SERVER_EVICT;
+            if( bHasValue && L'-' != argv[i + 1][0] )
+                bOK = 0 != GetFullPathName( argv[++i], RENDER_SERVER_MAX_MESH_ID, Request.strMeshId, NULL );
+        }
+        else if( 0 == _wcsicmp( argv[i], L"-shutdown" ) )
+        {
+            bClient = true;
+            Request.Command = RENDER_SERVER_SHUTDOWN;
+        }
+        else if( 0 == _wcsicmp( argv[i], L"-size" ) && bHasValue )
+        {
+            WCHAR* pEnd;
+            Request.Width = wcstoul( argv[++i], &pEnd, 10 );
+            Request.Height = ( L'x' == *pEnd ) ? wcstoul( pEnd + 1, NULL, 10 ) : Request.Width;
+        }
+        else if( 0 == _wcsicmp( argv[i], L"-fov" ) && bHasValue )
+            fFov = ( float )_wtof( argv[++i] );
+        else if( 0 == _wcsicmp( argv[i], L"-intrinsics" ) && i + 4 < argc )
+        {
+            bIntrinsics = true;
+            Request.fx = ( float )_wtof( argv[++i] );
+            Request.fy = ( float )_wtof( argv[++i] );
+            Request.cx = ( float )_wtof( argv[++i] );
+            Request.cy = ( float )_wtof( argv[++i] );
+        }
+        else if( 0 == _wcsicmp( argv[i], L"-eye" ) )
+            bOK = ParseVector( argc, argv, &i, &vEye );
+        else if( 0 == _wcsicmp( argv[i], L"-at" ) )
+            bOK = ParseVector( argc, argv, &i, &vAt );
+        else if( 0 == _wcsicmp( argv[i], L"-up" ) )
+            bOK = ParseVector( argc, argv, &i, &vUp );
+        else if( 0 == _wcsicmp( argv[i], L"-near" ) && bHasValue )
+            Request.fNear = ( float )_wtof( argv[++i] );
+        else if( 0 == _wcsicmp( argv[i], L"-far" ) && bHasValue )
+            Request.fFar = ( float )_wtof( argv[++i] );
+        else if( 0 == _wcsicmp( argv[i], L"-format" ) && bHasValue )
+        {
+            i++;
+            if( 0 == _wcsicmp( argv[i], L"view" ) )
+                Request.Format = RENDER_SERVER_VIEW_DEPTH;
+            else if( 0 == _wcsicmp( argv[i], L"window" ) )
+                Request.Format = RENDER_SERVER_WINDOW_DEPTH;
+            else
+                bOK = false;
+        }
+        else if( 0 == _wcsicmp( argv[i], L"-repeat" ) && bHasValue )
+            NumRepeats = __max( 1, wcstoul( argv[++i], NULL, 10 ) );
+        else if( 0 == _wcsicmp( argv[i], L"-out" ) && bHasValue )
+            strOutput = argv[++i];
+        else if( 0 == _wcsicmp( argv[i], L"-trajectory" ) && bHasValue )
+            strTrajectory = argv[++i];
+        else if( 0 == _wcsicmp( argv[i], L"-fps" ) && bHasValue )
+            bOK = ( fFrameRate = _wtof( argv[++i] ) ) > 0.0;
+        else
+            bOK = false;
+
+        if( !bOK )
+        {
+            PrintUsage();
+            return 1;
+        }
+    }
+
+    if( bClient && strTrajectory )
+    {
+        CDXUTTrajectory Trajectory;
+        char strPath[MAX_PATH * 3];
+        if( RENDER_SERVER_RENDER != Request.Command ||
+            0 == WideCharToMultiByte( CP_UTF8, 0, strTrajectory, -1, strPath, sizeof( strPath ), NULL, NULL ) ||
+            !Trajectory.Load( strPath ) || 0 == Trajectory.GetNumKeys() )
+        {
+            wprintf( L"Could not load a trajectory from %s\n", strTrajectory );
+            return 1;
+        }
+        return RunTrajectoryClient( &Request, &Trajectory, fFrameRate, bIntrinsics, strOutput );
+    }
+
+    if( bClient )
+    {
+        if( !bIntrinsics )
+        {
+            Request.fy = 0.5f * Request.Height / tanf( 0.5f * D3DXToRadian( fFov ) );
+            Request.fx = Request.fy;
+            Request.cx = 0.5f * ( Request.Width - 1.0f );
+            Request.cy = 0.5f * ( Request.Height - 1.0f );
+        }
+        D3DXMATRIX mView;
+        D3DXMatrixLookAtLH( &mView, &vEye, &vAt, &vUp );
+        memcpy( Request.mView, ( float* )mView, sizeof( Request.mView ) );
+        return RunClient( &Request, NumRepeats, strOutput );
+    }
+
+    CRenderServer Server( &Settings );
+    HRESULT hr = Server.Create();
+    if( FAILED( hr ) )
+    {
+        wprintf( L"Could not set up the Direct3D 10 device (0x%08x)\n", hr );
+        return 1;
+    }
+    Server.Run();
+    return 0;
+}
@@ -0,0 +1,104 @@
+//--------------------------------------------------------------------------------------
+// File: RenderServerProtocol.h
+//
+// Wire format between RenderServer and its clients.  A client opens the pipe in
+// message mode, writes one RENDER_SERVER_REQUEST and reads one RENDER_SERVER_RESPONSE
+// back, as many times as it likes on the same connection.
+//
+// Rendered images do not go through the pipe.  The server writes them, rows packed
+// top to bottom, at the start of a named file mapping owned by the connection and
+// returns the mapping's name in the response.  The name changes whenever the mapping
+// has to grow, so clients should reopen it when it differs from the last one.  The
+// contents stay valid until the next request on the same connection.
+//--------------------------------------------------------------------------------------
+#pragma once
+#ifndef RENDER_SERVER_PROTOCOL_H
+#define RENDER_SERVER_PROTOCOL_H
+
+#include <windows.h>
+
+#define RENDER_SERVER_PIPE_NAME         L"\\\\.\\pipe\\DepthFromObjRenderServer"
+#define RENDER_SERVER_MAGIC             0x53524F44      // "DORS"
+#define RENDER_SERVER_VERSION           1
+#define RENDER_SERVER_MAX_MESH_ID       260
+#define RENDER_SERVER_MAX_MAPPING_NAME  64
+
+enum RENDER_SERVER_COMMAND
+{
+    RENDER_SERVER_RENDER = 1,       // Load the mesh if it isn't resident and render it
+    RENDER_SERVER_STATS,            // Only fills in the server totals
+    RENDER_SERVER_EVICT,            // Unloads strMeshId, or every mesh if it is empty
+    RENDER_SERVER_SHUTDOWN,
+};
+
+enum RENDER_SERVER_FORMAT
+{
+    RENDER_SERVER_VIEW_DEPTH = 0,   // float view space depth, 0 where nothing was drawn
+    RENDER_SERVER_WINDOW_DEPTH,     // float depth buffer value in [0, 1], 1 where nothing was drawn
+};
+
+struct RENDER_SERVER_REQUEST
+{
+    UINT32  Magic;
+    UINT32  Version;
+    UINT32  Command;                // RENDER_SERVER_COMMAND
+    UINT32  Format;                 // RENDER_SERVER_FORMAT
+
+    // The mesh id is the .obj path as CMeshLoader10::Create would find it
+    WCHAR   strMeshId[RENDER_SERVER_MAX_MESH_ID];
+
+    // World to view transform, row vectors as in D3DX: left handed, +x right, +y up,
+    // looking down +z
+    float   mView[16];
+
+    // Pinhole intrinsics in pixels with the origin at the centre of the top left
+    // pixel and y down, as a calibrated camera would report them
+    float   fx, fy;
+    float   cx, cy;
+    UINT32  Width;
+    UINT32  Height;
+    float   fNear;
+    float   fFar;
+};
+
+struct RENDER_SERVER_STATS
+{
+    UINT64  NumRequests;            // Render requests
+    UINT64  NumCacheHits;
+    UINT64  NumCacheMisses;
+    UINT64  NumEvictions;
+    UINT64  NumResidentMeshes;
+    UINT64  ResidentBytes;          // Vertex and index data of the resident meshes
+    UINT64  TotalRenderNs;          // Summed over every render request
+    UINT64  TotalLoadNs;
+};
+
+struct RENDER_SERVER_RESPONSE
+{
+    UINT32  Magic;
+    UINT32  Version;
+    INT32   hr;                     // HRESULT; nothing below the timings is valid if it failed
+    UINT32  bCacheHit;
+
+    // Per-request timing, in nanoseconds
+    UINT64  QueueNs;                // Waiting for the device
+    UINT64  LoadNs;                 // Parsing and creating the mesh, 0 on a cache hit
+    UINT64  RenderNs;               // Drawing
+    UINT64  ReadbackNs;             // Copying to the staging texture and into shared memory
+    UINT64  TotalNs;                // From receiving the request to sending the response
+
+    UINT32  Format;
+    UINT32  Width;
+    UINT32  Height;
+    UINT32  BytesPerPixel;
+    UINT64  DataBytes;
+    WCHAR   strMappingName[RENDER_SERVER_MAX_MAPPING_NAME];
+
+    // Bounding sphere of the mesh, so a client can frame it after the first request
+    float   vCenter[3];
+    float   fRadius;
+
+    RENDER_SERVER_STATS Stats;
+};
+
+#endif
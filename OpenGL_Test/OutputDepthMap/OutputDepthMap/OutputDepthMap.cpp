@@ -10,10 +10,50 @@
 #include <stdlib.h>
 #include <memory.h>
 #include <math.h>
+#include <string.h>
+
+// Headless builds render .obj meshes into a float framebuffer through EGL, with
+// no window system, GLUT or GLEW.  Build them on Linux with
+//
+//   DXUT=../../../DepthFromObj_modified_withapp_ver2.0/DXUT/Optional
+//   g++ -O2 -DOUTPUTDEPTHMAP_HEADLESS -I$DXUT OutputDepthMap.cpp textfile.cpp
+//       $DXUT/DXUTObjGeometry.cpp $DXUT/DXUTArena.cpp $DXUT/DXUTMappedFile.cpp
+//       $DXUT/DXUTMemTrack.cpp $DXUT/DXUTProfiler.cpp $DXUT/DXUTTrajectory.cpp
+//       $DXUT/DXUTDepthReproject.cpp $DXUT/DXUTTiledTiff.cpp $DXUT/DXUTDepthSequence.cpp
+//       -lEGL -lGL -lpthread
+//
+// They work on Mesa's llvmpipe on machines without a GPU.  Meshes are read with
+// the same .obj code as the Direct3D sample.
+#ifdef OUTPUTDEPTHMAP_HEADLESS
+#define GL_GLEXT_PROTOTYPES
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#include <GL/gl.h>
+#include <GL/glext.h>
+#include <chrono>
+#include <algorithm>
+#else
 #include <GL/glew.h>
 #include <GL/glut.h>
+#endif
+ 
+#ifdef _WIN32
+#include <direct.h>
+#include <process.h>
+#else
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
  
 #include "textfile.h"
+#include "DXUTObjGeometry.h"
+#include "DXUTMath.h"
+#ifdef OUTPUTDEPTHMAP_HEADLESS
+#include "DXUTTrajectory.h"
+#include "DXUTDepthReproject.h"
+#include "DXUTTiledTiff.h"
+#include "DXUTDepthSequence.h"
+#endif
  
 #define M_PI       3.14159265358979323846
  
@@ -37,8 +77,11 @@ float colors2[] = { 1.0f, 0.0f, 0.0f, 1.0f,
             1.0f,0.0f, 0.0f, 1.0f};
  
 // Shader Names
-char *vertexFileName = "color.vert";
-char *fragmentFileName = "color.frag";
+const char *vertexFileName = "color.vert";
+const char *fragmentFileName = "color.frag";
+ 
+// Linked programs are kept here between runs; NULL to always compile
+const char *shaderCacheDir = "shadercache";
  
 // Program and Shader Identifiers
 GLuint p,v,f;
@@ -52,76 +95,9 @@ GLuint projMatrixLoc, viewMatrixLoc;
 // Vertex Array Objects Identifiers
 GLuint vao[3];
  
-// storage for Matrices
-float projMatrix[16];
-float viewMatrix[16];
- 
-// ----------------------------------------------------
-// VECTOR STUFF
-//
- 
-// res = a cross b;
-void crossProduct( float *a, float *b, float *res) {
- 
-    res[0] = a[1] * b[2]  -  b[1] * a[2];
-    res[1] = a[2] * b[0]  -  b[2] * a[0];
-    res[2] = a[0] * b[1]  -  b[0] * a[1];
-}
- 
-// Normalize a vec3
-void normalize(float *a) {
- 
-    float mag = sqrt(a[0] * a[0]  +  a[1] * a[1]  +  a[2] * a[2]);
- 
-    a[0] /= mag;
-    a[1] /= mag;
-    a[2] /= mag;
-}
- 
-// ----------------------------------------------------
-// MATRIX STUFF
-//
- 
-// sets the square matrix mat to the identity matrix,
-// size refers to the number of rows (or columns)
-void setIdentityMatrix( float *mat, int size) {
- 
-    // fill matrix with 0s
-    for (int i = 0; i < size * size; ++i)
-            mat[i] = 0.0f;
- 
-    // fill diagonal with 1s
-    for (int i = 0; i < size; ++i)
-        mat[i + i * size] = 1.0f;
-}
- 
-//
-// a = a * b;
-//
-void multMatrix(float *a, float *b) {
- 
-    float res[16];
- 
-    for (int i = 0; i < 4; ++i) {
-        for (int j = 0; j < 4; ++j) {
-            res[j*4 + i] = 0.0f;
-            for (int k = 0; k < 4; ++k) {
-                res[j*4 + i] += a[k*4 + i] * b[j*4 + k];
-            }
-        }
-    }
-    memcpy(a, res, 16 * sizeof(float));
- 
-}
- 
-// Defines a transformation matrix mat with a translation
-void setTranslationMatrix(float *mat, float x, float y, float z) {
- 
-    setIdentityMatrix(mat,4);
-    mat[12] = x;
-    mat[13] = y;
-    mat[14] = z;
-}
+// storage for Matrices, in the layout glUniformMatrix4fv expects
+DXUTMATRIX4 projMatrix;
+DXUTMATRIX4 viewMatrix;
  
 // ----------------------------------------------------
 // Projection Matrix
@@ -129,16 +105,7 @@ void setTranslationMatrix(float *mat, float x, float y, float z) {
  
 void buildProjectionMatrix(float fov, float ratio, float nearP, float farP) {
  
-    float f = 1.0f / tan (fov * (M_PI / 360.0));
- 
-    setIdentityMatrix(projMatrix,4);
- 
-    projMatrix[0] = f / ratio;
-    projMatrix[1 * 4 + 1] = f;
-    projMatrix[2 * 4 + 2] = (farP + nearP) / (nearP - farP);
-    projMatrix[3 * 4 + 2] = (2.0f * farP * nearP) / (nearP - farP);
-    projMatrix[2 * 4 + 3] = -1.0f;
-    projMatrix[3 * 4 + 3] = 0.0f;
+    DXUTMatrixPerspectiveFovRH(&projMatrix, fov * (float)(M_PI / 180.0), ratio, nearP, farP);
 }
  
 // ----------------------------------------------------
@@ -151,46 +118,11 @@ void buildProjectionMatrix(float fov, float ratio, float nearP, float farP) {
 void setCamera(float posX, float posY, float posZ,
                float lookAtX, float lookAtY, float lookAtZ) {
  
-    float dir[3], right[3], up[3];
- 
-    up[0] = 0.0f;   up[1] = 1.0f;   up[2] = 0.0f;
- 
-    dir[0] =  (lookAtX - posX);
-    dir[1] =  (lookAtY - posY);
-    dir[2] =  (lookAtZ - posZ);
-    normalize(dir);
- 
-    crossProduct(dir,up,right);
-    normalize(right);
- 
-    crossProduct(right,dir,up);
-    normalize(up);
- 
-    float aux[16];
- 
-    viewMatrix[0]  = right[0];
-    viewMatrix[4]  = right[1];
-    viewMatrix[8]  = right[2];
-    viewMatrix[12] = 0.0f;
- 
-    viewMatrix[1]  = up[0];
-    viewMatrix[5]  = up[1];
-    viewMatrix[9]  = up[2];
-    viewMatrix[13] = 0.0f;
- 
-    viewMatrix[2]  = -dir[0];
-    viewMatrix[6]  = -dir[1];
-    viewMatrix[10] = -dir[2];
-    viewMatrix[14] =  0.0f;
+    float eye[3] = { posX, posY, posZ };
+    float lookAt[3] = { lookAtX, lookAtY, lookAtZ };
+    float up[3] = { 0.0f, 1.0f, 0.0f };
  
-    viewMatrix[3]  = 0.0f;
-    viewMatrix[7]  = 0.0f;
-    viewMatrix[11] = 0.0f;
-    viewMatrix[15] = 1.0f;
- 
-    setTranslationMatrix(aux, -posX, -posY, -posZ);
- 
-    multMatrix(viewMatrix, aux);
+    DXUTMatrixLookAtRH(&viewMatrix, eye, lookAt, up);
 }
  
 // ----------------------------------------------------
@@ -228,10 +160,13 @@ void setupBuffers() {
     glVertexAttribPointer(vertexLoc, 4, GL_FLOAT, 0, 0, 0);
  
     // bind buffer for colors and copy data into buffer
+    // (the headless depth shader has no color input)
     glBindBuffer(GL_ARRAY_BUFFER, buffers[1]);
     glBufferData(GL_ARRAY_BUFFER, sizeof(colors1), colors1, GL_STATIC_DRAW);
-    glEnableVertexAttribArray(colorLoc);
-    glVertexAttribPointer(colorLoc, 4, GL_FLOAT, 0, 0, 0);
+    if (colorLoc != (GLuint)-1) {
+        glEnableVertexAttribArray(colorLoc);
+        glVertexAttribPointer(colorLoc, 4, GL_FLOAT, 0, 0, 0);
+    }
  
     //
     // VAO for second triangle
@@ -247,10 +182,13 @@ void setupBuffers() {
     glVertexAttribPointer(vertexLoc, 4, GL_FLOAT, 0, 0, 0);
  
     // bind buffer for colors and copy data into buffer
+    // (the headless depth shader has no color input)
     glBindBuffer(GL_ARRAY_BUFFER, buffers[1]);
     glBufferData(GL_ARRAY_BUFFER, sizeof(colors2), colors2, GL_STATIC_DRAW);
-    glEnableVertexAttribArray(colorLoc);
-    glVertexAttribPointer(colorLoc, 4, GL_FLOAT, 0, 0, 0);
+    if (colorLoc != (GLuint)-1) {
+        glEnableVertexAttribArray(colorLoc);
+        glVertexAttribPointer(colorLoc, 4, GL_FLOAT, 0, 0, 0);
+    }
  
  
  
@@ -259,10 +197,12 @@ void setupBuffers() {
 void setUniforms() {
  
     // must be called after glUseProgram
-    glUniformMatrix4fv(projMatrixLoc,  1, false, projMatrix);
-    glUniformMatrix4fv(viewMatrixLoc,  1, false, viewMatrix);
+    glUniformMatrix4fv(projMatrixLoc,  1, false, &projMatrix.m[0][0]);
+    glUniformMatrix4fv(viewMatrixLoc,  1, false, &viewMatrix.m[0][0]);
 }
  
+#ifndef OUTPUTDEPTHMAP_HEADLESS
+ 
 void renderScene(void) {
  
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
@@ -295,9 +235,11 @@ void processNormalKeys(unsigned char key, int x, int y) {
     }
 }
  
+#endif
+ 
 #define printOpenGLError() printOglError(__FILE__, __LINE__)
  
-int printOglError(char *file, int line)
+int printOglError(const char *file, int line)
 {
     //
     // Returns 1 if an OpenGL error occurred, 0 otherwise.
@@ -308,7 +250,11 @@ int printOglError(char *file, int line)
     glErr = glGetError();
     while (glErr != GL_NO_ERROR)
     {
+#ifdef OUTPUTDEPTHMAP_HEADLESS
+        printf("glError in file %s @ line %d: 0x%04x\n", file, line, glErr);
+#else
         printf("glError in file %s @ line %d: %s\n", file, line, gluErrorString(glErr));
+#endif
         retCode = 1;
         glErr = glGetError();
     }
@@ -349,42 +295,185 @@ void printProgramInfoLog(GLuint obj)
     }
 }
  
+// ----------------------------------------------------
+// PROGRAM BINARY CACHE
+//
+// Linking from source takes a while on software rasterizers, which adds
+// up over many short runs.  The linked program is saved with
+// glGetProgramBinary under a name made from a hash of the sources and of
+// the driver's vendor, renderer and version strings, and loaded back with
+// glProgramBinary.  Drivers may still reject a binary (after an update
+// that kept the version string, say); the program is then compiled from
+// source and the file replaced.
+//
+ 
+#define SHADER_CACHE_MAGIC 0x424D444F    // "ODMB"
+ 
+struct ProgramBinaryHeader {
+    unsigned int magic;
+    unsigned int format;
+    unsigned int length;
+};
+ 
+// 64 bit FNV-1a
+unsigned long long hashBytes(unsigned long long hash, const void *data, size_t size) {
+ 
+    const unsigned char *bytes = (const unsigned char *)data;
+    for (size_t i = 0; i < size; ++i) {
+        hash ^= bytes[i];
+        hash *= 0x100000001B3ull;
+    }
+    return hash;
+}
+ 
+unsigned long long hashString(unsigned long long hash, const char *s) {
+ 
+    // The terminator keeps "ab","c" apart from "a","bc"
+    return hashBytes(hash, s ? s : "", s ? strlen(s) + 1 : 1);
+}
+ 
+// Returns 0 if binaries aren't supported or there is no cache directory
+int programCacheFileName(const char *vs, const char *fs, char *fn, size_t size) {
+ 
+    GLint formats = 0;
+    glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+    while (glGetError() != GL_NO_ERROR)
+        ;
+    if (shaderCacheDir == NULL || formats <= 0)
+        return 0;
+ 
+    unsigned long long hash = 0xCBF29CE484222325ull;
+    hash = hashString(hash, vs);
+    hash = hashString(hash, fs);
+    hash = hashString(hash, (const char *)glGetString(GL_VENDOR));
+    hash = hashString(hash, (const char *)glGetString(GL_RENDERER));
+    hash = hashString(hash, (const char *)glGetString(GL_VERSION));
+    if (strlen(shaderCacheDir) + 22 > size)
+        return 0;
+    sprintf(fn, "%s/%016llx.bin", shaderCacheDir, hash);
+    return 1;
+}
+ 
+// Returns 1 if p was linked from the cached binary
+int loadProgramBinary(GLuint p, const char *fn) {
+ 
+    FILE *fp = fopen(fn, "rb");
+    if (fp == NULL)
+        return 0;
+ 
+    ProgramBinaryHeader header;
+    void *binary = NULL;
+    int ok = fread(&header, sizeof(header), 1, fp) == 1 && header.magic == SHADER_CACHE_MAGIC &&
+             header.length > 0 && (binary = malloc(header.length)) != NULL &&
+             fread(binary, 1, header.length, fp) == header.length;
+    fclose(fp);
+ 
+    GLint linked = 0;
+    if (ok) {
+        glProgramBinary(p, header.format, binary, header.length);
+        glGetProgramiv(p, GL_LINK_STATUS, &linked);
+        while (glGetError() != GL_NO_ERROR)
+            ;
+    }
+    free(binary);
+    return linked;
+}
+ 
+// Written to a temporary file first so concurrent runs never see half a file
+void saveProgramBinary(GLuint p, const char *fn) {
+ 
+    GLint length = 0;
+    glGetProgramiv(p, GL_PROGRAM_BINARY_LENGTH, &length);
+    if (length <= 0)
+        return;
+ 
+    ProgramBinaryHeader header;
+    void *binary = malloc(length);
+    GLenum format = 0;
+    glGetProgramBinary(p, length, &length, &format, binary);
+    header.magic = SHADER_CACHE_MAGIC;
+    header.format = format;
+    header.length = length;
+ 
+#ifdef _WIN32
+    _mkdir(shaderCacheDir);
+    int pid = _getpid();
+#else
+    mkdir(shaderCacheDir, 0755);
+    int pid = getpid();
+#endif
+    char tmp[1024];
+    sprintf(tmp, "%.1000s.%d.tmp", fn, pid);
+    FILE *fp = fopen(tmp, "wb");
+    if (fp != NULL) {
+        int ok = fwrite(&header, sizeof(header), 1, fp) == 1 && fwrite(binary, 1, length, fp) == (size_t)length;
+        if (fclose(fp) == 0 && ok) {
+            // rename won't replace an existing file on Windows
+            remove(fn);
+            ok = rename(tmp, fn) == 0;
+        }
+        if (!ok)
+            remove(tmp);
+    }
+    free(binary);
+}
+ 
 GLuint setupShaders() {
  
-    char *vs = NULL,*fs = NULL,*fs2 = NULL;
+    char *vs = NULL,*fs = NULL;
  
     GLuint p,v,f;
  
-    v = glCreateShader(GL_VERTEX_SHADER);
-    f = glCreateShader(GL_FRAGMENT_SHADER);
- 
     vs = textFileRead(vertexFileName);
     fs = textFileRead(fragmentFileName);
  
-    const char * vv = vs;
-    const char * ff = fs;
+    char cacheFileName[1024];
+    int cached = programCacheFileName(vs, fs, cacheFileName, sizeof(cacheFileName));
  
-    glShaderSource(v, 1, &vv,NULL);
-    glShaderSource(f, 1, &ff,NULL);
+    p = glCreateProgram();
+    if (cached && loadProgramBinary(p, cacheFileName)) {
+        printf("Program loaded from %s\n", cacheFileName);
+    }
+    else {
+        v = glCreateShader(GL_VERTEX_SHADER);
+        f = glCreateShader(GL_FRAGMENT_SHADER);
  
-    free(vs);free(fs);
+        const char * vv = vs;
+        const char * ff = fs;
  
-    glCompileShader(v);
-    glCompileShader(f);
+        glShaderSource(v, 1, &vv,NULL);
+        glShaderSource(f, 1, &ff,NULL);
  
-    printShaderInfoLog(v);
-    printShaderInfoLog(f);
+        glCompileShader(v);
+        glCompileShader(f);
  
-    p = glCreateProgram();
-    glAttachShader(p,v);
-    glAttachShader(p,f);
+        printShaderInfoLog(v);
+        printShaderInfoLog(f);
+ 
+        glAttachShader(p,v);
+        glAttachShader(p,f);
  
-    glBindFragDataLocation(p, 0, "outputF");
-    glLinkProgram(p);
-    printProgramInfoLog(p);
+        glBindFragDataLocation(p, 0, "outputF");
+        if (cached)
+            glProgramParameteri(p, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+        glLinkProgram(p);
+        printProgramInfoLog(p);
+ 
+        GLint linked = 0;
+        glGetProgramiv(p, GL_LINK_STATUS, &linked);
+        if (cached && linked)
+            saveProgramBinary(p, cacheFileName);
+ 
+        // The program keeps what it needs
+        glDetachShader(p,v);
+        glDetachShader(p,f);
+        glDeleteShader(v);
+        glDeleteShader(f);
+    }
+    free(vs);free(fs);
  
     vertexLoc = glGetAttribLocation(p,"position");
-    colorLoc = glGetAttribLocation(p, "color"); 
+    colorLoc = glGetAttribLocation(p, "color");
  
     projMatrixLoc = glGetUniformLocation(p, "projMatrix");
     viewMatrixLoc = glGetUniformLocation(p, "viewMatrix");
@@ -392,6 +481,1080 @@ GLuint setupShaders() {
     return(p);
 }
  
+#ifdef OUTPUTDEPTHMAP_HEADLESS
+ 
+// ----------------------------------------------------
+// HEADLESS RENDERING
+//
+// Each frame is drawn into a float framebuffer holding view space
+// depth, 0 where nothing was drawn, and read back through a ring of
+// pixel buffer objects.  glReadPixels into a PBO only queues the copy;
+// the PBO is mapped ring size - 1 frames later, so the CPU writes out
+// frame N while the frames after it are being drawn.
+//
+ 
+#define MAX_PIXEL_BUFFERS 8
+ 
+EGLDisplay eglDisplay = EGL_NO_DISPLAY;
+EGLContext eglContext = EGL_NO_CONTEXT;
+EGLSurface eglSurface = EGL_NO_SURFACE;
+ 
+// Framebuffer Identifiers
+GLuint fbo, depthTexture, depthRenderbuffer;
+ 
+// Readback ring
+GLuint pixelBuffers[MAX_PIXEL_BUFFERS];
+GLsync pixelFences[MAX_PIXEL_BUFFERS];
+ 
+// Mesh Identifiers
+GLuint meshVao, meshBuffers[2], indirectBuffer;
+ 
+// Subsets are drawn from the one vertex and index buffer, either with a
+// single glMultiDrawElementsIndirect or with one glDrawElements each, the
+// way DrawSubset does it in the Direct3D sample
+#define DRAW_INDIRECT 0
+#define DRAW_SUBSETS  1
+ 
+// Layout fixed by GL_DRAW_INDIRECT_BUFFER
+struct DrawElementsIndirectCommand {
+    GLuint count;
+    GLuint instanceCount;
+    GLuint firstIndex;
+    GLuint baseVertex;
+    GLuint baseInstance;
+};
+ 
+DrawElementsIndirectCommand *subsetCommands;    // One per non-empty subset
+float *subsetSpheres;                           // Center and radius of each
+DrawElementsIndirectCommand *drawCommands;      // This frame's, after culling
+int subsetCount;
+int drawMode = DRAW_INDIRECT;
+int cullSubsets = 0;
+int indirectCulled = 0;                         // indirectBuffer holds culled commands
+ 
+// The camera being drawn with, as it is stored in -pack sequences
+DXUT_CAMERA_KEY cameraKey;
+ 
+int initHeadlessContext() {
+ 
+    // The surfaceless platform needs neither a window system nor a GPU
+    PFNEGLGETPLATFORMDISPLAYEXTPROC getPlatformDisplay =
+        (PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT");
+    if (getPlatformDisplay)
+        eglDisplay = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, NULL);
+    if (eglDisplay == EGL_NO_DISPLAY)
+        eglDisplay = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+ 
+    EGLint major, minor;
+    if (eglDisplay == EGL_NO_DISPLAY || !eglInitialize(eglDisplay, &major, &minor)) {
+        printf("Could not initialize EGL\n");
+        return 0;
+    }
+    if (!eglBindAPI(EGL_OPENGL_API)) {
+        printf("EGL does not support desktop OpenGL\n");
+        return 0;
+    }
+ 
+    const EGLint configAttribs[] = {
+        EGL_SURFACE_TYPE, EGL_PBUFFER_BIT,
+        EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+        EGL_NONE };
+    EGLConfig config;
+    EGLint numConfigs = 0;
+    if (!eglChooseConfig(eglDisplay, configAttribs, &config, 1, &numConfigs) || numConfigs < 1) {
+        printf("No EGL config for desktop OpenGL\n");
+        return 0;
+    }
+ 
+    const EGLint contextAttribs[] = {
+        EGL_CONTEXT_MAJOR_VERSION, 3,
+        EGL_CONTEXT_MINOR_VERSION, 3,
+        EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+        EGL_NONE };
+    eglContext = eglCreateContext(eglDisplay, config, EGL_NO_CONTEXT, contextAttribs);
+    if (eglContext == EGL_NO_CONTEXT) {
+        printf("OpenGL 3.3 not supported\n");
+        return 0;
+    }
+ 
+    // Everything is drawn into our own framebuffer, so no surface is
+    // needed where surfaceless contexts are supported
+    const char *extensions = eglQueryString(eglDisplay, EGL_EXTENSIONS);
+    if (extensions == NULL || strstr(extensions, "EGL_KHR_surfaceless_context") == NULL) {
+        const EGLint pbufferAttribs[] = { EGL_WIDTH, 1, EGL_HEIGHT, 1, EGL_NONE };
+        eglSurface = eglCreatePbufferSurface(eglDisplay, config, pbufferAttribs);
+    }
+    if (!eglMakeCurrent(eglDisplay, eglSurface, eglSurface, eglContext)) {
+        printf("Could not make the EGL context current\n");
+        return 0;
+    }
+ 
+    printf("%s, %s\n", glGetString(GL_VERSION), glGetString(GL_RENDERER));
+    return 1;
+}
+ 
+void releaseHeadlessContext() {
+ 
+    if (eglDisplay == EGL_NO_DISPLAY)
+        return;
+    eglMakeCurrent(eglDisplay, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+    if (eglSurface != EGL_NO_SURFACE)
+        eglDestroySurface(eglDisplay, eglSurface);
+    if (eglContext != EGL_NO_CONTEXT)
+        eglDestroyContext(eglDisplay, eglContext);
+    eglTerminate(eglDisplay);
+}
+ 
+int setupDepthTarget(int w, int h) {
+ 
+    // Linear depth goes to a float color target; the depth buffer
+    // itself is only for the depth test, and the stencil marks the parts
+    // of reprojected frames that are drawn
+    glGenTextures(1, &depthTexture);
+    glBindTexture(GL_TEXTURE_2D, depthTexture);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_R32F, w, h, 0, GL_RED, GL_FLOAT, NULL);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+ 
+    glGenRenderbuffers(1, &depthRenderbuffer);
+    glBindRenderbuffer(GL_RENDERBUFFER, depthRenderbuffer);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH32F_STENCIL8, w, h);
+ 
+    glGenFramebuffers(1, &fbo);
+    glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, depthTexture, 0);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, depthRenderbuffer);
+ 
+    glViewport(0, 0, w, h);
+    return glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE;
+}
+ 
+void setupPixelBuffers(int count, int bytes) {
+ 
+    glGenBuffers(count, pixelBuffers);
+    for (int i = 0; i < count; ++i) {
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, pixelBuffers[i]);
+        glBufferData(GL_PIXEL_PACK_BUFFER, bytes, NULL, GL_STREAM_READ);
+        pixelFences[i] = 0;
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+}
+ 
+// Bounding sphere of the vertices used by count indices, around the
+// centre of their bounding box
+void subsetSphere(const DXUTOBJ_VERTEX *v, const unsigned int *indices, int count, float *sphere) {
+ 
+    float minCorner[3], maxCorner[3];
+    for (int k = 0; k < 3; ++k)
+        minCorner[k] = maxCorner[k] = v[indices[0]].Position[k];
+    for (int i = 1; i < count; ++i) {
+        for (int k = 0; k < 3; ++k) {
+            minCorner[k] = fminf(minCorner[k], v[indices[i]].Position[k]);
+            maxCorner[k] = fmaxf(maxCorner[k], v[indices[i]].Position[k]);
+        }
+    }
+    float r2 = 0.0f;
+    for (int k = 0; k < 3; ++k)
+        sphere[k] = 0.5f * (minCorner[k] + maxCorner[k]);
+    for (int i = 0; i < count; ++i) {
+        float d[3];
+        for (int k = 0; k < 3; ++k)
+            d[k] = v[indices[i]].Position[k] - sphere[k];
+        r2 = fmaxf(r2, d[0] * d[0] + d[1] * d[1] + d[2] * d[2]);
+    }
+    sphere[3] = sqrtf(r2);
+}
+ 
+// Uploads the welded vertices as they are; only the positions are used.
+// Triangles are sorted by subset so each subset is one range of the index
+// buffer and gets one indirect draw command.
+void setupMesh(const CDXUTObjGeometry *mesh) {
+ 
+    unsigned int triangleCount = mesh->GetNumIndices() / 3;
+    unsigned int materialCount = mesh->GetNumMaterials();
+    const unsigned int *indices = mesh->GetIndices();
+    const unsigned int *attributes = mesh->GetAttributes();
+ 
+    // Counting sort, stable so the file order is kept within a subset
+    unsigned int *first = (unsigned int *)calloc(materialCount + 1, sizeof(unsigned int));
+    unsigned int *sorted = (unsigned int *)malloc(mesh->GetNumIndices() * sizeof(unsigned int));
+    for (unsigned int t = 0; t < triangleCount; ++t)
+        first[attributes[t] + 1] += 3;
+    for (unsigned int m = 0; m < materialCount; ++m)
+        first[m + 1] += first[m];
+    for (unsigned int t = 0; t < triangleCount; ++t) {
+        unsigned int *dest = sorted + first[attributes[t]];
+        first[attributes[t]] += 3;
+        memcpy(dest, indices + 3 * t, 3 * sizeof(unsigned int));
+    }
+ 
+    // first[m] is now the end of subset m
+    subsetCommands = (DrawElementsIndirectCommand *)malloc(materialCount * sizeof(DrawElementsIndirectCommand));
+    drawCommands = (DrawElementsIndirectCommand *)malloc(materialCount * sizeof(DrawElementsIndirectCommand));
+    subsetSpheres = (float *)malloc(materialCount * 4 * sizeof(float));
+    subsetCount = 0;
+    for (unsigned int m = 0, start = 0; m < materialCount; start = first[m++]) {
+        if (first[m] == start)
+            continue;
+        DrawElementsIndirectCommand *cmd = &subsetCommands[subsetCount];
+        cmd->count = first[m] - start;
+        cmd->instanceCount = 1;
+        cmd->firstIndex = start;
+        cmd->baseVertex = 0;
+        cmd->baseInstance = 0;
+        subsetSphere(mesh->GetVertices(), sorted + start, cmd->count, &subsetSpheres[4 * subsetCount]);
+        ++subsetCount;
+    }
+ 
+    glGenVertexArrays(1, &meshVao);
+    glBindVertexArray(meshVao);
+    glGenBuffers(2, meshBuffers);
+ 
+    glBindBuffer(GL_ARRAY_BUFFER, meshBuffers[0]);
+    glBufferData(GL_ARRAY_BUFFER, mesh->GetNumVertices() * sizeof(DXUTOBJ_VERTEX), mesh->GetVertices(), GL_STATIC_DRAW);
+    glEnableVertexAttribArray(vertexLoc);
+    glVertexAttribPointer(vertexLoc, 3, GL_FLOAT, 0, sizeof(DXUTOBJ_VERTEX), 0);
+ 
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, meshBuffers[1]);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, mesh->GetNumIndices() * sizeof(unsigned int), sorted, GL_STATIC_DRAW);
+ 
+    // Without -cull the commands only change for parts of frames
+    glGenBuffers(1, &indirectBuffer);
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, indirectBuffer);
+    glBufferData(GL_DRAW_INDIRECT_BUFFER, subsetCount * sizeof(DrawElementsIndirectCommand), subsetCommands,
+                 cullSubsets ? GL_STREAM_DRAW : GL_STATIC_DRAW);
+ 
+    free(sorted);
+    free(first);
+}
+ 
+void releaseMesh() {
+ 
+    glDeleteBuffers(1, &indirectBuffer);
+    glDeleteBuffers(2, meshBuffers);
+    glDeleteVertexArrays(1, &meshVao);
+    free(subsetCommands);
+    free(drawCommands);
+    free(subsetSpheres);
+}
+ 
+// Copies the commands of the subsets whose bounding sphere touches the
+// frustum of viewProj to drawCommands and returns how many there are.  The
+// planes come straight from the rows of the OpenGL projMatrix * viewMatrix.
+int cullSubsetCommands(const DXUTMATRIX4 *viewProj) {
+ 
+    const float *m = &viewProj->m[0][0];
+    float planes[6][4];
+    for (int i = 0; i < 3; ++i) {
+        for (int j = 0; j < 4; ++j) {
+            planes[2 * i][j] = m[j * 4 + 3] + m[j * 4 + i];
+            planes[2 * i + 1][j] = m[j * 4 + 3] - m[j * 4 + i];
+        }
+    }
+    for (int i = 0; i < 6; ++i) {
+        float len = sqrtf(planes[i][0] * planes[i][0] + planes[i][1] * planes[i][1] + planes[i][2] * planes[i][2]);
+        for (int j = 0; j < 4; ++j)
+            planes[i][j] /= len;
+    }
+ 
+    int drawCount = 0;
+    for (int s = 0; s < subsetCount; ++s) {
+        const float *sphere = &subsetSpheres[4 * s];
+        int visible = 1;
+        for (int i = 0; visible && i < 6; ++i)
+            visible = planes[i][0] * sphere[0] + planes[i][1] * sphere[1] + planes[i][2] * sphere[2] +
+                      planes[i][3] >= -sphere[3];
+        if (visible)
+            drawCommands[drawCount++] = subsetCommands[s];
+    }
+    return drawCount;
+}
+ 
+// Returns the number of subsets drawn.  With cull, or with -cull, subsets
+// are culled against viewProj, which is the camera's or, when drawing part
+// of the frame, that of the part.
+int drawMesh(const DXUTMATRIX4 *viewProj, int cull) {
+ 
+    const DrawElementsIndirectCommand *commands = subsetCommands;
+    int drawCount = subsetCount;
+    cull = cull || cullSubsets;
+    if (cull) {
+        commands = drawCommands;
+        drawCount = cullSubsetCommands(viewProj);
+    }
+ 
+    glBindVertexArray(meshVao);
+    if (drawMode == DRAW_INDIRECT) {
+        glBindBuffer(GL_DRAW_INDIRECT_BUFFER, indirectBuffer);
+        // Orphaned so frames still in flight keep their commands.  After a
+        // culled draw the full list has to go back in.
+        if (cull || indirectCulled) {
+            glBufferData(GL_DRAW_INDIRECT_BUFFER, subsetCount * sizeof(DrawElementsIndirectCommand), NULL, GL_STREAM_DRAW);
+            glBufferSubData(GL_DRAW_INDIRECT_BUFFER, 0, drawCount * sizeof(DrawElementsIndirectCommand), commands);
+        }
+        indirectCulled = cull;
+        glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, 0, drawCount, 0);
+    }
+    else {
+        for (int i = 0; i < drawCount; ++i)
+            glDrawElements(GL_TRIANGLES, commands[i].count, GL_UNSIGNED_INT,
+                           (const void *)(commands[i].firstIndex * sizeof(GLuint)));
+    }
+    return drawCount;
+}
+ 
+// Axis aligned bounds of the vertices
+void meshBounds(const CDXUTObjGeometry *mesh, float *minCorner, float *maxCorner) {
+ 
+    const DXUTOBJ_VERTEX *v = mesh->GetVertices();
+    for (int k = 0; k < 3; ++k) {
+        minCorner[k] = mesh->GetNumVertices() ? v[0].Position[k] : 0.0f;
+        maxCorner[k] = minCorner[k];
+    }
+    for (unsigned int i = 1; i < mesh->GetNumVertices(); ++i) {
+        for (int k = 0; k < 3; ++k) {
+            minCorner[k] = fminf(minCorner[k], v[i].Position[k]);
+            maxCorner[k] = fmaxf(maxCorner[k], v[i].Position[k]);
+        }
+    }
+}
+ 
+// setCamera and buildProjectionMatrix as a camera key, with no model
+// transform
+void setCameraKey(const float *eye, const float *lookAt, float fov, float ratio, float nearP, float farP) {
+ 
+    memset(&cameraKey, 0, sizeof(cameraKey));
+    memcpy(cameraKey.vEye, eye, sizeof(cameraKey.vEye));
+    memcpy(cameraKey.vAt, lookAt, sizeof(cameraKey.vAt));
+    cameraKey.vUp[1] = 1.0f;
+    cameraKey.qWorld[3] = 1.0f;
+    cameraKey.fFovY = fov * (float)(M_PI / 180.0);
+    cameraKey.fAspect = ratio;
+    cameraKey.fNear = nearP;
+    cameraKey.fFar = farP;
+}
+ 
+// Orbits the bounding sphere at 2.5 radii, slightly above it
+void setOrbitCamera(int frame, int frameCount, float ratio, const float *center, float radius) {
+ 
+    float angle = 2.0f * (float)M_PI * frame / frameCount;
+    float eye[3] = { center[0] + 2.5f * radius * sinf(angle),
+                     center[1] + 0.5f * radius,
+                     center[2] + 2.5f * radius * cosf(angle) };
+    setCamera(eye[0], eye[1], eye[2], center[0], center[1], center[2]);
+    buildProjectionMatrix(45.0f, ratio, 1.0f * radius, 4.0f * radius);
+    setCameraKey(eye, center, 45.0f, ratio, 1.0f * radius, 4.0f * radius);
+}
+ 
+// The windowed demo's scene and camera
+void setDemoCamera(float ratio) {
+ 
+    float eye[3] = { 0.0f, 0.0f, 0.0f }, lookAt[3] = { 0.0f, 0.0f, -1.0f };
+    setCamera(0,0,0,0,0,-1);
+    buildProjectionMatrix(92.34f, ratio, 1.0f, 30.0f);
+    setCameraKey(eye, lookAt, 92.34f, ratio, 1.0f, 30.0f);
+}
+ 
+// Portable float map; rows bottom to top, the same order glReadPixels uses
+int writeDepthFile(const char *fn, const float *depth, int w, int h) {
+ 
+    FILE *fp = fopen(fn, "wb");
+    if (fp == NULL)
+        return 0;
+    int ok = fprintf(fp, "Pf\n%d %d\n-1.0\n", w, h) > 0 &&
+             fwrite(depth, sizeof(float), (size_t)w * h, fp) == (size_t)w * h;
+    return (fclose(fp) == 0) && ok;
+}
+ 
+double elapsedMs(std::chrono::steady_clock::time_point start) {
+ 
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+ 
+// Camera and projection of a trajectory pose.  The depth shader has no
+// world matrix, so the pose's model transform goes into the view matrix.
+// A ratio of 0 keeps the pose's own.
+void setTrajectoryCamera(const CDXUTTrajectory *trajectory, int frame, double frameRate, float ratio) {
+ 
+    DXUT_CAMERA_KEY pose;
+    DXUTMATRIX4 world, view;
+    trajectory->EvaluateFrame(frame, frameRate, &pose);
+    if (ratio > 0.0f)
+        pose.fAspect = ratio;
+    DXUTGetCameraKeyMatrices(&pose, &world, &view, &projMatrix);
+    cameraKey = pose;
+    DXUTMatrixMultiply(&viewMatrix, &world, &view);
+}
+ 
+// Draws the mesh, or the windowed demo's two triangles when there is no
+// mesh, and returns the number of subsets drawn.  Parts of frames pass
+// cull, since only a few of the subsets reach them.
+int drawScene(int haveMesh, const DXUTMATRIX4 *viewProj, int cull) {
+ 
+    if (haveMesh)
+        return drawMesh(viewProj, cull);
+    glBindVertexArray(vao[0]);
+    glDrawArrays(GL_TRIANGLES, 0, 3);
+    glBindVertexArray(vao[1]);
+    glDrawArrays(GL_TRIANGLES, 0, 3);
+    return 0;
+}
+ 
+// ----------------------------------------------------
+// REPROJECTION
+//
+// Along a dense camera path most of each frame is already in the ones
+// before it.  With -reproject every -refresh frames is drawn in full and
+// kept as the key frame.  The frames in between are warped on the CPU
+// (CDXUTDepthReprojector) from the key frame and from the tiles drawn
+// since, uploaded to the depth texture, and only the tiles the warp left
+// holes in are cleared and drawn again.  Each rect of them is drawn with
+// its subsets culled to it, unless that adds up to more subset draws than
+// drawing the mesh once, culled to the rects' bounding box and stenciled
+// to the rects, so a frame never submits more than a full one.  Those
+// tiles are read back for the frames after.  Warping only from drawn
+// pixels, never from warped ones, keeps the error to that of one warp:
+// depth edges out by at most half a pixel.
+//
+ 
+// Tiles drawn since the key frame
+struct DrawnRect {
+    DXUT_REPROJECT_RECT rect;
+    DXUTMATRIX4 viewProj;
+    size_t offset;              // Of its pixels in drawnDepth
+};
+std::vector<DrawnRect> drawnRects;
+std::vector<float> drawnDepth;
+ 
+// Draws the current frame over the warped key frame and returns the
+// number of subset draws; tiles and rects are what was drawn
+int drawReprojected(CDXUTDepthReprojector *reprojector, const float *keyDepth,
+                    const DXUTMATRIX4 *keyViewProj, const DXUTMATRIX4 *viewProj, int haveMesh,
+                    int *tiles, int *rects) {
+ 
+    std::vector<DXUT_REPROJECT_RECT> dirtyRects;
+    int w = reprojector->GetWidth(), h = reprojector->GetHeight();
+ 
+    reprojector->Begin(viewProj);
+    reprojector->AddSource(keyDepth, w, NULL, keyViewProj);
+    for (size_t i = 0; i < drawnRects.size(); ++i) {
+        const DrawnRect *drawn = &drawnRects[i];
+        reprojector->AddSource(&drawnDepth[drawn->offset], drawn->rect.Width, &drawn->rect, &drawn->viewProj);
+    }
+    *tiles = reprojector->End();
+    reprojector->GetDirtyRects(dirtyRects);
+    *rects = (int)dirtyRects.size();
+ 
+    glBindTexture(GL_TEXTURE_2D, depthTexture);
+    glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, w, h, GL_RED, GL_FLOAT, reprojector->GetDepth());
+ 
+    if (dirtyRects.empty())
+        return 0;
+ 
+    // Subsets reach few rects when they are small on screen, but large
+    // ones reach most of them
+    std::vector<DXUTMATRIX4> rectViewProjs(dirtyRects.size());
+    DXUT_REPROJECT_RECT bounds = dirtyRects[0];
+    int rectDraws = 0;
+    for (size_t i = 0; i < dirtyRects.size(); ++i) {
+        const DXUT_REPROJECT_RECT *rect = &dirtyRects[i];
+        unsigned int right = std::max(bounds.x + bounds.Width, rect->x + rect->Width);
+        unsigned int top = std::max(bounds.y + bounds.Height, rect->y + rect->Height);
+        bounds.x = std::min(bounds.x, rect->x);
+        bounds.y = std::min(bounds.y, rect->y);
+        bounds.Width = right - bounds.x;
+        bounds.Height = top - bounds.y;
+        DXUTGetRectViewProj(&rectViewProjs[i], viewProj, rect, w, h);
+        rectDraws += cullSubsetCommands(&rectViewProjs[i]);
+    }
+    DXUTMATRIX4 boundsViewProj;
+    DXUTGetRectViewProj(&boundsViewProj, viewProj, &bounds, w, h);
+    int drawOnce = rectDraws > cullSubsetCommands(&boundsViewProj);
+ 
+    // Clearing the rects sets their stencil to 1; everything else is 0
+    int drawn = 0;
+    if (drawOnce) {
+        glClearStencil(0);
+        glClear(GL_STENCIL_BUFFER_BIT);
+        glClearStencil(1);
+    }
+    glEnable(GL_SCISSOR_TEST);
+    for (size_t i = 0; i < dirtyRects.size(); ++i) {
+        const DXUT_REPROJECT_RECT *rect = &dirtyRects[i];
+        glScissor(rect->x, rect->y, rect->Width, rect->Height);
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | (drawOnce ? GL_STENCIL_BUFFER_BIT : 0));
+        if (!drawOnce)
+            drawn += drawScene(haveMesh, &rectViewProjs[i], 1);
+    }
+    if (drawOnce) {
+        glScissor(bounds.x, bounds.y, bounds.Width, bounds.Height);
+        glEnable(GL_STENCIL_TEST);
+        glStencilFunc(GL_EQUAL, 1, 0xFF);
+        drawn = drawScene(haveMesh, &boundsViewProj, 1);
+        glDisable(GL_STENCIL_TEST);
+    }
+    glDisable(GL_SCISSOR_TEST);
+ 
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    for (size_t i = 0; i < dirtyRects.size(); ++i) {
+        DrawnRect rect;
+        rect.rect = dirtyRects[i];
+        rect.viewProj = *viewProj;
+        rect.offset = drawnDepth.size();
+        drawnDepth.resize(rect.offset + (size_t)rect.rect.Width * rect.rect.Height);
+        glReadPixels(rect.rect.x, rect.rect.y, rect.rect.Width, rect.rect.Height, GL_RED, GL_FLOAT,
+                     &drawnDepth[rect.offset]);
+        drawnRects.push_back(rect);
+    }
+    return drawn;
+}
+ 
+// Counts the pixels covered in only one of depth and reference, and those
+// covered in both whose depths differ by more than tolerance, relative.
+// edgeErrors is how many of them are next to a depth edge of the reference,
+// where a warp can be half a pixel out, and maxError the largest relative
+// difference where both are covered.
+int countDepthErrors(const float *depth, const float *reference, int w, int h, float tolerance,
+                     int *edgeErrors, float *maxError) {
+ 
+    int errors = 0;
+    *edgeErrors = 0;
+    *maxError = 0.0f;
+    for (int y = 0; y < h; ++y) {
+        for (int x = 0; x < w; ++x) {
+            int i = y * w + x;
+            if (reference[i] > 0.0f && depth[i] > 0.0f) {
+                float error = fabsf(depth[i] - reference[i]) / reference[i];
+                *maxError = fmaxf(*maxError, error);
+                if (error <= tolerance)
+                    continue;
+            }
+            else if ((depth[i] > 0.0f) == (reference[i] > 0.0f))
+                continue;
+            ++errors;
+ 
+            int edge = 0;
+            for (int dy = -1; dy <= 1; ++dy) {
+                for (int dx = -1; dx <= 1; ++dx) {
+                    if (x + dx < 0 || x + dx >= w || y + dy < 0 || y + dy >= h)
+                        continue;
+                    float r = reference[i + dy * w + dx];
+                    if ((r > 0.0f) != (reference[i] > 0.0f) || fabsf(r - reference[i]) > tolerance * reference[i])
+                        edge = 1;
+                }
+            }
+            *edgeErrors += edge;
+        }
+    }
+    return errors;
+}
+ 
+// ----------------------------------------------------
+// TILED RENDERING
+//
+// Images too big for a framebuffer, or for memory, are drawn one tile at
+// a time with -image.  The framebuffer is the size of a tile, and each
+// tile's projection is the camera's followed by the crop that stretches
+// the tile to the whole of clip space, so the pixels are the ones the
+// full image would have and the subsets are culled to the tile.  Tiles
+// go through the readback ring like frames do: a tile is written to the
+// tiled TIFF while the ones after it are drawn, and only the ring and the
+// tile offsets stay in memory.
+//
+ 
+// Draws the image tile by tile, top row first, with the current camera.
+// Returns 0 if the file could not be written.
+int renderTiledImage(const char *fn, int imageWidth, int imageHeight, int tileWidth, int tileHeight,
+                     int ringSize, int haveMesh) {
+ 
+    CDXUTTiledTiffWriter writer;
+    if (!writer.Create(fn, imageWidth, imageHeight, tileWidth, tileHeight)) {
+        printf("Could not create %s\n", fn);
+        return 0;
+    }
+    int tilesX = writer.GetNumTilesX(), tilesY = writer.GetNumTilesY();
+    int tileCount = tilesX * tilesY;
+    int tileBytes = tileWidth * tileHeight * sizeof(float);
+    if (ringSize > tileCount)
+        ringSize = tileCount;
+    printf("%dx%d image in %d tiles of %dx%d\n", imageWidth, imageHeight, tileCount, tileWidth, tileHeight);
+ 
+    DXUTMATRIX4 cameraProj = projMatrix, crop, viewProj;
+    double waitMs = 0.0, writeMs = 0.0;
+    long long subsetsDrawn = 0;
+    int ok = 1;
+ 
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+ 
+    // Tile i is drawn on iteration i and written on iteration
+    // i + ringSize - 1
+    for (int tile = 0; ok && tile < tileCount + ringSize - 1; ++tile) {
+ 
+        if (tile < tileCount) {
+            // The tile's corners in the image, bottom left origin; the
+            // bottom row of tiles reaches below the image
+            int x = (tile % tilesX) * tileWidth;
+            int y = imageHeight - (tile / tilesX + 1) * tileHeight;
+            DXUTMatrixProjectionCrop(&crop,
+                                     2.0f * x / imageWidth - 1.0f, 2.0f * y / imageHeight - 1.0f,
+                                     2.0f * (x + tileWidth) / imageWidth - 1.0f,
+                                     2.0f * (y + tileHeight) / imageHeight - 1.0f);
+            DXUTMatrixMultiply(&projMatrix, &cameraProj, &crop);
+            setUniforms();
+            DXUTMatrixMultiply(&viewProj, &viewMatrix, &projMatrix);
+ 
+            int slot = tile % ringSize;
+            glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+            subsetsDrawn += drawScene(haveMesh, &viewProj, 1);
+            glBindBuffer(GL_PIXEL_PACK_BUFFER, pixelBuffers[slot]);
+            glReadPixels(0, 0, tileWidth, tileHeight, GL_RED, GL_FLOAT, 0);
+            pixelFences[slot] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+            glFlush();
+        }
+ 
+        int done = tile - (ringSize - 1);
+        if (done < 0)
+            continue;
+ 
+        int slot = done % ringSize;
+        std::chrono::steady_clock::time_point waitStart = std::chrono::steady_clock::now();
+        while (glClientWaitSync(pixelFences[slot], GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000) == GL_TIMEOUT_EXPIRED)
+            ;
+        glDeleteSync(pixelFences[slot]);
+        pixelFences[slot] = 0;
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, pixelBuffers[slot]);
+        const float *depth = (const float *)glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, tileBytes, GL_MAP_READ_BIT);
+        waitMs += elapsedMs(waitStart);
+        if (depth == NULL) {
+            printf("Could not map the readback buffer\n");
+            ok = 0;
+            break;
+        }
+ 
+        std::chrono::steady_clock::time_point writeStart = std::chrono::steady_clock::now();
+        if (!writer.WriteTile(done % tilesX, done / tilesX, depth, tileWidth, true)) {
+            printf("Could not write %s\n", fn);
+            ok = 0;
+        }
+        writeMs += elapsedMs(writeStart);
+        glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    projMatrix = cameraProj;
+ 
+    if (ok && !writer.Close()) {
+        printf("Could not write %s\n", fn);
+        ok = 0;
+    }
+    if (!ok)
+        return 0;
+ 
+    double totalMs = elapsedMs(start);
+    printf("%d tiles in %.1f ms (%.2f ms per tile, %.1f ms waiting on readback, %.1f ms writing, %d PBOs)\n",
+           tileCount, totalMs, totalMs / tileCount, waitMs, writeMs, ringSize);
+    if (haveMesh)
+        printf("%.1f of %d subsets drawn per tile\n", (double)subsetsDrawn / tileCount, subsetCount);
+    printf("Wrote %s\n", fn);
+    return 1;
+}
+ 
+// Everything runHeadless set up, and the context
+void releaseScene(int haveMesh, int ringSize) {
+ 
+    glDeleteBuffers(ringSize, pixelBuffers);
+    glDeleteFramebuffers(1, &fbo);
+    glDeleteRenderbuffers(1, &depthRenderbuffer);
+    glDeleteTextures(1, &depthTexture);
+    if (haveMesh)
+        releaseMesh();
+    else
+        glDeleteVertexArrays(3, vao);
+    glDeleteProgram(p);
+    releaseHeadlessContext();
+}
+ 
+int runHeadless(int argc, char **argv) {
+ 
+    int w = 640, h = 480;
+    int frameCount = 0, ringSize = 3;
+    const char *meshFileName = NULL;
+    const char *outputPrefix = NULL;
+    const char *trajectoryFileName = NULL;
+    double frameRate = 30.0;
+    float tolerance = 0.0f;
+    int reproject = 0, refreshInterval = 10, tileSize = 32, verify = 0;
+    int imageWidth = 0, imageHeight = 0, pack = 0;
+ 
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "-size") == 0 && i + 1 < argc) {
+            if (sscanf(argv[++i], "%dx%d", &w, &h) == 1)
+                h = w;
+        }
+        else if (strcmp(argv[i], "-frames") == 0 && i + 1 < argc)
+            frameCount = atoi(argv[++i]);
+        else if (strcmp(argv[i], "-pbos") == 0 && i + 1 < argc)
+            ringSize = atoi(argv[++i]);
+        else if (strcmp(argv[i], "-out") == 0 && i + 1 < argc)
+            outputPrefix = argv[++i];
+        else if (strcmp(argv[i], "-draw") == 0 && i + 1 < argc && strcmp(argv[i + 1], "indirect") == 0) {
+            drawMode = DRAW_INDIRECT;
+            ++i;
+        }
+        else if (strcmp(argv[i], "-draw") == 0 && i + 1 < argc && strcmp(argv[i + 1], "subsets") == 0) {
+            drawMode = DRAW_SUBSETS;
+            ++i;
+        }
+        else if (strcmp(argv[i], "-cull") == 0)
+            cullSubsets = 1;
+        else if (strcmp(argv[i], "-shadercache") == 0 && i + 1 < argc) {
+            shaderCacheDir = argv[++i];
+            if (strcmp(shaderCacheDir, "none") == 0)
+                shaderCacheDir = NULL;
+        }
+        else if (strcmp(argv[i], "-trajectory") == 0 && i + 1 < argc)
+            trajectoryFileName = argv[++i];
+        else if (strcmp(argv[i], "-fps") == 0 && i + 1 < argc)
+            frameRate = atof(argv[++i]);
+        else if (strcmp(argv[i], "-reproject") == 0 && i + 1 < argc) {
+            tolerance = (float)atof(argv[++i]);
+            reproject = 1;
+        }
+        else if (strcmp(argv[i], "-refresh") == 0 && i + 1 < argc)
+            refreshInterval = atoi(argv[++i]);
+        else if (strcmp(argv[i], "-tile") == 0 && i + 1 < argc)
+            tileSize = atoi(argv[++i]);
+        else if (strcmp(argv[i], "-verify") == 0)
+            verify = 1;
+        else if (strcmp(argv[i], "-pack") == 0)
+            pack = 1;
+        else if (strcmp(argv[i], "-image") == 0 && i + 1 < argc) {
+            if (sscanf(argv[++i], "%dx%d", &imageWidth, &imageHeight) == 1)
+                imageHeight = imageWidth;
+        }
+        else if (argv[i][0] != '-' && meshFileName == NULL)
+            meshFileName = argv[i];
+        else {
+            printf("Usage: OutputDepthMap [-size 640x480] [-frames 8] [-pbos 3] [-out prefix]\n"
+                   "                      [-draw indirect|subsets] [-cull] [-shadercache dir|none]\n"
+                   "                      [-trajectory file] [-fps 30]\n"
+                   "                      [-reproject tolerance] [-refresh 10] [-tile 32] [-verify]\n"
+                   "                      [-pack] [-image 32768x32768 -out prefix]\n"
+                   "                      [mesh.obj]\n");
+            return 1;
+        }
+    }
+ 
+    // Without a trajectory the camera orbits the mesh in frameCount steps
+    CDXUTTrajectory trajectory;
+    if (trajectoryFileName) {
+        if (!trajectory.Load(trajectoryFileName) || trajectory.GetNumKeys() == 0 || !(frameRate > 0.0)) {
+            printf("Could not read %s, or -fps is not positive\n", trajectoryFileName);
+            return 1;
+        }
+        if (frameCount <= 0)
+            frameCount = trajectory.GetNumFrames(frameRate);
+        printf("%s: %u keys, %d frames at %g fps\n", trajectoryFileName, trajectory.GetNumKeys(), frameCount,
+               frameRate);
+    }
+    if (frameCount <= 0)
+        frameCount = meshFileName ? 8 : 1;
+    if (ringSize < 1 || ringSize > MAX_PIXEL_BUFFERS || w <= 0 || h <= 0) {
+        printf("Invalid -size or -pbos (1 to %d)\n", MAX_PIXEL_BUFFERS);
+        return 1;
+    }
+ 
+    // -image draws one image of that size, in tiles of -size, to a TIFF;
+    // TIFF tiles are multiples of 16 pixels across
+    int tiled = imageWidth != 0 || imageHeight != 0;
+    if (tiled && (imageWidth <= 0 || imageHeight <= 0 || w % 16 != 0 || h % 16 != 0 || outputPrefix == NULL ||
+                  reproject)) {
+        printf("-image needs -out, a -size that is a multiple of 16 and no -reproject\n");
+        return 1;
+    }
+ 
+    // -pack writes the frames to one sequence file, with their cameras,
+    // in place of a file each
+    CDXUTDepthSequenceWriter sequence;
+    if (pack && !tiled) {
+        char fn[1024];
+        sprintf(fn, "%.1000s.dsq", outputPrefix ? outputPrefix : "depth");
+        if (tileSize < 1 || !sequence.Create(fn, w, h, tileSize)) {
+            printf("Could not create %s\n", fn);
+            return 1;
+        }
+        printf("Writing %s in %dx%d tiles\n", fn, tileSize, tileSize);
+    }
+ 
+    CDXUTDepthReprojector reprojector;
+    if (reproject) {
+        if (refreshInterval < 1 || tileSize < 1 || !reprojector.Create(w, h, tileSize, tolerance)) {
+            printf("Invalid -reproject, -refresh or -tile\n");
+            return 1;
+        }
+        printf("Reprojecting with %dx%d tiles, %g tolerance, full frame every %d\n", tileSize, tileSize,
+               tolerance, refreshInterval);
+    }
+    // -verify draws each frame again when it is read back, with the camera
+    // it was drawn with
+    if (verify && !reproject)
+        verify = 0;
+    if (verify || (ringSize > frameCount && !tiled))
+        ringSize = verify ? 1 : frameCount;
+ 
+    CDXUTObjGeometry mesh;
+    float center[3] = { 0.0f, 0.0f, 0.0f }, radius = 1.0f;
+    if (meshFileName) {
+        if (!mesh.Load(meshFileName)) {
+            printf("Could not read %s\n", meshFileName);
+            return 1;
+        }
+        float minCorner[3], maxCorner[3];
+        meshBounds(&mesh, minCorner, maxCorner);
+        float d[3];
+        for (int k = 0; k < 3; ++k) {
+            center[k] = 0.5f * (minCorner[k] + maxCorner[k]);
+            d[k] = maxCorner[k] - center[k];
+        }
+        radius = sqrtf(d[0] * d[0] + d[1] * d[1] + d[2] * d[2]) + 1e-3f;
+        printf("%s: %u vertices, %u triangles\n", meshFileName, mesh.GetNumVertices(), mesh.GetNumIndices() / 3);
+    }
+ 
+    if (!initHeadlessContext()) {
+        releaseHeadlessContext();
+        return 1;
+    }
+ 
+    fragmentFileName = "depth.frag";
+    std::chrono::steady_clock::time_point shaderStart = std::chrono::steady_clock::now();
+    p = setupShaders();
+    printf("Program ready in %.1f ms\n", elapsedMs(shaderStart));
+    if (!setupDepthTarget(w, h)) {
+        printf("Float framebuffer not supported\n");
+        releaseHeadlessContext();
+        return 1;
+    }
+    int frameBytes = w * h * sizeof(float);
+    setupPixelBuffers(ringSize, frameBytes);
+    if (meshFileName) {
+        // glMultiDrawElementsIndirect is core in 4.3
+        GLint glMajor = 0, glMinor = 0;
+        glGetIntegerv(GL_MAJOR_VERSION, &glMajor);
+        glGetIntegerv(GL_MINOR_VERSION, &glMinor);
+        if (drawMode == DRAW_INDIRECT && glMajor * 10 + glMinor < 43) {
+            printf("No multi-draw-indirect in OpenGL %d.%d, drawing subsets one at a time\n", glMajor, glMinor);
+            drawMode = DRAW_SUBSETS;
+        }
+        setupMesh(&mesh);
+        mesh.Release();
+        printf("%d subsets, %s%s\n", subsetCount,
+               drawMode == DRAW_INDIRECT ? "one indirect draw per frame" : "one draw per subset",
+               cullSubsets ? ", culled on the CPU" : "");
+    }
+    else
+        setupBuffers();
+ 
+    glEnable(GL_DEPTH_TEST);
+    glClearColor(0.0, 0.0, 0.0, 0.0);
+    glUseProgram(p);
+ 
+    float ratio = (1.0f * w) / h;
+    if (tiled) {
+        // The first frame's camera, seeing the whole image
+        float imageRatio = (1.0f * imageWidth) / imageHeight;
+        if (trajectoryFileName)
+            setTrajectoryCamera(&trajectory, 0, frameRate, imageRatio);
+        else if (meshFileName)
+            setOrbitCamera(0, frameCount, imageRatio, center, radius);
+        else
+            setDemoCamera(imageRatio);
+        char fn[1024];
+        sprintf(fn, "%.1000s.tif", outputPrefix);
+        int ok = renderTiledImage(fn, imageWidth, imageHeight, w, h, ringSize, meshFileName != NULL);
+        printOpenGLError();
+        releaseScene(meshFileName != NULL, ringSize);
+        return ok ? 0 : 1;
+    }
+ 
+    double waitMs = 0.0, drawMs = 0.0, verifyMs = 0.0;
+    int subsetsDrawn[MAX_PIXEL_BUFFERS], tilesDrawn[MAX_PIXEL_BUFFERS], rectsDrawn[MAX_PIXEL_BUFFERS];
+    DXUT_CAMERA_KEY frameCameras[MAX_PIXEL_BUFFERS];
+    int ok = 1;
+ 
+    // The last frame drawn in full and its camera
+    float *keyDepth = NULL, *referenceDepth = NULL;
+    DXUTMATRIX4 viewProj, keyViewProj;
+    int reprojectedFrames = 0, totalTiles = 0, totalErrors = 0, totalEdgeErrors = 0;
+    float worstError = 0.0f;
+    if (reproject) {
+        keyDepth = (float *)malloc(frameBytes);
+        referenceDepth = verify ? (float *)malloc(frameBytes) : NULL;
+    }
+ 
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+ 
+    // Frame i is drawn on iteration i and written out on iteration
+    // i + ringSize - 1, once the frames after it have been queued
+    for (int frame = 0; ok && frame < frameCount + ringSize - 1; ++frame) {
+ 
+        if (frame < frameCount) {
+            int slot = frame % ringSize;
+ 
+            if (trajectoryFileName)
+                setTrajectoryCamera(&trajectory, frame, frameRate, 0.0f);
+            else if (meshFileName)
+                setOrbitCamera(frame, frameCount, ratio, center, radius);
+            else
+                setDemoCamera(ratio);
+            if (!trajectoryFileName)
+                cameraKey.fTime = frame / frameRate;
+            frameCameras[slot] = cameraKey;
+            setUniforms();
+            DXUTMatrixMultiply(&viewProj, &viewMatrix, &projMatrix);
+ 
+            std::chrono::steady_clock::time_point drawStart = std::chrono::steady_clock::now();
+            tilesDrawn[slot] = rectsDrawn[slot] = -1;
+            if (reproject && frame % refreshInterval != 0) {
+                subsetsDrawn[slot] = drawReprojected(&reprojector, keyDepth, &keyViewProj, &viewProj,
+                                                     meshFileName != NULL, &tilesDrawn[slot], &rectsDrawn[slot]);
+                totalTiles += tilesDrawn[slot];
+                ++reprojectedFrames;
+            }
+            else {
+                glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+                subsetsDrawn[slot] = drawScene(meshFileName != NULL, &viewProj, 0);
+ 
+                // The next frame is warped from this one, so it can't wait
+                // for the ring
+                if (reproject) {
+                    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+                    glReadPixels(0, 0, w, h, GL_RED, GL_FLOAT, keyDepth);
+                    keyViewProj = viewProj;
+                    drawnRects.clear();
+                    drawnDepth.clear();
+                }
+            }
+            drawMs += elapsedMs(drawStart);
+ 
+            glBindBuffer(GL_PIXEL_PACK_BUFFER, pixelBuffers[slot]);
+            glReadPixels(0, 0, w, h, GL_RED, GL_FLOAT, 0);
+            pixelFences[slot] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+            glFlush();
+        }
+ 
+        int done = frame - (ringSize - 1);
+        if (done < 0)
+            continue;
+ 
+        int slot = done % ringSize;
+        std::chrono::steady_clock::time_point waitStart = std::chrono::steady_clock::now();
+        while (glClientWaitSync(pixelFences[slot], GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000) == GL_TIMEOUT_EXPIRED)
+            ;
+        glDeleteSync(pixelFences[slot]);
+        pixelFences[slot] = 0;
+        waitMs += elapsedMs(waitStart);
+ 
+        // Draws the frame again in full to compare; not counted in the timings
+        if (verify && tilesDrawn[slot] >= 0) {
+            std::chrono::steady_clock::time_point verifyStart = std::chrono::steady_clock::now();
+            glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+            glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+            drawScene(meshFileName != NULL, &viewProj, 0);
+            glReadPixels(0, 0, w, h, GL_RED, GL_FLOAT, referenceDepth);
+            verifyMs += elapsedMs(verifyStart);
+        }
+ 
+        waitStart = std::chrono::steady_clock::now();
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, pixelBuffers[slot]);
+        const float *depth = (const float *)glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, frameBytes, GL_MAP_READ_BIT);
+        waitMs += elapsedMs(waitStart);
+        if (depth == NULL) {
+            printf("Could not map the readback buffer\n");
+            ok = 0;
+            break;
+        }
+ 
+        int covered = 0;
+        float nearest = 0.0f, farthest = 0.0f;
+        for (int i = 0; i < w * h; ++i) {
+            if (depth[i] > 0.0f) {
+                if (covered == 0 || depth[i] < nearest) nearest = depth[i];
+                if (covered == 0 || depth[i] > farthest) farthest = depth[i];
+                ++covered;
+            }
+        }
+        if (meshFileName)
+            printf("frame %d: %d of %d subsets drawn, %d pixels covered, depth %.4f to %.4f",
+                   done, subsetsDrawn[slot], subsetCount, covered, nearest, farthest);
+        else
+            printf("frame %d: %d pixels covered, depth %.4f to %.4f", done, covered, nearest, farthest);
+        if (tilesDrawn[slot] >= 0)
+            printf(", %d of %d tiles redrawn in %d rects\n", tilesDrawn[slot], reprojector.GetNumTiles(),
+                   rectsDrawn[slot]);
+        else
+            printf("\n");
+ 
+        if (sequence.IsOpen()) {
+            if (!sequence.AddFrame(depth, w, &frameCameras[slot])) {
+                printf("Could not add frame %d to the sequence\n", done);
+                ok = 0;
+            }
+        }
+        else if (outputPrefix) {
+            char fn[1024];
+            sprintf(fn, "%.1000s_%04d.pfm", outputPrefix, done);
+            if (!writeDepthFile(fn, depth, w, h)) {
+                printf("Could not write %s\n", fn);
+                ok = 0;
+            }
+        }
+        if (verify && tilesDrawn[slot] >= 0) {
+            std::chrono::steady_clock::time_point verifyStart = std::chrono::steady_clock::now();
+            int edgeErrors;
+            float maxError;
+            int errors = countDepthErrors(depth, referenceDepth, w, h, tolerance, &edgeErrors, &maxError);
+            printf("frame %d: %d pixels off by more than %g (%d of them at depth edges), largest error %.5f\n",
+                   done, errors, tolerance, edgeErrors, maxError);
+            totalErrors += errors;
+            totalEdgeErrors += edgeErrors;
+            worstError = fmaxf(worstError, maxError);
+            verifyMs += elapsedMs(verifyStart);
+        }
+        glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+ 
+    double totalMs = elapsedMs(start) - verifyMs;
+    printf("%d frames at %dx%d in %.1f ms (%.2f ms per frame, %.1f ms waiting on readback, %d PBOs)\n",
+           frameCount, w, h, totalMs, totalMs / frameCount, waitMs, ringSize);
+    if (meshFileName)
+        printf("%.3f ms per frame culling and submitting draws\n", drawMs / frameCount);
+    if (reproject)
+        printf("%d of %d frames reprojected, %.1f%% of their tiles redrawn\n", reprojectedFrames, frameCount,
+               reprojectedFrames ? 100.0 * totalTiles / ((double)reprojectedFrames * reprojector.GetNumTiles()) : 0.0);
+    if (verify)
+        printf("%d pixels off by more than %g in all (%d of them at depth edges), largest error %.5f\n",
+               totalErrors, tolerance, totalEdgeErrors, worstError);
+    if (sequence.IsOpen())
+        printf("%u frames packed in %.1f MB, %.1f%% of their raw size\n", sequence.GetNumFrames(),
+               sequence.GetCompressedSize() / 1048576.0,
+               100.0 * sequence.GetCompressedSize() / (double)sequence.GetRawSize());
+    sequence.Close();
+    printOpenGLError();
+ 
+    free(keyDepth);
+    free(referenceDepth);
+ 
+    releaseScene(meshFileName != NULL, ringSize);
+    return ok ? 0 : 1;
+}
+ 
+int main(int argc, char **argv) {
+ 
+    return runHeadless(argc, argv);
+}
+ 
+#else
+ 
 int main(int argc, char **argv) {
     glutInit(&argc, argv);
     glutInitDisplayMode(GLUT_DEPTH | GLUT_DOUBLE | GLUT_RGBA);
@@ -421,4 +1584,6 @@ int main(int argc, char **argv) {
     glutMainLoop();
  
     return(0); 
-}
\ No newline at end of file
+}
+ 
+#endif
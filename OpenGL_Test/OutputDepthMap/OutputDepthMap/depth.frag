@@ -0,0 +1,9 @@
+#version 150
+
+out float outputF;
+
+void main()
+{
+    // 1 / w is the distance along the view axis, the same units as the mesh
+    outputF = 1.0 / gl_FragCoord.w;
+}